@@ -11,6 +11,13 @@
 #include "assets/lang_config.h"
 #include "mcp_server.h"
 #include "audio_debugger.h"
+#include "power_governor.h"
+#include "metrics.h"
+#include "trace.h"
+#include "boot_sequence.h"
+#include "local_command_router.h"
+#include "tts_cache.h"
+#include "opus_decode_rate.h"
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "afe_audio_processor.h"
@@ -20,6 +27,9 @@
 
 #if CONFIG_USE_AFE_WAKE_WORD
 #include "afe_wake_word.h"
+#if CONFIG_USE_LOCAL_COMMANDS
+#include "multinet_command_recognizer.h"
+#endif
 #elif CONFIG_USE_ESP_WAKE_WORD
 #include "esp_wake_word.h"
 #else
@@ -28,6 +38,7 @@
 
 #include <cstring>
 #include <esp_log.h>
+#include <esp_heap_caps.h>
 #include <cJSON.h>
 #include <driver/gpio.h>
 #include <arpa/inet.h>
@@ -147,6 +158,10 @@ void Application::CheckNewVersion(Ota& ota) {
 
             auto& board = Board::GetInstance();
             board.SetPowerSaveMode(false);
+            // 启动时唤醒词阶段可能仍在初始化，等它完成后再停止检测
+            if (auto boot = boot_sequence_.load()) {
+                boot->WaitFor("wake_word");
+            }
             wake_word_->StopDetection();
             // 预先关闭音频输出，避免升级过程有音频操作
             auto codec = board.GetAudioCodec();
@@ -208,6 +223,32 @@ void Application::CheckNewVersion(Ota& ota) {
     }
 }
 
+// 按缓存启动后重新检查版本和配置，有新固件、需要激活或协议类型变化时在待机状态下重启，
+// 缓存已被清除或更新，重启后走正常的检查流程。只有令牌、地址等参数变化时不重启，
+// 新参数已写入 NVS，协议在下次打开音频通道时读取
+void Application::RevalidateConfig() {
+    const int MAX_RETRY = 3;
+    Ota ota;
+    for (int i = 0; i < MAX_RETRY; i++) {
+        if (ota.CheckVersion()) {
+            if (ota.HasServerTime()) {
+                has_server_time_ = true;
+            }
+            if (ota.RequiresRestart()) {
+                ESP_LOGI(TAG, "Firmware or activation changed, restart when idle");
+                restart_pending_ = true;
+            } else if (ota.HasConfigChanged()) {
+                ESP_LOGI(TAG, "Protocol settings updated, applied when the audio channel opens");
+            } else {
+                ESP_LOGI(TAG, "Cached config is up to date");
+            }
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10000 << i));
+    }
+    ESP_LOGW(TAG, "Failed to revalidate config, keep using cached config");
+}
+
 // void Application::ShowActivationCode(const std::string& code, const std::string& message) {
 //     struct digit_sound {
 //         char digit;
@@ -337,12 +378,14 @@ void Application::PlaySound(const std::string_view& sound) {
 
         std::lock_guard<std::mutex> lock(mutex_);
         audio_decode_queue_.emplace_back(std::move(packet));
+        audio_decode_cv_.notify_all();
     }
 }
 
 void Application::EnterAudioTestingMode() {
     ESP_LOGI(TAG, "Entering audio testing mode");
     ResetDecoder();
+    opus_encoder_->Reset();
     SetDeviceState(kDeviceStateAudioTesting);
 }
 
@@ -452,16 +495,136 @@ void Application::StopListening() {
 }
 
 void Application::Start() {
-    auto& board = Board::GetInstance();
+#if CONFIG_USE_TRACE
+    Trace::Initialize();
+#endif
     SetDeviceState(kDeviceStateStarting);
 
     /* Setup the display */
+    auto& board = Board::GetInstance();
     auto display = board.GetDisplay();
 
+    /* 之后的状态切换由功耗调度器调整 CPU 频率、模组省电和屏幕刷新率 */
+    auto& governor = PowerGovernor::GetInstance();
+    governor.Start(device_state_);
+    OnDeviceStateChanged([&governor](DeviceState previous_state, DeviceState current_state) {
+        governor.SetDeviceState(current_state);
+    });
+
+    /* Start the clock timer to update the status bar */
+    esp_timer_start_periodic(clock_timer_handle_, 1000000);
+
+    // 启动阶段按依赖并行：唤醒词模型加载与联网、版本检查同时进行。
+    // 配网模式会播放提示音，所以网络在音频编解码初始化之后启动
+    Ota ota;
+    bool protocol_started = false;
+    BootSequence boot;
+    boot.AddStage("audio", {}, [this]() {
+        InitializeAudio();
+    });
+    boot.AddStage("network", { "audio" }, [&board, display]() {
+        board.StartNetwork();
+        // Update the status bar immediately to show the network state
+        display->UpdateStatusBar(true);
+    }, 4096 * 2);
+    boot.AddStage("wake_word", { "audio" }, [this, &boot]() {
+        InitializeAudioFrontend();
+        // 与联网、版本检查中的状态切换串行判断，配网或升级时不开始检测
+        boot.Dispatch([this]() {
+            if (device_state_ != kDeviceStateWifiConfiguring && device_state_ != kDeviceStateUpgrading) {
+                wake_word_->StartDetection();
+            }
+        });
+        BootProfiler::GetInstance().Mark("wake_word_ready");
+    }, 4096 * 2);
+    // Check for new firmware version or get the MQTT broker address
+    bool config_cached = false;
+    boot.AddStage("ota", { "network" }, [this, &ota, &config_cached]() {
+#if CONFIG_USE_OTA_CONFIG_CACHE
+        // 有上次的检查结果时直接按缓存启动，进入待机后在后台重新检查
+        if (ota.LoadCachedConfig()) {
+            config_cached = true;
+            xEventGroupSetBits(event_group_, CHECK_NEW_VERSION_DONE_EVENT);
+            return;
+        }
+#endif
+        CheckNewVersion(ota);
+    }, 4096 * 2);
+    boot.AddStage("protocol", { "ota" }, [this, &ota, &protocol_started]() {
+        protocol_started = InitializeProtocol(ota);
+    });
+    // boot 在 Start 中一直有效（之后进入主循环不再返回），Run 返回后的 Dispatch 直接执行
+    boot_sequence_ = &boot;
+    boot.Run();
+    boot_sequence_ = nullptr;
+
+    // Wait for the new version check to finish
+    xEventGroupWaitBits(event_group_, CHECK_NEW_VERSION_DONE_EVENT, pdTRUE, pdFALSE, portMAX_DELAY);
+    SetDeviceState(kDeviceStateIdle);
+
+    has_server_time_ = ota.HasServerTime();
+    if (protocol_started) {
+        std::string message = std::string(Lang::Strings::VERSION) + ota.GetCurrentVersion();
+        // display->ShowNotification(message.c_str());
+        display->SetChatMessage("system", "");
+        // Play the success sound to indicate the device is ready
+        ResetDecoder();
+        PlaySound(Lang::Sounds::P3_SUCCESS);
+    }
+    BootProfiler::GetInstance().Mark("ready");
+    BootProfiler::GetInstance().PrintReport();
+
+    if (config_cached) {
+        xTaskCreate([](void* arg) {
+            Application* app = (Application*)arg;
+            app->RevalidateConfig();
+            app->check_new_version_task_handle_ = nullptr;
+            vTaskDelete(NULL);
+        }, "check_new_version", 4096 * 2, this, 2, &check_new_version_task_handle_);
+    }
+
+    // Print heap stats
+    SystemInfo::PrintHeapStats();
+    
+    // Enter the main event loop
+    MainEventLoop();
+}
+
+void Application::InitializeAudio() {
+    auto& board = Board::GetInstance();
+
     /* Setup the audio codec */
     auto codec = board.GetAudioCodec();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+    playback_ = std::make_unique<PlaybackPipeline>(mutex_, audio_decode_cv_, audio_decode_queue_, background_task_,
+        AUDIO_PCM_FIFO_SLOTS, codec->output_sample_rate() * OPUS_FRAME_DURATION_MS / 1000);
+    playback_->OnPrepareDecode([this](const AudioStreamPacket& packet) {
+        SetDecodeSampleRate(packet.sample_rate, packet.frame_duration);
+    });
+    playback_->OnDecode([this, codec](AudioStreamPacket&& packet, PcmSlot* slot) {
+        return !aborted_ && DecodePacket(codec, std::move(packet), slot);
+    });
+    playback_->OnOutput([this, codec](PcmSlot* slot) {
+        {
+            TRACE_SCOPE("i2s.write");
+            audio_debugger_->Feed(kAudioDebugTapOutput, slot->pcm, codec->output_sample_rate());
+            codec->OutputData(slot->pcm);
+        }
+        // 解码完成到这一帧最后一个采样从喇叭播出：排队和写入 DMA 的时间加上 DMA 中尚未播放的数据
+        static auto speaker_latency = Metrics::GetInstance().Histogram("audio.decoder_to_speaker_us",
+            { 20000, 50000, 100000, 200000, 400000 });
+        speaker_latency->Record(esp_timer_get_time() - slot->decoded_us + codec->GetOutputPendingUs());
+#ifdef CONFIG_USE_SERVER_AEC
+        playout_clock_.OnRender(slot->timestamp, slot->pcm.size(), codec->output_sample_rate(),
+            esp_timer_get_time(), codec->GetOutputPendingUs());
+#endif
+        last_output_time_ = std::chrono::steady_clock::now();
+    });
+    playback_->OnQueryOutputPending([codec]() {
+        return codec->GetOutputPendingUs();
+    });
+    SetDecodeSampleRate(16000, OPUS_FRAME_DURATION_MS);
+    opus_encoder_ = std::make_unique<OpusFrameEncoder>(16000, OPUS_FRAME_DURATION_MS);
     if (aec_mode_ != kAecOff) {
         ESP_LOGI(TAG, "AEC mode: %d, setting opus encoder complexity to 0", aec_mode_);
         opus_encoder_->SetComplexity(0);
@@ -474,38 +637,42 @@ void Application::Start() {
     }
 
     if (codec->input_sample_rate() != 16000) {
-        input_resampler_.Configure(codec->input_sample_rate(), 16000);
-        reference_resampler_.Configure(codec->input_sample_rate(), 16000);
+        // 双声道时麦克风与回采参考交错输入，同一个重采样器一次处理
+        input_resampler_.Configure(codec->input_sample_rate(), 16000, codec->input_channels());
     }
     codec->Start();
 
+    // 输出任务会立即用到调试器，需在创建音频任务之前创建
+    audio_debugger_ = std::make_unique<AudioDebugger>();
+
 #if CONFIG_USE_AUDIO_PROCESSOR
     xTaskCreatePinnedToCore([](void* arg) {
         Application* app = (Application*)arg;
-        app->AudioLoop();
+        app->AudioInputLoop();
         vTaskDelete(NULL);
-    }, "audio_loop", 4096 * 2, this, 8, &audio_loop_task_handle_, 1);
+    }, "audio_input", 4096 * 2, this, 8, &audio_input_task_handle_, 1);
 #else
     xTaskCreate([](void* arg) {
         Application* app = (Application*)arg;
-        app->AudioLoop();
+        app->AudioInputLoop();
         vTaskDelete(NULL);
-    }, "audio_loop", 4096 * 2, this, 8, &audio_loop_task_handle_);
+    }, "audio_input", 4096 * 2, this, 8, &audio_input_task_handle_);
 #endif
+    xTaskCreate([](void* arg) {
+        Application* app = (Application*)arg;
+        app->AudioOutputLoop();
+        vTaskDelete(NULL);
+    }, "audio_output", 4096, this, 7, &audio_output_task_handle_);
 
-    /* Start the clock timer to update the status bar */
-    esp_timer_start_periodic(clock_timer_handle_, 1000000);
-
-    /* Wait for the network to be ready */
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    board.StartNetwork();
-
-    // Update the status bar immediately to show the network state
-    display->UpdateStatusBar(true);
+    // 音频消费者（唤醒词、音频处理器）随设备状态启停，状态变化时唤醒采集任务重新检查
+    OnDeviceStateChanged([this](DeviceState previous_state, DeviceState current_state) {
+        xTaskNotifyGive(audio_input_task_handle_);
+    });
+}
 
-    // Check for new firmware version or get the MQTT broker address
-    Ota ota;
-    CheckNewVersion(ota);
+bool Application::InitializeProtocol(Ota& ota) {
+    auto codec = Board::GetInstance().GetAudioCodec();
+    auto display = Board::GetInstance().GetDisplay();
 
     // Initialize the protocol
     display->SetStatus(Lang::Strings::LOADING_PROTOCOL);
@@ -514,6 +681,9 @@ void Application::Start() {
 #if CONFIG_IOT_PROTOCOL_MCP
     McpServer::GetInstance().AddCommonTools();
 #endif
+#if CONFIG_USE_TTS_CACHE
+    TtsCache::GetInstance().Initialize();
+#endif
 
     if (ota.HasMqttConfig()) {
         protocol_ = std::make_unique<MqttProtocol>();
@@ -529,16 +699,31 @@ void Application::Start() {
         Alert(Lang::Strings::ERROR, message.c_str(), "sad", Lang::Sounds::P3_EXCLAMATION);
     });
     protocol_->OnIncomingAudio([this](AudioStreamPacket&& packet) {
+        TRACE_INSTANT("audio.incoming");
+        static auto decode_dropped = Metrics::GetInstance().Counter("audio.decode_dropped");
+        static auto decode_queue = Metrics::GetInstance().Gauge("audio.decode_queue");
+#if CONFIG_USE_TTS_CACHE
+        TtsCache::GetInstance().AppendFrame(packet);
+#endif
         std::lock_guard<std::mutex> lock(mutex_);
-        if (device_state_ == kDeviceStateSpeaking && audio_decode_queue_.size() < MAX_AUDIO_PACKETS_IN_QUEUE) {
-            audio_decode_queue_.emplace_back(std::move(packet));
+#if CONFIG_USE_TTS_CACHE
+        next_downlink_timestamp_ = packet.timestamp + packet.frame_duration;
+#endif
+        if (device_state_ == kDeviceStateSpeaking) {
+            if (audio_decode_queue_.size() < MAX_AUDIO_PACKETS_IN_QUEUE) {
+                audio_decode_queue_.emplace_back(std::move(packet));
+                audio_decode_cv_.notify_all();
+            } else {
+                decode_dropped->Increment();
+            }
+            decode_queue->Set(audio_decode_queue_.size());
         }
     });
-    protocol_->OnAudioChannelOpened([this, codec, &board]() {
-        board.SetPowerSaveMode(false);
-        if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
-            ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
-                protocol_->server_sample_rate(), codec->output_sample_rate());
+    protocol_->OnAudioChannelOpened([this, codec]() {
+        // 输出采样率是 Opus 支持的采样率时按输出采样率解码，只有其他采样率（如 44.1k）才在解码后重采样
+        if (!IsOpusDecodeSampleRate(codec->output_sample_rate())) {
+            ESP_LOGI(TAG, "Device output sample rate %d is not an Opus decode rate, resampling from %d",
+                codec->output_sample_rate(), protocol_->server_sample_rate());
         }
 
 #if CONFIG_IOT_PROTOCOL_XIAOZHI
@@ -550,8 +735,10 @@ void Application::Start() {
         }
 #endif
     });
-    protocol_->OnAudioChannelClosed([this, &board]() {
-        board.SetPowerSaveMode(true);
+    protocol_->OnAudioChannelClosed([this]() {
+#if CONFIG_USE_TTS_CACHE
+        TtsCache::GetInstance().CancelSentence();
+#endif
         Schedule([this]() {
             auto display = Board::GetInstance().GetDisplay();
             display->SetChatMessage("system", "");
@@ -571,7 +758,20 @@ void Application::Start() {
                     }
                 });
             } else if (strcmp(state->valuestring, "stop") == 0) {
+#if CONFIG_USE_TTS_CACHE
+                TtsCache::GetInstance().EndSentence();
+#endif
                 Schedule([this]() {
+#if CONFIG_USE_TTS_CACHE
+                    // 命中缓存的句子在服务端发出 stop 时还有最后一段没有播完，等播放队列排空再切换状态
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        audio_decode_cv_.wait_for(lock, std::chrono::seconds(3), [this]() {
+                            return aborted_ || device_state_ != kDeviceStateSpeaking ||
+                                (audio_decode_queue_.empty() && tts_cache_queue_.empty());
+                        });
+                    }
+#endif
                     background_task_->WaitForCompletion();
                     if (device_state_ == kDeviceStateSpeaking) {
                         if (listening_mode_ == kListeningModeManualStop) {
@@ -589,6 +789,9 @@ void Application::Start() {
                         display->SetChatMessage("assistant", message.c_str());
                     });
                 }
+#if CONFIG_USE_TTS_CACHE
+                OnTtsSentenceStart(root);
+#endif
             }
         } else if (strcmp(type->valuestring, "stt") == 0) {
             auto text = cJSON_GetObjectItem(root, "text");
@@ -649,46 +852,23 @@ void Application::Start() {
             ESP_LOGW(TAG, "Unknown message type: %s", type->valuestring);
         }
     });
-    bool protocol_started = protocol_->Start();
+    return protocol_->Start();
+}
 
-    audio_debugger_ = std::make_unique<AudioDebugger>();
+void Application::InitializeAudioFrontend() {
+    auto codec = Board::GetInstance().GetAudioCodec();
     audio_processor_->Initialize(codec);
-    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
-                ESP_LOGW(TAG, "Too many audio packets in queue, drop the newest packet");
-                return;
-            }
+    audio_processor_->OnOutput([this](const int16_t* data, size_t samples) {
+        audio_debugger_->Feed(kAudioDebugTapAfeOutput, data, samples, 16000);
+        // 本段最后一个采样的采集时间取最近一次 RX DMA 完成时间，不含 AFE 内部缓存
+        int64_t capture_end_us = last_capture_time_us_;
+        // 攒满一帧才需要编码，已有编码任务在排队时由它一并处理
+        if (!opus_encoder_->Write(data, samples, capture_end_us) || encode_pending_.exchange(true)) {
+            return;
         }
-        background_task_->Schedule([this, data = std::move(data)]() mutable {
-            opus_encoder_->Encode(std::move(data), [this](std::vector<uint8_t>&& opus) {
-                AudioStreamPacket packet;
-                packet.payload = std::move(opus);
-#ifdef CONFIG_USE_SERVER_AEC
-                {
-                    std::lock_guard<std::mutex> lock(timestamp_mutex_);
-                    if (!timestamp_queue_.empty()) {
-                        packet.timestamp = timestamp_queue_.front();
-                        timestamp_queue_.pop_front();
-                    } else {
-                        packet.timestamp = 0;
-                    }
-
-                    if (timestamp_queue_.size() > 3) { // 限制队列长度3
-                        timestamp_queue_.pop_front(); // 该包发送前先出队保持队列长度
-                        return;
-                    }
-                }
-#endif
-                std::lock_guard<std::mutex> lock(mutex_);
-                if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
-                    ESP_LOGW(TAG, "Too many audio packets in queue, drop the oldest packet");
-                    audio_send_queue_.pop_front();
-                }
-                audio_send_queue_.emplace_back(std::move(packet));
-                xEventGroupSetBits(event_group_, SEND_AUDIO_EVENT);
-            });
+        int64_t capture_us = capture_end_us - (int64_t)samples * 1000000 / 16000;
+        background_task_->Schedule([this, capture_us]() {
+            EncodeUplinkFrames(capture_us);
         });
     });
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -706,6 +886,14 @@ void Application::Start() {
     });
 
     wake_word_->Initialize(codec);
+#if CONFIG_USE_LOCAL_COMMANDS
+    auto recognizer = std::make_unique<MultinetCommandRecognizer>();
+    if (recognizer->Initialize() && recognizer->SetCommands(LocalCommandRouter::GetPhrases(recognizer->GetLanguage()))) {
+        command_recognizer_ = std::move(recognizer);
+    } else {
+        ESP_LOGW(TAG, "Local commands disabled, no usable MultiNet model");
+    }
+#endif
     wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
         Schedule([this, &wake_word]() {
             if (!protocol_) {
@@ -713,33 +901,21 @@ void Application::Start() {
             }
 
             if (device_state_ == kDeviceStateIdle) {
-                wake_word_->EncodeWakeWordData();
-
-                if (!protocol_->IsAudioChannelOpened()) {
-                    SetDeviceState(kDeviceStateConnecting);
-                    if (!protocol_->OpenAudioChannel()) {
-                        wake_word_->StartDetection();
-                        return;
-                    }
-                }
-
-                ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
-#if CONFIG_USE_AFE_WAKE_WORD
-                AudioStreamPacket packet;
-                // Encode and send the wake word data to the server
-                while (wake_word_->GetWakeWordOpus(packet.payload)) {
-                    protocol_->SendAudio(packet);
+                wake_word_time_us_ = esp_timer_get_time();
+#if CONFIG_USE_LOCAL_COMMANDS
+                // 先在本地识别命令词，窗口结束仍没有命令时再建立云端会话
+                if (command_recognizer_ && wake_word_->DetectCommand(command_recognizer_.get(), CONFIG_LOCAL_COMMAND_WINDOW_MS,
+                        [this, wake_word = std::string(wake_word)](int command) {
+                    Schedule([this, wake_word, command]() {
+                        OnLocalCommand(wake_word, command);
+                    });
+                })) {
+                    ESP_LOGI(TAG, "Wake word detected: %s, waiting for local command", wake_word.c_str());
+                    Board::GetInstance().GetDisplay()->SetStatus(Lang::Strings::LISTENING);
+                    return;
                 }
-                // Set the chat state to wake word detected
-                protocol_->SendWakeWordDetected(wake_word);
-#else
-                // Play the pop up sound to indicate the wake word is detected
-                // And wait 60ms to make sure the queue has been processed by audio task
-                ResetDecoder();
-                PlaySound(Lang::Sounds::P3_POPUP);
-                vTaskDelay(pdMS_TO_TICKS(60));
 #endif
-                SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
+                StartWakeWordSession(wake_word);
             } else if (device_state_ == kDeviceStateSpeaking) {
                 AbortSpeaking(kAbortReasonWakeWordDetected);
             } else if (device_state_ == kDeviceStateActivating) {
@@ -747,28 +923,163 @@ void Application::Start() {
             }
         });
     });
+}
+
+void Application::StartWakeWordSession(const std::string& wake_word) {
+    wake_word_->EncodeWakeWordData();
+
+    if (!protocol_->IsAudioChannelOpened()) {
+        SetDeviceState(kDeviceStateConnecting);
+        if (!protocol_->OpenAudioChannel()) {
+            wake_word_->StartDetection();
+            return;
+        }
+    }
+
+    ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
+#if CONFIG_USE_AFE_WAKE_WORD
+    AudioStreamPacket packet;
+    // Encode and send the wake word data to the server
+    while (wake_word_->GetWakeWordOpus(packet.payload)) {
+        protocol_->SendAudio(packet);
+    }
+    // Set the chat state to wake word detected
+    protocol_->SendWakeWordDetected(wake_word);
+#else
+    // Play the pop up sound to indicate the wake word is detected
+    // And wait 60ms to make sure the queue has been processed by audio task
+    ResetDecoder();
+    PlaySound(Lang::Sounds::P3_POPUP);
+    vTaskDelay(pdMS_TO_TICKS(60));
+#endif
+    SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
+}
+
+void Application::OnLocalCommand(const std::string& wake_word, int command) {
+    // 窗口期间已经通过按键等方式进入其他状态
+    if (device_state_ != kDeviceStateIdle || !protocol_) {
+        return;
+    }
+
+    static auto local_commands = Metrics::GetInstance().Counter("command.local");
+    static auto cloud_fallbacks = Metrics::GetInstance().Counter("command.cloud_fallbacks");
+    static auto command_latency = Metrics::GetInstance().Histogram("command.latency_ms",
+        { 300, 600, 1000, 1500, 2000, 3000 });
+
+    auto& board = Board::GetInstance();
+    auto codec = board.GetAudioCodec();
+    auto backlight = board.GetBacklight();
+    LocalCommandState state;
+    state.volume = codec->output_volume();
+    state.brightness = backlight ? backlight->brightness() : -1;
+
+    LocalCommandAction action;
+    if (command < 0 || !LocalCommandRouter::Route(command, state, action)) {
+        cloud_fallbacks->Increment();
+        StartWakeWordSession(wake_word);
+        return;
+    }
+
+    if (!action.stop) {
+        std::string result;
+        auto arguments = cJSON_Parse(LocalCommandRouter::GetArgumentsJson(action).c_str());
+        bool success = McpServer::GetInstance().CallTool(action.tool, arguments, result);
+        cJSON_Delete(arguments);
+        if (!success) {
+            cloud_fallbacks->Increment();
+            StartWakeWordSession(wake_word);
+            return;
+        }
+        if (action.argument == "volume") {
+            board.GetDisplay()->ShowNotification(Lang::Strings::VOLUME + std::to_string(action.value));
+        }
+    }
+    ESP_LOGI(TAG, "Local command %d handled: %s", command, action.stop ? "stop" : action.tool.c_str());
+    local_commands->Increment();
+    command_latency->Record((esp_timer_get_time() - wake_word_time_us_) / 1000);
+    board.GetDisplay()->SetStatus(Lang::Strings::STANDBY);
     wake_word_->StartDetection();
+}
 
-    // Wait for the new version check to finish
-    xEventGroupWaitBits(event_group_, CHECK_NEW_VERSION_DONE_EVENT, pdTRUE, pdFALSE, portMAX_DELAY);
-    SetDeviceState(kDeviceStateIdle);
+#if CONFIG_USE_TTS_CACHE
+// 在网络任务中调用，与下行音频保持同样的顺序
+void Application::OnTtsSentenceStart(const cJSON* root) {
+    auto& cache = TtsCache::GetInstance();
+    cache.EndSentence();
+    auto text = cJSON_GetObjectItem(root, "text");
+    if (!protocol_->server_tts_cache() || !cJSON_IsString(text)) {
+        return;
+    }
+    auto voice = cJSON_GetObjectItem(root, "voice");
+    uint64_t key = TtsCache::MakeKey(cJSON_IsString(voice) ? voice->valuestring : "",
+        protocol_->server_sample_rate(), text->valuestring);
+    if (!cJSON_IsTrue(cJSON_GetObjectItem(root, "cache"))) {
+        cache.BeginSentence(key);
+        return;
+    }
 
-    has_server_time_ = ota.HasServerTime();
-    if (protocol_started) {
-        std::string message = std::string(Lang::Strings::VERSION) + ota.GetCurrentVersion();
-        // display->ShowNotification(message.c_str());
-        display->SetChatMessage("system", "");
-        // Play the success sound to indicate the device is ready
-        ResetDecoder();
-        PlaySound(Lang::Sounds::P3_SUCCESS);
+    // 服务端探测缓存后会等待回复再继续下发，所以在主任务中排在 tts start 之后入队，再回复
+    Schedule([this, key]() {
+        auto& cache = TtsCache::GetInstance();
+        uint32_t timestamp;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timestamp = next_downlink_timestamp_;
+        }
+        std::list<AudioStreamPacket> packets;
+        bool hit = !aborted_ && device_state_ == kDeviceStateSpeaking && cache.Lookup(key, timestamp, packets) &&
+            !packets.empty();
+        if (!hit) {
+            cache.BeginSentence(key);
+            protocol_->SendTtsCacheResult(TtsCache::KeyToString(key), false);
+            return;
+        }
+
+        std::string reply_key;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            next_downlink_timestamp_ = packets.back().timestamp + packets.back().frame_duration;
+            tts_cache_queue_.splice(tts_cache_queue_.end(), packets);
+            tts_cache_reply_key_ = TtsCache::KeyToString(key);
+            reply_key = FeedTtsCacheFrames();
+        }
+        audio_decode_cv_.notify_all();
+        // 整句不长时立即回复，否则由播放任务在缓存音频快播完时回复
+        if (!reply_key.empty()) {
+            protocol_->SendTtsCacheResult(reply_key, true);
+        }
+    });
+}
+
+/*
+ * 调用方需持有 mutex_。把缓存帧移入解码队列，直到队列达到长度上限。
+ * 缓存帧全部入队且剩余不超过半个队列（约 1.2 秒）时取出待发的命中回复，由调用方在锁外发送：
+ * 服务端收到回复才下发下一句，这段时间足够覆盖网络往返，下一句到达时队列也有空位。
+ */
+std::string Application::FeedTtsCacheFrames() {
+    while (!tts_cache_queue_.empty() && audio_decode_queue_.size() < MAX_AUDIO_PACKETS_IN_QUEUE) {
+        audio_decode_queue_.splice(audio_decode_queue_.end(), tts_cache_queue_, tts_cache_queue_.begin());
+    }
+    std::string reply_key;
+    if (tts_cache_queue_.empty() && audio_decode_queue_.size() <= MAX_AUDIO_PACKETS_IN_QUEUE / 2) {
+        reply_key.swap(tts_cache_reply_key_);
     }
+    return reply_key;
+}
 
-    // Print heap stats
-    SystemInfo::PrintHeapStats();
-    
-    // Enter the main event loop
-    MainEventLoop();
+// 清空播放队列时丢弃未入队的缓存帧，服务端仍在等待回复，立即回复让它继续
+void Application::DropTtsCacheFrames() {
+    std::string reply_key;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tts_cache_queue_.clear();
+        reply_key.swap(tts_cache_reply_key_);
+    }
+    if (!reply_key.empty()) {
+        protocol_->SendTtsCacheResult(reply_key, true);
+    }
 }
+#endif
 
 void Application::OnClockTimer() {
     clock_ticks_++;
@@ -776,11 +1087,34 @@ void Application::OnClockTimer() {
     auto display = Board::GetInstance().GetDisplay();
     display->UpdateStatusBar();
 
+#if CONFIG_METRICS_REPORT_INTERVAL > 0
+    if (++metrics_report_ticks_ >= CONFIG_METRICS_REPORT_INTERVAL) {
+        metrics_report_ticks_ = 0;
+        Schedule([this]() {
+            if (protocol_) {
+                protocol_->SendMetrics(Metrics::GetInstance().GetSnapshotJson());
+            }
+        });
+    }
+#endif
+
+    if (restart_pending_ && device_state_ == kDeviceStateIdle) {
+        restart_pending_ = false;
+        Schedule([this]() {
+            Reboot();
+        });
+    }
+
     // Print the debug info every 10 seconds
     if (clock_ticks_ % 10 == 0) {
         // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
         // SystemInfo::PrintTaskList();
         SystemInfo::PrintHeapStats();
+        PowerGovernor::GetInstance().PrintEnergyReport();
+
+        auto& metrics = Metrics::GetInstance();
+        metrics.Gauge("heap.free_sram")->Set(heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+        metrics.Gauge("heap.min_free_sram")->Set(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
 
         // If we have synchronized server time, set the status to clock "HH:MM" if the device is idle
         if (has_server_time_) {
@@ -817,14 +1151,13 @@ void Application::MainEventLoop() {
         auto bits = xEventGroupWaitBits(event_group_, SCHEDULE_EVENT | SEND_AUDIO_EVENT, pdTRUE, pdFALSE, portMAX_DELAY);
 
         if (bits & SEND_AUDIO_EVENT) {
+            TRACE_SCOPE("main.send_audio");
             std::unique_lock<std::mutex> lock(mutex_);
             auto packets = std::move(audio_send_queue_);
             lock.unlock();
-            for (auto& packet : packets) {
-                if (!protocol_->SendAudio(packet)) {
-                    break;
-                }
-            }
+            protocol_->SendAudioFrames(packets);
+            lock.lock();
+            audio_packet_pool_.splice(audio_packet_pool_.end(), packets);
         }
 
         if (bits & SCHEDULE_EVENT) {
@@ -838,93 +1171,164 @@ void Application::MainEventLoop() {
     }
 }
 
-// The Audio Loop is used to input and output audio data
-void Application::AudioLoop() {
+// 采集与播放分成两个任务：采集由 I2S RX DMA 节拍驱动，播放由解码队列驱动，互不等待
+void Application::AudioInputLoop() {
+    while (true) {
+        if (!OnAudioInput()) {
+            // 没有消费者时不读取 I2S，等待设备状态变化；超时兜底处理未经过状态切换的启停
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        }
+    }
+}
+
+void Application::AudioOutputLoop() {
     auto codec = Board::GetInstance().GetAudioCodec();
     while (true) {
-        OnAudioInput();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // 有已解码的帧可播放或可以开始下一帧解码时醒来；空闲时每秒醒来一次，用于长时间无声后关闭输出
+            audio_decode_cv_.wait_for(lock, std::chrono::seconds(1), [this, codec]() {
+                return codec->output_enabled() && (playback_->HasFilled() || playback_->CanDecodeNextPacket());
+            });
+        }
         if (codec->output_enabled()) {
             OnAudioOutput();
         }
     }
 }
 
+// 解码与播放的流水线见 PlaybackPipeline，这里在两帧之间补充缓存帧，并在长时间无声后关闭输出
 void Application::OnAudioOutput() {
-    if (busy_decoding_audio_) {
-        return;
-    }
-
     auto now = std::chrono::steady_clock::now();
     auto codec = Board::GetInstance().GetAudioCodec();
     const int max_silence_seconds = 10;
 
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (audio_decode_queue_.empty()) {
-        // Disable the output if there is no audio data for a long time
-        if (device_state_ == kDeviceStateIdle) {
-            auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - last_output_time_).count();
-            if (duration > max_silence_seconds) {
-                codec->EnableOutput(false);
-            }
-        }
+#if CONFIG_USE_TTS_CACHE
+    std::string reply_key;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reply_key = FeedTtsCacheFrames();
+    }
+    if (!reply_key.empty()) {
+        Schedule([this, reply_key]() {
+            protocol_->SendTtsCacheResult(reply_key, true);
+        });
+    }
+#endif
+
+    if (playback_->Step()) {
         return;
     }
 
-    auto packet = std::move(audio_decode_queue_.front());
-    audio_decode_queue_.pop_front();
-    lock.unlock();
-    audio_decode_cv_.notify_all();
+    // Disable the output if there is no audio data for a long time
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (playback_->Idle() && device_state_ == kDeviceStateIdle) {
+        auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - last_output_time_).count();
+        if (duration > max_silence_seconds) {
+            codec->EnableOutput(false);
+        }
+    }
+}
 
-    // Synchronize the sample rate and frame duration
-    SetDecodeSampleRate(packet.sample_rate, packet.frame_duration);
+bool Application::DecodePacket(AudioCodec* codec, AudioStreamPacket&& packet, PcmSlot* slot) {
+    static auto decode_us = Metrics::GetInstance().Histogram("opus.decode_us",
+        { 1000, 2000, 5000, 10000, 20000, 40000 });
+    int64_t decode_start_us = esp_timer_get_time();
+    TRACE_BEGIN("opus.decode");
+    bool decoded = opus_decoder_->Decode(std::move(packet.payload), slot->pcm);
+    TRACE_END("opus.decode");
+    if (!decoded) {
+        return false;
+    }
+    decode_us->Record(esp_timer_get_time() - decode_start_us);
+    audio_debugger_->Feed(kAudioDebugTapDecoded, slot->pcm, opus_decoder_->sample_rate());
+    // 只有编解码芯片的采样率 Opus 不支持时才需要重采样，缓冲区与槽位交换后继续复用
+    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
+        output_resample_buffer_.resize(output_resampler_.GetOutputSamples(slot->pcm.size()));
+        output_resampler_.Process(slot->pcm.data(), slot->pcm.size(), output_resample_buffer_.data());
+        slot->pcm.swap(output_resample_buffer_);
+    }
+    slot->timestamp = packet.timestamp;
+    slot->decoded_us = esp_timer_get_time();
+    return true;
+}
 
-    busy_decoding_audio_ = true;
-    background_task_->Schedule([this, codec, packet = std::move(packet)]() mutable {
-        busy_decoding_audio_ = false;
-        if (aborted_) {
-            return;
+void Application::EncodeUplinkFrames(int64_t capture_us) {
+    static auto encode_us = Metrics::GetInstance().Histogram("opus.encode_us",
+        { 2000, 5000, 10000, 20000, 40000, 80000 });
+    static auto encoder_latency = Metrics::GetInstance().Histogram("audio.mic_to_encoder_us",
+        { 20000, 50000, 100000, 200000, 400000 });
+    static auto send_dropped = Metrics::GetInstance().Counter("audio.send_dropped");
+
+    // 先清除标记再取帧，之后攒满的帧会重新调度
+    encode_pending_ = false;
+    if (capture_us > 0) {
+        encoder_latency->Record(esp_timer_get_time() - capture_us);
+    }
+    while (opus_encoder_->HasFrame()) {
+        std::list<AudioStreamPacket> node;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (audio_packet_pool_.empty()) {
+                audio_packet_pool_.emplace_back();
+            }
+            node.splice(node.end(), audio_packet_pool_, audio_packet_pool_.begin());
+        }
+        auto& packet = node.front();
+
+        TRACE_BEGIN("opus.encode");
+        int64_t encode_start_us = esp_timer_get_time();
+        int64_t frame_capture_us = 0;
+        bool encoded = opus_encoder_->EncodeFrame(packet.payload, &frame_capture_us);
+        TRACE_END("opus.encode");
+        if (encoded) {
+            encode_us->Record(esp_timer_get_time() - encode_start_us);
+            packet.sample_rate = 16000;
+            packet.frame_duration = OPUS_FRAME_DURATION_MS;
+#ifdef CONFIG_USE_SERVER_AEC
+            // 帧首采集时喇叭正在播放的内容对应的服务端时间戳，没有播放时为 0
+            packet.timestamp = playout_clock_.Lookup(frame_capture_us);
+#else
+            packet.timestamp = 0;
+#endif
         }
 
-        std::vector<int16_t> pcm;
-        if (!opus_decoder_->Decode(std::move(packet.payload), pcm)) {
-            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!encoded) {
+            audio_packet_pool_.splice(audio_packet_pool_.end(), node);
+            continue;
         }
-        // Resample if the sample rate is different
-        if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-            int target_size = output_resampler_.GetOutputSamples(pcm.size());
-            std::vector<int16_t> resampled(target_size);
-            output_resampler_.Process(pcm.data(), pcm.size(), resampled.data());
-            pcm = std::move(resampled);
+        if (audio_send_queue_.size() >= MAX_AUDIO_PACKETS_IN_QUEUE) {
+            ESP_LOGW(TAG, "Too many audio packets in queue, drop the oldest packet");
+            audio_packet_pool_.splice(audio_packet_pool_.end(), audio_send_queue_, audio_send_queue_.begin());
+            send_dropped->Increment();
         }
-        codec->OutputData(pcm);
-#ifdef CONFIG_USE_SERVER_AEC
-        std::lock_guard<std::mutex> lock(timestamp_mutex_);
-        timestamp_queue_.push_back(packet.timestamp);
-#endif
-        last_output_time_ = std::chrono::steady_clock::now();
-    });
+        audio_send_queue_.splice(audio_send_queue_.end(), node);
+        xEventGroupSetBits(event_group_, SEND_AUDIO_EVENT);
+    }
 }
 
-void Application::OnAudioInput() {
+bool Application::OnAudioInput() {
     if (device_state_ == kDeviceStateAudioTesting) {
         if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
             ExitAudioTestingMode();
-            return;
+            return true;
         }
         std::vector<int16_t> data;
         int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
         if (ReadAudio(data, 16000, samples)) {
-            background_task_->Schedule([this, data = std::move(data)]() mutable {
-                opus_encoder_->Encode(std::move(data), [this](std::vector<uint8_t>&& opus) {
+            if (opus_encoder_->Write(data.data(), data.size())) {
+                background_task_->Schedule([this]() {
                     AudioStreamPacket packet;
-                    packet.payload = std::move(opus);
-                    packet.frame_duration = OPUS_FRAME_DURATION_MS;
-                    packet.sample_rate = 16000;
-                    std::lock_guard<std::mutex> lock(mutex_);
-                    audio_testing_queue_.push_back(std::move(packet));
+                    while (opus_encoder_->EncodeFrame(packet.payload)) {
+                        packet.frame_duration = OPUS_FRAME_DURATION_MS;
+                        packet.sample_rate = 16000;
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        audio_testing_queue_.push_back(std::move(packet));
+                    }
                 });
-            });
-            return;
+            }
+            return true;
         }
     }
 
@@ -934,7 +1338,7 @@ void Application::OnAudioInput() {
         if (samples > 0) {
             if (ReadAudio(data, 16000, samples)) {
                 wake_word_->Feed(data);
-                return;
+                return true;
             }
         }
     }
@@ -945,15 +1349,16 @@ void Application::OnAudioInput() {
         if (samples > 0) {
             if (ReadAudio(data, 16000, samples)) {
                 audio_processor_->Feed(data);
-                return;
+                return true;
             }
         }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(OPUS_FRAME_DURATION_MS / 2));
+    return false;
 }
 
 bool Application::ReadAudio(std::vector<int16_t>& data, int sample_rate, int samples) {
+    TRACE_SCOPE("i2s.read");
     auto codec = Board::GetInstance().GetAudioCodec();
     if (!codec->input_enabled()) {
         return false;
@@ -964,27 +1369,9 @@ bool Application::ReadAudio(std::vector<int16_t>& data, int sample_rate, int sam
         if (!codec->InputData(data)) {
             return false;
         }
-        if (codec->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
-            }
-        } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
-        }
+        input_resample_buffer_.resize(input_resampler_.GetOutputSamples(data.size()));
+        input_resampler_.Process(data.data(), data.size(), input_resample_buffer_.data());
+        data.swap(input_resample_buffer_);
     } else {
         data.resize(samples);
         if (!codec->InputData(data)) {
@@ -992,9 +1379,16 @@ bool Application::ReadAudio(std::vector<int16_t>& data, int sample_rate, int sam
         }
     }
     
-    // 音频调试：发送原始音频数据
+    last_capture_time_us_ = codec->input_dma_time_us();
+
+    // 音频调试：双声道时数据为麦克风与回采参考交错排列
     if (audio_debugger_) {
-        audio_debugger_->Feed(data);
+        if (codec->input_channels() == 2) {
+            audio_debugger_->Feed(kAudioDebugTapMic, data.data(), data.size() / 2, sample_rate, 2);
+            audio_debugger_->Feed(kAudioDebugTapReference, data.data() + 1, data.size() / 2, sample_rate, 2);
+        } else {
+            audio_debugger_->Feed(kAudioDebugTapMic, data, sample_rate);
+        }
     }
     
     return true;
@@ -1003,6 +1397,9 @@ bool Application::ReadAudio(std::vector<int16_t>& data, int sample_rate, int sam
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
+#if CONFIG_USE_TTS_CACHE
+    TtsCache::GetInstance().CancelSentence();
+#endif
     protocol_->SendAbortSpeaking(reason);
 }
 
@@ -1012,16 +1409,28 @@ void Application::SetListeningMode(ListeningMode mode) {
 }
 
 void Application::SetDeviceState(DeviceState state) {
+    // 启动阶段在各自的任务中并行执行，状态切换和回调统一在启动任务中串行执行
+    auto boot = boot_sequence_.load();
+    if (boot != nullptr && !boot->IsRunTask()) {
+        boot->Dispatch([this, state]() {
+            SetDeviceState(state);
+        });
+        return;
+    }
     if (device_state_ == state) {
         return;
     }
     
     clock_ticks_ = 0;
+    TRACE_INSTANT(STATE_STRINGS[state]);
     auto previous_state = device_state_;
     device_state_ = state;
     ESP_LOGI(TAG, "STATE: %s", STATE_STRINGS[device_state_]);
     // The state is changed, wait for all background tasks to finish
     background_task_->WaitForCompletion();
+#if CONFIG_USE_TTS_CACHE
+    TtsCache::GetInstance().SetWritable(state == kDeviceStateIdle);
+#endif
 
     auto& board = Board::GetInstance();
     auto display = board.GetDisplay();
@@ -1039,9 +1448,10 @@ void Application::SetDeviceState(DeviceState state) {
             display->SetStatus(Lang::Strings::CONNECTING);
             display->SetEmotion("loading");
             display->SetChatMessage("system", "");
-            timestamp_queue_.clear();
+            playout_clock_.Reset();
             break;
         case kDeviceStateListening:
+            BootProfiler::GetInstance().Mark("first_conversation");
             display->SetStatus(Lang::Strings::LISTENING);
             display->SetEmotion("thinking");
             // Update the IoT states before sending the start listening command
@@ -1054,12 +1464,15 @@ void Application::SetDeviceState(DeviceState state) {
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
                 if (previous_state == kDeviceStateSpeaking) {
+#if CONFIG_USE_TTS_CACHE
+                    DropTtsCacheFrames();
+#endif
                     audio_decode_queue_.clear();
                     audio_decode_cv_.notify_all();
                     // FIXME: Wait for the speaker to empty the buffer
                     vTaskDelay(pdMS_TO_TICKS(120));
                 }
-                opus_encoder_->ResetState();
+                opus_encoder_->Reset();
                 audio_processor_->Start();
                 wake_word_->StopDetection();
             }
@@ -1083,12 +1496,24 @@ void Application::SetDeviceState(DeviceState state) {
             // Do nothing
             break;
     }
+
+    for (auto& callback : state_changed_callbacks_) {
+        callback(previous_state, state);
+    }
+}
+
+void Application::OnDeviceStateChanged(std::function<void(DeviceState previous_state, DeviceState current_state)> callback) {
+    state_changed_callbacks_.push_back(callback);
 }
 
 void Application::ResetDecoder() {
+#if CONFIG_USE_TTS_CACHE
+    DropTtsCacheFrames();
+#endif
     std::lock_guard<std::mutex> lock(mutex_);
     opus_decoder_->ResetState();
     audio_decode_queue_.clear();
+    playback_->Clear();
     audio_decode_cv_.notify_all();
     last_output_time_ = std::chrono::steady_clock::now();
     auto codec = Board::GetInstance().GetAudioCodec();
@@ -1096,14 +1521,15 @@ void Application::ResetDecoder() {
 }
 
 void Application::SetDecodeSampleRate(int sample_rate, int frame_duration) {
-    if (opus_decoder_->sample_rate() == sample_rate && opus_decoder_->duration_ms() == frame_duration) {
+    auto codec = Board::GetInstance().GetAudioCodec();
+    int decode_sample_rate = OpusDecodeSampleRate(codec->output_sample_rate(), sample_rate);
+    if (opus_decoder_->sample_rate() == decode_sample_rate && opus_decoder_->duration_ms() == frame_duration) {
         return;
     }
 
     opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(decode_sample_rate, 1, frame_duration);
 
-    auto codec = Board::GetInstance().GetAudioCodec();
     if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
         ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
         output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
@@ -1125,6 +1551,14 @@ void Application::Reboot() {
     esp_restart();
 }
 
+void Application::OnNetworkChanged() {
+    Schedule([this]() {
+        if (protocol_) {
+            protocol_->OnNetworkChanged();
+        }
+    });
+}
+
 void Application::WakeWordInvoke(const std::string& wake_word) {
     if (device_state_ == kDeviceStateIdle) {
         ToggleChatState();
@@ -12,17 +12,23 @@
 #include <vector>
 #include <condition_variable>
 #include <memory>
+#include <atomic>
 
-#include <opus_encoder.h>
 #include <opus_decoder.h>
-#include <opus_resampler.h>
 
+#include "device_state.h"
 #include "protocol.h"
 #include "ota.h"
 #include "background_task.h"
 #include "audio_processor.h"
 #include "wake_word.h"
 #include "audio_debugger.h"
+#include "polyphase_resampler.h"
+#include "playback_pipeline.h"
+#include "opus_frame_encoder.h"
+#include "playout_clock.h"
+
+class BootSequence;
 
 #define SCHEDULE_EVENT (1 << 0)
 #define SEND_AUDIO_EVENT (1 << 1)
@@ -34,23 +40,11 @@ enum AecMode {
     kAecOnServerSide,
 };
 
-enum DeviceState {
-    kDeviceStateUnknown,
-    kDeviceStateStarting,
-    kDeviceStateWifiConfiguring,
-    kDeviceStateIdle,
-    kDeviceStateConnecting,
-    kDeviceStateListening,
-    kDeviceStateSpeaking,
-    kDeviceStateUpgrading,
-    kDeviceStateActivating,
-    kDeviceStateAudioTesting,
-    kDeviceStateFatalError
-};
-
 #define OPUS_FRAME_DURATION_MS 100
 #define MAX_AUDIO_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+// 播放流水线中已解码待播放的帧数上限
+#define AUDIO_PCM_FIFO_SLOTS 2
 
 class Application {
 public:
@@ -75,6 +69,8 @@ public:
     void StopListening();
     void UpdateIotStates();
     void Reboot();
+    // 板卡切换网络接口后调用，在主任务中把协议连接迁移到新网络
+    void OnNetworkChanged();
     void WakeWordInvoke(const std::string& wake_word);
     void PlaySound(const std::string_view& sound);
     bool CanEnterSleepMode();
@@ -82,16 +78,21 @@ public:
     void SetAecMode(AecMode mode);
     AecMode GetAecMode() const { return aec_mode_; }
     BackgroundTask* GetBackgroundTask() const { return background_task_; }
+    void OnDeviceStateChanged(std::function<void(DeviceState previous_state, DeviceState current_state)> callback);
 
 private:
     Application();
     ~Application();
 
     std::unique_ptr<WakeWord> wake_word_;
+    // 唤醒后的本地命令词识别，未启用或没有模型时为空
+    std::unique_ptr<CommandRecognizer> command_recognizer_;
+    int64_t wake_word_time_us_ = 0;
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::mutex mutex_;
     std::list<std::function<void()>> main_tasks_;
+    std::vector<std::function<void(DeviceState, DeviceState)>> state_changed_callbacks_;
     std::unique_ptr<Protocol> protocol_;
     EventGroupHandle_t event_group_ = nullptr;
     esp_timer_handle_t clock_timer_handle_ = nullptr;
@@ -102,41 +103,68 @@ private:
     bool has_server_time_ = false;
     bool aborted_ = false;
     bool voice_detected_ = false;
-    bool busy_decoding_audio_ = false;
     int clock_ticks_ = 0;
+    int metrics_report_ticks_ = 0;
     TaskHandle_t check_new_version_task_handle_ = nullptr;
+    std::atomic<bool> restart_pending_ = false;
+    // 启动阶段并行执行期间非空，状态切换转交给启动任务串行执行
+    std::atomic<BootSequence*> boot_sequence_ = nullptr;
 
     // Audio encode / decode
-    TaskHandle_t audio_loop_task_handle_ = nullptr;
+    TaskHandle_t audio_input_task_handle_ = nullptr;
+    TaskHandle_t audio_output_task_handle_ = nullptr;
+    std::atomic<int64_t> last_capture_time_us_ = 0;
     BackgroundTask* background_task_ = nullptr;
     std::chrono::steady_clock::time_point last_output_time_;
     std::list<AudioStreamPacket> audio_send_queue_;
+    // 发送完的上行包节点回收到这里，payload 容量随节点保留，稳态下编码与发送都不分配内存
+    std::list<AudioStreamPacket> audio_packet_pool_;
+    std::atomic<bool> encode_pending_ = false;
     std::list<AudioStreamPacket> audio_decode_queue_;
     std::condition_variable audio_decode_cv_;
+    std::unique_ptr<PlaybackPipeline> playback_;
     std::list<AudioStreamPacket> audio_testing_queue_;
+    // TTS 缓存命中的整句音频，按解码队列的空位逐步移入，解码队列的长度限制对它同样有效
+    std::list<AudioStreamPacket> tts_cache_queue_;
+    // 命中时的回复等缓存音频快播完才发出，服务端收到后才下发下一句，不会因为队列已满被丢弃
+    std::string tts_cache_reply_key_;
+    // 下一帧下行音频的时间戳，缓存帧接着服务端下发的时间戳编号
+    uint32_t next_downlink_timestamp_ = 0;
 
-    // 新增：用于维护音频包的timestamp队列
-    std::list<uint32_t> timestamp_queue_;
-    std::mutex timestamp_mutex_;
+    // 服务端 AEC：记录下行每帧的实际播放时间，为上行帧查找对应的服务端时间戳
+    PlayoutClock playout_clock_;
 
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
+    std::unique_ptr<OpusFrameEncoder> opus_encoder_;
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
 
-    OpusResampler input_resampler_;
-    OpusResampler reference_resampler_;
-    OpusResampler output_resampler_;
+    PolyphaseResampler input_resampler_;
+    PolyphaseResampler output_resampler_;
+    std::vector<int16_t> input_resample_buffer_;
+    std::vector<int16_t> output_resample_buffer_;
 
     void MainEventLoop();
-    void OnAudioInput();
+    void InitializeAudio();
+    void InitializeAudioFrontend();
+    void StartWakeWordSession(const std::string& wake_word);
+    void OnLocalCommand(const std::string& wake_word, int command);
+    void OnTtsSentenceStart(const cJSON* root);
+    std::string FeedTtsCacheFrames();
+    void DropTtsCacheFrames();
+    bool InitializeProtocol(Ota& ota);
+    bool OnAudioInput();
+    void EncodeUplinkFrames(int64_t capture_us);
     void OnAudioOutput();
+    bool DecodePacket(AudioCodec* codec, AudioStreamPacket&& packet, PcmSlot* slot);
     bool ReadAudio(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
     void CheckNewVersion(Ota& ota);
+    void RevalidateConfig();
     void ShowActivationCode(const std::string& code, const std::string& message);
     void OnClockTimer();
     void SetListeningMode(ListeningMode mode);
-    void AudioLoop();
+    void AudioInputLoop();
+    void AudioOutputLoop();
     void EnterAudioTestingMode();
     void ExitAudioTestingMode();
 };
@@ -3,7 +3,10 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
 #include <cstring>
+#include <algorithm>
 #include <driver/i2s_common.h>
 
 #define TAG "AudioCodec"
@@ -15,7 +18,13 @@ AudioCodec::~AudioCodec() {
 }
 
 void AudioCodec::OutputData(std::vector<int16_t>& data) {
+    // 以 DMA 缓冲区为单位对比已写入与已播放的帧数；播空后 DMA 自动补零，从当前位置重新计数
+    uint32_t sent_frames = output_dma_sent_.load(std::memory_order_relaxed) * AUDIO_CODEC_DMA_FRAME_NUM;
+    if ((int32_t)(sent_frames - output_frames_written_) > 0) {
+        output_frames_written_ = sent_frames;
+    }
     Write(data.data(), data.size());
+    output_frames_written_ += data.size() / output_channels_;
 }
 
 bool AudioCodec::InputData(std::vector<int16_t>& data) {
@@ -34,6 +43,7 @@ void AudioCodec::Start() {
         output_volume_ = 10;
     }
 
+    RegisterDmaCallbacks();
     ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
     ESP_ERROR_CHECK(i2s_channel_enable(rx_handle_));
 
@@ -65,3 +75,48 @@ void AudioCodec::EnableOutput(bool enable) {
     output_enabled_ = enable;
     ESP_LOGI(TAG, "Set output enable to %s", enable ? "true" : "false");
 }
+
+bool IRAM_ATTR AudioCodec::OnInputDma(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    auto codec = (AudioCodec*)user_ctx;
+    codec->input_dma_time_us_.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    return false;
+}
+
+bool IRAM_ATTR AudioCodec::OnOutputDma(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    auto codec = (AudioCodec*)user_ctx;
+    codec->output_dma_sent_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void AudioCodec::RegisterDmaCallbacks() {
+    if (rx_handle_ != nullptr) {
+        i2s_event_callbacks_t callbacks = {};
+        callbacks.on_recv = OnInputDma;
+        ESP_ERROR_CHECK(i2s_channel_register_event_callback(rx_handle_, &callbacks, this));
+    }
+    if (tx_handle_ != nullptr) {
+        i2s_event_callbacks_t callbacks = {};
+        callbacks.on_sent = OnOutputDma;
+        ESP_ERROR_CHECK(i2s_channel_register_event_callback(tx_handle_, &callbacks, this));
+    }
+}
+
+int64_t AudioCodec::input_dma_time_us() const {
+    uint32_t dma_time = input_dma_time_us_.load(std::memory_order_relaxed);
+    if (dma_time == 0) {
+        return 0;
+    }
+    // 回调里只保存低 32 位，按与当前时间的差值还原
+    int64_t now = esp_timer_get_time();
+    return now - (uint32_t)((uint32_t)now - dma_time);
+}
+
+int AudioCodec::GetOutputPendingUs() const {
+    if (output_sample_rate_ <= 0) {
+        return 0;
+    }
+    uint32_t sent_frames = output_dma_sent_.load(std::memory_order_relaxed) * AUDIO_CODEC_DMA_FRAME_NUM;
+    int32_t pending = std::clamp((int32_t)(output_frames_written_ - sent_frames), (int32_t)0,
+        (int32_t)(AUDIO_CODEC_DMA_DESC_NUM * AUDIO_CODEC_DMA_FRAME_NUM));
+    return (int64_t)pending * 1000000 / output_sample_rate_;
+}
@@ -8,11 +8,13 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <atomic>
 
 #include "board.h"
 
-#define AUDIO_CODEC_DMA_DESC_NUM 6
-#define AUDIO_CODEC_DMA_FRAME_NUM 240
+// DMA 描述符数量和每个描述符的帧数可以在板子的 config.json 中通过 sdkconfig 覆盖
+#define AUDIO_CODEC_DMA_DESC_NUM CONFIG_AUDIO_CODEC_DMA_DESC_NUM
+#define AUDIO_CODEC_DMA_FRAME_NUM CONFIG_AUDIO_CODEC_DMA_FRAME_NUM
 #define AUDIO_CODEC_DEFAULT_MIC_GAIN 60.0
 
 class AudioCodec {
@@ -38,6 +40,11 @@ public:
     inline bool input_enabled() const { return input_enabled_; }
     inline bool output_enabled() const { return output_enabled_; }
 
+    // 最近一个 RX DMA 缓冲区采集完成的时间 (esp_timer us)，未注册回调时返回 0
+    int64_t input_dma_time_us() const;
+    // 已写入 TX DMA 但尚未播放的数据时长
+    int GetOutputPendingUs() const;
+
 protected:
     i2s_chan_handle_t tx_handle_ = nullptr;
     i2s_chan_handle_t rx_handle_ = nullptr;
@@ -54,6 +61,17 @@ protected:
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
+
+    // 在 i2s_channel_enable 之前调用，注册 on_recv/on_sent DMA 回调
+    void RegisterDmaCallbacks();
+
+private:
+    std::atomic<uint32_t> input_dma_time_us_ = 0;
+    std::atomic<uint32_t> output_dma_sent_ = 0;
+    uint32_t output_frames_written_ = 0;
+
+    static bool OnInputDma(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+    static bool OnOutputDma(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
 };
 
 #endif // _AUDIO_CODEC_H
@@ -1,5 +1,6 @@
 #include "afe_audio_processor.h"
 #include <esp_log.h>
+#include "trace.h"
 
 #define PROCESSOR_RUNNING 0x01
 
@@ -50,6 +51,8 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec) {
 #ifdef CONFIG_USE_DEVICE_AEC
     afe_config->aec_init = true;
     afe_config->vad_init = false;
+    device_aec_enabled_ = true;
+    reference_aligner_.Configure(16000, codec_->input_channels());
 #else
     afe_config->aec_init = false;
     afe_config->vad_init = true;
@@ -83,10 +86,21 @@ void AfeAudioProcessor::Feed(const std::vector<int16_t>& data) {
     if (afe_data_ == nullptr) {
         return;
     }
+#if CONFIG_USE_DEVICE_AEC
+    if (device_aec_enabled_ && codec_->input_reference()) {
+        // 对齐回采参考后再送入 AFE，原始数据由调用方持有，这里拷贝到复用的缓冲区处理
+        feed_buffer_.assign(data.begin(), data.end());
+        reference_aligner_.Process(feed_buffer_.data(), feed_buffer_.size() / codec_->input_channels());
+        afe_iface_->feed(afe_data_, feed_buffer_.data());
+        return;
+    }
+#endif
     afe_iface_->feed(afe_data_, data.data());
 }
 
 void AfeAudioProcessor::Start() {
+    // 每次会话开始重新估计回声延迟，之前的估计继续生效直到得到新结果
+    reference_aligner_.Restart();
     xEventGroupSetBits(event_group_, PROCESSOR_RUNNING);
 }
 
@@ -101,7 +115,7 @@ bool AfeAudioProcessor::IsRunning() {
     return xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING;
 }
 
-void AfeAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
+void AfeAudioProcessor::OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) {
     output_callback_ = callback;
 }
 
@@ -119,6 +133,7 @@ void AfeAudioProcessor::AudioProcessorTask() {
         xEventGroupWaitBits(event_group_, PROCESSOR_RUNNING, pdFALSE, pdTRUE, portMAX_DELAY);
 
         auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        TRACE_INSTANT("afe.fetch");
         if ((xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING) == 0) {
             continue;
         }
@@ -141,7 +156,9 @@ void AfeAudioProcessor::AudioProcessorTask() {
         }
 
         if (output_callback_) {
-            output_callback_(std::vector<int16_t>(res->data, res->data + res->data_size / sizeof(int16_t)));
+            TRACE_SCOPE("afe.output");
+            // 直接交出 AFE 的输出缓冲区，在下一次 fetch 之前有效
+            output_callback_(res->data, res->data_size / sizeof(int16_t));
         }
     }
 }
@@ -151,11 +168,13 @@ void AfeAudioProcessor::EnableDeviceAec(bool enable) {
 #if CONFIG_USE_DEVICE_AEC
         afe_iface_->disable_vad(afe_data_);
         afe_iface_->enable_aec(afe_data_);
+        device_aec_enabled_ = true;
 #else
         ESP_LOGE(TAG, "Device AEC is not supported");
 #endif
     } else {
         afe_iface_->disable_aec(afe_data_);
         afe_iface_->enable_vad(afe_data_);
+        device_aec_enabled_ = false;
     }
 }
@@ -8,6 +8,13 @@
 
 #define DETECTION_RUNNING_EVENT 1
 
+// 保留唤醒前后的音频，命令词窗口内没有识别到命令时，窗口内说的话也一起上传
+#if CONFIG_USE_LOCAL_COMMANDS
+#define WAKE_WORD_PCM_KEEP_MS (2000 + CONFIG_LOCAL_COMMAND_WINDOW_MS)
+#else
+#define WAKE_WORD_PCM_KEEP_MS 2000
+#endif
+
 #define TAG "AfeWakeWord"
 
 AfeWakeWord::AfeWakeWord()
@@ -87,6 +94,7 @@ void AfeWakeWord::StartDetection() {
 
 void AfeWakeWord::StopDetection() {
     xEventGroupClearBits(event_group_, DETECTION_RUNNING_EVENT);
+    command_recognizer_ = nullptr;
     if (afe_data_ != nullptr) {
         afe_iface_->reset_buffer(afe_data_);
     }
@@ -127,6 +135,12 @@ void AfeWakeWord::AudioDetectionTask() {
         // Store the wake word data for voice recognition, like who is speaking
         StoreWakeWordData(res->data, res->data_size / sizeof(int16_t));
 
+        auto recognizer = command_recognizer_.load();
+        if (recognizer != nullptr) {
+            FeedCommandRecognizer(recognizer, res->data, res->data_size / sizeof(int16_t));
+            continue;
+        }
+
         if (res->wakeup_state == WAKENET_DETECTED) {
             StopDetection();
             last_detected_wake_word_ = wake_words_[res->wake_word_index - 1];
@@ -138,11 +152,47 @@ void AfeWakeWord::AudioDetectionTask() {
     }
 }
 
+bool AfeWakeWord::DetectCommand(CommandRecognizer* recognizer, int timeout_ms, std::function<void(int command)> callback) {
+    if (afe_data_ == nullptr) {
+        return false;
+    }
+    recognizer->Reset();
+    command_pcm_.clear();
+    command_samples_left_ = timeout_ms * 16;
+    command_callback_ = callback;
+    command_recognizer_ = recognizer;
+    StartDetection();
+    return true;
+}
+
+void AfeWakeWord::FeedCommandRecognizer(CommandRecognizer* recognizer, const int16_t* data, size_t samples) {
+    // AFE 输出的块大小与识别模型不一定相同
+    command_pcm_.insert(command_pcm_.end(), data, data + samples);
+    size_t chunk_size = recognizer->GetChunkSize();
+    size_t offset = 0;
+    int command = -1;
+    while (command < 0 && command_pcm_.size() - offset >= chunk_size) {
+        command = recognizer->Detect(command_pcm_.data() + offset);
+        offset += chunk_size;
+    }
+    command_pcm_.erase(command_pcm_.begin(), command_pcm_.begin() + offset);
+    command_samples_left_ -= samples;
+    if (command < 0 && command_samples_left_ > 0) {
+        return;
+    }
+
+    auto callback = std::move(command_callback_);
+    StopDetection();
+    if (callback) {
+        callback(command);
+    }
+}
+
 void AfeWakeWord::StoreWakeWordData(const int16_t* data, size_t samples) {
     // store audio data to wake_word_pcm_
     wake_word_pcm_.emplace_back(std::vector<int16_t>(data, data + samples));
-    // keep about 2 seconds of data, detect duration is 30ms (sample_rate == 16000, chunksize == 512)
-    while (wake_word_pcm_.size() > 2000 / 30) {
+    // detect duration is 30ms (sample_rate == 16000, chunksize == 512)
+    while (wake_word_pcm_.size() > WAKE_WORD_PCM_KEEP_MS / 30) {
         wake_word_pcm_.pop_front();
     }
 }
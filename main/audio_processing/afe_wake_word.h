@@ -14,6 +14,7 @@
 #include <functional>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 
 #include "audio_codec.h"
 #include "wake_word.h"
@@ -33,6 +34,7 @@ public:
     void EncodeWakeWordData();
     bool GetWakeWordOpus(std::vector<uint8_t>& opus);
     const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
+    bool DetectCommand(CommandRecognizer* recognizer, int timeout_ms, std::function<void(int command)> callback) override;
 
 private:
     esp_afe_sr_iface_t* afe_iface_ = nullptr;
@@ -52,7 +54,14 @@ private:
     std::mutex wake_word_mutex_;
     std::condition_variable wake_word_cv_;
 
+    // 非空时处于命令词识别窗口
+    std::atomic<CommandRecognizer*> command_recognizer_ = nullptr;
+    std::function<void(int command)> command_callback_;
+    std::vector<int16_t> command_pcm_;
+    int command_samples_left_ = 0;
+
     void StoreWakeWordData(const int16_t* data, size_t size);
+    void FeedCommandRecognizer(CommandRecognizer* recognizer, const int16_t* data, size_t samples);
     void AudioDetectionTask();
 };
 
@@ -3,15 +3,104 @@
 
 #if CONFIG_USE_AUDIO_DEBUGGER
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
 #include <cstring>
 #include <string>
+#include <algorithm>
 #endif
 
 #define TAG "AudioDebugger"
 
+#define AUDIO_DEBUG_MAX_SAMPLES_PER_PACKET 480
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+namespace {
+
+struct AdpcmState {
+    int16_t predictor = 0;
+    uint8_t index = 0;
+};
+
+// 每个抓取点只有一个生产者线程，编码状态跨包延续，包内的块头记录起始状态，单包即可独立解码
+AdpcmState adpcm_states[kAudioDebugTapCount];
+
+const int16_t kImaStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+const int8_t kImaIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+uint8_t EncodeAdpcmSample(AdpcmState& state, int16_t sample) {
+    int step = kImaStepTable[state.index];
+    int diff = sample - state.predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    int delta = step >> 3;
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 1;
+        delta += step;
+    }
+
+    int predictor = state.predictor + ((nibble & 8) ? -delta : delta);
+    state.predictor = std::clamp(predictor, -32768, 32767);
+    state.index = std::clamp(state.index + kImaIndexTable[nibble], 0, 88);
+    return nibble;
+}
+
+// 负载格式：int16 起始预测值 + uint8 起始步长索引 + 保留字节，之后每字节两个样本（低半字节在前）
+size_t EncodeAdpcm(AdpcmState& state, const int16_t* data, size_t samples, size_t stride, uint8_t* out) {
+    memcpy(out, &state.predictor, sizeof(state.predictor));
+    out[2] = state.index;
+    out[3] = 0;
+    uint8_t* p = out + 4;
+    for (size_t i = 0; i < samples; i += 2) {
+        uint8_t byte = EncodeAdpcmSample(state, data[i * stride]);
+        if (i + 1 < samples) {
+            byte |= EncodeAdpcmSample(state, data[(i + 1) * stride]) << 4;
+        }
+        *p++ = byte;
+    }
+    return p - out;
+}
+
+size_t GetMaxPayloadSize(size_t samples) {
+#if CONFIG_AUDIO_DEBUG_ADPCM
+    return 4 + (samples + 1) / 2;
+#else
+    return samples * sizeof(int16_t);
+#endif
+}
+
+} // namespace
+#endif
+
 
 AudioDebugger::AudioDebugger() {
 #if CONFIG_USE_AUDIO_DEBUGGER
@@ -20,30 +109,61 @@ AudioDebugger::AudioDebugger() {
         // 解析配置的服务器地址 "IP:PORT"
         std::string server_addr = CONFIG_AUDIO_DEBUG_UDP_SERVER;
         size_t colon_pos = server_addr.find(':');
-        
+
         if (colon_pos != std::string::npos) {
             std::string ip = server_addr.substr(0, colon_pos);
             int port = std::stoi(server_addr.substr(colon_pos + 1));
-            
+
             memset(&udp_server_addr_, 0, sizeof(udp_server_addr_));
             udp_server_addr_.sin_family = AF_INET;
             udp_server_addr_.sin_port = htons(port);
             inet_pton(AF_INET, ip.c_str(), &udp_server_addr_.sin_addr);
-            
+
             ESP_LOGI(TAG, "Initialized server address: %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
         } else {
             ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
             close(udp_sockfd_);
             udp_sockfd_ = -1;
+            return;
         }
     } else {
         ESP_LOGW(TAG, "Failed to create UDP socket: %d", errno);
+        return;
+    }
+
+    ring_buffer_ = xRingbufferCreateWithCaps(CONFIG_AUDIO_DEBUG_RING_SIZE, RINGBUF_TYPE_NOSPLIT, MALLOC_CAP_SPIRAM);
+    if (ring_buffer_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate ring buffer in PSRAM, fallback to internal RAM");
+        ring_buffer_ = xRingbufferCreateWithCaps(16 * 1024, RINGBUF_TYPE_NOSPLIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
     }
+    if (ring_buffer_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create ring buffer");
+        close(udp_sockfd_);
+        udp_sockfd_ = -1;
+        return;
+    }
+
+    xTaskCreate([](void* arg) {
+        auto debugger = (AudioDebugger*)arg;
+        debugger->SenderTask();
+        vTaskDelete(NULL);
+    }, "audio_debug", 4096, this, 1, &sender_task_);
+#if CONFIG_AUDIO_DEBUG_ADPCM
+    ESP_LOGI(TAG, "Audio debugger started, taps: 0x%02x, codec: adpcm", CONFIG_AUDIO_DEBUG_TAPS);
+#else
+    ESP_LOGI(TAG, "Audio debugger started, taps: 0x%02x, codec: pcm16", CONFIG_AUDIO_DEBUG_TAPS);
+#endif
 #endif
 }
 
 AudioDebugger::~AudioDebugger() {
 #if CONFIG_USE_AUDIO_DEBUGGER
+    if (sender_task_ != nullptr) {
+        vTaskDelete(sender_task_);
+    }
+    if (ring_buffer_ != nullptr) {
+        vRingbufferDeleteWithCaps(ring_buffer_);
+    }
     if (udp_sockfd_ >= 0) {
         close(udp_sockfd_);
         ESP_LOGI(TAG, "Closed UDP socket");
@@ -51,18 +171,95 @@ AudioDebugger::~AudioDebugger() {
 #endif
 }
 
-void AudioDebugger::Feed(const std::vector<int16_t>& data) {
+bool AudioDebugger::IsTapEnabled(AudioDebugTap tap) const {
 #if CONFIG_USE_AUDIO_DEBUGGER
-    if (udp_sockfd_ >= 0) {
-        ssize_t sent = sendto(udp_sockfd_, data.data(), data.size() * sizeof(int16_t), 0,
+    return ring_buffer_ != nullptr && (CONFIG_AUDIO_DEBUG_TAPS & (1 << tap)) != 0;
+#else
+    return false;
+#endif
+}
+
+void AudioDebugger::Feed(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, size_t stride) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    if (!IsTapEnabled(tap) || samples == 0 || sample_rate <= 0) {
+        return;
+    }
+
+    // 输入侧抓取点在一帧采集完成后调用，时间戳回推到帧首；
+    // 输出侧抓取点在数据送出前调用，当前时间即为帧首
+    int64_t timestamp_us = esp_timer_get_time();
+    if (tap == kAudioDebugTapMic || tap == kAudioDebugTapReference || tap == kAudioDebugTapAfeOutput) {
+        timestamp_us -= (int64_t)samples * 1000000 / sample_rate;
+    }
+
+    for (size_t offset = 0; offset < samples; offset += AUDIO_DEBUG_MAX_SAMPLES_PER_PACKET) {
+        size_t count = std::min<size_t>(AUDIO_DEBUG_MAX_SAMPLES_PER_PACKET, samples - offset);
+        FeedChunk(tap, data + offset * stride, count, sample_rate, stride,
+            timestamp_us + (int64_t)offset * 1000000 / sample_rate);
+    }
+#endif
+}
+
+void AudioDebugger::FeedChunk(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, size_t stride, int64_t timestamp_us) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    // 序号先占用，缓冲区满丢包时服务端能从序号空洞发现
+    uint32_t sequence = sequences_[tap].fetch_add(1, std::memory_order_relaxed);
+
+    size_t item_size = sizeof(AudioDebugPacketHeader) + GetMaxPayloadSize(samples);
+    void* item = nullptr;
+    if (xRingbufferSendAcquire(ring_buffer_, &item, item_size, 0) != pdTRUE) {
+        return;
+    }
+
+    auto header = (AudioDebugPacketHeader*)item;
+    header->magic[0] = 'A';
+    header->magic[1] = 'D';
+    header->version = 1;
+    header->tap = tap;
+    header->reserved = 0;
+    header->sample_rate = sample_rate;
+    header->sequence = sequence;
+    header->timestamp_us = timestamp_us;
+    header->samples = samples;
+
+    auto payload = (uint8_t*)item + sizeof(AudioDebugPacketHeader);
+#if CONFIG_AUDIO_DEBUG_ADPCM
+    header->codec = kAudioDebugCodecImaAdpcm;
+    header->payload_size = EncodeAdpcm(adpcm_states[tap], data, samples, stride, payload);
+#else
+    header->codec = kAudioDebugCodecPcm16;
+    header->payload_size = samples * sizeof(int16_t);
+    if (stride == 1) {
+        memcpy(payload, data, samples * sizeof(int16_t));
+    } else {
+        auto pcm = (int16_t*)payload;
+        for (size_t i = 0; i < samples; i++) {
+            pcm[i] = data[i * stride];
+        }
+    }
+#endif
+    xRingbufferSendComplete(ring_buffer_, item);
+#endif
+}
+
+void AudioDebugger::SenderTask() {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    while (true) {
+        size_t size = 0;
+        auto item = (uint8_t*)xRingbufferReceive(ring_buffer_, &size, portMAX_DELAY);
+        if (item == nullptr) {
+            continue;
+        }
+        auto header = (AudioDebugPacketHeader*)item;
+        size_t packet_size = sizeof(AudioDebugPacketHeader) + header->payload_size;
+        ssize_t sent = sendto(udp_sockfd_, item, packet_size, 0,
                              (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
+        vRingbufferReturnItem(ring_buffer_, item);
         if (sent < 0) {
             ESP_LOGW(TAG, "Failed to send audio data to %s: %d", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno);
-        } else {
-            ESP_LOGD(TAG, "Sent %d bytes audio data to %s", sent, CONFIG_AUDIO_DEBUG_UDP_SERVER);
+            // 网络暂不可用时稍作等待，避免刷屏；期间新数据在环形缓冲区满后被丢弃
+            vTaskDelay(pdMS_TO_TICKS(100));
         }
     }
 #endif
 }
-
- 
\ No newline at end of file
@@ -3,20 +3,72 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/ringbuf.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+// 调试抓取点，编号与 scripts/audio_debug_server.py 保持一致
+enum AudioDebugTap : uint8_t {
+    kAudioDebugTapMic = 0,      // 原始麦克风
+    kAudioDebugTapReference,    // 回采参考信号
+    kAudioDebugTapAfeOutput,    // AFE 处理后送编码的音频
+    kAudioDebugTapDecoded,      // 解码后的 TTS（重采样前）
+    kAudioDebugTapOutput,       // 最终送往 I2S 的音频
+    kAudioDebugTapCount
+};
+
+enum AudioDebugCodec : uint8_t {
+    kAudioDebugCodecPcm16 = 0,
+    kAudioDebugCodecImaAdpcm = 1,
+};
+
+// UDP 包头，小端序，后面紧跟负载
+struct __attribute__((packed)) AudioDebugPacketHeader {
+    uint8_t magic[2];       // 'A' 'D'
+    uint8_t version;        // 1
+    uint8_t tap;            // AudioDebugTap
+    uint8_t codec;          // AudioDebugCodec
+    uint8_t reserved;
+    uint16_t sample_rate;
+    uint32_t sequence;      // 每个抓取点独立递增，环形缓冲区满被丢弃的包也占用序号
+    uint64_t timestamp_us;  // 第一个采样点经过抓取点的时间 (esp_timer)
+    uint16_t samples;
+    uint16_t payload_size;
+};
+
+/*
+ * 多抓取点音频调试器。
+ * Feed 只把数据（可选 IMA ADPCM 压缩后）拷贝进 PSRAM 环形缓冲区，从不阻塞；
+ * 低优先级任务负责把缓冲区中的包通过 UDP 发往 CONFIG_AUDIO_DEBUG_UDP_SERVER，
+ * 因此不会影响音频任务的时序。
+ */
 class AudioDebugger {
 public:
     AudioDebugger();
     ~AudioDebugger();
 
-    void Feed(const std::vector<int16_t>& data);
+    // 抓取单声道数据；stride 用于从交错的多声道数据中取出一个声道
+    void Feed(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, size_t stride = 1);
+    void Feed(AudioDebugTap tap, const std::vector<int16_t>& data, int sample_rate) {
+        Feed(tap, data.data(), data.size(), sample_rate);
+    }
+
+    bool IsTapEnabled(AudioDebugTap tap) const;
 
 private:
     int udp_sockfd_ = -1;
     struct sockaddr_in udp_server_addr_;
+    RingbufHandle_t ring_buffer_ = nullptr;
+    TaskHandle_t sender_task_ = nullptr;
+    std::atomic<uint32_t> sequences_[kAudioDebugTapCount] = {};
+
+    void FeedChunk(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, size_t stride, int64_t timestamp_us);
+    void SenderTask();
 };
 
-#endif 
\ No newline at end of file
+#endif
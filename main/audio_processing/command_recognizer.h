@@ -0,0 +1,29 @@
+#ifndef COMMAND_RECOGNIZER_H
+#define COMMAND_RECOGNIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 设备端命令词识别，唤醒后由 WakeWord::DetectCommand 在同一路 AFE 输出上驱动
+class CommandRecognizer {
+public:
+    virtual ~CommandRecognizer() = default;
+
+    // 加载模型，没有可用模型时返回 false
+    virtual bool Initialize() = 0;
+    // 模型语言，"cn" 使用拼音命令词，"en" 使用英文命令词
+    virtual std::string GetLanguage() const = 0;
+    // 注册命令词，first 为命令编号，同一编号可以注册多个说法
+    virtual bool SetCommands(const std::vector<std::pair<int, std::string>>& commands) = 0;
+    // 每次 Detect 需要的采样数，16kHz 单声道
+    virtual size_t GetChunkSize() = 0;
+    // 开始新一轮识别
+    virtual void Reset() = 0;
+    // 返回识别到的命令编号，仍在识别中返回 -1
+    virtual int Detect(const int16_t* data) = 0;
+};
+
+#endif // COMMAND_RECOGNIZER_H
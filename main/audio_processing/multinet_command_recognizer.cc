@@ -0,0 +1,87 @@
+#include "multinet_command_recognizer.h"
+
+#include <esp_log.h>
+#include <esp_mn_models.h>
+#include <esp_mn_speech_commands.h>
+
+#define TAG "MultinetCommandRecognizer"
+
+// 识别窗口由 AfeWakeWord 控制，模型自身的超时设得更长，不会先触发
+#define MULTINET_TIMEOUT_MS 10000
+
+MultinetCommandRecognizer::~MultinetCommandRecognizer() {
+    if (model_data_ != nullptr) {
+        esp_mn_commands_free();
+        multinet_->destroy(model_data_);
+    }
+    if (models_ != nullptr) {
+        esp_srmodel_deinit(models_);
+    }
+}
+
+bool MultinetCommandRecognizer::Initialize() {
+    models_ = esp_srmodel_init("model");
+    if (models_ == nullptr || models_->num == -1) {
+        ESP_LOGW(TAG, "No speech recognition models");
+        return false;
+    }
+    char* model_name = esp_srmodel_filter(models_, ESP_MN_PREFIX, ESP_MN_CHINESE);
+    language_ = "cn";
+    if (model_name == nullptr) {
+        model_name = esp_srmodel_filter(models_, ESP_MN_PREFIX, ESP_MN_ENGLISH);
+        language_ = "en";
+    }
+    if (model_name == nullptr) {
+        ESP_LOGW(TAG, "No MultiNet model, select one in ESP Speech Recognition menu");
+        return false;
+    }
+
+    multinet_ = esp_mn_handle_from_name(model_name);
+    model_data_ = multinet_->create(model_name, MULTINET_TIMEOUT_MS);
+    if (model_data_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create MultiNet model %s", model_name);
+        return false;
+    }
+    esp_mn_commands_alloc(multinet_, model_data_);
+    ESP_LOGI(TAG, "MultiNet model: %s, chunk size: %d", model_name, multinet_->get_samp_chunksize(model_data_));
+    return true;
+}
+
+bool MultinetCommandRecognizer::SetCommands(const std::vector<std::pair<int, std::string>>& commands) {
+    esp_mn_commands_clear();
+    for (auto& [command, phrase] : commands) {
+        // MultiNet 的命令编号从 1 开始
+        if (esp_mn_commands_add(command + 1, (char*)phrase.c_str()) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to add command: %s", phrase.c_str());
+        }
+    }
+    esp_mn_error_t* error = esp_mn_commands_update();
+    if (error != nullptr) {
+        for (int i = 0; i < error->num; i++) {
+            ESP_LOGW(TAG, "Invalid command phrase: %s", error->phrases[i]->string);
+        }
+        return error->num < (int)commands.size();
+    }
+    return true;
+}
+
+size_t MultinetCommandRecognizer::GetChunkSize() {
+    return multinet_->get_samp_chunksize(model_data_);
+}
+
+void MultinetCommandRecognizer::Reset() {
+    multinet_->clean(model_data_);
+}
+
+int MultinetCommandRecognizer::Detect(const int16_t* data) {
+    esp_mn_state_t state = multinet_->detect(model_data_, (int16_t*)data);
+    if (state != ESP_MN_STATE_DETECTED) {
+        return -1;
+    }
+    esp_mn_results_t* results = multinet_->get_results(model_data_);
+    if (results->num <= 0) {
+        return -1;
+    }
+    ESP_LOGI(TAG, "Command detected: %s, id: %d, prob: %.2f", results->string, results->command_id[0], results->prob[0]);
+    return results->command_id[0] - 1;
+}
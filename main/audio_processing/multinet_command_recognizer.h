@@ -0,0 +1,29 @@
+#ifndef MULTINET_COMMAND_RECOGNIZER_H
+#define MULTINET_COMMAND_RECOGNIZER_H
+
+#include <esp_mn_iface.h>
+#include <model_path.h>
+
+#include "command_recognizer.h"
+
+class MultinetCommandRecognizer : public CommandRecognizer {
+public:
+    MultinetCommandRecognizer() = default;
+    ~MultinetCommandRecognizer();
+
+    bool Initialize() override;
+    std::string GetLanguage() const override { return language_; }
+    bool SetCommands(const std::vector<std::pair<int, std::string>>& commands) override;
+    size_t GetChunkSize() override;
+    void Reset() override;
+    int Detect(const int16_t* data) override;
+
+private:
+    // 模型列表在识别器的生命周期内保留，析构时释放
+    srmodel_list_t* models_ = nullptr;
+    esp_mn_iface_t* multinet_ = nullptr;
+    model_iface_data_t* model_data_ = nullptr;
+    std::string language_;
+};
+
+#endif // MULTINET_COMMAND_RECOGNIZER_H
@@ -1,25 +1,88 @@
 #include "no_audio_processor.h"
 #include <esp_log.h>
 
+#include "metrics.h"
+
 #define TAG "NoAudioProcessor"
 
+// 预录块数，每块 30ms；输出随之延迟 90ms
+#define NO_PROCESSOR_VAD_PRE_ROLL_CHUNKS 3
+
 void NoAudioProcessor::Initialize(AudioCodec* codec) {
     codec_ = codec;
 }
 
 void NoAudioProcessor::Feed(const std::vector<int16_t>& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (!is_running_ || !output_callback_) {
         return;
     }
+#if CONFIG_USE_NO_PROCESSOR_VAD
+    bool active = vad_.Process(data.data(), data.size());
+    if (vad_.speaking() != is_speaking_) {
+        is_speaking_ = vad_.speaking();
+        if (vad_state_change_callback_) {
+            vad_state_change_callback_(is_speaking_);
+        }
+    }
+
+    if (pre_roll_.empty()) {
+        pre_roll_.resize(NO_PROCESSOR_VAD_PRE_ROLL_CHUNKS);
+    }
+    if (pre_roll_count_ == pre_roll_.size()) {
+        Emit(pre_roll_[pre_roll_head_]);
+        pre_roll_head_ = (pre_roll_head_ + 1) % pre_roll_.size();
+        pre_roll_count_--;
+    }
+    auto& chunk = pre_roll_[(pre_roll_head_ + pre_roll_count_) % pre_roll_.size()];
+    chunk.data.assign(data.begin(), data.end());
+    chunk.active = active;
+    pre_roll_count_++;
+    if (active) {
+        for (size_t i = 0; i < pre_roll_count_; i++) {
+            pre_roll_[(pre_roll_head_ + i) % pre_roll_.size()].active = true;
+        }
+    }
+#else
     // 直接将输入数据传递给输出回调
-    output_callback_(std::vector<int16_t>(data));
+    output_callback_(data.data(), data.size());
+#endif
+}
+
+void NoAudioProcessor::Emit(const PreRollChunk& chunk) {
+    if (!chunk.active) {
+        // 静音段送全零数据，时间轴保持连续，服务端断句不受影响，Opus DTX 把它压缩到几个字节
+        static auto silence_chunks = Metrics::GetInstance().Counter("vad.silence_chunks");
+        silence_chunks->Increment();
+        if (silence_.size() != chunk.data.size()) {
+            silence_.assign(chunk.data.size(), 0);
+        }
+        output_callback_(silence_.data(), silence_.size());
+        return;
+    }
+    output_callback_(chunk.data.data(), chunk.data.size());
 }
 
 void NoAudioProcessor::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    vad_.Reset();
+    // 上一次聆听留下的数据不再送出
+    pre_roll_head_ = 0;
+    pre_roll_count_ = 0;
+    is_speaking_ = false;
     is_running_ = true;
 }
 
 void NoAudioProcessor::Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 缓冲中最后约 90ms 的数据照常送出，不截掉句尾
+    while (pre_roll_count_ > 0) {
+        if (output_callback_) {
+            Emit(pre_roll_[pre_roll_head_]);
+        }
+        pre_roll_head_ = (pre_roll_head_ + 1) % pre_roll_.size();
+        pre_roll_count_--;
+    }
     is_running_ = false;
 }
 
@@ -27,7 +90,7 @@ bool NoAudioProcessor::IsRunning() {
     return is_running_;
 }
 
-void NoAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
+void NoAudioProcessor::OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) {
     output_callback_ = callback;
 }
 
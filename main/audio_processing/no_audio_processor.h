@@ -3,9 +3,11 @@
 
 #include <vector>
 #include <functional>
+#include <mutex>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "simple_vad.h"
 
 class NoAudioProcessor : public AudioProcessor {
 public:
@@ -17,16 +19,33 @@ public:
     void Start() override;
     void Stop() override;
     bool IsRunning() override;
-    void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) override;
+    void OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) override;
     void OnVadStateChange(std::function<void(bool speaking)> callback) override;
     size_t GetFeedSize() override;
     void EnableDeviceAec(bool enable) override;
 
 private:
     AudioCodec* codec_ = nullptr;
-    std::function<void(std::vector<int16_t>&& data)> output_callback_;
+    // Feed 在音频输入任务中调用，Start/Stop 在主任务中调用，预录缓冲和输出回调的调用由它串行化
+    std::mutex mutex_;
+    std::function<void(const int16_t* data, size_t samples)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     bool is_running_ = false;
+    bool is_speaking_ = false;
+    SimpleVad vad_;
+    std::vector<int16_t> silence_;
+
+    // 预录：输出比输入延迟 NO_PROCESSOR_VAD_PRE_ROLL_CHUNKS 块，
+    // 某块判为语音时，它之前仍在缓冲中的几块也按原样送出，不会吞掉弱起的首字
+    struct PreRollChunk {
+        std::vector<int16_t> data;
+        bool active = false;
+    };
+    std::vector<PreRollChunk> pre_roll_;
+    size_t pre_roll_head_ = 0;
+    size_t pre_roll_count_ = 0;
+
+    void Emit(const PreRollChunk& chunk);
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef OPUS_DECODE_RATE_H
+#define OPUS_DECODE_RATE_H
+
+// Opus 可以在这些采样率下直接解码任意采样率编码的码流
+inline bool IsOpusDecodeSampleRate(int sample_rate) {
+    return sample_rate == 8000 || sample_rate == 12000 || sample_rate == 16000 ||
+        sample_rate == 24000 || sample_rate == 48000;
+}
+
+// 解码器的采样率：编解码芯片的输出采样率是 Opus 支持的采样率时直接按该采样率解码，省去解码后的重采样；
+// 否则按码流的采样率解码，再重采样到输出采样率
+inline int OpusDecodeSampleRate(int output_sample_rate, int stream_sample_rate) {
+    return IsOpusDecodeSampleRate(output_sample_rate) ? output_sample_rate : stream_sample_rate;
+}
+
+#endif // OPUS_DECODE_RATE_H
@@ -0,0 +1,122 @@
+#include "opus_frame_encoder.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "OpusFrameEncoder"
+
+#define OPUS_FRAME_MAX_PACKET_BYTES 1500
+
+OpusFrameEncoder::OpusFrameEncoder(int sample_rate, int frame_duration_ms, size_t ring_frames)
+    : sample_rate_(sample_rate), duration_ms_(frame_duration_ms), ring_frames_(ring_frames), capture_us_(ring_frames) {
+    frame_samples_ = sample_rate * frame_duration_ms / 1000;
+
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, 1, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+    SetDtx(true);
+
+    // 环形缓冲区优先放在 PSRAM，每帧只被拷入和编码各读一次
+    size_t size = frame_samples_ * ring_frames_ * sizeof(int16_t);
+    ring_ = (int16_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ring_ == nullptr) {
+        ring_ = (int16_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    if (ring_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes frame ring", (unsigned)size);
+    }
+}
+
+OpusFrameEncoder::~OpusFrameEncoder() {
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+    if (ring_ != nullptr) {
+        heap_caps_free(ring_);
+    }
+}
+
+bool OpusFrameEncoder::Write(const int16_t* data, size_t samples, int64_t capture_end_us) {
+    if (ring_ == nullptr) {
+        return false;
+    }
+    bool frame_ready = false;
+    while (samples > 0) {
+        size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+        size_t frame = write_pos / frame_samples_;
+        if (frame - read_frame_.load(std::memory_order_acquire) >= ring_frames_) {
+            // 编码跟不上时丢弃新数据，已攒好的帧保持完整
+            dropped_samples_ += samples;
+            break;
+        }
+        size_t offset = write_pos % frame_samples_;
+        size_t count = std::min(samples, frame_samples_ - offset);
+        memcpy(ring_ + (frame % ring_frames_) * frame_samples_ + offset, data, count * sizeof(int16_t));
+        data += count;
+        samples -= count;
+        if (offset + count == frame_samples_) {
+            // 这一帧最后一个采样之后还有 samples 个采样，据此倒推帧首的采集时间
+            capture_us_[frame % ring_frames_] = capture_end_us == 0 ? 0 :
+                capture_end_us - (int64_t)(samples + frame_samples_) * 1000000 / sample_rate_;
+            frame_ready = true;
+        }
+        write_pos_.store(write_pos + count, std::memory_order_release);
+    }
+    return frame_ready;
+}
+
+bool OpusFrameEncoder::HasFrame() const {
+    return write_pos_.load(std::memory_order_acquire) / frame_samples_ > read_frame_.load(std::memory_order_relaxed);
+}
+
+bool OpusFrameEncoder::EncodeFrame(std::vector<uint8_t>& payload, int64_t* capture_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (encoder_ == nullptr || !HasFrame()) {
+        return false;
+    }
+    size_t read_frame = read_frame_.load(std::memory_order_relaxed);
+    const int16_t* pcm = ring_ + (read_frame % ring_frames_) * frame_samples_;
+    if (capture_us != nullptr) {
+        *capture_us = capture_us_[read_frame % ring_frames_];
+    }
+    payload.resize(OPUS_FRAME_MAX_PACKET_BYTES);
+    int ret = opus_encode(encoder_, pcm, frame_samples_, payload.data(), payload.size());
+    // 编码完成后才释放这一帧，生产者在此之前不会覆盖它
+    read_frame_.store(read_frame + 1, std::memory_order_release);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+        payload.clear();
+        return false;
+    }
+    payload.resize(ret);
+    return true;
+}
+
+void OpusFrameEncoder::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+    size_t frame = write_pos_.load(std::memory_order_relaxed) / frame_samples_;
+    write_pos_.store(frame * frame_samples_, std::memory_order_relaxed);
+    read_frame_.store(frame, std::memory_order_release);
+}
+
+void OpusFrameEncoder::SetComplexity(int complexity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
+    }
+}
+
+void OpusFrameEncoder::SetDtx(bool enable) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_DTX(enable ? 1 : 0));
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef OPUS_FRAME_ENCODER_H
+#define OPUS_FRAME_ENCODER_H
+
+#include <opus.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+/*
+ * 上行 Opus 编码器，自带按帧累积的 PCM 环形缓冲区。
+ * 生产者（音频处理任务）把任意长度的数据直接写入预分配的环形缓冲区，攒满一帧后由消费者（后台任务）
+ * 在缓冲区上就地编码到调用方提供的 payload 中，payload 的容量在复用时保留，稳态下不分配内存。
+ * Write 只允许一个线程调用且不加锁；编码器状态由 mutex_ 保护，EncodeFrame 与 Reset 可以在不同线程调用。
+ */
+class OpusFrameEncoder {
+public:
+    OpusFrameEncoder(int sample_rate, int frame_duration_ms, size_t ring_frames = 3);
+    ~OpusFrameEncoder();
+
+    // 写入 PCM，本次写入攒满至少一帧时返回 true；环形缓冲区满时丢弃新数据。
+    // capture_end_us 为本段最后一个采样的采集时间，用于推算每帧第一个采样的采集时间
+    bool Write(const int16_t* data, size_t samples, int64_t capture_end_us = 0);
+    bool HasFrame() const;
+    // 编码最早的完整帧，payload 调整为编码后的长度，capture_us 返回该帧第一个采样的采集时间
+    bool EncodeFrame(std::vector<uint8_t>& payload, int64_t* capture_us = nullptr);
+    // 丢弃未编码的数据并重置编码器状态，调用时生产者不能在写入
+    void Reset();
+
+    void SetComplexity(int complexity);
+    void SetDtx(bool enable);
+
+    int sample_rate() const { return sample_rate_; }
+    int duration_ms() const { return duration_ms_; }
+    size_t dropped_samples() const { return dropped_samples_; }
+
+private:
+    std::mutex mutex_;
+    OpusEncoder* encoder_ = nullptr;
+    int sample_rate_;
+    int duration_ms_;
+    size_t frame_samples_;
+    size_t ring_frames_;
+    int16_t* ring_ = nullptr;
+    std::vector<int64_t> capture_us_;
+    // write_pos_ 按采样计数、read_frame_ 按帧计数，都单调递增，取模后定位到环形缓冲区
+    std::atomic<size_t> write_pos_ = 0;
+    std::atomic<size_t> read_frame_ = 0;
+    size_t dropped_samples_ = 0;
+};
+
+#endif // OPUS_FRAME_ENCODER_H
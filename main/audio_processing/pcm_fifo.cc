@@ -0,0 +1,44 @@
+#include "pcm_fifo.h"
+
+PcmFifo::PcmFifo(size_t slots, size_t samples_per_slot) : slots_(slots), filled_(slots) {
+    free_.reserve(slots);
+    for (auto& slot : slots_) {
+        slot.pcm.reserve(samples_per_slot);
+        free_.push_back(&slot);
+    }
+}
+
+PcmSlot* PcmFifo::AcquireFree() {
+    if (free_.empty()) {
+        return nullptr;
+    }
+    auto slot = free_.back();
+    free_.pop_back();
+    return slot;
+}
+
+void PcmFifo::Commit(PcmSlot* slot) {
+    // 槽位总数固定，已解码的数量不可能超过容量
+    filled_[(filled_head_ + filled_count_) % filled_.size()] = slot;
+    filled_count_++;
+}
+
+void PcmFifo::Release(PcmSlot* slot) {
+    free_.push_back(slot);
+}
+
+PcmSlot* PcmFifo::PopFilled() {
+    if (filled_count_ == 0) {
+        return nullptr;
+    }
+    auto slot = filled_[filled_head_];
+    filled_head_ = (filled_head_ + 1) % filled_.size();
+    filled_count_--;
+    return slot;
+}
+
+void PcmFifo::Clear() {
+    while (auto slot = PopFilled()) {
+        Release(slot);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef PCM_FIFO_H
+#define PCM_FIFO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct PcmSlot {
+    std::vector<int16_t> pcm;
+    uint32_t timestamp = 0;     // 服务端 AEC 使用的包时间戳
+    int64_t decoded_us = 0;     // 解码完成时间，用于统计解码到播放的延迟
+};
+
+/*
+ * 解码与播放之间的定长 PCM 队列。
+ * 槽位在构造时预留容量并循环复用，解码直接写入空闲槽位，播放完后归还，稳态下不再分配内存。
+ * 本身不加锁，由调用方持有的互斥锁保护；槽位在 Acquire 之后、Commit/Release 之前由持有者独占。
+ */
+class PcmFifo {
+public:
+    PcmFifo(size_t slots, size_t samples_per_slot);
+
+    // 取一个空闲槽位用于解码，没有空闲槽位时返回 nullptr
+    PcmSlot* AcquireFree();
+    // 解码完成，放入播放队列尾部
+    void Commit(PcmSlot* slot);
+    // 解码失败或被中止，直接归还
+    void Release(PcmSlot* slot);
+
+    // 取队首已解码的槽位用于播放，播放完后调用 Release 归还
+    PcmSlot* PopFilled();
+
+    // 丢弃所有尚未播放的数据，正在解码或播放的槽位仍由持有者归还
+    void Clear();
+
+    size_t filled() const { return filled_count_; }
+    bool HasFree() const { return !free_.empty(); }
+
+private:
+    std::vector<PcmSlot> slots_;
+    std::vector<PcmSlot*> free_;
+    std::vector<PcmSlot*> filled_;
+    size_t filled_head_ = 0;
+    size_t filled_count_ = 0;
+};
+
+#endif // PCM_FIFO_H
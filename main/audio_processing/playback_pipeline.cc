@@ -0,0 +1,97 @@
+#include "playback_pipeline.h"
+#include "metrics.h"
+
+PlaybackPipeline::PlaybackPipeline(std::mutex& mutex, std::condition_variable& cv,
+                                   std::list<AudioStreamPacket>& decode_queue, BackgroundTask* background_task,
+                                   size_t slots, size_t samples_per_slot)
+    : mutex_(mutex), cv_(cv), decode_queue_(decode_queue), background_task_(background_task),
+      fifo_(slots, samples_per_slot) {
+}
+
+void PlaybackPipeline::OnPrepareDecode(std::function<void(const AudioStreamPacket& packet)> callback) {
+    on_prepare_decode_ = callback;
+}
+
+void PlaybackPipeline::OnDecode(std::function<bool(AudioStreamPacket&& packet, PcmSlot* slot)> callback) {
+    on_decode_ = callback;
+}
+
+void PlaybackPipeline::OnOutput(std::function<void(PcmSlot* slot)> callback) {
+    on_output_ = callback;
+}
+
+void PlaybackPipeline::OnQueryOutputPending(std::function<int()> callback) {
+    on_query_output_pending_ = callback;
+}
+
+bool PlaybackPipeline::CanDecodeNextPacket() const {
+    return !busy_decoding_ && fifo_.HasFree() && !decode_queue_.empty();
+}
+
+bool PlaybackPipeline::Idle() const {
+    return decode_queue_.empty() && !busy_decoding_ && fifo_.filled() == 0;
+}
+
+void PlaybackPipeline::Clear() {
+    fifo_.Clear();
+    generation_++;
+    rendering_ = false;
+}
+
+bool PlaybackPipeline::Step() {
+    static auto underruns = Metrics::GetInstance().Counter("audio.pcm_underruns");
+    static auto fifo_depth = Metrics::GetInstance().Gauge("audio.pcm_fifo");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (CanDecodeNextPacket()) {
+        auto slot = fifo_.AcquireFree();
+        auto packet = std::move(decode_queue_.front());
+        decode_queue_.pop_front();
+        busy_decoding_ = true;
+        uint32_t generation = generation_;
+        lock.unlock();
+        cv_.notify_all();
+
+        if (on_prepare_decode_) {
+            on_prepare_decode_(packet);
+        }
+        background_task_->Schedule([this, slot, generation, packet = std::move(packet)]() mutable {
+            bool decoded = on_decode_(std::move(packet), slot);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                busy_decoding_ = false;
+                // 解码期间被清空的话丢弃这一帧
+                if (decoded && generation == generation_) {
+                    fifo_.Commit(slot);
+                } else {
+                    fifo_.Release(slot);
+                }
+            }
+            cv_.notify_all();
+        });
+        lock.lock();
+    }
+
+    auto slot = fifo_.PopFilled();
+    if (slot == nullptr) {
+        if (!busy_decoding_ && decode_queue_.empty()) {
+            rendering_ = false;
+        }
+        return false;
+    }
+    fifo_depth->Set(fifo_.filled());
+    // 播放过程中 DMA 已经播空，说明解码或网络没跟上，喇叭上出现了一段静音
+    if (rendering_ && on_query_output_pending_() == 0) {
+        underruns->Increment();
+    }
+    rendering_ = true;
+    lock.unlock();
+
+    on_output_(slot);
+
+    lock.lock();
+    fifo_.Release(slot);
+    lock.unlock();
+    cv_.notify_all();
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef PLAYBACK_PIPELINE_H
+#define PLAYBACK_PIPELINE_H
+
+#include "pcm_fifo.h"
+#include "protocol.h"
+#include "background_task.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+
+/*
+ * 下行播放流水线：解码在后台任务中写入 PCM 队列的空闲槽位，播放任务从队列取帧写入 I2S。
+ * 每次先安排下一帧解码再阻塞写入当前帧，解码 N+1 与播放 N 并行；同一时刻最多一帧在解码，
+ * 解码期间被 Clear 的话丢弃这一帧。
+ * 待解码队列属于调用方，与流水线的状态由调用方的 mutex 一起保护；解码和写入由回调完成，不持锁。
+ */
+class PlaybackPipeline {
+public:
+    PlaybackPipeline(std::mutex& mutex, std::condition_variable& cv, std::list<AudioStreamPacket>& decode_queue,
+                     BackgroundTask* background_task, size_t slots, size_t samples_per_slot);
+
+    // 取出一包、交给后台任务之前在播放任务中调用，此时没有其他帧在解码，可以切换解码器
+    void OnPrepareDecode(std::function<void(const AudioStreamPacket& packet)> callback);
+    // 在后台任务中把一包解码到槽位，失败返回 false
+    void OnDecode(std::function<bool(AudioStreamPacket&& packet, PcmSlot* slot)> callback);
+    // 在播放任务中把一帧写入 I2S，阻塞到写入完成
+    void OnOutput(std::function<void(PcmSlot* slot)> callback);
+    // 返回 DMA 中尚未播放的时长，播放过程中为 0 说明出现了断流
+    void OnQueryOutputPending(std::function<int()> callback);
+
+    // 安排下一帧解码并播放一帧已解码的帧，调用方不能持有 mutex；没有可播放的帧时返回 false
+    bool Step();
+
+    // 以下调用方需持有 mutex
+    bool CanDecodeNextPacket() const;
+    bool HasFilled() const { return fifo_.filled() > 0; }
+    // 待解码队列为空、没有帧在解码且没有已解码的帧
+    bool Idle() const;
+    // 丢弃已解码未播放的帧，正在解码的帧完成后丢弃；待解码队列由调用方清空
+    void Clear();
+
+private:
+    friend class PlaybackPipelineTest;
+
+    std::mutex& mutex_;
+    std::condition_variable& cv_;
+    std::list<AudioStreamPacket>& decode_queue_;
+    BackgroundTask* background_task_;
+    PcmFifo fifo_;
+    bool busy_decoding_ = false;
+    bool rendering_ = false;
+    uint32_t generation_ = 0;
+
+    std::function<void(const AudioStreamPacket&)> on_prepare_decode_;
+    std::function<bool(AudioStreamPacket&&, PcmSlot*)> on_decode_;
+    std::function<void(PcmSlot*)> on_output_;
+    std::function<int()> on_query_output_pending_;
+};
+
+#endif // PLAYBACK_PIPELINE_H
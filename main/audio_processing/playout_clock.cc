@@ -0,0 +1,96 @@
+#include "playout_clock.h"
+
+#include <algorithm>
+#include <limits>
+
+#define PLAYOUT_GAP_US          20000       // 测得的开始时间偏离推算值超过此值视为断流，重新起段
+#define PLAYOUT_WINDOW_US       4000000     // 每个窗口取一次测量误差的下包络
+#define PLAYOUT_MAX_DRIFT_PPM   1000
+
+PlayoutClock::PlayoutClock(size_t capacity) : anchors_(capacity) {
+}
+
+void PlayoutClock::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    head_ = 0;
+    count_ = 0;
+    continuous_ = false;
+}
+
+int64_t PlayoutClock::PredictUs(int64_t samples) const {
+    int64_t nominal = samples * 1000000 / segment_rate_;
+    return nominal + nominal * drift_ppm_ / 1000000;
+}
+
+void PlayoutClock::OnRender(uint32_t timestamp, size_t samples, int sample_rate, int64_t now_us, int pending_us) {
+    if (samples == 0 || sample_rate <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // DMA 水位按整块统计，正在播放的那块算作未播放，测得的开始时间只会偏晚
+    int64_t measured_us = now_us + pending_us - (int64_t)samples * 1000000 / sample_rate;
+
+    if (continuous_ && sample_rate == segment_rate_) {
+        int64_t predicted_us = segment_start_us_ + PredictUs(segment_samples_);
+        int64_t residual = measured_us - predicted_us;
+        if (residual > PLAYOUT_GAP_US || residual < -PLAYOUT_GAP_US) {
+            continuous_ = false;
+        } else {
+            min_residual_us_ = std::min(min_residual_us_, residual);
+            int64_t elapsed = predicted_us - window_start_us_;
+            if (elapsed >= PLAYOUT_WINDOW_US) {
+                // 下包络应当为零：按它修正当前帧的开始时间并以此为新起点，漂移的变化只影响之后的推算；
+                // 第一个窗口只消除起段时的测量偏差，之后的残余偏移按斜率计入漂移
+                segment_start_us_ = predicted_us + min_residual_us_;
+                segment_samples_ = 0;
+                if (!first_window_) {
+                    int ppm = (int)(min_residual_us_ * 1000000 / elapsed);
+                    drift_ppm_ = std::clamp(drift_ppm_ + ppm / 4, -PLAYOUT_MAX_DRIFT_PPM, PLAYOUT_MAX_DRIFT_PPM);
+                }
+                first_window_ = false;
+                window_start_us_ = segment_start_us_;
+                min_residual_us_ = std::numeric_limits<int64_t>::max();
+            }
+        }
+    }
+    if (!continuous_ || sample_rate != segment_rate_) {
+        continuous_ = true;
+        segment_rate_ = sample_rate;
+        segment_start_us_ = measured_us;
+        segment_samples_ = 0;
+        window_start_us_ = measured_us;
+        min_residual_us_ = std::numeric_limits<int64_t>::max();
+        first_window_ = true;
+    }
+
+    auto& anchor = anchors_[(head_ + count_) % anchors_.size()];
+    anchor.start_us = segment_start_us_ + PredictUs(segment_samples_);
+    segment_samples_ += samples;
+    anchor.end_us = segment_start_us_ + PredictUs(segment_samples_);
+    anchor.timestamp = timestamp;
+    anchor.duration_ms = samples * 1000 / sample_rate;
+    if (count_ < anchors_.size()) {
+        count_++;
+    } else {
+        head_ = (head_ + 1) % anchors_.size();
+    }
+}
+
+uint32_t PlayoutClock::Lookup(int64_t capture_us) {
+    if (capture_us <= 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = count_; i > 0; i--) {
+        const auto& anchor = anchors_[(head_ + i - 1) % anchors_.size()];
+        if (capture_us < anchor.start_us) {
+            continue;
+        }
+        if (capture_us >= anchor.end_us) {
+            return 0;
+        }
+        return anchor.timestamp + (uint32_t)((capture_us - anchor.start_us) * anchor.duration_ms /
+            (anchor.end_us - anchor.start_us));
+    }
+    return 0;
+}
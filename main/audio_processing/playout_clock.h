@@ -0,0 +1,54 @@
+#ifndef PLAYOUT_CLOCK_H
+#define PLAYOUT_CLOCK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+
+/*
+ * 服务端 AEC 使用的播放时钟模型。
+ * 每帧写入 DMA 后记录它在本地时间轴上的播放区间和服务端时间戳，保存在定长环形缓冲区中；
+ * 上行每帧按第一个采样的采集时间查找当时正在播放的帧，插值得到对应的服务端时间戳。
+ * 连续播放时帧的开始时间按已播放的采样数推算，精确到采样；DMA 水位测得的时间只用来发现断流，
+ * 以及通过其下包络修正起点和 I2S 时钟相对 esp_timer 的漂移。
+ */
+class PlayoutClock {
+public:
+    explicit PlayoutClock(size_t capacity = 32);
+
+    // 一帧写入 DMA 之后调用，pending_us 为写入后 DMA 中尚未播放的时长（包含这一帧）
+    void OnRender(uint32_t timestamp, size_t samples, int sample_rate, int64_t now_us, int pending_us);
+    // 返回 capture_us 时刻喇叭正在播放的内容对应的服务端时间戳（毫秒），当时没有播放则返回 0
+    uint32_t Lookup(int64_t capture_us);
+    void Reset();
+
+    int drift_ppm() const { return drift_ppm_; }
+
+private:
+    struct Anchor {
+        int64_t start_us;
+        int64_t end_us;
+        uint32_t timestamp;
+        uint32_t duration_ms;
+    };
+
+    std::mutex mutex_;
+    std::vector<Anchor> anchors_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+
+    // 当前连续播放段
+    bool continuous_ = false;
+    int segment_rate_ = 0;
+    int64_t segment_start_us_ = 0;
+    int64_t segment_samples_ = 0;
+    int64_t min_residual_us_ = 0;
+    int64_t window_start_us_ = 0;
+    bool first_window_ = true;
+    int drift_ppm_ = 0;
+
+    int64_t PredictUs(int64_t samples) const;
+};
+
+#endif // PLAYOUT_CLOCK_H
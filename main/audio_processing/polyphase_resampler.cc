@@ -0,0 +1,284 @@
+#include "polyphase_resampler.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#define TAG "PolyphaseResampler"
+
+// 滤波器组系数上限，16k→44.1k 需要 441 相位 x 32 抽头
+#define POLYPHASE_MAX_COEFFICIENTS 16384
+#define POLYPHASE_DEFAULT_TAPS 48
+#define POLYPHASE_KAISER_BETA 8.0f
+// 超过该大小的滤波器组优先放在 PSRAM
+#define POLYPHASE_INTERNAL_BANK_BYTES 4096
+
+namespace {
+
+struct RatioConfig {
+    int input_sample_rate;
+    int output_sample_rate;
+    int taps;           // 每个相位的抽头数，即滤波器覆盖的输入采样数
+    float cutoff;       // 截止频率，相对较低一侧的奈奎斯特频率
+};
+
+// 抽头数按较低采样率一侧约 1.5kHz 过渡带、60dB 阻带选取
+const RatioConfig kRatioConfigs[] = {
+    { 16000, 24000, 32, 0.95f },
+    { 24000, 16000, 48, 0.95f },
+    { 16000, 48000, 32, 0.95f },
+    { 48000, 16000, 96, 0.95f },
+    { 44100, 16000, 64, 0.92f },
+    { 16000, 44100, 32, 0.95f },
+};
+
+float BesselI0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+        if (term < sum * 1e-9f) {
+            break;
+        }
+    }
+    return sum;
+}
+
+// 同一比例的滤波器组只生成一次，按引用计数在最后一个实例释放时回收
+struct FilterBank {
+    int up;
+    int down;
+    int taps;
+    float cutoff;
+    int16_t* coefficients;
+    int users;
+};
+
+std::mutex filter_banks_mutex;
+std::vector<FilterBank> filter_banks;
+
+int16_t* BuildFilterBank(int up, int down, int taps, float cutoff) {
+    size_t count = up * taps;
+    size_t bytes = count * sizeof(int16_t);
+    // 每个输出只读取一个相位的 taps 个连续系数，放在 PSRAM 时基本都命中 cache
+    int16_t* bank = nullptr;
+    if (bytes > POLYPHASE_INTERNAL_BANK_BYTES) {
+        bank = (int16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    }
+    if (bank == nullptr) {
+        bank = (int16_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (bank == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %u coefficients", (unsigned)count);
+        return nullptr;
+    }
+
+    // 原型低通工作在 L 倍上采样后的采样率，截止频率取两侧奈奎斯特频率中较低者；
+    // 系数按需计算，不为整个原型分配临时缓冲区
+    float fc = cutoff * 0.5f / std::max(up, down);
+    float center = (count - 1) / 2.0f;
+    float i0_beta = BesselI0(POLYPHASE_KAISER_BETA);
+    auto prototype = [&](size_t n) {
+        float t = n - center;
+        float sinc = t == 0 ? 2.0f * fc : sinf(2.0f * (float)M_PI * fc * t) / ((float)M_PI * t);
+        float r = 2.0f * n / (count - 1) - 1.0f;
+        return sinc * BesselI0(POLYPHASE_KAISER_BETA * sqrtf(std::max(0.0f, 1.0f - r * r))) / i0_beta;
+    };
+
+    // 相位 p 的第 k 个系数作用于距离最新采样 k 个输入采样的数据，逆序存放以便与历史数据正序点积；
+    // 每个相位单独归一化并把量化误差补到中心抽头，保证直流增益精确为 1
+    std::vector<float> phase(taps);
+    for (int p = 0; p < up; p++) {
+        float sum = 0;
+        for (int k = 0; k < taps; k++) {
+            phase[k] = prototype(p + k * up);
+            sum += phase[k];
+        }
+        int16_t* coefficients = bank + p * taps;
+        int total = 0;
+        for (int k = 0; k < taps; k++) {
+            int value = (int)lrintf(phase[k] / sum * 32768.0f);
+            coefficients[taps - 1 - k] = std::clamp(value, -32768, 32767);
+            total += coefficients[taps - 1 - k];
+        }
+        coefficients[taps / 2] = std::clamp(coefficients[taps / 2] + 32768 - total, -32768, 32767);
+    }
+    return bank;
+}
+
+const int16_t* AcquireSharedBank(int up, int down, int taps, float cutoff) {
+    std::lock_guard<std::mutex> lock(filter_banks_mutex);
+    for (auto& bank : filter_banks) {
+        if (bank.up == up && bank.down == down && bank.taps == taps && bank.cutoff == cutoff) {
+            bank.users++;
+            return bank.coefficients;
+        }
+    }
+    int16_t* coefficients = BuildFilterBank(up, down, taps, cutoff);
+    if (coefficients != nullptr) {
+        filter_banks.push_back({ up, down, taps, cutoff, coefficients, 1 });
+    }
+    return coefficients;
+}
+
+void ReleaseSharedBank(const int16_t* coefficients) {
+    std::lock_guard<std::mutex> lock(filter_banks_mutex);
+    for (auto it = filter_banks.begin(); it != filter_banks.end(); ++it) {
+        if (it->coefficients == coefficients) {
+            if (--it->users == 0) {
+                heap_caps_free(it->coefficients);
+                filter_banks.erase(it);
+            }
+            return;
+        }
+    }
+}
+
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler() {
+}
+
+PolyphaseResampler::~PolyphaseResampler() {
+    ReleaseFilterBank();
+}
+
+void PolyphaseResampler::ReleaseFilterBank() {
+    if (bank_ != nullptr) {
+        ReleaseSharedBank(bank_);
+        bank_ = nullptr;
+    }
+}
+
+template <int kChannels>
+PolyphaseResampler::Kernel PolyphaseResampler::SelectKernel(int taps) {
+    switch (taps) {
+    case 32:
+        return &PolyphaseResampler::Run<32, kChannels>;
+    case 48:
+        return &PolyphaseResampler::Run<48, kChannels>;
+    case 64:
+        return &PolyphaseResampler::Run<64, kChannels>;
+    case 96:
+        return &PolyphaseResampler::Run<96, kChannels>;
+    default:
+        return &PolyphaseResampler::Run<0, kChannels>;
+    }
+}
+
+bool PolyphaseResampler::Configure(int input_sample_rate, int output_sample_rate, int channels) {
+    if (input_sample_rate <= 0 || output_sample_rate <= 0 || channels < 1 || channels > 2) {
+        ESP_LOGE(TAG, "Invalid configuration: %d -> %d, %d channels", input_sample_rate, output_sample_rate, channels);
+        return false;
+    }
+
+    int divisor = std::gcd(input_sample_rate, output_sample_rate);
+    int up = output_sample_rate / divisor;
+    int down = input_sample_rate / divisor;
+    int taps = POLYPHASE_DEFAULT_TAPS;
+    float cutoff = 0.9f;
+    for (const auto& config : kRatioConfigs) {
+        if (config.input_sample_rate == input_sample_rate && config.output_sample_rate == output_sample_rate) {
+            taps = config.taps;
+            cutoff = config.cutoff;
+            break;
+        }
+    }
+    if (up * taps > POLYPHASE_MAX_COEFFICIENTS) {
+        ESP_LOGE(TAG, "Unsupported ratio %d -> %d (%d/%d)", input_sample_rate, output_sample_rate, up, down);
+        return false;
+    }
+
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    channels_ = channels;
+    up_ = up;
+    down_ = down;
+    taps_ = taps;
+    kernel_ = channels == 2 ? SelectKernel<2>(taps) : SelectKernel<1>(taps);
+    ReleaseFilterBank();
+    bank_ = AcquireSharedBank(up, down, taps, cutoff);
+    Reset();
+
+    ESP_LOGI(TAG, "Configured %d -> %d Hz, L/M = %d/%d, %d taps, %d channels",
+        input_sample_rate, output_sample_rate, up, down, taps, channels);
+    return bank_ != nullptr;
+}
+
+void PolyphaseResampler::Reset() {
+    // 以 taps_ - 1 个零作为初始历史，第一个输入采样即可产生输出
+    for (int c = 0; c < channels_; c++) {
+        history_[c].assign(taps_ - 1, 0);
+    }
+    history_size_ = taps_ - 1;
+    position_ = 0;
+    phase_ = 0;
+}
+
+size_t PolyphaseResampler::GetOutputSamples(size_t input_samples) const {
+    if (kernel_ == nullptr || bank_ == nullptr) {
+        return 0;
+    }
+    // 第 k 个输出需要的最新采样位置为 position_ + taps_ - 1 + (phase_ + k * down_) / up_
+    long available = (long)(history_size_ + input_samples / channels_) - (long)(position_ + taps_);
+    if (available < 0) {
+        return 0;
+    }
+    long limit = (available + 1) * up_ - phase_;
+    return (size_t)((limit + down_ - 1) / down_) * channels_;
+}
+
+size_t PolyphaseResampler::Process(const int16_t* input, size_t input_samples, int16_t* output) {
+    if (kernel_ == nullptr || bank_ == nullptr) {
+        return 0;
+    }
+
+    size_t frames = input_samples / channels_;
+    for (int c = 0; c < channels_; c++) {
+        auto& history = history_[c];
+        if (history.size() < history_size_ + frames) {
+            history.resize(history_size_ + frames);
+        }
+        int16_t* dest = history.data() + history_size_;
+        for (size_t i = 0; i < frames; i++) {
+            dest[i] = input[i * channels_ + c];
+        }
+    }
+    history_size_ += frames;
+
+    size_t produced = (this->*kernel_)(output);
+
+    // 丢弃已经用不到的采样，只保留下一个输出窗口起点之后的数据
+    for (int c = 0; c < channels_; c++) {
+        memmove(history_[c].data(), history_[c].data() + position_, (history_size_ - position_) * sizeof(int16_t));
+    }
+    history_size_ -= position_;
+    position_ = 0;
+    return produced;
+}
+
+template <int kTaps, int kChannels>
+size_t PolyphaseResampler::Run(int16_t* output) {
+    const int taps = kTaps > 0 ? kTaps : taps_;
+    int16_t* out = output;
+    while (position_ + taps <= history_size_) {
+        const int16_t* coefficients = bank_ + phase_ * taps;
+        for (int c = 0; c < kChannels; c++) {
+            const int16_t* x = history_[c].data() + position_;
+            int32_t acc = 1 << 14;
+            for (int k = 0; k < taps; k++) {
+                acc += (int32_t)coefficients[k] * x[k];
+            }
+            *out++ = (int16_t)std::clamp(acc >> 15, (int32_t)-32768, (int32_t)32767);
+        }
+        phase_ += down_;
+        position_ += phase_ / up_;
+        phase_ %= up_;
+    }
+    return out - output;
+}
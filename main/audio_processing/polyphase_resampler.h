@@ -0,0 +1,58 @@
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ * 定点多相重采样器：Q15 系数，32 位累加，输出饱和到 16 位。
+ * 常用比例（16k↔24k、16k↔48k、44.1k→16k）使用预设的抽头数，内核按抽头数和声道数模板特化，
+ * 内层循环在编译期确定长度；其他比例按最简分数 L/M 生成滤波器组，使用通用内核。
+ * 双声道输入为 mic/ref 交错排列，一次调用同时处理两个声道，输出同样交错。
+ * 滤波器组只读，相同比例的实例共用一份；较大的滤波器组（如 44.1k 相关比例）放在 PSRAM。
+ */
+class PolyphaseResampler {
+public:
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    bool Configure(int input_sample_rate, int output_sample_rate, int channels = 1);
+    void Reset();
+
+    // 返回值与紧接着以相同输入长度调用 Process 的输出采样数（含所有声道）完全一致
+    size_t GetOutputSamples(size_t input_samples) const;
+    size_t Process(const int16_t* input, size_t input_samples, int16_t* output);
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+    int channels() const { return channels_; }
+    int taps() const { return taps_; }
+
+private:
+    using Kernel = size_t (PolyphaseResampler::*)(int16_t* output);
+
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int channels_ = 1;
+    int up_ = 1;
+    int down_ = 1;
+    int taps_ = 0;
+    // up_ 组相位，每组 taps_ 个系数，按输入时间正序存放，与历史数据顺序点积；与同比例的实例共用
+    const int16_t* bank_ = nullptr;
+    Kernel kernel_ = nullptr;
+
+    // 每个声道独立的连续历史缓冲区，前 taps_ - 1 个为上一次调用留下的采样
+    std::vector<int16_t> history_[2];
+    size_t history_size_ = 0;
+    size_t position_ = 0;
+    int phase_ = 0;
+
+    void ReleaseFilterBank();
+    template <int kChannels>
+    static Kernel SelectKernel(int taps);
+    template <int kTaps, int kChannels>
+    size_t Run(int16_t* output);
+};
+
+#endif // POLYPHASE_RESAMPLER_H
@@ -0,0 +1,208 @@
+#include "reference_aligner.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+
+#include "metrics.h"
+
+#define TAG "ReferenceAligner"
+
+#define ALIGNER_WINDOW_MS           1000
+#define ALIGNER_MIN_REF_POWER       (200 * 200)     // 抽取后参考的均方值，低于此值视为没有播放
+#define ALIGNER_MIN_CORRELATION     0.2f            // 归一化互相关峰值低于此值的窗口丢弃
+#define ALIGNER_SAFETY_MARGIN_Q8    (16 * 256)      // 补偿后保留 1ms 余量，保证 AEC 滤波器因果
+#define ALIGNER_HYSTERESIS_Q8       64              // 补偿量变化不足 0.25 个采样时不调整
+
+ReferenceAligner::ReferenceAligner() {
+}
+
+void ReferenceAligner::Configure(int sample_rate, int channels) {
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    enabled_ = channels >= 2 && channels <= kMaxChannels;
+    window_size_ = sample_rate * ALIGNER_WINDOW_MS / 1000 / kDecimation;
+    for (auto& line : lines_) {
+        line = DelayLine();
+    }
+    has_estimate_ = false;
+    delay_q8_ = 0;
+    applied_q8_ = 0;
+    Restart();
+}
+
+void ReferenceAligner::Restart() {
+    decimate_mic_ = 0;
+    decimate_ref_ = 0;
+    decimate_count_ = 0;
+    std::fill(std::begin(mic_history_), std::end(mic_history_), 0);
+    std::fill(std::begin(ref_history_), std::end(ref_history_), 0);
+    ResetWindow();
+}
+
+void ReferenceAligner::ResetWindow() {
+    std::fill(std::begin(correlation_), std::end(correlation_), 0);
+    mic_energy_ = 0;
+    ref_energy_ = 0;
+    ref_power_ = 0;
+    window_count_ = 0;
+}
+
+int ReferenceAligner::delay_us() const {
+    return (int)((int64_t)delay_q8_ * 1000000 / 256 / sample_rate_);
+}
+
+void ReferenceAligner::Process(int16_t* data, size_t frames) {
+    if (!enabled_) {
+        return;
+    }
+    const int ref = channels_ - 1;
+    for (size_t i = 0; i < frames; i++) {
+        int16_t* frame = data + i * channels_;
+        // 估计使用未对齐的原始数据，得到的是绝对延迟
+        decimate_mic_ += frame[0];
+        decimate_ref_ += frame[ref];
+        if (++decimate_count_ == kDecimation) {
+            Accumulate(decimate_mic_ / kDecimation, decimate_ref_ / kDecimation);
+            decimate_mic_ = 0;
+            decimate_ref_ = 0;
+            decimate_count_ = 0;
+        }
+
+        if (applied_q8_ != 0) {
+            for (int c = 0; c < channels_; c++) {
+                frame[c] = Delay(lines_[c], frame[c]);
+            }
+            delay_pos_ = (delay_pos_ + 1) % kDelayLineSize;
+        }
+    }
+}
+
+void ReferenceAligner::Accumulate(int32_t mic, int32_t ref) {
+    // 一阶差分白化，使互相关峰更尖锐，效果接近 PHAT 加权
+    int32_t white_mic = mic - last_mic_;
+    int32_t white_ref = ref - last_ref_;
+    last_mic_ = mic;
+    last_ref_ = ref;
+    ref_power_ += ref * ref;
+
+    history_pos_ = (history_pos_ + 1) % kHistorySize;
+    mic_history_[history_pos_] = (int16_t)std::clamp(white_mic, (int32_t)-32768, (int32_t)32767);
+    ref_history_[history_pos_] = (int16_t)std::clamp(white_ref, (int32_t)-32768, (int32_t)32767);
+
+    // 麦克风延后 kNegativeLags 个采样参与计算，负延迟也只需要参考的历史数据
+    size_t mic_pos = (history_pos_ + kHistorySize - kNegativeLags) % kHistorySize;
+    int32_t m = mic_history_[mic_pos];
+    mic_energy_ += m * m;
+    int32_t r0 = ref_history_[mic_pos];
+    ref_energy_ += r0 * r0;
+    if (m != 0) {
+        for (int lag = -kNegativeLags; lag <= kPositiveLags; lag++) {
+            size_t ref_pos = (mic_pos + kHistorySize - lag) % kHistorySize;
+            correlation_[lag + kNegativeLags] += m * (int32_t)ref_history_[ref_pos];
+        }
+    }
+
+    if (++window_count_ >= window_size_) {
+        Evaluate();
+        ResetWindow();
+    }
+}
+
+void ReferenceAligner::Evaluate() {
+    if (ref_power_ / window_count_ < ALIGNER_MIN_REF_POWER || mic_energy_ == 0 || ref_energy_ == 0) {
+        return;
+    }
+
+    // 回声可能反相，按绝对值找峰
+    int peak = 0;
+    for (int i = 1; i < kLagCount; i++) {
+        if (llabs(correlation_[i]) > llabs(correlation_[peak])) {
+            peak = i;
+        }
+    }
+    float sign = correlation_[peak] < 0 ? -1.0f : 1.0f;
+    float y1 = sign * correlation_[peak];
+    float rho = y1 / sqrtf((float)mic_energy_ * (float)ref_energy_);
+    if (rho < ALIGNER_MIN_CORRELATION) {
+        ESP_LOGD(TAG, "Correlation too weak: %.2f", rho);
+        return;
+    }
+
+    // 抛物线插值得到亚采样精度。差分白化后主峰两侧是负的旁瓣，邻点要按峰的符号取值而不能取绝对值
+    float offset = 0;
+    if (peak > 0 && peak < kLagCount - 1) {
+        float y0 = sign * correlation_[peak - 1];
+        float y2 = sign * correlation_[peak + 1];
+        float denominator = y0 - 2 * y1 + y2;
+        if (denominator < 0) {
+            offset = std::clamp(0.5f * (y0 - y2) / denominator, -0.5f, 0.5f);
+        }
+    }
+    float lag = (peak - kNegativeLags + offset) * kDecimation;
+    int32_t estimate_q8 = (int32_t)lrintf(lag * 256);
+
+    if (!has_estimate_) {
+        delay_q8_ = estimate_q8;
+        has_estimate_ = true;
+    } else {
+        delay_q8_ += (estimate_q8 - delay_q8_) / 2;
+    }
+    ESP_LOGI(TAG, "Echo delay %.2f samples (rho %.2f), smoothed %.2f", lag, rho, delay_q8_ / 256.0f);
+
+    static auto delay_gauge = Metrics::GetInstance().Gauge("aec.ref_delay_us");
+    delay_gauge->Set(delay_us());
+    UpdateCompensation();
+}
+
+void ReferenceAligner::UpdateCompensation() {
+    int32_t compensation = delay_q8_ - ALIGNER_SAFETY_MARGIN_Q8;
+    compensation = std::clamp(compensation, -(kDelayLineSize - 4) * 256, (kDelayLineSize - 4) * 256);
+    if (abs(compensation - applied_q8_) < ALIGNER_HYSTERESIS_Q8) {
+        return;
+    }
+    applied_q8_ = compensation;
+    const int ref = channels_ - 1;
+    for (int c = 0; c < channels_; c++) {
+        bool delayed = c == ref ? compensation > 0 : compensation < 0;
+        SetDelay(lines_[c], delayed ? abs(compensation) : 0);
+    }
+}
+
+void ReferenceAligner::SetDelay(DelayLine& line, int32_t delay_q8) {
+    int delay = delay_q8 >> 8;
+    float mu = (delay_q8 & 0xFF) / 256.0f;
+    float h[4];
+    if (delay == 0) {
+        // 不足一个采样时没有未来数据可用，退化为线性插值
+        h[0] = 0;
+        h[1] = 1 - mu;
+        h[2] = mu;
+        h[3] = 0;
+    } else {
+        // 三阶拉格朗日插值，节点为 delay-1 .. delay+2
+        h[0] = -mu * (mu - 1) * (mu - 2) / 6;
+        h[1] = (mu + 1) * (mu - 1) * (mu - 2) / 2;
+        h[2] = -(mu + 1) * mu * (mu - 2) / 2;
+        h[3] = (mu + 1) * mu * (mu - 1) / 6;
+    }
+    line.delay = delay;
+    for (int k = 0; k < 4; k++) {
+        line.coefficients[k] = (int16_t)std::clamp((int)lrintf(h[k] * 32768.0f), -32768, 32767);
+    }
+}
+
+int16_t ReferenceAligner::Delay(DelayLine& line, int16_t sample) {
+    line.history[delay_pos_] = sample;
+    int32_t acc = 1 << 14;
+    for (int k = 0; k < 4; k++) {
+        int offset = line.delay - 1 + k;
+        if (offset < 0) {
+            continue;
+        }
+        acc += line.coefficients[k] * line.history[(delay_pos_ + kDelayLineSize - offset) % kDelayLineSize];
+    }
+    return (int16_t)std::clamp(acc >> 15, (int32_t)-32768, (int32_t)32767);
+}
@@ -0,0 +1,77 @@
+#ifndef REFERENCE_ALIGNER_H
+#define REFERENCE_ALIGNER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * 设备端 AEC 的回采参考对齐。
+ * 麦克风与回采参考交错输入（参考为最后一个声道），在 4 倍抽取并一阶差分白化后的信号上
+ * 持续累积互相关，每个窗口找出回声相对参考的延迟，再用分数延迟线延后参考（或在回声超前时延后麦克风），
+ * 让 AEC 滤波器不用把抽头浪费在固定延迟上。只有参考有足够能量（正在播放）的窗口才参与估计。
+ */
+class ReferenceAligner {
+public:
+    ReferenceAligner();
+
+    void Configure(int sample_rate, int channels);
+    // 会话开始时清空累积的互相关，已有的延迟估计保留作为初值
+    void Restart();
+    // 就地处理 frames 帧交错数据
+    void Process(int16_t* data, size_t frames);
+
+    // 估计出的回声相对参考的延迟，正值表示参考超前
+    int delay_us() const;
+    bool has_estimate() const { return has_estimate_; }
+
+private:
+    static constexpr int kMaxChannels = 4;
+    static constexpr int kDecimation = 4;
+    static constexpr int kNegativeLags = 16;    // 抽取后，回声超前参考最多 4ms
+    static constexpr int kPositiveLags = 200;   // 抽取后，参考超前回声最多 50ms
+    static constexpr int kLagCount = kNegativeLags + kPositiveLags + 1;
+    static constexpr int kHistorySize = 256;    // 抽取后信号的环形缓冲区，需大于 kLagCount
+    static constexpr int kDelayLineSize = 1024; // 原始采样率下分数延迟线长度
+
+    struct DelayLine {
+        int delay = 0;              // 整数部分
+        int16_t coefficients[4] = { 0, 32767, 0, 0 };   // Q15，作用于 delay-1 .. delay+2
+        int16_t history[kDelayLineSize] = {};
+    };
+
+    int sample_rate_ = 16000;
+    int channels_ = 1;
+    bool enabled_ = false;
+
+    // 互相关估计
+    int32_t decimate_mic_ = 0;
+    int32_t decimate_ref_ = 0;
+    int decimate_count_ = 0;
+    int32_t last_mic_ = 0;
+    int32_t last_ref_ = 0;
+    int16_t mic_history_[kHistorySize] = {};
+    int16_t ref_history_[kHistorySize] = {};
+    size_t history_pos_ = 0;
+    int64_t correlation_[kLagCount] = {};
+    int64_t mic_energy_ = 0;
+    int64_t ref_energy_ = 0;
+    int64_t ref_power_ = 0;
+    int window_count_ = 0;
+    int window_size_ = 0;
+
+    // 对齐
+    bool has_estimate_ = false;
+    int32_t delay_q8_ = 0;          // 估计的延迟，Q8 采样
+    int32_t applied_q8_ = 0;        // 当前生效的补偿量，正值延后参考、负值延后麦克风
+    size_t delay_pos_ = 0;
+    DelayLine lines_[kMaxChannels];
+
+    void Accumulate(int32_t mic, int32_t ref);
+    void Evaluate();
+    void ResetWindow();
+    void UpdateCompensation();
+    static void SetDelay(DelayLine& line, int32_t delay_q8);
+    int16_t Delay(DelayLine& line, int16_t sample);
+};
+
+#endif // REFERENCE_ALIGNER_H
@@ -0,0 +1,163 @@
+#include "simple_vad.h"
+
+#include <algorithm>
+#include <cstring>
+
+// 各门限的能量单位为 log2(均方值) 的 Q8，256 约等于 3dB
+#define VAD_MIN_SPEECH_ENERGY   (12 * 256)  // 约 -50dBFS，低于此值直接视为静音
+#define VAD_INITIAL_NOISE_FLOOR (9 * 256)   // 约 -60dBFS，安静房间的底噪
+#define VAD_WARMUP_SUBFRAMES    50          // 冷启动预热窗口 500ms
+#define VAD_SPEECH_MARGIN       (3 * 256)   // 高出噪声底约 9dB
+#define VAD_FLATNESS_THRESHOLD  11469       // 预测残差比 0.35，Q15
+#define VAD_MAX_VOICED_ZCR      11469       // 过零率 0.35，Q15
+#define VAD_ONSET_SUBFRAMES     3           // 连续 30ms 语音候选进入说话状态
+#define VAD_HANGOVER_SUBFRAMES  30          // 静音 300ms 后退出说话状态
+
+SimpleVad::SimpleVad(int sample_rate) {
+    subframe_samples_ = std::clamp(sample_rate / 100, 1, kMaxSubframeSamples);
+    noise_floor_ = VAD_INITIAL_NOISE_FLOOR;
+    Reset();
+}
+
+// 底噪在多次聆听之间保留，同一环境下每次开始聆听都不需要重新收敛
+void SimpleVad::Reset() {
+    pending_samples_ = 0;
+    speech_run_ = 0;
+    silence_run_ = 0;
+    speaking_ = false;
+}
+
+bool SimpleVad::Process(const int16_t* data, size_t samples) {
+    bool active = speaking_;
+    while (samples > 0) {
+        // 不足一个子帧的尾部留到下一次凑齐
+        if (pending_samples_ > 0 || samples < (size_t)subframe_samples_) {
+            size_t count = std::min(samples, (size_t)(subframe_samples_ - pending_samples_));
+            memcpy(pending_ + pending_samples_, data, count * sizeof(int16_t));
+            pending_samples_ += count;
+            data += count;
+            samples -= count;
+            if (pending_samples_ < subframe_samples_) {
+                break;
+            }
+            pending_samples_ = 0;
+            active |= AnalyzeSubframe(pending_);
+        } else {
+            active |= AnalyzeSubframe(data);
+            data += subframe_samples_;
+            samples -= subframe_samples_;
+        }
+        active |= speaking_;
+    }
+    return active;
+}
+
+bool SimpleVad::AnalyzeSubframe(const int16_t* data) {
+    uint64_t energy = 0;
+    int crossings = 0;
+    for (int i = 0; i < subframe_samples_; i++) {
+        energy += (int32_t)data[i] * data[i];
+        if (i > 0 && ((data[i] ^ data[i - 1]) < 0)) {
+            crossings++;
+        }
+    }
+    int32_t level = Log2Q8(energy / subframe_samples_ + 1);
+    int32_t zcr = crossings * 32768 / subframe_samples_;
+
+    bool warming_up = warmup_subframes_ >= 0;
+    bool candidate = false;
+    bool voiced = false;
+    int32_t excess = level - noise_floor_;
+    if (level >= VAD_MIN_SPEECH_ENERGY && (excess >= VAD_SPEECH_MARGIN || warming_up)) {
+        // 浊音谱峰明显、过零率低；清音或其它强信号只按能量判断
+        voiced = zcr < VAD_MAX_VOICED_ZCR && PredictionErrorRatio(data, energy) < VAD_FLATNESS_THRESHOLD;
+        candidate = excess >= VAD_SPEECH_MARGIN && (voiced || excess >= 2 * VAD_SPEECH_MARGIN);
+    }
+
+    // 冷启动时底噪从很低的值开始，较吵的环境会一直被当作语音。预热窗口内浊音不到一半时，
+    // 最安静的 10ms 不可能低于底噪，把底噪至少抬到这里；一开始就在说话时窗口以浊音为主，留到下一个窗口
+    if (warming_up) {
+        warmup_min_level_ = std::min(warmup_min_level_, level);
+        warmup_voiced_ += voiced;
+        if (++warmup_subframes_ == VAD_WARMUP_SUBFRAMES) {
+            if (warmup_voiced_ * 2 < VAD_WARMUP_SUBFRAMES) {
+                noise_floor_ = std::max(noise_floor_, warmup_min_level_);
+                warmup_subframes_ = -1;
+            } else {
+                warmup_subframes_ = 0;
+                warmup_min_level_ = INT32_MAX;
+                warmup_voiced_ = 0;
+            }
+        }
+    }
+
+    // 噪声底快速跟随下降，缓慢上升，语音期间几乎不动
+    if (level < noise_floor_) {
+        noise_floor_ += (level - noise_floor_) / 4;
+    } else {
+        noise_floor_ += candidate ? 1 : 4;
+    }
+
+    if (candidate) {
+        silence_run_ = 0;
+        if (!speaking_ && ++speech_run_ >= VAD_ONSET_SUBFRAMES) {
+            speaking_ = true;
+        }
+    } else {
+        speech_run_ = 0;
+        if (speaking_ && ++silence_run_ >= VAD_HANGOVER_SUBFRAMES) {
+            speaking_ = false;
+        }
+    }
+    return candidate;
+}
+
+int32_t SimpleVad::Log2Q8(uint64_t value) {
+    if (value == 0) {
+        return 0;
+    }
+    int n = 63 - __builtin_clzll(value);
+    uint32_t frac = n >= 8 ? (uint32_t)(value >> (n - 8)) : (uint32_t)(value << (8 - n));
+    return n * 256 + (frac & 0xFF);
+}
+
+// 用 8 阶线性预测的残差能量与总能量之比近似谱平坦度：白噪声接近 1，浊音远小于 1。
+// 反射系数用 Schur 递推求得，全程定点，返回值为 Q15
+int32_t SimpleVad::PredictionErrorRatio(const int16_t* data, uint64_t energy) const {
+    int64_t autocorr[kLpcOrder + 1];
+    autocorr[0] = energy;
+    for (int lag = 1; lag <= kLpcOrder; lag++) {
+        int64_t sum = 0;
+        for (int i = lag; i < subframe_samples_; i++) {
+            sum += (int32_t)data[i] * data[i - lag];
+        }
+        autocorr[lag] = sum;
+    }
+
+    // 缩放到 30 位以内，并加一点白噪声修正保证递推稳定
+    int shift = std::max(0, 64 - __builtin_clzll(energy) - 30);
+    int32_t c0[kLpcOrder + 1], c1[kLpcOrder + 1];
+    for (int k = 0; k <= kLpcOrder; k++) {
+        c0[k] = c1[k] = (int32_t)(autocorr[k] >> shift);
+    }
+    int32_t r0 = c1[0] + (c1[0] >> 12);
+    c0[0] = c1[0] = r0;
+    if (r0 <= 0) {
+        return 32768;
+    }
+
+    for (int k = 0; k < kLpcOrder; k++) {
+        if (c1[0] <= 0) {
+            return 0;
+        }
+        int32_t rc = (int32_t)(-((int64_t)c0[k + 1] * 32768) / c1[0]);
+        rc = std::clamp(rc, -32440, 32440);
+        for (int n = 0; n < kLpcOrder - k; n++) {
+            int32_t t0 = c0[n + k + 1];
+            int32_t t1 = c1[n];
+            c0[n + k + 1] = t0 + (int32_t)(((int64_t)t1 * rc) >> 15);
+            c1[n] = t1 + (int32_t)(((int64_t)t0 * rc) >> 15);
+        }
+    }
+    return (int32_t)std::clamp<int64_t>((int64_t)c1[0] * 32768 / r0, 0, 32768);
+}
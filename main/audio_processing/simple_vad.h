@@ -0,0 +1,46 @@
+#ifndef SIMPLE_VAD_H
+#define SIMPLE_VAD_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * 不依赖 AFE 的轻量语音检测，全部为定点运算，适合 ESP32 / C3 等没有音频处理器的板子。
+ * 按 10ms 子帧计算能量、过零率和谱平坦度：能量需高出自适应噪声底，且谱形状像浊音，
+ * 或者能量足够强，才判为语音候选。连续若干候选子帧进入说话状态，静音持续超过拖尾时长才退出。
+ */
+class SimpleVad {
+public:
+    explicit SimpleVad(int sample_rate = 16000);
+
+    // 分析一段单声道数据，返回本段是否需要上传（含语音候选或仍处于说话状态）
+    bool Process(const int16_t* data, size_t samples);
+    void Reset();
+
+    bool speaking() const { return speaking_; }
+
+private:
+    static constexpr int kMaxSubframeSamples = 480;
+    static constexpr int kLpcOrder = 8;
+
+    int subframe_samples_;
+    int16_t pending_[kMaxSubframeSamples];
+    int pending_samples_ = 0;
+
+    // log2 能量，Q8。从固定的低底噪开始而不是第一个子帧：聆听开始时用户可能已经在说话，
+    // 用第一个子帧做底噪会把语音当成噪声
+    int32_t noise_floor_;
+    // 冷启动预热窗口，底噪确定后 warmup_subframes_ 置为 -1
+    int warmup_subframes_ = 0;
+    int warmup_voiced_ = 0;
+    int32_t warmup_min_level_ = INT32_MAX;
+    int speech_run_ = 0;
+    int silence_run_ = 0;
+    bool speaking_ = false;
+
+    bool AnalyzeSubframe(const int16_t* data);
+    static int32_t Log2Q8(uint64_t value);
+    int32_t PredictionErrorRatio(const int16_t* data, uint64_t energy) const;
+};
+
+#endif // SIMPLE_VAD_H
@@ -6,6 +6,7 @@
 #include <functional>
 
 #include "audio_codec.h"
+#include "command_recognizer.h"
 
 class WakeWord {
 public:
@@ -21,6 +22,11 @@ public:
     virtual void EncodeWakeWordData() = 0;
     virtual bool GetWakeWordOpus(std::vector<uint8_t>& opus) = 0;
     virtual const std::string& GetLastDetectedWakeWord() const = 0;
+    // 唤醒后继续用同一路音频识别命令词，识别到命令或超时后在检测任务中回调（超时为 -1）并停止检测；
+    // 期间调用 StopDetection 会取消识别且不回调。不支持时返回 false
+    virtual bool DetectCommand(CommandRecognizer* recognizer, int timeout_ms, std::function<void(int command)> callback) {
+        return false;
+    }
 };
 
 #endif
@@ -1,5 +1,6 @@
 #include "board.h"
 #include "system_info.h"
+#include "tls_session_cache.h"
 #include "settings.h"
 #include "display/display.h"
 #include "assets/lang_config.h"
@@ -61,6 +62,11 @@ Camera* Board::GetCamera() {
     return nullptr;
 }
 
+TlsSessionCache& Board::GetTlsSessionCache() {
+    static TlsSessionCache cache;
+    return cache;
+}
+
 Led* Board::GetLed() {
     static NoLed led;
     return &led;
@@ -14,6 +14,8 @@
 void* create_board();
 class AudioCodec;
 class Display;
+class TlsSessionCache;
+class LinkQualityMonitor;
 class Board {
 private:
     Board(const Board&) = delete; // 禁用拷贝构造函数
@@ -41,6 +43,10 @@ public:
     virtual bool GetTemperature(float& esp32temp);
     virtual Display* GetDisplay();
     virtual Camera* GetCamera();
+    // 所有 TLS 连接共用的会话缓存
+    TlsSessionCache& GetTlsSessionCache();
+    // 协议层向其上报发送结果、丢包和时延，只有能切换网络的板卡才提供
+    virtual LinkQualityMonitor* GetLinkQualityMonitor() { return nullptr; }
     virtual Http* CreateHttp() = 0;
     virtual WebSocket* CreateWebSocket() = 0;
     virtual Mqtt* CreateMqtt() = 0;
@@ -3,21 +3,24 @@
 #include "display.h"
 #include "assets/lang_config.h"
 #include "settings.h"
+#include "metrics.h"
 #include <esp_log.h>
+#include <esp_timer.h>
 
 static const char *TAG = "DualNetworkBoard";
 
-DualNetworkBoard::DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, size_t ml307_rx_buffer_size, int32_t default_net_type) 
-    : Board(), 
-      ml307_tx_pin_(ml307_tx_pin), 
-      ml307_rx_pin_(ml307_rx_pin), 
+DualNetworkBoard::DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, size_t ml307_rx_buffer_size, int32_t default_net_type)
+    : Board(),
+      ml307_tx_pin_(ml307_tx_pin),
+      ml307_rx_pin_(ml307_rx_pin),
       ml307_rx_buffer_size_(ml307_rx_buffer_size) {
-    
+
     // 从Settings加载网络类型
-    network_type_ = LoadNetworkTypeFromSettings(default_net_type);
-    
-    // 只初始化当前网络类型对应的板卡
-    InitializeCurrentBoard();
+    preferred_type_ = LoadNetworkTypeFromSettings(default_net_type);
+    network_type_ = preferred_type_;
+
+    // 只初始化当前网络类型对应的板卡，备用网络在联网后再创建
+    current_board_ = &GetBoard(preferred_type_);
 }
 
 NetworkType DualNetworkBoard::LoadNetworkTypeFromSettings(int32_t default_net_type) {
@@ -32,23 +35,37 @@ void DualNetworkBoard::SaveNetworkTypeToSettings(NetworkType type) {
     settings.SetInt("type", network_type);
 }
 
-void DualNetworkBoard::InitializeCurrentBoard() {
-    if (network_type_ == NetworkType::ML307) {
-        ESP_LOGI(TAG, "Initialize ML307 board");
-        current_board_ = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_rx_buffer_size_);
-    } else {
+Board& DualNetworkBoard::GetBoard(NetworkType type) {
+    if (type == NetworkType::ML307) {
+        if (!ml307_board_) {
+            ESP_LOGI(TAG, "Initialize ML307 board");
+            ml307_board_ = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_rx_buffer_size_);
+        }
+        return *ml307_board_;
+    }
+    if (!wifi_board_) {
         ESP_LOGI(TAG, "Initialize WiFi board");
-        current_board_ = std::make_unique<WifiBoard>();
+        wifi_board_ = std::make_unique<WifiBoard>();
     }
+    return *wifi_board_;
 }
 
 void DualNetworkBoard::SwitchNetworkType() {
     auto display = GetDisplay();
-    if (network_type_ == NetworkType::WIFI) {    
-        SaveNetworkTypeToSettings(NetworkType::ML307);
+    NetworkType target = network_type_ == NetworkType::WIFI ? NetworkType::ML307 : NetworkType::WIFI;
+    SaveNetworkTypeToSettings(target);
+#if CONFIG_USE_NETWORK_FAILOVER
+    // 备用网络已经连上时直接切换，不需要重启
+    if (standby_started_ && IsNetworkReady(target)) {
+        std::lock_guard<std::mutex> lock(switch_mutex_);
+        preferred_type_ = target;
+        SwitchTo(target);
+        return;
+    }
+#endif
+    if (target == NetworkType::ML307) {
         display->ShowNotification(Lang::Strings::SWITCH_TO_4G_NETWORK);
     } else {
-        SaveNetworkTypeToSettings(NetworkType::WIFI);
         display->ShowNotification(Lang::Strings::SWITCH_TO_WIFI_NETWORK);
     }
     vTaskDelay(pdMS_TO_TICKS(1000));
@@ -56,14 +73,14 @@ void DualNetworkBoard::SwitchNetworkType() {
     app.Reboot();
 }
 
- 
+
 std::string DualNetworkBoard::GetBoardType() {
-    return current_board_->GetBoardType();
+    return current_board_.load()->GetBoardType();
 }
 
 void DualNetworkBoard::StartNetwork() {
     auto display = Board::GetInstance().GetDisplay();
-    
+
     if (network_type_ == NetworkType::WIFI) {
         display->SetStatus(Lang::Strings::CONNECTING);
         display->SetNetStatus(1);
@@ -71,37 +88,137 @@ void DualNetworkBoard::StartNetwork() {
         display->SetStatus(Lang::Strings::DETECTING_MODULE);
         display->SetNetStatus(0);
     }
-    current_board_->StartNetwork();
+    current_board_.load()->StartNetwork();
+
+#if CONFIG_USE_NETWORK_FAILOVER
+    // 配网模式下不启动备用网络
+    if (Application::GetInstance().GetDeviceState() == kDeviceStateWifiConfiguring) {
+        return;
+    }
+    xTaskCreate([](void* arg) {
+        auto board = (DualNetworkBoard*)arg;
+        board->FailoverTask();
+        vTaskDelete(NULL);
+    }, "network_failover", 4096, this, 2, &failover_task_handle_);
+#endif
+}
+
+#if CONFIG_USE_NETWORK_FAILOVER
+bool DualNetworkBoard::IsNetworkReady(NetworkType type) {
+    if (type == NetworkType::ML307) {
+        return ml307_board_ && ml307_board_->IsNetworkReady();
+    }
+    return wifi_board_ && wifi_board_->IsNetworkReady();
+}
+
+bool DualNetworkBoard::StartStandby(NetworkType type) {
+    ESP_LOGI(TAG, "Start standby network %s", type == NetworkType::ML307 ? "ML307" : "WiFi");
+    if (type == NetworkType::ML307) {
+        auto& board = static_cast<Ml307Board&>(GetBoard(type));
+        return board.StartModem();
+    }
+    // 没有保存的 AP 时返回失败；连接超时不算失败，WifiStation 会在后台继续重连
+    auto& board = static_cast<WifiBoard&>(GetBoard(type));
+    return board.StartStation(10 * 1000);
+}
+
+// 调用者持有 switch_mutex_
+void DualNetworkBoard::SwitchTo(NetworkType type) {
+    static auto switches = Metrics::GetInstance().Counter("network.switches");
+    switches->Increment();
+    ESP_LOGW(TAG, "Switch network to %s", type == NetworkType::ML307 ? "ML307" : "WiFi");
+
+    current_board_ = &GetBoard(type);
+    network_type_ = type;
+#if CONFIG_USE_ML307_PPP
+    SetDefaultNetif(type);
+#endif
+    link_monitor_.OnSwitched(esp_timer_get_time() / 1000, type == preferred_type_);
+
+    auto display = GetDisplay();
+    if (type == NetworkType::ML307) {
+        display->ShowNotification(Lang::Strings::SWITCH_TO_4G_NETWORK);
+        display->SetNetStatus(0);
+    } else {
+        display->ShowNotification(Lang::Strings::SWITCH_TO_WIFI_NETWORK);
+        display->SetNetStatus(1);
+    }
+    // 由协议层在新网络上重建连接，会话和音频通道保持不变
+    Application::GetInstance().OnNetworkChanged();
+}
+
+void DualNetworkBoard::FailoverTask() {
+    auto& app = Application::GetInstance();
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        int64_t now_ms = esp_timer_get_time() / 1000;
+
+        std::unique_lock<std::mutex> lock(switch_mutex_);
+        NetworkType active = network_type_;
+        NetworkType standby = active == NetworkType::WIFI ? NetworkType::ML307 : NetworkType::WIFI;
+        bool standby_up = standby_started_ && IsNetworkReady(standby);
+        auto action = link_monitor_.Step(now_ms, IsNetworkReady(active), standby_up, standby_started_,
+            app.GetDeviceState() == kDeviceStateIdle);
+        if (action == kFailoverSwitch) {
+            SwitchTo(standby);
+            continue;
+        }
+        lock.unlock();
+
+        if (action == kFailoverStartStandby) {
+            standby_started_ = StartStandby(standby);
+#if CONFIG_USE_ML307_PPP
+            // Wi-Fi 的路由优先级高于 PPP，备用网络连上后默认路由仍要留在当前网络
+            std::lock_guard<std::mutex> route_lock(switch_mutex_);
+            SetDefaultNetif(network_type_);
+#endif
+        }
+    }
 }
+#endif
+
+#if CONFIG_USE_ML307_PPP
+void DualNetworkBoard::SetDefaultNetif(NetworkType type) {
+    esp_netif_t* netif = nullptr;
+    if (type == NetworkType::ML307) {
+        netif = ml307_board_ ? ml307_board_->GetNetif() : nullptr;
+    } else {
+        netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    }
+    if (netif != nullptr) {
+        esp_netif_set_default_netif(netif);
+    }
+}
+#endif
 
 Http* DualNetworkBoard::CreateHttp() {
-    return current_board_->CreateHttp();
+    return current_board_.load()->CreateHttp();
 }
 
 WebSocket* DualNetworkBoard::CreateWebSocket() {
-    return current_board_->CreateWebSocket();
+    return current_board_.load()->CreateWebSocket();
 }
 
 Mqtt* DualNetworkBoard::CreateMqtt() {
-    return current_board_->CreateMqtt();
+    return current_board_.load()->CreateMqtt();
 }
 
 Udp* DualNetworkBoard::CreateUdp() {
-    return current_board_->CreateUdp();
+    return current_board_.load()->CreateUdp();
 }
 
 const char* DualNetworkBoard::GetNetworkStateIcon() {
-    return current_board_->GetNetworkStateIcon();
+    return current_board_.load()->GetNetworkStateIcon();
 }
 
 void DualNetworkBoard::SetPowerSaveMode(bool enabled) {
-    current_board_->SetPowerSaveMode(enabled);
+    current_board_.load()->SetPowerSaveMode(enabled);
 }
 
-std::string DualNetworkBoard::GetBoardJson() {   
-    return current_board_->GetBoardJson();
+std::string DualNetworkBoard::GetBoardJson() {
+    return current_board_.load()->GetBoardJson();
 }
 
 std::string DualNetworkBoard::GetDeviceStatusJson() {
-    return current_board_->GetDeviceStatusJson();
-}
+    return current_board_.load()->GetDeviceStatusJson();
+}
\ No newline at end of file
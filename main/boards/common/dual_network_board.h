@@ -4,7 +4,14 @@
 #include "board.h"
 #include "wifi_board.h"
 #include "ml307_board.h"
+#include "link_quality_monitor.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 //enum NetworkType
 enum class NetworkType {
@@ -13,39 +20,60 @@ enum class NetworkType {
 };
 
 // 双网络板卡类，可以在WiFi和ML307之间切换
+// 开启 CONFIG_USE_NETWORK_FAILOVER 时，当前链路开始变差才启动另一条网络作为备用链路，持续变差时不重启直接切换
 class DualNetworkBoard : public Board {
 private:
-    // 使用基类指针存储当前活动的板卡
-    std::unique_ptr<Board> current_board_;
-    NetworkType network_type_ = NetworkType::ML307;  // Default to ML307
+    // 两块板卡按需创建，创建后一直保留
+    std::unique_ptr<WifiBoard> wifi_board_;
+    std::unique_ptr<Ml307Board> ml307_board_;
+    std::atomic<Board*> current_board_ = nullptr;
+    std::atomic<NetworkType> network_type_ = NetworkType::ML307;  // Default to ML307
+    // 用户选择的网络，自动切换不改变它
+    NetworkType preferred_type_ = NetworkType::ML307;
 
     // ML307的引脚配置
     gpio_num_t ml307_tx_pin_;
     gpio_num_t ml307_rx_pin_;
     size_t ml307_rx_buffer_size_;
-    
+
+#if CONFIG_USE_NETWORK_FAILOVER
+    LinkQualityMonitor link_monitor_;
+    std::mutex switch_mutex_;
+    std::atomic<bool> standby_started_ = false;
+    TaskHandle_t failover_task_handle_ = nullptr;
+
+    bool IsNetworkReady(NetworkType type);
+    bool StartStandby(NetworkType type);
+    void SwitchTo(NetworkType type);
+    void FailoverTask();
+#endif
+#if CONFIG_USE_ML307_PPP
+    // 两条网络都是 lwIP 接口时，默认路由需要跟随当前网络
+    void SetDefaultNetif(NetworkType type);
+#endif
+
     // 从Settings加载网络类型
     NetworkType LoadNetworkTypeFromSettings(int32_t default_net_type);
-    
+
     // 保存网络类型到Settings
     void SaveNetworkTypeToSettings(NetworkType type);
 
-    // 初始化当前网络类型对应的板卡
-    void InitializeCurrentBoard();
- 
+    // 返回网络类型对应的板卡，没有则创建
+    Board& GetBoard(NetworkType type);
+
 public:
     DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, size_t ml307_rx_buffer_size = 4096, int32_t default_net_type = 1);
     virtual ~DualNetworkBoard() = default;
- 
+
     // 切换网络类型
     void SwitchNetworkType();
-    
+
     // 获取当前网络类型
     NetworkType GetNetworkType() const { return network_type_; }
-    
+
     // 获取当前活动的板卡引用
     Board& GetCurrentBoard() const { return *current_board_; }
-    
+
     // 重写Board接口
     virtual std::string GetBoardType() override;
     virtual void StartNetwork() override;
@@ -57,6 +85,9 @@ public:
     virtual void SetPowerSaveMode(bool enabled) override;
     virtual std::string GetBoardJson() override;
     virtual std::string GetDeviceStatusJson() override;
+#if CONFIG_USE_NETWORK_FAILOVER
+    virtual LinkQualityMonitor* GetLinkQualityMonitor() override { return &link_monitor_; }
+#endif
 };
 
-#endif // DUAL_NETWORK_BOARD_H 
\ No newline at end of file
+#endif // DUAL_NETWORK_BOARD_H
\ No newline at end of file
@@ -209,7 +209,7 @@ std::string Esp32Camera::Explain(const std::string& question) {
         }, jpeg_queue);
     });
 
-    auto http = Board::GetInstance().CreateHttp();
+    auto http = std::unique_ptr<Http>(Board::GetInstance().CreateHttp());
     // 构造multipart/form-data请求体
     std::string boundary = "----ESP32_CAMERA_BOUNDARY";
 
@@ -0,0 +1,522 @@
+#include "http_connection_pool.h"
+#include "metrics.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#define TAG "HttpConnectionPool"
+
+#define HTTP_MAX_HEADER_SIZE    8192
+#define HTTP_MAX_LINE_SIZE      1024
+#define HTTP_MAX_REDIRECTS      5
+#define HTTP_MAX_DRAIN_SIZE     4096    // 关闭时最多读掉这么多未读的响应体以保留连接，更多时直接断开
+
+static std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+static std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+HttpConnectionPool::HttpConnectionPool(TransportFactory factory, size_t max_idle, int idle_timeout_ms)
+    : factory_(factory), max_idle_(max_idle), idle_timeout_us_((int64_t)idle_timeout_ms * 1000) {
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            ((HttpConnectionPool*)arg)->CloseExpired();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "http_pool",
+        .skip_unhandled_events = true
+    };
+    esp_timer_create(&timer_args, &cleanup_timer_);
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    if (cleanup_timer_ != nullptr) {
+        esp_timer_stop(cleanup_timer_);
+        esp_timer_delete(cleanup_timer_);
+    }
+    Clear();
+}
+
+std::string HttpConnectionPool::MakeKey(const std::string& host, int port, bool tls) {
+    return (tls ? "https://" : "http://") + host + ":" + std::to_string(port);
+}
+
+Transport* HttpConnectionPool::Acquire(const std::string& host, int port, bool tls, int timeout_ms, bool allow_reuse, bool& reused) {
+    static auto reused_counter = Metrics::GetInstance().Counter("http.pool_reused");
+    static auto connect_counter = Metrics::GetInstance().Counter("http.pool_connects");
+
+    reused = false;
+    auto key = MakeKey(host, port, tls);
+    if (allow_reuse) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+            if (it->key == key && it->transport->connected()) {
+                auto transport = it->transport;
+                idle_.erase(it);
+                reused = true;
+                reused_counter->Increment();
+                ESP_LOGD(TAG, "Reuse connection to %s", key.c_str());
+                return transport;
+            }
+        }
+    }
+
+    auto transport = factory_(tls, timeout_ms);
+    if (!transport->Connect(host.c_str(), port)) {
+        ESP_LOGE(TAG, "Failed to connect to %s", key.c_str());
+        delete transport;
+        return nullptr;
+    }
+    connect_counter->Increment();
+    return transport;
+}
+
+void HttpConnectionPool::Release(const std::string& host, int port, bool tls, Transport* transport) {
+    Transport* evicted = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() >= max_idle_) {
+            evicted = idle_.back().transport;
+            idle_.pop_back();
+        }
+        idle_.push_front({ MakeKey(host, port, tls), transport, esp_timer_get_time() });
+    }
+    delete evicted;
+
+    if (!esp_timer_is_active(cleanup_timer_)) {
+        esp_timer_start_once(cleanup_timer_, idle_timeout_us_);
+    }
+}
+
+void HttpConnectionPool::CloseExpired() {
+    std::list<IdleConnection> expired;
+    int64_t next_expire_us = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t now = esp_timer_get_time();
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            auto current = it++;
+            if (now - current->released_us >= idle_timeout_us_) {
+                expired.splice(expired.end(), idle_, current);
+            } else if (next_expire_us == 0 || current->released_us + idle_timeout_us_ < next_expire_us) {
+                next_expire_us = current->released_us + idle_timeout_us_;
+            }
+        }
+        if (next_expire_us != 0) {
+            esp_timer_start_once(cleanup_timer_, std::max<int64_t>(next_expire_us - now, 1000));
+        }
+    }
+    // 在锁外断开，TLS 连接断开时要发送 close_notify
+    for (auto& connection : expired) {
+        ESP_LOGD(TAG, "Close idle connection to %s", connection.key.c_str());
+        delete connection.transport;
+    }
+}
+
+void HttpConnectionPool::Clear() {
+    std::list<IdleConnection> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle.swap(idle_);
+    }
+    for (auto& connection : idle) {
+        delete connection.transport;
+    }
+}
+
+PooledHttp::PooledHttp(HttpConnectionPool& pool) : pool_(pool) {
+}
+
+PooledHttp::~PooledHttp() {
+    Close();
+}
+
+void PooledHttp::SetTimeout(int timeout_ms) {
+    timeout_ms_ = timeout_ms;
+}
+
+void PooledHttp::SetHeader(const std::string& key, const std::string& value) {
+    headers_[key] = value;
+    if (ToLower(key) == "transfer-encoding") {
+        chunked_request_ = ToLower(value).find("chunked") != std::string::npos;
+    }
+}
+
+void PooledHttp::SetContent(std::string&& content) {
+    content_ = std::move(content);
+    has_content_ = true;
+}
+
+bool PooledHttp::ParseUrl(const std::string& url) {
+    size_t host_start;
+    if (url.compare(0, 8, "https://") == 0) {
+        tls_ = true;
+        host_start = 8;
+    } else if (url.compare(0, 7, "http://") == 0) {
+        tls_ = false;
+        host_start = 7;
+    } else {
+        return false;
+    }
+
+    size_t path_start = url.find('/', host_start);
+    std::string authority = url.substr(host_start, path_start == std::string::npos ? std::string::npos : path_start - host_start);
+    path_ = path_start == std::string::npos ? "/" : url.substr(path_start);
+
+    size_t colon = authority.find(':');
+    if (colon != std::string::npos) {
+        host_ = authority.substr(0, colon);
+        port_ = atoi(authority.c_str() + colon + 1);
+    } else {
+        host_ = authority;
+        port_ = tls_ ? 443 : 80;
+    }
+    return !host_.empty() && port_ > 0;
+}
+
+bool PooledHttp::Open(const std::string& method, const std::string& url) {
+    method_ = method;
+    std::string current_url = url;
+    for (int redirects = 0; ; redirects++) {
+        if (!ParseUrl(current_url)) {
+            ESP_LOGE(TAG, "Invalid URL: %s", current_url.c_str());
+            return false;
+        }
+        if (!Request()) {
+            return false;
+        }
+        if (chunked_request_ || redirects >= HTTP_MAX_REDIRECTS) {
+            return true;
+        }
+        if (status_code_ != 301 && status_code_ != 302 && status_code_ != 303 && status_code_ != 307 && status_code_ != 308) {
+            return true;
+        }
+        std::string location = GetResponseHeader("Location");
+        if (location.empty()) {
+            return true;
+        }
+
+        if (location[0] == '/') {
+            location = (tls_ ? "https://" : "http://") + host_ + ":" + std::to_string(port_) + location;
+        }
+        if (status_code_ == 303 || ((status_code_ == 301 || status_code_ == 302) && method_ == "POST")) {
+            method_ = "GET";
+            content_.clear();
+            has_content_ = false;
+        }
+        ESP_LOGI(TAG, "Redirect %d to %s", status_code_, location.c_str());
+        Close();
+        current_url = location;
+    }
+}
+
+bool PooledHttp::Request() {
+    // 空闲连接可能已被服务器关闭，没有收到响应时换新连接重发一次。
+    // 发出的请求可能已被服务器处理，只重发幂等的方法（RFC 9110 9.2.2），POST 等失败时交给调用方处理
+    bool idempotent = method_ == "GET" || method_ == "HEAD" || method_ == "PUT" || method_ == "DELETE" ||
+        method_ == "OPTIONS";
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = false;
+        transport_ = pool_.Acquire(host_, port_, tls_, timeout_ms_, !chunked_request_ && attempt == 0, reused);
+        if (transport_ == nullptr) {
+            return false;
+        }
+        if (SendRequest() && (chunked_request_ || ReadResponseHeaders())) {
+            return true;
+        }
+        delete transport_;
+        transport_ = nullptr;
+        if (!reused || !idempotent) {
+            return false;
+        }
+        ESP_LOGW(TAG, "Reused connection to %s was closed, retrying", host_.c_str());
+    }
+    return false;
+}
+
+bool PooledHttp::SendRequest() {
+    response_parsed_ = false;
+    status_code_ = -1;
+    response_headers_.clear();
+    keep_alive_ = false;
+    chunked_response_ = false;
+    until_close_ = false;
+    body_done_ = false;
+    chunk_crlf_pending_ = false;
+    content_length_ = 0;
+    body_remaining_ = 0;
+    chunk_remaining_ = 0;
+    rx_buffer_.clear();
+
+    std::string request = method_ + " " + path_ + " HTTP/1.1\r\n";
+    request += "Host: " + host_;
+    if (port_ != (tls_ ? 443 : 80)) {
+        request += ":" + std::to_string(port_);
+    }
+    request += "\r\n";
+    for (auto& header : headers_) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    if (!chunked_request_ && (has_content_ || method_ == "POST" || method_ == "PUT")) {
+        request += "Content-Length: " + std::to_string(content_.size()) + "\r\n";
+    }
+    request += "\r\n";
+    if (!chunked_request_) {
+        request += content_;
+    }
+    return transport_->Send(request.data(), request.size()) == (int)request.size();
+}
+
+bool PooledHttp::FillBuffer() {
+    char buffer[512];
+    int ret = transport_->Receive(buffer, sizeof(buffer));
+    if (ret <= 0) {
+        return false;
+    }
+    rx_buffer_.append(buffer, ret);
+    return true;
+}
+
+bool PooledHttp::ReadLine(std::string& line) {
+    size_t end;
+    while ((end = rx_buffer_.find("\r\n")) == std::string::npos) {
+        if (rx_buffer_.size() > HTTP_MAX_LINE_SIZE || !FillBuffer()) {
+            return false;
+        }
+    }
+    line = rx_buffer_.substr(0, end);
+    rx_buffer_.erase(0, end + 2);
+    return true;
+}
+
+bool PooledHttp::ReadResponseHeaders() {
+    bool http10 = false;
+    while (true) {
+        size_t header_end;
+        while ((header_end = rx_buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (rx_buffer_.size() > HTTP_MAX_HEADER_SIZE || !FillBuffer()) {
+                ESP_LOGE(TAG, "Failed to read response headers from %s", host_.c_str());
+                return false;
+            }
+        }
+
+        // 状态行：HTTP/1.1 200 OK
+        size_t line_end = rx_buffer_.find("\r\n");
+        std::string status_line = rx_buffer_.substr(0, line_end);
+        size_t space = status_line.find(' ');
+        if (status_line.compare(0, 5, "HTTP/") != 0 || space == std::string::npos) {
+            ESP_LOGE(TAG, "Invalid status line: %s", status_line.c_str());
+            return false;
+        }
+        status_code_ = atoi(status_line.c_str() + space + 1);
+        http10 = status_line.compare(0, 8, "HTTP/1.0") == 0;
+
+        response_headers_.clear();
+        size_t pos = line_end + 2;
+        while (pos < header_end) {
+            size_t end = rx_buffer_.find("\r\n", pos);
+            size_t colon = rx_buffer_.find(':', pos);
+            if (colon != std::string::npos && colon < end) {
+                response_headers_[ToLower(rx_buffer_.substr(pos, colon - pos))] = Trim(rx_buffer_.substr(colon + 1, end - colon - 1));
+            }
+            pos = end + 2;
+        }
+        rx_buffer_.erase(0, header_end + 4);
+
+        // 跳过 100 Continue 等临时响应
+        if (status_code_ >= 100 && status_code_ < 200) {
+            continue;
+        }
+        break;
+    }
+
+    // HTTP/1.1 默认保持连接，HTTP/1.0 需要服务器明确声明
+    std::string connection = ToLower(GetResponseHeader("Connection"));
+    keep_alive_ = http10 ? connection.find("keep-alive") != std::string::npos : connection.find("close") == std::string::npos;
+    std::string transfer_encoding = ToLower(GetResponseHeader("Transfer-Encoding"));
+    std::string content_length = GetResponseHeader("Content-Length");
+    if (method_ == "HEAD" || status_code_ == 204 || status_code_ == 304) {
+        body_done_ = true;
+    } else if (transfer_encoding.find("chunked") != std::string::npos) {
+        chunked_response_ = true;
+    } else if (!content_length.empty()) {
+        content_length_ = strtoul(content_length.c_str(), nullptr, 10);
+        body_remaining_ = content_length_;
+        body_done_ = content_length_ == 0;
+    } else {
+        // 没有长度信息，读到连接关闭为止
+        until_close_ = true;
+        keep_alive_ = false;
+    }
+    response_parsed_ = true;
+    return true;
+}
+
+int PooledHttp::GetStatusCode() {
+    if (!response_parsed_) {
+        if (transport_ == nullptr || !ReadResponseHeaders()) {
+            return -1;
+        }
+    }
+    return status_code_;
+}
+
+std::string PooledHttp::GetResponseHeader(const std::string& key) const {
+    auto it = response_headers_.find(ToLower(key));
+    if (it == response_headers_.end()) {
+        return "";
+    }
+    return it->second;
+}
+
+size_t PooledHttp::GetBodyLength() {
+    if (GetStatusCode() < 0) {
+        return 0;
+    }
+    return content_length_;
+}
+
+int PooledHttp::ReadBody(char* buffer, size_t buffer_size) {
+    if (!rx_buffer_.empty()) {
+        size_t size = std::min(buffer_size, rx_buffer_.size());
+        memcpy(buffer, rx_buffer_.data(), size);
+        rx_buffer_.erase(0, size);
+        return size;
+    }
+    return transport_->Receive(buffer, buffer_size);
+}
+
+int PooledHttp::Read(char* buffer, size_t buffer_size) {
+    if (GetStatusCode() < 0) {
+        return -1;
+    }
+    if (body_done_ || buffer_size == 0) {
+        return 0;
+    }
+
+    if (chunked_response_) {
+        if (chunk_remaining_ == 0) {
+            std::string line;
+            if (chunk_crlf_pending_) {
+                if (!ReadLine(line)) {
+                    return -1;
+                }
+                chunk_crlf_pending_ = false;
+            }
+            if (!ReadLine(line)) {
+                return -1;
+            }
+            chunk_remaining_ = strtoul(line.c_str(), nullptr, 16);
+            if (chunk_remaining_ == 0) {
+                // 最后一块之后是可选的 trailer，以空行结束
+                do {
+                    if (!ReadLine(line)) {
+                        return -1;
+                    }
+                } while (!line.empty());
+                body_done_ = true;
+                return 0;
+            }
+        }
+        int ret = ReadBody(buffer, std::min(buffer_size, chunk_remaining_));
+        if (ret <= 0) {
+            return -1;
+        }
+        chunk_remaining_ -= ret;
+        chunk_crlf_pending_ = chunk_remaining_ == 0;
+        return ret;
+    }
+
+    if (until_close_) {
+        int ret = ReadBody(buffer, buffer_size);
+        if (ret <= 0) {
+            body_done_ = true;
+            return ret < 0 ? -1 : 0;
+        }
+        return ret;
+    }
+
+    int ret = ReadBody(buffer, std::min(buffer_size, body_remaining_));
+    if (ret <= 0) {
+        return -1;
+    }
+    body_remaining_ -= ret;
+    body_done_ = body_remaining_ == 0;
+    return ret;
+}
+
+std::string PooledHttp::ReadAll() {
+    std::string body;
+    if (GetBodyLength() > 0) {
+        body.reserve(content_length_);
+    }
+    char buffer[512];
+    int ret;
+    while ((ret = Read(buffer, sizeof(buffer))) > 0) {
+        body.append(buffer, ret);
+    }
+    return body;
+}
+
+int PooledHttp::Write(const char* buffer, size_t buffer_size) {
+    if (transport_ == nullptr) {
+        return -1;
+    }
+    if (!chunked_request_) {
+        return transport_->Send(buffer, buffer_size);
+    }
+
+    char chunk_header[16];
+    snprintf(chunk_header, sizeof(chunk_header), "%x\r\n", (unsigned int)buffer_size);
+    if (transport_->Send(chunk_header, strlen(chunk_header)) < 0) {
+        return -1;
+    }
+    if (buffer_size == 0) {
+        // 长度为 0 的块表示请求体结束
+        return transport_->Send("\r\n", 2) < 0 ? -1 : 0;
+    }
+    if (transport_->Send(buffer, buffer_size) < 0 || transport_->Send("\r\n", 2) < 0) {
+        return -1;
+    }
+    return buffer_size;
+}
+
+void PooledHttp::ReleaseConnection() {
+    // 少量未读的响应体读掉后连接仍可复用
+    if (response_parsed_ && keep_alive_ && !body_done_) {
+        char buffer[512];
+        size_t drained = 0;
+        while (!body_done_ && drained < HTTP_MAX_DRAIN_SIZE) {
+            int ret = Read(buffer, sizeof(buffer));
+            if (ret <= 0) {
+                break;
+            }
+            drained += ret;
+        }
+    }
+
+    if (response_parsed_ && keep_alive_ && body_done_ && rx_buffer_.empty() && transport_->connected()) {
+        pool_.Release(host_, port_, tls_, transport_);
+    } else {
+        delete transport_;
+    }
+    transport_ = nullptr;
+}
+
+void PooledHttp::Close() {
+    if (transport_ != nullptr) {
+        ReleaseConnection();
+    }
+}
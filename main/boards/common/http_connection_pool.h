@@ -0,0 +1,117 @@
+#ifndef HTTP_CONNECTION_POOL_H
+#define HTTP_CONNECTION_POOL_H
+
+#include <http.h>
+#include <transport.h>
+#include <esp_timer.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+/*
+ * 按 host:port 保存空闲的 keep-alive 连接，OTA、激活、拍照识别等短请求复用同一条连接，
+ * 省去重新建立 TCP 连接和 TLS 握手的时间。空闲超过 idle_timeout_ms 的连接由定时器关闭。
+ */
+class HttpConnectionPool {
+public:
+    // 创建未连接的传输层，tls 表示 https
+    using TransportFactory = std::function<Transport*(bool tls, int timeout_ms)>;
+
+    HttpConnectionPool(TransportFactory factory, size_t max_idle = 2, int idle_timeout_ms = 30000);
+    ~HttpConnectionPool();
+    HttpConnectionPool(const HttpConnectionPool&) = delete;
+    HttpConnectionPool& operator=(const HttpConnectionPool&) = delete;
+
+    // 有空闲连接且允许复用时返回空闲连接并置 reused 为 true，否则新建连接，失败返回 nullptr
+    Transport* Acquire(const std::string& host, int port, bool tls, int timeout_ms, bool allow_reuse, bool& reused);
+    // 归还响应已完整读完、服务器允许保持的连接
+    void Release(const std::string& host, int port, bool tls, Transport* transport);
+    void Clear();
+
+private:
+    struct IdleConnection {
+        std::string key;
+        Transport* transport;
+        int64_t released_us;
+    };
+
+    TransportFactory factory_;
+    size_t max_idle_;
+    int64_t idle_timeout_us_;
+    std::mutex mutex_;
+    std::list<IdleConnection> idle_;
+    esp_timer_handle_t cleanup_timer_ = nullptr;
+
+    static std::string MakeKey(const std::string& host, int port, bool tls);
+    void CloseExpired();
+};
+
+/*
+ * 通过 HttpConnectionPool 收发的 HTTP/1.1 客户端。
+ * 用 SetContent 设置请求体时，Open 发送完整请求并读取响应头，复用的连接已被服务器关闭时，GET 等幂等请求换新连接重发一次，
+ * POST 不重发，直接返回失败；
+ * 请求头包含 Transfer-Encoding: chunked 时，请求体由 Write 分块发送（长度为 0 表示结束），
+ * 读取状态码时才读取响应头，这类请求无法重发，总是使用新连接。
+ * 响应读完后 Close 把连接还给连接池。
+ */
+class PooledHttp : public Http {
+public:
+    PooledHttp(HttpConnectionPool& pool);
+    ~PooledHttp();
+
+    void SetTimeout(int timeout_ms) override;
+    void SetHeader(const std::string& key, const std::string& value) override;
+    void SetContent(std::string&& content) override;
+    bool Open(const std::string& method, const std::string& url) override;
+    void Close() override;
+    int Read(char* buffer, size_t buffer_size) override;
+    int Write(const char* buffer, size_t buffer_size) override;
+    int GetStatusCode() override;
+    std::string GetResponseHeader(const std::string& key) const override;
+    size_t GetBodyLength() override;
+    std::string ReadAll() override;
+
+private:
+    HttpConnectionPool& pool_;
+    Transport* transport_ = nullptr;
+    int timeout_ms_ = 30000;
+    std::map<std::string, std::string> headers_;
+    std::string content_;
+    bool has_content_ = false;
+    bool chunked_request_ = false;
+
+    std::string method_;
+    bool tls_ = false;
+    std::string host_;
+    int port_ = 0;
+    std::string path_;
+
+    // 响应状态
+    bool response_parsed_ = false;
+    int status_code_ = -1;
+    std::map<std::string, std::string> response_headers_;
+    bool keep_alive_ = false;
+    bool chunked_response_ = false;
+    bool until_close_ = false;
+    bool body_done_ = false;
+    bool chunk_crlf_pending_ = false;
+    size_t content_length_ = 0;
+    size_t body_remaining_ = 0;
+    size_t chunk_remaining_ = 0;
+    std::string rx_buffer_;
+
+    bool ParseUrl(const std::string& url);
+    bool Request();
+    bool SendRequest();
+    bool ReadResponseHeaders();
+    bool FillBuffer();
+    bool ReadLine(std::string& line);
+    int ReadBody(char* buffer, size_t buffer_size);
+    void ReleaseConnection();
+};
+
+#endif // HTTP_CONNECTION_POOL_H
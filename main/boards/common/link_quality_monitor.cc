@@ -0,0 +1,127 @@
+#include "link_quality_monitor.h"
+
+#include <algorithm>
+
+#define MAX_RECOVER_MS  (10 * 60 * 1000)
+
+LinkQualityMonitor::LinkQualityMonitor() : LinkQualityMonitor(Policy()) {
+}
+
+LinkQualityMonitor::LinkQualityMonitor(const Policy& policy) : policy_(policy), recover_ms_(policy.recover_ms) {
+}
+
+void LinkQualityMonitor::RecordSend(bool success) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sends_++;
+    if (success) {
+        consecutive_send_failures_ = 0;
+    } else {
+        send_failures_++;
+        consecutive_send_failures_++;
+    }
+}
+
+void LinkQualityMonitor::RecordReceive(int lost_packets) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    received_++;
+    lost_ += std::max(lost_packets, 0);
+}
+
+void LinkQualityMonitor::RecordRtt(int rtt_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_rtt_ms_ = std::max(max_rtt_ms_, rtt_ms);
+}
+
+bool LinkQualityMonitor::IsWindowBad(bool active_up) {
+    bool bad = !active_up;
+    if (consecutive_send_failures_ >= policy_.max_consecutive_send_failures) {
+        bad = true;
+    }
+    if (sends_ >= policy_.min_sends && send_failures_ * 100 >= sends_ * policy_.max_send_failure_percent) {
+        bad = true;
+    }
+    int expected = received_ + lost_;
+    if (expected >= policy_.min_expected_packets && lost_ * 100 >= expected * policy_.max_loss_percent) {
+        bad = true;
+    }
+    if (max_rtt_ms_ > policy_.max_rtt_ms) {
+        bad = true;
+    }
+
+    sends_ = 0;
+    send_failures_ = 0;
+    received_ = 0;
+    lost_ = 0;
+    max_rtt_ms_ = 0;
+    return bad;
+}
+
+LinkDecision LinkQualityMonitor::Evaluate(int64_t now_ms, bool active_up, bool standby_up, bool idle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bad_windows_ = IsWindowBad(active_up) ? bad_windows_ + 1 : 0;
+    if (!standby_up) {
+        standby_up_since_ms_ = -1;
+    } else if (standby_up_since_ms_ < 0) {
+        standby_up_since_ms_ = now_ms;
+    }
+
+    // 回到首选链路后稳定了一段时间，恢复默认的切回等待时间
+    if (on_preferred_ && returned_ms_ >= 0 && now_ms - returned_ms_ >= 2 * policy_.dwell_ms) {
+        recover_ms_ = policy_.recover_ms;
+        returned_ms_ = -1;
+    }
+
+    bool dwell_passed = last_switch_ms_ < 0 || now_ms - last_switch_ms_ >= policy_.dwell_ms;
+    if (bad_windows_ >= policy_.switch_windows) {
+        // 当前链路已经断开时不必等待保持时间
+        if (standby_up && (dwell_passed || !active_up)) {
+            return kLinkSwitch;
+        }
+        return kLinkPrepare;
+    }
+    if (bad_windows_ >= policy_.prepare_windows) {
+        return kLinkPrepare;
+    }
+    if (!on_preferred_ && idle && dwell_passed && standby_up_since_ms_ >= 0 &&
+        now_ms - standby_up_since_ms_ >= recover_ms_) {
+        return kLinkSwitch;
+    }
+    return kLinkStay;
+}
+
+FailoverAction LinkQualityMonitor::Step(int64_t now_ms, bool active_up, bool standby_up, bool standby_started, bool idle) {
+    auto decision = Evaluate(now_ms, active_up, standby_up, idle);
+    if (decision == kLinkSwitch) {
+        return kFailoverSwitch;
+    }
+    // 链路正常时不启动备用链路，不额外耗电
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (decision == kLinkPrepare && !standby_started &&
+        (last_standby_attempt_ms_ < 0 || now_ms - last_standby_attempt_ms_ >= policy_.standby_retry_ms)) {
+        last_standby_attempt_ms_ = now_ms;
+        return kFailoverStartStandby;
+    }
+    return kFailoverNone;
+}
+
+void LinkQualityMonitor::OnSwitched(int64_t now_ms, bool to_preferred) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (to_preferred) {
+        returned_ms_ = now_ms;
+    } else if (returned_ms_ >= 0) {
+        // 切回首选链路后很快又变差，说明它只是在线但质量不好，加倍切回前的等待时间
+        recover_ms_ = std::min(recover_ms_ * 2, MAX_RECOVER_MS);
+        returned_ms_ = -1;
+    }
+    on_preferred_ = to_preferred;
+    last_switch_ms_ = now_ms;
+    bad_windows_ = 0;
+    consecutive_send_failures_ = 0;
+    // 原来的链路成为备用链路，重新计算它的在线时长
+    standby_up_since_ms_ = -1;
+    sends_ = 0;
+    send_failures_ = 0;
+    received_ = 0;
+    lost_ = 0;
+    max_rtt_ms_ = 0;
+}
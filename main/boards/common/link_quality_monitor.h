@@ -0,0 +1,82 @@
+#ifndef LINK_QUALITY_MONITOR_H
+#define LINK_QUALITY_MONITOR_H
+
+#include <cstdint>
+#include <mutex>
+
+enum LinkDecision {
+    kLinkStay,
+    kLinkPrepare,   // 当前链路开始变差，提前准备备用链路
+    kLinkSwitch,
+};
+
+enum FailoverAction {
+    kFailoverNone,
+    kFailoverStartStandby,  // 启动备用链路，结果在下次 Step 时通过 standby_started 传入
+    kFailoverSwitch,        // 切换到备用链路，完成后调用 OnSwitched
+};
+
+/*
+ * 链路质量监测与切换策略，不依赖具体网络，双网络板卡每秒调用一次 Step，按返回的动作启动备用链路或切换。
+ * 协议层上报发送结果、丢包和往返时延，板卡上报两条链路是否在线；每秒统计一个窗口，
+ * 连续多个窗口变差才切换到备用链路，切换后保持一段时间不再切换，避免来回抖动；
+ * 工作在备用链路上时，首选链路持续正常一段时间、且设备空闲才切回。
+ */
+class LinkQualityMonitor {
+public:
+    struct Policy {
+        int prepare_windows = 1;        // 连续变差的窗口数达到此值时准备备用链路
+        int switch_windows = 3;         // 连续变差的窗口数达到此值时切换
+        int min_sends = 5;              // 一个窗口内发送次数不少于此值才按失败比例判断
+        int max_send_failure_percent = 30;
+        int max_consecutive_send_failures = 3;
+        int min_expected_packets = 10;  // 一个窗口内应收包数不少于此值才按丢包比例判断
+        int max_loss_percent = 20;
+        int max_rtt_ms = 1500;
+        int dwell_ms = 60000;           // 切换后至少保持的时间
+        int recover_ms = 30000;         // 首选链路持续正常多久后切回
+        int standby_retry_ms = 10000;   // 备用链路启动失败后（如没有 SIM 卡、没有保存的 AP）的重试间隔
+    };
+
+    LinkQualityMonitor();
+    explicit LinkQualityMonitor(const Policy& policy);
+
+    // 以下由协议层调用，可在任意任务中调用
+    void RecordSend(bool success);
+    void RecordReceive(int lost_packets = 0);
+    void RecordRtt(int rtt_ms);
+
+    // now_ms 为单调时间；active_up、standby_up 为当前链路和备用链路是否在线
+    LinkDecision Evaluate(int64_t now_ms, bool active_up, bool standby_up, bool idle);
+    // 在 Evaluate 的基础上决定是否启动备用链路：开始变差且备用链路未启动时才启动，失败后按间隔重试
+    FailoverAction Step(int64_t now_ms, bool active_up, bool standby_up, bool standby_started, bool idle);
+    // 完成切换后调用，to_preferred 表示切换到了首选链路
+    void OnSwitched(int64_t now_ms, bool to_preferred);
+
+    bool on_preferred() const { return on_preferred_; }
+    int bad_windows() const { return bad_windows_; }
+
+private:
+    Policy policy_;
+    std::mutex mutex_;
+
+    // 当前窗口的统计
+    int sends_ = 0;
+    int send_failures_ = 0;
+    int consecutive_send_failures_ = 0;
+    int received_ = 0;
+    int lost_ = 0;
+    int max_rtt_ms_ = 0;
+
+    int bad_windows_ = 0;
+    bool on_preferred_ = true;
+    int64_t last_switch_ms_ = -1;
+    int64_t standby_up_since_ms_ = -1;
+    int64_t returned_ms_ = -1;
+    int64_t last_standby_attempt_ms_ = -1;
+    int recover_ms_;
+
+    bool IsWindowBad(bool active_up);
+};
+
+#endif // LINK_QUALITY_MONITOR_H
@@ -7,17 +7,33 @@
 
 #include <esp_log.h>
 #include <esp_timer.h>
+#include <web_socket.h>
+#include <opus_encoder.h>
+#if CONFIG_USE_ML307_PPP
+#include "settings.h"
+#include "socket_transport.h"
+#include <esp_mqtt.h>
+#include <esp_udp.h>
+#include <tcp_transport.h>
+#else
 #include <ml307_http.h>
 #include <ml307_ssl_transport.h>
-#include <web_socket.h>
 #include <ml307_mqtt.h>
 #include <ml307_udp.h>
-#include <opus_encoder.h>
+#endif
 
 static const char *TAG = "Ml307Board";
 
+#if CONFIG_USE_ML307_PPP
+Ml307Board::Ml307Board(gpio_num_t tx_pin, gpio_num_t rx_pin, size_t rx_buffer_size) : modem_(tx_pin, rx_pin, rx_buffer_size),
+    http_pool_([](bool tls, int timeout_ms) -> Transport* {
+        return new SocketTransport(tls, true, timeout_ms);
+    }) {
+}
+#else
 Ml307Board::Ml307Board(gpio_num_t tx_pin, gpio_num_t rx_pin, size_t rx_buffer_size) : modem_(tx_pin, rx_pin, rx_buffer_size) {
 }
+#endif
 
 std::string Ml307Board::GetBoardType() {
     return "ml307";
@@ -27,6 +43,13 @@ void Ml307Board::StartNetwork() {
     auto display = Board::GetInstance().GetDisplay();
     display->SetStatus(Lang::Strings::DETECTING_MODULE);
     vTaskDelay(pdMS_TO_TICKS(1000));
+#if CONFIG_USE_ML307_PPP
+    if (modem_.Detect() != 0) {
+        ESP_LOGE(TAG, "ML307 not detected");
+        return;
+    }
+    WaitForNetworkReady();
+#else
     modem_.SetDebug(false);
     modem_.SetBaudRate(921600);
 
@@ -41,6 +64,7 @@ void Ml307Board::StartNetwork() {
     });
 
     WaitForNetworkReady();
+#endif
 }
 
 void Ml307Board::WaitForNetworkReady() {
@@ -64,13 +88,62 @@ void Ml307Board::WaitForNetworkReady() {
     ESP_LOGI(TAG, "ML307 IMEI: %s", imei.c_str());
     ESP_LOGI(TAG, "ML307 ICCID: %s", iccid.c_str());
 
+#if CONFIG_USE_ML307_PPP
+    if (!modem_.Dial()) {
+        application.Alert(Lang::Strings::ERROR, Lang::Strings::REG_ERROR, "sad", Lang::Sounds::P3_ERR_REG);
+    }
+#else
     // Close all previous connections
     modem_.ResetConnections();
 
     // Enable sleep mode
     modem_.SetSleepMode(true, 30);
+#endif
+}
+
+bool Ml307Board::StartModem() {
+#if CONFIG_USE_ML307_PPP
+    if (modem_.Detect() != 0 || modem_.WaitForNetworkReady() < 0) {
+        ESP_LOGW(TAG, "ML307 network is not ready");
+        return false;
+    }
+    return modem_.Dial();
+#else
+    modem_.SetDebug(false);
+    modem_.SetBaudRate(921600);
+    if (modem_.WaitForNetworkReady() < 0) {
+        ESP_LOGW(TAG, "ML307 network is not ready");
+        return false;
+    }
+    modem_.ResetConnections();
+    modem_.SetSleepMode(true, 30);
+    return true;
+#endif
+}
+
+#if CONFIG_USE_ML307_PPP
+Http* Ml307Board::CreateHttp() {
+    return new PooledHttp(http_pool_);
 }
 
+WebSocket* Ml307Board::CreateWebSocket() {
+    Settings settings("websocket", false);
+    std::string url = settings.GetString("url");
+    if (url.find("wss://") == 0) {
+        // 与 HTTP 一样用证书包验证服务器，接收任务需要阻塞读，只有连接和握手有超时
+        return new WebSocket(new SocketTransport(true, true, 0, 10000));
+    }
+    return new WebSocket(new TcpTransport());
+}
+
+Mqtt* Ml307Board::CreateMqtt() {
+    return new EspMqtt();
+}
+
+Udp* Ml307Board::CreateUdp() {
+    return new EspUdp();
+}
+#else
 Http* Ml307Board::CreateHttp() {
     return new Ml307Http(modem_);
 }
@@ -86,6 +159,7 @@ Mqtt* Ml307Board::CreateMqtt() {
 Udp* Ml307Board::CreateUdp() {
     return new Ml307Udp(modem_, 0);
 }
+#endif
 
 const char* Ml307Board::GetNetworkStateIcon() {
     if (!modem_.network_ready()) {
@@ -2,11 +2,24 @@
 #define ML307_BOARD_H
 
 #include "board.h"
+
+#include <sdkconfig.h>
+#if CONFIG_USE_ML307_PPP
+#include "ppp_modem.h"
+#include "http_connection_pool.h"
+#else
 #include <ml307_at_modem.h>
+#endif
 
 class Ml307Board : public Board {
 protected:
+#if CONFIG_USE_ML307_PPP
+    // 模组拨号后作为 lwIP 网络接口，连接都走标准 socket
+    PppModem modem_;
+    HttpConnectionPool http_pool_;
+#else
     Ml307AtModem modem_;
+#endif
     virtual std::string GetBoardJson() override;
     void WaitForNetworkReady();
 
@@ -22,6 +35,12 @@ public:
     virtual void SetPowerSaveMode(bool enabled) override;
     virtual AudioCodec* GetAudioCodec() override { return nullptr; }
     virtual std::string GetDeviceStatusJson() override;
+    // 作为双网络板卡的备用链路启动，不显示提示
+    bool StartModem();
+    bool IsNetworkReady() { return modem_.network_ready(); }
+#if CONFIG_USE_ML307_PPP
+    esp_netif_t* GetNetif() { return modem_.netif(); }
+#endif
 };
 
 #endif // ML307_BOARD_H
@@ -0,0 +1,350 @@
+#include <sdkconfig.h>
+#if CONFIG_USE_ML307_PPP
+#include "ppp_modem.h"
+#include "metrics.h"
+
+#include <esp_log.h>
+#include <driver/uart.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "PppModem"
+
+#define PPP_MODEM_BAUD_RATE     921600
+#define PPP_GOT_IP_EVENT        (1 << 0)
+#define PPP_LOST_IP_EVENT       (1 << 1)
+#define PPP_REDIAL_MIN_DELAY_MS 1000
+#define PPP_REDIAL_MAX_DELAY_MS (60 * 1000)
+
+std::string PppCeregState::ToString() const {
+    std::string json = "{";
+    json += "\"stat\":" + std::to_string(stat);
+    if (!tac.empty()) {
+        json += ",\"tac\":\"" + tac + "\"";
+    }
+    if (!ci.empty()) {
+        json += ",\"ci\":\"" + ci + "\"";
+    }
+    if (act >= 0) {
+        json += ",\"AcT\":" + std::to_string(act);
+    }
+    json += "}";
+    return json;
+}
+
+PppModem::PppModem(gpio_num_t tx_pin, gpio_num_t rx_pin, size_t rx_buffer_size) {
+    event_group_ = xEventGroupCreate();
+    esp_netif_init();
+    esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_PPP();
+    netif_ = esp_netif_new(&netif_config);
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, &PppModem::IpEventHandler, this));
+
+    esp_modem_dte_config_t dte_config = ESP_MODEM_DTE_DEFAULT_CONFIG();
+    dte_config.uart_config.tx_io_num = tx_pin;
+    dte_config.uart_config.rx_io_num = rx_pin;
+    dte_config.uart_config.rts_io_num = UART_PIN_NO_CHANGE;
+    dte_config.uart_config.cts_io_num = UART_PIN_NO_CHANGE;
+    dte_config.uart_config.flow_control = ESP_MODEM_FLOW_CONTROL_NONE;
+    dte_config.uart_config.rx_buffer_size = rx_buffer_size;
+    // 音频数据的突发量不大，但 CMUX 下命令和数据共用串口，缓冲区留得宽一些
+    dte_config.uart_config.tx_buffer_size = 2048;
+    dte_config.task_stack_size = 4096;
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG(CONFIG_ML307_PPP_APN);
+    dce_ = esp_modem_new_dev(ESP_MODEM_DCE_GENERIC, &dte_config, &dce_config, netif_);
+    if (dce_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create modem device");
+    }
+}
+
+PppModem::~PppModem() {
+    esp_event_handler_unregister(IP_EVENT, ESP_EVENT_ANY_ID, &PppModem::IpEventHandler);
+    if (dce_ != nullptr) {
+        esp_modem_destroy(dce_);
+    }
+    if (netif_ != nullptr) {
+        esp_netif_destroy(netif_);
+    }
+    vEventGroupDelete(event_group_);
+}
+
+void PppModem::IpEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
+    auto modem = (PppModem*)arg;
+    if (event_id == IP_EVENT_PPP_GOT_IP) {
+        auto event = (ip_event_got_ip_t*)event_data;
+        if (event->esp_netif != modem->netif_) {
+            return;
+        }
+        ESP_LOGI(TAG, "PPP got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        modem->network_ready_ = true;
+        xEventGroupClearBits(modem->event_group_, PPP_LOST_IP_EVENT);
+        xEventGroupSetBits(modem->event_group_, PPP_GOT_IP_EVENT);
+    } else if (event_id == IP_EVENT_PPP_LOST_IP) {
+        auto event = (ip_event_got_ip_t*)event_data;
+        if (event->esp_netif != modem->netif_) {
+            return;
+        }
+        ESP_LOGW(TAG, "PPP lost IP");
+        modem->network_ready_ = false;
+        xEventGroupClearBits(modem->event_group_, PPP_GOT_IP_EVENT);
+        xEventGroupSetBits(modem->event_group_, PPP_LOST_IP_EVENT);
+    }
+}
+
+bool PppModem::At(const char* command, std::string& response, int timeout_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dce_ == nullptr || !command_available_) {
+        return false;
+    }
+    char out[ESP_MODEM_C_API_STR_MAX] = {0};
+    if (esp_modem_at(dce_, command, out, timeout_ms) != ESP_OK) {
+        return false;
+    }
+    response = out;
+    return true;
+}
+
+bool PppModem::Command(const std::string& command, int timeout_ms) {
+    std::string response;
+    // esp_modem 会在末尾补 \r
+    std::string at = command;
+    while (!at.empty() && (at.back() == '\r' || at.back() == '\n')) {
+        at.pop_back();
+    }
+    return At(at.c_str(), response, timeout_ms);
+}
+
+int PppModem::Detect() {
+    if (dce_ == nullptr) {
+        return -1;
+    }
+    // 模组上电默认 115200；ESP32 软重启时模组不复位，仍是上次设置的波特率，两种都试
+    esp_modem_dte_config_t dte_config = ESP_MODEM_DTE_DEFAULT_CONFIG();
+    uart_port_t port = dte_config.uart_config.port_num;
+    // 模组可能还停留在上次的数据模式
+    esp_modem_set_mode(dce_, ESP_MODEM_MODE_COMMAND);
+    const int baud_rates[] = { 115200, PPP_MODEM_BAUD_RATE };
+    int baud_rate = 0;
+    for (int i = 0; i < 20 && baud_rate == 0; i++) {
+        uart_set_baudrate(port, baud_rates[i % 2]);
+        if (esp_modem_sync(dce_) == ESP_OK) {
+            baud_rate = baud_rates[i % 2];
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(250));
+        }
+    }
+    if (baud_rate == 0) {
+        ESP_LOGE(TAG, "Modem not responding");
+        return -1;
+    }
+    // PPP 的吞吐受限于串口速率
+    if (baud_rate != PPP_MODEM_BAUD_RATE) {
+        if (esp_modem_set_baud(dce_, PPP_MODEM_BAUD_RATE) == ESP_OK) {
+            uart_set_baudrate(port, PPP_MODEM_BAUD_RATE);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            esp_modem_sync(dce_);
+        } else {
+            ESP_LOGW(TAG, "Failed to set baud rate, keep %d", baud_rate);
+        }
+    }
+    return 0;
+}
+
+int PppModem::WaitForNetworkReady(int timeout_ms) {
+    bool pin_ok = false;
+    for (int i = 0; i < 10 && !pin_ok; i++) {
+        if (esp_modem_read_pin(dce_, &pin_ok) != ESP_OK || !pin_ok) {
+            vTaskDelay(pdMS_TO_TICKS(500));
+        }
+    }
+    if (!pin_ok) {
+        return -1;
+    }
+
+    int64_t waited_ms = 0;
+    while (true) {
+        cereg_ = GetRegistrationState();
+        // 1: 已注册本地网络，5: 已注册漫游网络
+        if (cereg_.stat == 1 || cereg_.stat == 5) {
+            break;
+        }
+        if (waited_ms >= timeout_ms) {
+            return -2;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        waited_ms += 1000;
+    }
+
+    module_name_ = GetModuleName();
+    imei_ = GetImei();
+    iccid_ = GetIccid();
+    carrier_name_ = GetCarrierName();
+    csq_ = GetCsq();
+    return 0;
+}
+
+bool PppModem::Dial(int timeout_ms) {
+    xEventGroupClearBits(event_group_, PPP_GOT_IP_EVENT | PPP_LOST_IP_EVENT);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (esp_modem_set_mode(dce_, ESP_MODEM_MODE_CMUX) == ESP_OK) {
+            ESP_LOGI(TAG, "PPP dialed in CMUX mode");
+            command_available_ = true;
+        } else if (esp_modem_set_mode(dce_, ESP_MODEM_MODE_DATA) == ESP_OK) {
+            ESP_LOGW(TAG, "CMUX not supported, AT commands are unavailable after dialing");
+            command_available_ = false;
+        } else {
+            ESP_LOGE(TAG, "Failed to enter data mode");
+            return false;
+        }
+    }
+    auto bits = xEventGroupWaitBits(event_group_, PPP_GOT_IP_EVENT, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+    if ((bits & PPP_GOT_IP_EVENT) == 0) {
+        return false;
+    }
+    if (redial_task_ == nullptr) {
+        xTaskCreate([](void* arg) {
+            auto modem = (PppModem*)arg;
+            modem->RedialTask();
+            vTaskDelete(NULL);
+        }, "ppp_redial", 4096, this, 2, &redial_task_);
+    }
+    return true;
+}
+
+bool PppModem::Redial() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 退出数据模式，回到命令模式确认仍注册在网络上
+        esp_modem_set_mode(dce_, ESP_MODEM_MODE_COMMAND);
+        command_available_ = true;
+    }
+    auto state = GetRegistrationState();
+    if (state.stat != 1 && state.stat != 5) {
+        ESP_LOGW(TAG, "Not registered, stat %d", state.stat);
+        return false;
+    }
+    cereg_ = state;
+    return Dial();
+}
+
+void PppModem::RedialTask() {
+    static auto redials = Metrics::GetInstance().Counter("ppp.redials");
+    int delay_ms = PPP_REDIAL_MIN_DELAY_MS;
+    while (true) {
+        // 拿到 IP 时清除 LOST 位，这里一直等到下一次断开
+        xEventGroupWaitBits(event_group_, PPP_LOST_IP_EVENT, pdFALSE, pdFALSE, portMAX_DELAY);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        if (network_ready_) {
+            // 模组自己恢复了连接
+            delay_ms = PPP_REDIAL_MIN_DELAY_MS;
+            continue;
+        }
+        ESP_LOGW(TAG, "Redial after %d ms", delay_ms);
+        redials->Increment();
+        if (Redial()) {
+            ESP_LOGI(TAG, "PPP redialed");
+            delay_ms = PPP_REDIAL_MIN_DELAY_MS;
+        } else {
+            // Dial 会清除事件位，失败后重新置位以便继续重试
+            xEventGroupSetBits(event_group_, PPP_LOST_IP_EVENT);
+            delay_ms = std::min(delay_ms * 2, PPP_REDIAL_MAX_DELAY_MS);
+        }
+    }
+}
+
+std::string PppModem::GetModuleName() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dce_ == nullptr || !command_available_) {
+        return module_name_;
+    }
+    char name[ESP_MODEM_C_API_STR_MAX] = {0};
+    if (esp_modem_get_module_name(dce_, name) == ESP_OK) {
+        module_name_ = name;
+    }
+    return module_name_;
+}
+
+std::string PppModem::GetImei() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dce_ == nullptr || !command_available_) {
+        return imei_;
+    }
+    char imei[ESP_MODEM_C_API_STR_MAX] = {0};
+    if (esp_modem_get_imei(dce_, imei) == ESP_OK) {
+        imei_ = imei;
+    }
+    return imei_;
+}
+
+std::string PppModem::GetIccid() {
+    std::string response;
+    if (At("AT+ICCID", response)) {
+        auto pos = response.find("+ICCID:");
+        if (pos != std::string::npos) {
+            pos += 7;
+            while (pos < response.size() && response[pos] == ' ') {
+                pos++;
+            }
+            auto end = response.find_first_of("\r\n", pos);
+            iccid_ = response.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        }
+    }
+    return iccid_;
+}
+
+std::string PppModem::GetCarrierName() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dce_ == nullptr || !command_available_) {
+        return carrier_name_;
+    }
+    char name[ESP_MODEM_C_API_STR_MAX] = {0};
+    int act = 0;
+    if (esp_modem_get_operator_name(dce_, name, &act) == ESP_OK) {
+        carrier_name_ = name;
+    }
+    return carrier_name_;
+}
+
+int PppModem::GetCsq() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dce_ == nullptr || !command_available_) {
+        return csq_;
+    }
+    int rssi = 99, ber = 99;
+    if (esp_modem_get_signal_quality(dce_, &rssi, &ber) == ESP_OK) {
+        csq_ = rssi == 99 ? -1 : rssi;
+    }
+    return csq_;
+}
+
+PppCeregState PppModem::GetRegistrationState() {
+    std::string response;
+    if (!At("AT+CEREG?", response)) {
+        return cereg_;
+    }
+    // +CEREG: <n>,<stat>[,"<tac>","<ci>",<AcT>]
+    auto pos = response.find("+CEREG:");
+    if (pos == std::string::npos) {
+        return cereg_;
+    }
+    std::string fields[5];
+    int count = 0;
+    for (size_t i = pos + 7; i < response.size() && count < 5; i++) {
+        char c = response[i];
+        if (c == ',') {
+            count++;
+        } else if (c == '\r' || c == '\n') {
+            break;
+        } else if (c != ' ' && c != '"') {
+            fields[count] += c;
+        }
+    }
+    PppCeregState state;
+    state.stat = fields[1].empty() ? 0 : atoi(fields[1].c_str());
+    state.tac = fields[2];
+    state.ci = fields[3];
+    state.act = fields[4].empty() ? -1 : atoi(fields[4].c_str());
+    return state;
+}
+
+#endif // CONFIG_USE_ML307_PPP
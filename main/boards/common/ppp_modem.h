@@ -0,0 +1,80 @@
+#ifndef PPP_MODEM_H
+#define PPP_MODEM_H
+
+#include <driver/gpio.h>
+#include <esp_netif.h>
+#include <esp_event.h>
+#include <esp_modem_api.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+#include <string>
+#include <mutex>
+
+// +CEREG 查询结果，格式与 Ml307AtModem 一致
+struct PppCeregState {
+    int stat = 0;
+    std::string tac;
+    std::string ci;
+    int act = -1;
+
+    std::string ToString() const;
+};
+
+/*
+ * 以 PPP over UART 方式使用 4G 模组：拨号后模组成为 lwIP 的一个网络接口，
+ * esp_http_client、esp-mqtt 和普通 socket 不经过 AT 指令直接收发数据。
+ * 优先使用 CMUX，数据通道之外保留一个 AT 通道查询信号和注册状态；模组不支持 CMUX 时退回纯数据模式，
+ * 此时只能返回拨号前查询并缓存的信息。
+ * 首次拨号成功后启动重拨任务，PPP 断开（模组掉网、基站释放连接）时按指数退避重新拨号。
+ * 接口与 Ml307AtModem 中 Ml307Board 用到的部分保持一致。
+ */
+class PppModem {
+public:
+    PppModem(gpio_num_t tx_pin, gpio_num_t rx_pin, size_t rx_buffer_size = 4096);
+    ~PppModem();
+
+    // 与模组同步、切换波特率，返回 0 表示成功，-1 表示没有检测到模组
+    int Detect();
+    // 等待注册网络，返回 0 表示成功，-1 表示 SIM 卡异常，-2 表示注册失败
+    int WaitForNetworkReady(int timeout_ms = 60000);
+    // 拨号进入数据模式并等待获得 IP 地址
+    bool Dial(int timeout_ms = 30000);
+
+    bool Command(const std::string& command, int timeout_ms = 1000);
+    bool network_ready() const { return network_ready_; }
+    esp_netif_t* netif() const { return netif_; }
+
+    std::string GetModuleName();
+    std::string GetImei();
+    std::string GetIccid();
+    std::string GetCarrierName();
+    int GetCsq();
+    PppCeregState GetRegistrationState();
+
+private:
+    esp_netif_t* netif_ = nullptr;
+    esp_modem_dce_t* dce_ = nullptr;
+    EventGroupHandle_t event_group_ = nullptr;
+    TaskHandle_t redial_task_ = nullptr;
+    std::mutex mutex_;
+    bool network_ready_ = false;
+    // 拨号后仍可以发送 AT 指令（CMUX 或尚未拨号）
+    bool command_available_ = true;
+
+    // 拨号前查询一次，纯数据模式下直接返回
+    std::string module_name_;
+    std::string imei_;
+    std::string iccid_;
+    std::string carrier_name_;
+    int csq_ = -1;
+    PppCeregState cereg_;
+
+    bool At(const char* command, std::string& response, int timeout_ms = 1000);
+    bool Redial();
+    void RedialTask();
+    static void IpEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
+};
+
+#endif // PPP_MODEM_H
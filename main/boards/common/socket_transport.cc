@@ -0,0 +1,211 @@
+#include "socket_transport.h"
+#include "board.h"
+#include "tls_session_cache.h"
+
+#include <esp_log.h>
+#include <esp_random.h>
+#include <esp_crt_bundle.h>
+#include <mbedtls/net_sockets.h>
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#include <cerrno>
+#include <cstring>
+
+#define TAG "SocketTransport"
+
+static int SslRandom(void* context, unsigned char* output, size_t length) {
+    esp_fill_random(output, length);
+    return 0;
+}
+
+static int SslSend(void* context, const unsigned char* data, size_t length) {
+    int fd = *(int*)context;
+    int ret = send(fd, data, length, 0);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_TIMEOUT : MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+    return ret;
+}
+
+static int SslReceive(void* context, unsigned char* buffer, size_t length) {
+    int fd = *(int*)context;
+    int ret = recv(fd, buffer, length, 0);
+    if (ret < 0) {
+        // 设置了 SO_RCVTIMEO 时超时返回 EAGAIN，转换为超时错误，避免 mbedtls 无限重试
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_TIMEOUT : MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+    return ret;
+}
+
+SocketTransport::SocketTransport(bool tls, bool verify_server, int timeout_ms, int handshake_timeout_ms)
+    : tls_(tls), verify_server_(verify_server), timeout_ms_(timeout_ms), handshake_timeout_ms_(handshake_timeout_ms) {
+}
+
+SocketTransport::~SocketTransport() {
+    Disconnect();
+}
+
+bool SocketTransport::Connect(const char* host, int port) {
+    Disconnect();
+    if (!ConnectSocket(host, port)) {
+        return false;
+    }
+    if (tls_ && !Handshake(host, port)) {
+        Disconnect();
+        return false;
+    }
+    // 握手完成后换回收发超时，0 表示一直阻塞
+    if (handshake_timeout_ms_ != timeout_ms_) {
+        SetSocketTimeout(timeout_ms_);
+    }
+    connected_ = true;
+    return true;
+}
+
+bool SocketTransport::ConnectSocket(const char* host, int port) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    if (getaddrinfo(host, port_str, &hints, &result) != 0 || result == nullptr) {
+        ESP_LOGE(TAG, "Failed to resolve %s", host);
+        return false;
+    }
+
+    fd_ = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd_ < 0) {
+        ESP_LOGE(TAG, "Failed to create socket");
+        freeaddrinfo(result);
+        return false;
+    }
+    SetSocketTimeout(handshake_timeout_ms_);
+    int nodelay = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    int ret = connect(fd_, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to connect to %s:%d, errno %d", host, port, errno);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+void SocketTransport::SetSocketTimeout(int timeout_ms) {
+    struct timeval tv = {};
+    if (timeout_ms > 0) {
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+    }
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool SocketTransport::Handshake(const char* host, int port) {
+    mbedtls_ssl_init(&ssl_);
+    mbedtls_ssl_config_init(&conf_);
+    ssl_initialized_ = true;
+
+    int ret = mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to set SSL config: -0x%x", -ret);
+        return false;
+    }
+    if (verify_server_) {
+        mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+        esp_crt_bundle_attach(&conf_);
+    } else {
+        mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_NONE);
+    }
+    mbedtls_ssl_conf_rng(&conf_, SslRandom, nullptr);
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+    mbedtls_ssl_conf_session_tickets(&conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    ret = mbedtls_ssl_setup(&ssl_, &conf_);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to setup SSL: -0x%x", -ret);
+        return false;
+    }
+    mbedtls_ssl_set_hostname(&ssl_, host);
+    mbedtls_ssl_set_bio(&ssl_, &fd_, SslSend, SslReceive, nullptr);
+
+    auto& cache = Board::GetInstance().GetTlsSessionCache();
+    return cache.Handshake(std::string(host) + ":" + std::to_string(port), &ssl_);
+}
+
+void SocketTransport::Disconnect() {
+    if (ssl_initialized_) {
+        if (connected_) {
+            mbedtls_ssl_close_notify(&ssl_);
+        }
+        mbedtls_ssl_free(&ssl_);
+        mbedtls_ssl_config_free(&conf_);
+        ssl_initialized_ = false;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    connected_ = false;
+}
+
+int SocketTransport::Send(const char* data, size_t length) {
+    if (!connected_) {
+        return -1;
+    }
+    size_t total_sent = 0;
+    while (total_sent < length) {
+        int ret;
+        if (tls_) {
+            ret = mbedtls_ssl_write(&ssl_, (const unsigned char*)data + total_sent, length - total_sent);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                continue;
+            }
+        } else {
+            ret = send(fd_, data + total_sent, length - total_sent, 0);
+        }
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to send data: %d", ret);
+            connected_ = false;
+            return -1;
+        }
+        total_sent += ret;
+    }
+    return total_sent;
+}
+
+int SocketTransport::Receive(char* buffer, size_t buffer_size) {
+    if (!connected_) {
+        return -1;
+    }
+    while (true) {
+        int ret;
+        if (tls_) {
+            ret = mbedtls_ssl_read(&ssl_, (unsigned char*)buffer, buffer_size);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                continue;
+            }
+#ifdef MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET
+            if (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+                continue;
+            }
+#endif
+            if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+                ret = 0;
+            }
+        } else {
+            ret = recv(fd_, buffer, buffer_size, 0);
+        }
+        if (ret <= 0) {
+            // 对端关闭或出错后连接不再可用
+            connected_ = false;
+            return ret < 0 ? -1 : 0;
+        }
+        return ret;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SOCKET_TRANSPORT_H
+#define SOCKET_TRANSPORT_H
+
+#include <transport.h>
+#include <mbedtls/ssl.h>
+
+#include <string>
+
+/*
+ * 基于 lwip socket 的传输层，可选 TLS。
+ * TLS 握手前后通过 Board 的 TlsSessionCache 恢复和保存会话，同一服务器的后续连接只需简化握手。
+ * timeout_ms 为 0 时收发一直阻塞（WebSocket 的接收任务需要），否则超时返回错误。
+ * 连接和 TLS 握手期间使用 handshake_timeout_ms，服务器不响应时不会卡住连接流程。
+ */
+class SocketTransport : public Transport {
+public:
+    SocketTransport(bool tls, bool verify_server = true, int timeout_ms = 0, int handshake_timeout_ms = 10000);
+    ~SocketTransport();
+
+    bool Connect(const char* host, int port) override;
+    void Disconnect() override;
+    int Send(const char* data, size_t length) override;
+    int Receive(char* buffer, size_t buffer_size) override;
+
+private:
+    bool tls_;
+    bool verify_server_;
+    int timeout_ms_;
+    int handshake_timeout_ms_;
+    int fd_ = -1;
+    bool ssl_initialized_ = false;
+    mbedtls_ssl_context ssl_;
+    mbedtls_ssl_config conf_;
+
+    bool ConnectSocket(const char* host, int port);
+    bool Handshake(const char* host, int port);
+    void SetSocketTimeout(int timeout_ms);
+};
+
+#endif // SOCKET_TRANSPORT_H
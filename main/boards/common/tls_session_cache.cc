@@ -0,0 +1,114 @@
+#include "tls_session_cache.h"
+#include "metrics.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cinttypes>
+
+#define TAG "TlsSessionCache"
+
+TlsSessionCache::TlsSessionCache(size_t capacity) : capacity_(capacity) {
+}
+
+TlsSessionCache::~TlsSessionCache() {
+    for (auto& entry : entries_) {
+        mbedtls_ssl_session_free(&entry.session);
+    }
+}
+
+bool TlsSessionCache::Handshake(const std::string& key, mbedtls_ssl_context* ssl) {
+    int64_t start_time = esp_timer_get_time();
+    bool restored = Restore(key, ssl);
+    // 逐步握手，记录是否经过接收服务器证书这一步。服务器接受恢复时（Session ID 或 Ticket），
+    // TLS 1.2 在 ServerHello 之后直接进入 ChangeCipherSpec，TLS 1.3 的 PSK 握手也不发送证书；
+    // 使用 Ticket 时服务器回的 Session ID 是客户端随机生成的，不能靠比较 ID 判断
+    bool received_certificate = false;
+    while (!mbedtls_ssl_is_handshake_over(ssl)) {
+        if (ssl->MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+            received_certificate = true;
+        }
+        int ret = mbedtls_ssl_handshake_step(ssl);
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            ESP_LOGE(TAG, "TLS handshake with %s failed: -0x%x", key.c_str(), -ret);
+            if (restored) {
+                Remove(key);
+            }
+            return false;
+        }
+    }
+    Save(key, ssl);
+    RecordHandshake(key, restored && !received_certificate, esp_timer_get_time() - start_time);
+    return true;
+}
+
+bool TlsSessionCache::Restore(const std::string& key, mbedtls_ssl_context* ssl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->key != key) {
+            continue;
+        }
+        int ret = mbedtls_ssl_set_session(ssl, &it->session);
+        if (ret != 0) {
+            ESP_LOGW(TAG, "Failed to restore session for %s: -0x%x", key.c_str(), -ret);
+            mbedtls_ssl_session_free(&it->session);
+            entries_.erase(it);
+            return false;
+        }
+        // 最近使用的放在最前面
+        entries_.splice(entries_.begin(), entries_, it);
+        return true;
+    }
+    return false;
+}
+
+void TlsSessionCache::Save(const std::string& key, const mbedtls_ssl_context* ssl) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    int ret = mbedtls_ssl_get_session(ssl, &session);
+    if (ret != 0) {
+        ESP_LOGW(TAG, "Failed to save session for %s: -0x%x", key.c_str(), -ret);
+        mbedtls_ssl_session_free(&session);
+        Remove(key);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.begin();
+    while (it != entries_.end() && it->key != key) {
+        ++it;
+    }
+    if (it == entries_.end()) {
+        if (entries_.size() >= capacity_) {
+            mbedtls_ssl_session_free(&entries_.back().session);
+            entries_.pop_back();
+        }
+        entries_.emplace_front();
+        it = entries_.begin();
+        it->key = key;
+    } else {
+        mbedtls_ssl_session_free(&it->session);
+        entries_.splice(entries_.begin(), entries_, it);
+    }
+    it->session = session;
+}
+
+void TlsSessionCache::Remove(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->key == key) {
+            mbedtls_ssl_session_free(&it->session);
+            entries_.erase(it);
+            return;
+        }
+    }
+}
+
+void TlsSessionCache::RecordHandshake(const std::string& key, bool resumed, int64_t duration_us) {
+    auto& metrics = Metrics::GetInstance();
+    static auto full_handshakes = metrics.Counter("tls.full_handshakes");
+    static auto resumed_handshakes = metrics.Counter("tls.resumed_handshakes");
+    static auto handshake_ms = metrics.Histogram("tls.handshake_ms", { 100, 300, 1000, 3000 });
+    (resumed ? resumed_handshakes : full_handshakes)->Increment();
+    handshake_ms->Record(duration_us / 1000);
+    ESP_LOGI(TAG, "%s handshake with %s took %" PRId64 " ms", resumed ? "Resumed" : "Full", key.c_str(), duration_us / 1000);
+}
@@ -0,0 +1,45 @@
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include <mbedtls/ssl.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+
+/*
+ * TLS 会话缓存，按 host:port 保存最近几次握手得到的会话（Session ID 或 Session Ticket），
+ * 再次连接同一服务器时用简化握手恢复会话，省去证书链传输、验证和密钥交换。
+ * 由 Board 持有，所有基于 mbedtls 的连接共用。
+ */
+class TlsSessionCache {
+public:
+    TlsSessionCache(size_t capacity = 4);
+    ~TlsSessionCache();
+    TlsSessionCache(const TlsSessionCache&) = delete;
+    TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+    // ssl 设置好 bio 后调用：用缓存的会话握手，成功后保存本次会话并记录握手次数和耗时，失败时丢弃缓存的会话
+    bool Handshake(const std::string& key, mbedtls_ssl_context* ssl);
+
+private:
+    struct Entry {
+        std::string key;
+        mbedtls_ssl_session session;
+    };
+
+    std::mutex mutex_;
+    std::list<Entry> entries_;
+    size_t capacity_;
+
+    // 有缓存的会话时设置到 ssl 上
+    bool Restore(const std::string& key, mbedtls_ssl_context* ssl);
+    // 保存本次会话，服务器续发了 Ticket 时替换缓存的会话
+    void Save(const std::string& key, const mbedtls_ssl_context* ssl);
+    // 服务器拒绝恢复或连接出错时丢弃缓存的会话
+    void Remove(const std::string& key);
+    // 记录一次握手的耗时，用于统计会话恢复节省的时间
+    void RecordHandshake(const std::string& key, bool resumed, int64_t duration_us);
+};
+
+#endif // TLS_SESSION_CACHE_H
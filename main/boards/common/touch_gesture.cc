@@ -0,0 +1,252 @@
+#include "touch_gesture.h"
+
+#include <cstdlib>
+
+/*
+ * 状态转换表，按顺序匹配：同一 (状态, 事件) 可以有多行，
+ * 动作返回 false 时继续匹配下一行，用于表达带条件的转换。
+ */
+const TouchGestureEngine::Transition TouchGestureEngine::kTransitions[] = {
+    { kStateIdle,          kEventDown,             kStatePressed,       &TouchGestureEngine::BeginPress },
+    { kStatePressed,       kEventMove,             kStateSwiping,       &TouchGestureEngine::StartSwipe },
+    { kStatePressed,       kEventLongPressTimeout, kStateHeld,          &TouchGestureEngine::EmitLongPress },
+    { kStatePressed,       kEventRepeatTimeout,    kStatePressed,       &TouchGestureEngine::EmitRepeat },
+    { kStatePressed,       kEventUp,               kStateWaitSecondTap, &TouchGestureEngine::WaitForSecondTap },
+    { kStatePressed,       kEventUp,               kStateIdle,          &TouchGestureEngine::EmitTap },
+    { kStateHeld,          kEventRepeatTimeout,    kStateHeld,          &TouchGestureEngine::EmitRepeat },
+    { kStateHeld,          kEventUp,               kStateIdle,          &TouchGestureEngine::Release },
+    { kStateSwiping,       kEventUp,               kStateIdle,          &TouchGestureEngine::EmitSwipe },
+    { kStateWaitSecondTap, kEventDoubleTapTimeout, kStateIdle,          &TouchGestureEngine::EmitPendingTap },
+    { kStateWaitSecondTap, kEventDown,             kStateSecondPressed, &TouchGestureEngine::BeginSecondPress },
+    { kStateWaitSecondTap, kEventDown,             kStatePressed,       &TouchGestureEngine::FlushTapThenBeginPress },
+    { kStateSecondPressed, kEventLongPressTimeout, kStateHeld,          &TouchGestureEngine::EmitLongPress },
+    { kStateSecondPressed, kEventUp,               kStateIdle,          &TouchGestureEngine::EmitDoubleTap },
+};
+
+TouchGestureEngine::TouchGestureEngine(const TouchGestureConfig& config) : config_(config) {
+}
+
+void TouchGestureEngine::AddZone(int zone_id, int x_min, int y_min, int x_max, int y_max) {
+    zones_.push_back(Zone{zone_id, x_min, y_min, x_max, y_max});
+}
+
+void TouchGestureEngine::OnGesture(int zone_id, TouchGesture gesture, std::function<void()> callback) {
+    bindings_.push_back(Binding{zone_id, gesture, callback});
+}
+
+void TouchGestureEngine::Reset() {
+    state_ = kStateIdle;
+    touching_ = false;
+    zone_id_ = -1;
+    pending_zone_id_ = -1;
+    ClearDeadlines();
+}
+
+void TouchGestureEngine::Feed(int64_t now_ms, bool touched, int x, int y) {
+    Tick(now_ms);
+
+    if (touched) {
+        last_x_ = x;
+        last_y_ = y;
+        if (!touching_) {
+            touching_ = true;
+            Dispatch(kEventDown);
+        } else {
+            Dispatch(kEventMove);
+        }
+    } else if (touching_) {
+        touching_ = false;
+        Dispatch(kEventUp);
+    }
+}
+
+void TouchGestureEngine::Tick(int64_t now_ms) {
+    now_ms_ = now_ms;
+    // 同一时刻可能有多个超时到期，依次处理，每处理一个都会清除对应的截止时间
+    while (true) {
+        int64_t* deadline = nullptr;
+        Event event = kEventLongPressTimeout;
+        if (long_press_deadline_ms_ >= 0 && long_press_deadline_ms_ <= now_ms_) {
+            deadline = &long_press_deadline_ms_;
+            event = kEventLongPressTimeout;
+        }
+        if (repeat_deadline_ms_ >= 0 && repeat_deadline_ms_ <= now_ms_ &&
+            (deadline == nullptr || repeat_deadline_ms_ < *deadline)) {
+            deadline = &repeat_deadline_ms_;
+            event = kEventRepeatTimeout;
+        }
+        if (double_tap_deadline_ms_ >= 0 && double_tap_deadline_ms_ <= now_ms_ &&
+            (deadline == nullptr || double_tap_deadline_ms_ < *deadline)) {
+            deadline = &double_tap_deadline_ms_;
+            event = kEventDoubleTapTimeout;
+        }
+        if (deadline == nullptr) {
+            break;
+        }
+        *deadline = -1;
+        Dispatch(event);
+    }
+}
+
+int TouchGestureEngine::GetNextTimeoutMs(int64_t now_ms) const {
+    int64_t next = -1;
+    for (auto deadline : { long_press_deadline_ms_, repeat_deadline_ms_, double_tap_deadline_ms_ }) {
+        if (deadline >= 0 && (next < 0 || deadline < next)) {
+            next = deadline;
+        }
+    }
+    if (next < 0) {
+        return -1;
+    }
+    return next > now_ms ? static_cast<int>(next - now_ms) : 0;
+}
+
+void TouchGestureEngine::Dispatch(Event event) {
+    for (const auto& transition : kTransitions) {
+        if (transition.state != state_ || transition.event != event) {
+            continue;
+        }
+        if ((this->*transition.action)()) {
+            state_ = transition.next_state;
+            return;
+        }
+    }
+}
+
+int TouchGestureEngine::FindZone(int x, int y) const {
+    for (const auto& zone : zones_) {
+        if (x >= zone.x_min && x <= zone.x_max && y >= zone.y_min && y <= zone.y_max) {
+            return zone.id;
+        }
+    }
+    return -1;
+}
+
+bool TouchGestureEngine::HasBinding(int zone_id, TouchGesture gesture) const {
+    for (const auto& binding : bindings_) {
+        if (binding.zone_id == zone_id && binding.gesture == gesture) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TouchGestureEngine::Emit(int zone_id, TouchGesture gesture) {
+    for (const auto& binding : bindings_) {
+        if (binding.zone_id == zone_id && binding.gesture == gesture && binding.callback) {
+            binding.callback();
+        }
+    }
+}
+
+void TouchGestureEngine::ClearDeadlines() {
+    long_press_deadline_ms_ = -1;
+    repeat_deadline_ms_ = -1;
+    double_tap_deadline_ms_ = -1;
+}
+
+bool TouchGestureEngine::BeginPress() {
+    zone_id_ = FindZone(last_x_, last_y_);
+    start_x_ = last_x_;
+    start_y_ = last_y_;
+    press_time_ms_ = now_ms_;
+    long_press_deadline_ms_ = now_ms_ + config_.long_press_ms;
+    if (HasBinding(zone_id_, kTouchGestureRepeat)) {
+        // 重复手势在按下时立即触发一次，之后按间隔重复
+        Emit(zone_id_, kTouchGestureRepeat);
+        repeat_deadline_ms_ = now_ms_ + config_.repeat_delay_ms;
+    }
+    return true;
+}
+
+bool TouchGestureEngine::BeginSecondPress() {
+    if (FindZone(last_x_, last_y_) != pending_zone_id_) {
+        return false;
+    }
+    zone_id_ = pending_zone_id_;
+    double_tap_deadline_ms_ = -1;
+    press_time_ms_ = now_ms_;
+    long_press_deadline_ms_ = now_ms_ + config_.long_press_ms;
+    return true;
+}
+
+bool TouchGestureEngine::FlushTapThenBeginPress() {
+    EmitPendingTap();
+    return BeginPress();
+}
+
+bool TouchGestureEngine::StartSwipe() {
+    int dx = std::abs(last_x_ - start_x_);
+    int dy = std::abs(last_y_ - start_y_);
+    if (dx < config_.swipe_min_distance && dy < config_.swipe_min_distance) {
+        return false;
+    }
+    if (!HasBinding(zone_id_, kTouchGestureSwipeLeft) && !HasBinding(zone_id_, kTouchGestureSwipeRight) &&
+        !HasBinding(zone_id_, kTouchGestureSwipeUp) && !HasBinding(zone_id_, kTouchGestureSwipeDown)) {
+        return false;
+    }
+    ClearDeadlines();
+    return true;
+}
+
+bool TouchGestureEngine::EmitSwipe() {
+    int dx = last_x_ - start_x_;
+    int dy = last_y_ - start_y_;
+    TouchGesture gesture;
+    if (std::abs(dx) >= std::abs(dy)) {
+        gesture = dx < 0 ? kTouchGestureSwipeLeft : kTouchGestureSwipeRight;
+    } else {
+        gesture = dy < 0 ? kTouchGestureSwipeUp : kTouchGestureSwipeDown;
+    }
+    Emit(zone_id_, gesture);
+    return true;
+}
+
+bool TouchGestureEngine::EmitLongPress() {
+    long_press_deadline_ms_ = -1;
+    Emit(zone_id_, kTouchGestureLongPress);
+    return true;
+}
+
+bool TouchGestureEngine::EmitRepeat() {
+    Emit(zone_id_, kTouchGestureRepeat);
+    repeat_deadline_ms_ = now_ms_ + config_.repeat_interval_ms;
+    return true;
+}
+
+bool TouchGestureEngine::WaitForSecondTap() {
+    if (now_ms_ - press_time_ms_ < config_.tap_min_ms || !HasBinding(zone_id_, kTouchGestureDoubleTap)) {
+        return false;
+    }
+    ClearDeadlines();
+    pending_zone_id_ = zone_id_;
+    double_tap_deadline_ms_ = now_ms_ + config_.double_tap_gap_ms;
+    return true;
+}
+
+bool TouchGestureEngine::EmitTap() {
+    ClearDeadlines();
+    if (now_ms_ - press_time_ms_ >= config_.tap_min_ms) {
+        Emit(zone_id_, kTouchGestureTap);
+    }
+    return true;
+}
+
+bool TouchGestureEngine::EmitPendingTap() {
+    ClearDeadlines();
+    Emit(pending_zone_id_, kTouchGestureTap);
+    pending_zone_id_ = -1;
+    return true;
+}
+
+bool TouchGestureEngine::EmitDoubleTap() {
+    ClearDeadlines();
+    Emit(zone_id_, kTouchGestureDoubleTap);
+    pending_zone_id_ = -1;
+    return true;
+}
+
+bool TouchGestureEngine::Release() {
+    ClearDeadlines();
+    return true;
+}
@@ -0,0 +1,132 @@
+#ifndef TOUCH_GESTURE_H
+#define TOUCH_GESTURE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum TouchGesture {
+    kTouchGestureTap,
+    kTouchGestureDoubleTap,
+    kTouchGestureLongPress,
+    kTouchGestureRepeat,
+    kTouchGestureSwipeLeft,
+    kTouchGestureSwipeRight,
+    kTouchGestureSwipeUp,
+    kTouchGestureSwipeDown,
+    kTouchGestureCount
+};
+
+struct TouchGestureConfig {
+    int tap_min_ms = 0;             // 短于该时长的按下视为抖动
+    int long_press_ms = 800;        // 按住超过该时长触发长按
+    int double_tap_gap_ms = 250;    // 两次点击的最大间隔
+    int repeat_delay_ms = 500;      // 按下后首次重复前的等待
+    int repeat_interval_ms = 500;   // 按住时的重复间隔
+    int swipe_min_distance = 40;    // 滑动判定的最小位移（像素）
+};
+
+/*
+ * 表驱动的触摸手势状态机，不依赖具体触摸芯片。
+ * 驱动层在每次读到触摸点后调用 Feed()，在超时唤醒时调用 Tick()，
+ * 并通过 GetNextTimeoutMs() 得到下一次需要唤醒的时间。
+ */
+class TouchGestureEngine {
+public:
+    explicit TouchGestureEngine(const TouchGestureConfig& config = TouchGestureConfig());
+
+    // 区域为闭区间，CST816 的虚拟按键可以用单点区域表示
+    void AddZone(int zone_id, int x_min, int y_min, int x_max, int y_max);
+    void OnGesture(int zone_id, TouchGesture gesture, std::function<void()> callback);
+
+    void Feed(int64_t now_ms, bool touched, int x, int y);
+    void Tick(int64_t now_ms);
+    // 返回距下一次超时的毫秒数，没有待处理的超时返回 -1
+    int GetNextTimeoutMs(int64_t now_ms) const;
+    bool IsTouching() const { return touching_; }
+    void Reset();
+
+private:
+    enum State {
+        kStateIdle,
+        kStatePressed,
+        kStateHeld,
+        kStateSwiping,
+        kStateWaitSecondTap,
+        kStateSecondPressed,
+    };
+
+    enum Event {
+        kEventDown,
+        kEventUp,
+        kEventMove,
+        kEventLongPressTimeout,
+        kEventRepeatTimeout,
+        kEventDoubleTapTimeout,
+    };
+
+    typedef bool (TouchGestureEngine::*Action)();
+
+    struct Transition {
+        State state;
+        Event event;
+        State next_state;
+        Action action;  // 返回 false 表示条件不满足，继续匹配下一条
+    };
+
+    struct Zone {
+        int id;
+        int x_min;
+        int y_min;
+        int x_max;
+        int y_max;
+    };
+
+    struct Binding {
+        int zone_id;
+        TouchGesture gesture;
+        std::function<void()> callback;
+    };
+
+    static const Transition kTransitions[];
+
+    TouchGestureConfig config_;
+    std::vector<Zone> zones_;
+    std::vector<Binding> bindings_;
+
+    State state_ = kStateIdle;
+    bool touching_ = false;
+    int zone_id_ = -1;
+    int pending_zone_id_ = -1;
+    int start_x_ = 0;
+    int start_y_ = 0;
+    int last_x_ = 0;
+    int last_y_ = 0;
+    int64_t now_ms_ = 0;
+    int64_t press_time_ms_ = 0;
+    int64_t long_press_deadline_ms_ = -1;
+    int64_t repeat_deadline_ms_ = -1;
+    int64_t double_tap_deadline_ms_ = -1;
+
+    void Dispatch(Event event);
+    int FindZone(int x, int y) const;
+    bool HasBinding(int zone_id, TouchGesture gesture) const;
+    void Emit(int zone_id, TouchGesture gesture);
+    void ClearDeadlines();
+
+    // 状态转换动作
+    bool BeginPress();
+    bool BeginSecondPress();
+    bool FlushTapThenBeginPress();
+    bool StartSwipe();
+    bool EmitSwipe();
+    bool EmitLongPress();
+    bool EmitRepeat();
+    bool WaitForSecondTap();
+    bool EmitTap();
+    bool EmitPendingTap();
+    bool EmitDoubleTap();
+    bool Release();
+};
+
+#endif // TOUCH_GESTURE_H
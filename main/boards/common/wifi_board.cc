@@ -6,14 +6,14 @@
 #include "font_awesome_symbols.h"
 #include "settings.h"
 #include "assets/lang_config.h"
+#include "socket_transport.h"
+#include "wifi_fast_connect.h"
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <esp_http.h>
 #include <esp_mqtt.h>
 #include <esp_udp.h>
 #include <tcp_transport.h>
-#include <tls_transport.h>
 #include <web_socket.h>
 #include <esp_log.h>
 
@@ -26,7 +26,20 @@
 
 static const char *TAG = "WifiBoard";
 
-WifiBoard::WifiBoard() {
+// 快速连接时 WifiStation 没有经过扫描，取不到 SSID
+static std::string GetConnectedSsid() {
+    std::string ssid = WifiStation::GetInstance().GetSsid();
+#if CONFIG_WIFI_FAST_CONNECT
+    if (ssid.empty()) {
+        ssid = WifiFastConnect::GetInstance().ssid();
+    }
+#endif
+    return ssid;
+}
+
+WifiBoard::WifiBoard() : http_pool_([](bool tls, int timeout_ms) -> Transport* {
+        return new SocketTransport(tls, true, timeout_ms);
+    }) {
     Settings settings("wifi", true);
     wifi_config_mode_ = settings.GetInt("force_ap") == 1;
     if (wifi_config_mode_) {
@@ -167,9 +180,16 @@ void WifiBoard::StartNetwork() {
 
         auto display = Board::GetInstance().GetDisplay();
         std::string notification = Lang::Strings::CONNECTED_TO;
-        notification += ssid;
+        notification += ssid.empty() ? GetConnectedSsid() : ssid;
         display->ShowNotification(notification.c_str(), 30000);
     });
+#if CONFIG_WIFI_FAST_CONNECT
+    // 需在 WifiStation 之前注册事件处理，才能赶在扫描之前发起定向连接
+    if (!wifi_config_mode_) {
+        WifiFastConnect::GetInstance().Start();
+    }
+#endif
+    station_started_ = true;
     wifi_station.Start();
     
     // Try to connect to WiFi, if failed, launch the WiFi configuration AP
@@ -185,15 +205,36 @@ void WifiBoard::StartNetwork() {
     }
 }
 
+bool WifiBoard::StartStation(int timeout_ms) {
+    if (SsidManager::GetInstance().GetSsidList().empty()) {
+        return false;
+    }
+    auto& wifi_station = WifiStation::GetInstance();
+    if (!station_started_) {
+        station_started_ = true;
+#if CONFIG_WIFI_FAST_CONNECT
+        WifiFastConnect::GetInstance().Start();
+#endif
+        wifi_station.Start();
+    }
+    return wifi_station.WaitForConnected(timeout_ms);
+}
+
+bool WifiBoard::IsNetworkReady() {
+    return station_started_ && WifiStation::GetInstance().IsConnected();
+}
+
 Http* WifiBoard::CreateHttp() {
-    return new EspHttp();
+    return new PooledHttp(http_pool_);
 }
 
 WebSocket* WifiBoard::CreateWebSocket() {
     Settings settings("websocket", false);
     std::string url = settings.GetString("url");
     if (url.find("wss://") == 0) {
-        return new WebSocket(new TlsTransport());
+        // 每次对话都会重新连接，通过会话缓存恢复 TLS 会话；与 HTTP 一样用证书包验证服务器。
+        // 接收任务需要阻塞读，只有连接和握手有超时
+        return new WebSocket(new SocketTransport(true, true, 0, 10000));
     } else {
         return new WebSocket(new TcpTransport());
     }
@@ -232,7 +273,7 @@ std::string WifiBoard::GetBoardJson() {
     std::string board_json = std::string("{\"type\":\"" BOARD_TYPE "\",");
     board_json += "\"name\":\"" BOARD_NAME "\",";
     if (!wifi_config_mode_) {
-        board_json += "\"ssid\":\"" + wifi_station.GetSsid() + "\",";
+        board_json += "\"ssid\":\"" + GetConnectedSsid() + "\",";
         board_json += "\"rssi\":" + std::to_string(wifi_station.GetRssi()) + ",";
         board_json += "\"channel\":" + std::to_string(wifi_station.GetChannel()) + ",";
         board_json += "\"ip\":\"" + wifi_station.GetIpAddress() + "\",";
@@ -323,7 +364,7 @@ std::string WifiBoard::GetDeviceStatusJson() {
     auto network = cJSON_CreateObject();
     auto& wifi_station = WifiStation::GetInstance();
     cJSON_AddStringToObject(network, "type", "wifi");
-    cJSON_AddStringToObject(network, "ssid", wifi_station.GetSsid().c_str());
+    cJSON_AddStringToObject(network, "ssid", GetConnectedSsid().c_str());
     int rssi = wifi_station.GetRssi();
     if (rssi >= -60) {
         cJSON_AddStringToObject(network, "signal", "strong");
@@ -2,10 +2,13 @@
 #define WIFI_BOARD_H
 
 #include "board.h"
+#include "http_connection_pool.h"
 
 class WifiBoard : public Board {
 protected:
     bool wifi_config_mode_ = false;
+    bool station_started_ = false;
+    HttpConnectionPool http_pool_;
     void EnterWifiConfigMode();
     virtual std::string GetBoardJson() override;
 
@@ -20,6 +23,9 @@ public:
     virtual const char* GetNetworkStateIcon() override;
     virtual void SetPowerSaveMode(bool enabled) override;
     virtual void ResetWifiConfiguration();
+    // 作为双网络板卡的备用链路启动，不显示提示，连接失败也不进入配网模式
+    bool StartStation(int timeout_ms);
+    bool IsNetworkReady();
     virtual AudioCodec* GetAudioCodec() override { return nullptr; }
     virtual std::string GetDeviceStatusJson() override;
 };
@@ -0,0 +1,133 @@
+#include "wifi_fast_connect.h"
+#include "settings.h"
+#include "metrics.h"
+#include "boot_sequence.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <ssid_manager.h>
+#include <cstring>
+
+#define TAG "WifiFastConnect"
+
+void WifiFastConnect::Start() {
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    has_record_ = LoadRecord();
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
+        &WifiFastConnect::EventHandler, this, nullptr));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+        &WifiFastConnect::EventHandler, this, nullptr));
+}
+
+bool WifiFastConnect::LoadRecord() {
+    Settings settings("wifi", false);
+    ssid_ = settings.GetString("fast_ssid");
+    std::string bssid = settings.GetString("fast_bssid");
+    channel_ = settings.GetInt("fast_channel");
+    if (ssid_.empty() || bssid.length() != 12 || channel_ <= 0) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        bssid_[i] = (uint8_t)strtoul(bssid.substr(i * 2, 2).c_str(), nullptr, 16);
+    }
+
+    // 只对仍在已保存列表中的 SSID 快速连接，密码以列表为准
+    auto ssid_list = SsidManager::GetInstance().GetSsidList();
+    for (auto& item : ssid_list) {
+        if (item.ssid == ssid_) {
+            password_ = item.password;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WifiFastConnect::SaveRecord() {
+    char bssid[13];
+    snprintf(bssid, sizeof(bssid), "%02x%02x%02x%02x%02x%02x", connected_bssid_[0], connected_bssid_[1],
+        connected_bssid_[2], connected_bssid_[3], connected_bssid_[4], connected_bssid_[5]);
+    // 和上次相同时不写 flash
+    Settings settings("wifi", true);
+    if (settings.GetString("fast_ssid") == connected_ssid_ && settings.GetString("fast_bssid") == bssid &&
+        settings.GetInt("fast_channel") == connected_channel_) {
+        return;
+    }
+    settings.SetString("fast_ssid", connected_ssid_);
+    settings.SetString("fast_bssid", bssid);
+    settings.SetInt("fast_channel", connected_channel_);
+}
+
+void WifiFastConnect::ClearRecord() {
+    Settings settings("wifi", true);
+    settings.EraseKey("fast_ssid");
+    settings.EraseKey("fast_bssid");
+    settings.EraseKey("fast_channel");
+}
+
+void WifiFastConnect::EventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
+    static_cast<WifiFastConnect*>(arg)->OnEvent(event_base, event_id, event_data);
+}
+
+void WifiFastConnect::OnEvent(esp_event_base_t event_base, int32_t event_id, void* event_data) {
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        connect_start_us_ = esp_timer_get_time();
+        if (!has_record_) {
+            return;
+        }
+        wifi_config_t config = {};
+        strncpy((char*)config.sta.ssid, ssid_.c_str(), sizeof(config.sta.ssid));
+        strncpy((char*)config.sta.password, password_.c_str(), sizeof(config.sta.password));
+        config.sta.bssid_set = true;
+        memcpy(config.sta.bssid, bssid_, sizeof(bssid_));
+        config.sta.channel = channel_;
+        config.sta.scan_method = WIFI_FAST_SCAN;
+        config.sta.failure_retry_cnt = 1;
+        esp_wifi_set_config(WIFI_IF_STA, &config);
+        if (esp_wifi_connect() == ESP_OK) {
+            attempting_ = true;
+            ESP_LOGI(TAG, "Connecting to %s on channel %d without scan", ssid_.c_str(), channel_);
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        auto event = (wifi_event_sta_connected_t*)event_data;
+        connected_ssid_.assign((const char*)event->ssid, event->ssid_len);
+        memcpy(connected_bssid_, event->bssid, sizeof(connected_bssid_));
+        connected_channel_ = event->channel;
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        if (attempting_) {
+            auto event = (wifi_event_sta_disconnected_t*)event_data;
+            ESP_LOGW(TAG, "Fast connect to %s failed, reason %d, fall back to scan", ssid_.c_str(), event->reason);
+            static auto failures = Metrics::GetInstance().Counter("wifi.fast_connect_failed");
+            failures->Increment();
+            attempting_ = false;
+            has_record_ = false;
+            ClearRecord();
+            // AP 可能换了信道或 BSSID，之后的重连按 SSID 在全信道查找
+            wifi_config_t config = {};
+            strncpy((char*)config.sta.ssid, ssid_.c_str(), sizeof(config.sta.ssid));
+            strncpy((char*)config.sta.password, password_.c_str(), sizeof(config.sta.password));
+            config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+            esp_wifi_set_config(WIFI_IF_STA, &config);
+        }
+        connected_ssid_.clear();
+        if (connect_start_us_ == 0) {
+            connect_start_us_ = esp_timer_get_time();
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        if (connect_start_us_ != 0) {
+            int64_t elapsed_ms = (esp_timer_get_time() - connect_start_us_) / 1000;
+            static auto time_to_ip = Metrics::GetInstance().Histogram("wifi.time_to_ip_ms", { 500, 1000, 2000, 5000 });
+            time_to_ip->Record(elapsed_ms);
+            ESP_LOGI(TAG, "Got IP %lld ms after %s", elapsed_ms, attempting_ ? "fast connect" : "connect start");
+            connect_start_us_ = 0;
+        }
+        BootProfiler::GetInstance().Mark("wifi_got_ip");
+        attempting_ = false;
+        if (!connected_ssid_.empty()) {
+            SaveRecord();
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+#include <esp_event.h>
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Wi-Fi 快速连接：记录上次成功连接的 SSID、BSSID 和信道，启动时不等扫描，直接向该 AP 发起定向连接。
+ * 需在 WifiStation::Start 之前调用 Start，这样 STA_START 事件先由这里处理；定向连接失败时清除记录，
+ * 并把配置改回只按 SSID 全信道连接，之后交给 WifiStation 的重连和扫描流程。
+ * DHCP 租约复用由 lwIP 的 LWIP_DHCP_RESTORE_LAST_IP 完成（直接请求上次的地址，跳过 DISCOVER）。
+ * 同时统计从开始连接（启动或断线）到获得 IP 的时间。
+ */
+class WifiFastConnect {
+public:
+    static WifiFastConnect& GetInstance() {
+        static WifiFastConnect instance;
+        return instance;
+    }
+    WifiFastConnect(const WifiFastConnect&) = delete;
+    WifiFastConnect& operator=(const WifiFastConnect&) = delete;
+
+    void Start();
+    // 通过快速连接连上的 SSID，WifiStation 没有经过扫描时不知道当前 SSID
+    const std::string& ssid() const { return connected_ssid_; }
+
+private:
+    WifiFastConnect() = default;
+
+    std::string ssid_;
+    std::string password_;
+    uint8_t bssid_[6] = {};
+    int channel_ = 0;
+    bool has_record_ = false;
+    bool attempting_ = false;
+    bool started_ = false;
+    int64_t connect_start_us_ = 0;
+
+    // 最近一次关联成功的 AP，获得 IP 后才保存
+    std::string connected_ssid_;
+    uint8_t connected_bssid_[6] = {};
+    int connected_channel_ = 0;
+
+    bool LoadRecord();
+    void SaveRecord();
+    void ClearRecord();
+    static void EventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
+    void OnEvent(esp_event_base_t event_base, int32_t event_id, void* event_data);
+};
+
+#endif // WIFI_FAST_CONNECT_H
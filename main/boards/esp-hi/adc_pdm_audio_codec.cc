@@ -195,6 +195,7 @@ void AdcPdmAudioCodec::Start() {
         output_volume_ = 10;
     }
 
+    RegisterDmaCallbacks();
     ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
 
     EnableInput(true);
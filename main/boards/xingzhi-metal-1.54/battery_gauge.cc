@@ -0,0 +1,92 @@
+#include "battery_gauge.h"
+
+#include <algorithm>
+
+// 锂电池开路电压曲线，3.4V 截止
+static const struct {
+    int mv;
+    int level;
+} kOcvCurve[] = {
+    {3400, 0},
+    {3600, 5},
+    {3680, 10},
+    {3720, 20},
+    {3760, 30},
+    {3800, 40},
+    {3850, 50},
+    {3900, 60},
+    {3960, 70},
+    {4030, 80},
+    {4110, 90},
+    {4200, 100},
+};
+
+BatteryGauge::BatteryGauge(const BatteryGaugeConfig& config) : config_(config) {
+}
+
+void BatteryGauge::Reset() {
+    head_ = 0;
+    count_ = 0;
+    ema_mv_ = 0;
+    level_ = -1;
+}
+
+int BatteryGauge::OcvToLevel(int ocv_mv) {
+    const int points = sizeof(kOcvCurve) / sizeof(kOcvCurve[0]);
+    if (ocv_mv <= kOcvCurve[0].mv) {
+        return 0;
+    }
+    if (ocv_mv >= kOcvCurve[points - 1].mv) {
+        return 100;
+    }
+    for (int i = 1; i < points; i++) {
+        if (ocv_mv < kOcvCurve[i].mv) {
+            const auto& lo = kOcvCurve[i - 1];
+            const auto& hi = kOcvCurve[i];
+            return lo.level + (ocv_mv - lo.mv) * (hi.level - lo.level) / (hi.mv - lo.mv);
+        }
+    }
+    return 100;
+}
+
+int BatteryGauge::WindowMedian() const {
+    int n = std::min(count_, kWindowSize);
+    std::array<int, kWindowSize> sorted;
+    std::copy(window_.begin(), window_.begin() + n, sorted.begin());
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.begin() + n);
+    return sorted[n / 2];
+}
+
+void BatteryGauge::AddSample(int voltage_mv, int load_current_ma, bool charging) {
+    // 充放电切换时端电压会跳变，旧样本不再有参考意义
+    if (charging != charging_) {
+        charging_ = charging;
+        Reset();
+    }
+
+    // 充电电流未知，充电时不做补偿
+    int ocv_mv = voltage_mv;
+    if (!charging) {
+        ocv_mv += load_current_ma * config_.internal_resistance_mohm / 1000;
+    }
+
+    window_[head_] = ocv_mv;
+    head_ = (head_ + 1) % kWindowSize;
+    if (count_ < kWindowSize) {
+        count_++;
+    }
+
+    // 窗口填满之前直接跟随中值，避免开机时被第一个样本拖住
+    int median = WindowMedian();
+    bool warming_up = count_ < kWindowSize;
+    if (warming_up) {
+        ema_mv_ = median;
+    } else {
+        ema_mv_ += config_.ema_alpha * (median - ema_mv_);
+    }
+
+    int level = OcvToLevel(static_cast<int>(ema_mv_));
+    if (warming_up || (charging && level > level_) || (!charging && level < level_)) {
+        level_ = level;
+    }
+}
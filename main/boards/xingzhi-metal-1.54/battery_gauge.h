@@ -0,0 +1,46 @@
+#ifndef BATTERY_GAUGE_H
+#define BATTERY_GAUGE_H
+
+#include <array>
+#include <cstdint>
+
+struct BatteryGaugeConfig {
+    int internal_resistance_mohm = 200;  // 电芯内阻加保护板、走线压降
+    float ema_alpha = 0.125f;            // 中值之后的指数平滑系数
+    int min_samples = 3;                 // 低于该样本数时不上报低电量
+};
+
+/*
+ * 电池电量估计，不依赖 ADC 驱动，输入为已校准的电池电压。
+ * 每个样本先按负载电流补偿内阻压降得到开路电压，再经过滑动中值
+ * 和 EMA 滤波后查 OCV 曲线；放电时电量只降不升，充电时只升不降。
+ */
+class BatteryGauge {
+public:
+    explicit BatteryGauge(const BatteryGaugeConfig& config = BatteryGaugeConfig());
+
+    void AddSample(int voltage_mv, int load_current_ma, bool charging);
+    void Reset();
+
+    int GetOcvMv() const { return static_cast<int>(ema_mv_); }
+    // 尚无样本时返回 -1
+    int GetLevel() const { return level_; }
+    bool IsReady() const { return count_ >= config_.min_samples; }
+
+    static int OcvToLevel(int ocv_mv);
+
+private:
+    static constexpr int kWindowSize = 9;
+
+    BatteryGaugeConfig config_;
+    std::array<int, kWindowSize> window_ = {};
+    int head_ = 0;
+    int count_ = 0;
+    float ema_mv_ = 0;
+    int level_ = -1;
+    bool charging_ = false;
+
+    int WindowMedian() const;
+};
+
+#endif // BATTERY_GAUGE_H
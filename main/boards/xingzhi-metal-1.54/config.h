@@ -23,6 +23,13 @@
 // 按键
 #define BOOT_BUTTON_GPIO        GPIO_NUM_0
 
+// 触摸中断。CST816 的 INT 在这块板上接到哪个引脚还没有原理图确认，默认按 50 ms 轮询；
+// 确认后改成对应引脚即可由 INT 唤醒，空闲时不再读取控制器
+#define TOUCH_INT_GPIO          GPIO_NUM_NC
+
+// 加速度计 INT1，设为 GPIO_NUM_NC 时每秒读取一次锁存的事件
+#define SC7A20H_INT_GPIO        GPIO_NUM_NC
+
 // 屏幕
 #define DISPLAY_SPI_HOST SPI3_HOST
 #define DISPLAY_SDA GPIO_NUM_10
@@ -54,5 +61,8 @@
 #define POWER_CBS_ADC_UNIT ADC_UNIT_1   // adc检测公共unit GPIO1
 #define POWER_USBIN_ADC_CHANNEL ADC_CHANNEL_0 // 检测usb是否插入 GPIO1
 #define POWER_BATTERY_ADC_CHANNEL ADC_CHANNEL_6 // 电池电量检测 GPIO7
+// 电池分压比 (约 2.28)，由原先 1970~2430 的 ADC 区间对应 3.4V~4.2V 推得
+#define POWER_BATTERY_DIVIDER_NUM 228
+#define POWER_BATTERY_DIVIDER_DEN 100
 
 #endif // _BOARD_CONFIG_H_
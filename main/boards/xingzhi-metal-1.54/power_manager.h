@@ -1,13 +1,18 @@
 #pragma once
-#include <vector>
+#include <algorithm>
 #include <functional>
 
 #include <esp_timer.h>
 #include <driver/gpio.h>
-#include <esp_adc/adc_oneshot.h>
+#include <esp_adc/adc_continuous.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "sdkconfig.h"
 #include "button.h"
 #include "board.h"
+#include "battery_gauge.h"
 // #include "wake_word_detect.h"
 #include "config.h"
 #include "assets/lang_config.h"
@@ -15,22 +20,37 @@
 
 class PowerManager {
 private:
-    esp_timer_handle_t timer_handle_;
     esp_timer_handle_t power_timer_handle_;
+    TaskHandle_t battery_task_handle_ = nullptr;
     std::function<void(bool)> on_charging_status_changed_;
     std::function<void(bool)> on_low_battery_status_changed_;
 
     gpio_num_t charging_pin_ = GPIO_NUM_NC;
-    std::vector<uint16_t> adc_values_;
+    BatteryGauge battery_gauge_;
     uint32_t battery_level_ = 30;
     bool is_charging_ = false;
     bool is_low_battery_ = false;
+    bool stopping_ = false;
     int ticks_ = 0;
-    adc_oneshot_unit_handle_t adc_handle_;
-    const int kBatteryAdcInterval = 60; 
-    const int kBatteryAdcDataCount = 3;
+    int usb_adc_raw_ = 0;
+    adc_continuous_handle_t adc_handle_ = nullptr;
+    adc_cali_handle_t adc_cali_handle_ = nullptr;
+    const int kBatteryLogInterval = 60;
     const int kLowBatteryLevel = 20;
 
+    // 每秒一次突发采样：启动 DMA 转换，取满一帧后立即停止，
+    // 其余时间 ADC 不工作，也不持有 APB 频率锁
+    static constexpr int kAdcSampleFreqHz = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+    static constexpr int kAdcFrameSamples = 64;
+    static constexpr int kAdcFrameBytes = kAdcFrameSamples * SOC_ADC_DIGI_RESULT_BYTES;
+    static constexpr int kAdcReadTimeoutMs = 500;
+    static constexpr int kBatterySampleIntervalMs = 1000;
+
+    // 各状态下的估计负载电流（mA），用于补偿内阻压降
+    static constexpr int kIdleLoadMa = 90;
+    static constexpr int kListeningLoadMa = 160;
+    static constexpr int kSpeakingLoadMa = 380;
+
     bool is_usb_inserted_on_boot = false; // 上电前是否插入usb
 
     bool pressed = false; // 是否按下按键
@@ -49,8 +69,7 @@ private:
 
     void PowrSwitch() {
         if (is_first_boot == true && shutedup == false) {
-            int usb_adc_value0;
-            ESP_ERROR_CHECK(adc_oneshot_read(adc_handle_, POWER_USBIN_ADC_CHANNEL, &usb_adc_value0));
+            int usb_adc_value0 = usb_adc_raw_;
             is_usb_inserted_on_boot = (1500 < usb_adc_value0 && usb_adc_value0 < 4000 );
             ESP_LOGI("powercontrol", "USB ADC VALUE 0: %d", usb_adc_value0);
             shutedup = true;
@@ -73,10 +92,7 @@ private:
                 // display->SetStatus(Lang::Strings::SHUT_DOWN);
                 display->ShowNotification(Lang::Strings::SHUT_DOWN);
 
-                if (timer_handle_) {
-                    esp_timer_stop(timer_handle_);
-                    esp_timer_delete(timer_handle_);
-                }
+                stopping_ = true;
                 auto& app = Application::GetInstance();
                 auto codec = Board::GetInstance().GetAudioCodec();
                 if (app.GetDeviceState() == kDeviceStateListening) {
@@ -115,82 +131,87 @@ private:
         }
     }
 
-    void CheckBatteryStatus() {
-        int usb_usb_adc_value0;
-        ESP_ERROR_CHECK(adc_oneshot_read(adc_handle_, POWER_USBIN_ADC_CHANNEL, &usb_usb_adc_value0));
-        new_charging_status = (1500 < usb_usb_adc_value0 && usb_usb_adc_value0 < 4000);
-        // ESP_LOGE("powercontrol", "USB ADC VALUE 1: %d", usb_usb_adc_value0);
-
-        if (new_charging_status != is_charging_) {
-            ReadBatteryAdcData();
-            is_charging_ = new_charging_status;
-            if (on_charging_status_changed_) {
-                on_charging_status_changed_(is_charging_);
-            }
-            return;
+    static int GetLoadCurrentMa(DeviceState state) {
+        switch (state) {
+            case kDeviceStateSpeaking:
+                return kSpeakingLoadMa;
+            case kDeviceStateListening:
+            case kDeviceStateConnecting:
+                return kListeningLoadMa;
+            default:
+                return kIdleLoadMa;
         }
+    }
 
-        // 如果电池电量数据不足，则读取电池电量数据
-        if (adc_values_.size() < kBatteryAdcDataCount) {
-            ReadBatteryAdcData();
-            return;
+    static int Median(int* values, int count) {
+        std::nth_element(values, values + count / 2, values + count);
+        return values[count / 2];
+    }
+
+    bool SampleAdcFrame(int& battery_raw, int& usb_raw) {
+        uint8_t buffer[kAdcFrameBytes];
+        uint32_t length = 0;
+        adc_continuous_flush_pool(adc_handle_);
+        ESP_ERROR_CHECK(adc_continuous_start(adc_handle_));
+        esp_err_t err = adc_continuous_read(adc_handle_, buffer, sizeof(buffer), &length, kAdcReadTimeoutMs);
+        adc_continuous_stop(adc_handle_);
+        if (err != ESP_OK) {
+            ESP_LOGW("PowerManager", "ADC read failed (err=0x%x)", err);
+            return false;
         }
 
-        // 如果电池电量数据充足，则每 kBatteryAdcInterval 个 tick 读取一次电池电量数据
-        ticks_++;
-        if (ticks_ % kBatteryAdcInterval == 0) {
-            ReadBatteryAdcData();
+        // 两个通道交替转换，各自取中值去掉毛刺
+        int battery_values[kAdcFrameSamples];
+        int usb_values[kAdcFrameSamples];
+        int battery_count = 0;
+        int usb_count = 0;
+        for (uint32_t i = 0; i < length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            auto data = reinterpret_cast<adc_digi_output_data_t*>(&buffer[i]);
+            if (data->type2.channel == POWER_BATTERY_ADC_CHANNEL) {
+                battery_values[battery_count++] = data->type2.data;
+            } else if (data->type2.channel == POWER_USBIN_ADC_CHANNEL) {
+                usb_values[usb_count++] = data->type2.data;
+            }
+        }
+        if (battery_count == 0 || usb_count == 0) {
+            return false;
         }
+        battery_raw = Median(battery_values, battery_count);
+        usb_raw = Median(usb_values, usb_count);
+        return true;
     }
 
-    void ReadBatteryAdcData() {
-        int adc_value;
-        ESP_ERROR_CHECK(adc_oneshot_read(adc_handle_, POWER_BATTERY_ADC_CHANNEL, &adc_value));
-
-        // 将 ADC 值添加到队列中
-        adc_values_.push_back(adc_value);
-        if (adc_values_.size() > kBatteryAdcDataCount) {
-            adc_values_.erase(adc_values_.begin());
+    int RawToBatteryMv(int raw) {
+        int pin_mv = 0;
+        if (adc_cali_handle_ == nullptr || adc_cali_raw_to_voltage(adc_cali_handle_, raw, &pin_mv) != ESP_OK) {
+            pin_mv = raw * 3100 / 4095;
         }
-        uint32_t average_adc = 0;
-        for (auto value : adc_values_) {
-            average_adc += value;
+        return pin_mv * POWER_BATTERY_DIVIDER_NUM / POWER_BATTERY_DIVIDER_DEN;
+    }
+
+    void CheckBatteryStatus() {
+        int battery_raw;
+        if (!SampleAdcFrame(battery_raw, usb_adc_raw_)) {
+            return;
         }
-        average_adc /= adc_values_.size();
-
-        // 定义电池电量区间
-        const struct {
-            uint16_t adc;
-            uint8_t level;
-        } levels[] = {
-            {1970, 0},
-            {2062, 20},
-            {2154, 40},
-            {2246, 60},
-            {2338, 80},
-            {2430, 100}
-        };
+        new_charging_status = (1500 < usb_adc_raw_ && usb_adc_raw_ < 4000);
 
-        // 低于最低值时
-        if (average_adc < levels[0].adc) {
-            battery_level_ = 0;
+        int battery_mv = RawToBatteryMv(battery_raw);
+        int load_ma = GetLoadCurrentMa(Application::GetInstance().GetDeviceState());
+        battery_gauge_.AddSample(battery_mv, load_ma, new_charging_status);
+        if (battery_gauge_.GetLevel() >= 0) {
+            battery_level_ = battery_gauge_.GetLevel();
         }
-        // 高于最高值时
-        else if (average_adc >= levels[5].adc) {
-			battery_level_ = 100;
-        } else {
-            // 线性插值计算中间值
-            for (int i = 0; i < 5; i++) {
-                if (average_adc >= levels[i].adc && average_adc < levels[i+1].adc) {
-                    float ratio = static_cast<float>(average_adc - levels[i].adc) / (levels[i+1].adc - levels[i].adc);
-                    battery_level_ = levels[i].level + ratio * (levels[i+1].level - levels[i].level);
-                    break;
-                }
+
+        if (new_charging_status != is_charging_) {
+            is_charging_ = new_charging_status;
+            if (on_charging_status_changed_) {
+                on_charging_status_changed_(is_charging_);
             }
         }
 
         // Check low battery status
-        if (adc_values_.size() >= kBatteryAdcDataCount) {
+        if (battery_gauge_.IsReady()) {
             bool new_low_battery_status = battery_level_ <= kLowBatteryLevel;
             if (new_low_battery_status != is_low_battery_) {
                 is_low_battery_ = new_low_battery_status;
@@ -200,7 +221,56 @@ private:
             }
         }
 
-        ESP_LOGI("PowerManager", "ADC value: %d average: %ld level: %ld", adc_value, average_adc, battery_level_);
+        if (ticks_++ % kBatteryLogInterval == 0) {
+            ESP_LOGI("PowerManager", "Battery %d mV load %d mA ocv %d mV level %ld",
+                battery_mv, load_ma, battery_gauge_.GetOcvMv(), battery_level_);
+        }
+    }
+
+    void BatteryTask() {
+        while (!stopping_) {
+            vTaskDelay(pdMS_TO_TICKS(kBatterySampleIntervalMs));
+            CheckBatteryStatus();
+        }
+        battery_task_handle_ = nullptr;
+        vTaskDelete(NULL);
+    }
+
+    void InitializeAdc() {
+        adc_continuous_handle_cfg_t handle_config = {
+            .max_store_buf_size = kAdcFrameBytes * 2,
+            .conv_frame_size = kAdcFrameBytes,
+        };
+        ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_config, &adc_handle_));
+
+        adc_digi_pattern_config_t patterns[2] = {};
+        patterns[0].atten = ADC_ATTEN_DB_12;
+        patterns[0].channel = POWER_BATTERY_ADC_CHANNEL; // 电池电量
+        patterns[0].unit = POWER_CBS_ADC_UNIT;
+        patterns[0].bit_width = ADC_BITWIDTH_12;
+        patterns[1] = patterns[0];
+        patterns[1].channel = POWER_USBIN_ADC_CHANNEL; // usb
+
+        adc_continuous_config_t config = {
+            .pattern_num = 2,
+            .adc_pattern = patterns,
+            .sample_freq_hz = kAdcSampleFreqHz,
+            .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+            .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+        };
+        ESP_ERROR_CHECK(adc_continuous_config(adc_handle_, &config));
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        adc_cali_curve_fitting_config_t cali_config = {
+            .unit_id = POWER_CBS_ADC_UNIT,
+            .atten = ADC_ATTEN_DB_12,
+            .bitwidth = ADC_BITWIDTH_12,
+        };
+        if (adc_cali_create_scheme_curve_fitting(&cali_config, &adc_cali_handle_) != ESP_OK) {
+            ESP_LOGW("PowerManager", "ADC calibration unavailable, using nominal scale");
+            adc_cali_handle_ = nullptr;
+        }
+#endif
     }
 
 public:
@@ -227,19 +297,6 @@ public:
         gpio_set_level(Power_Control, 1);
         ESP_LOGI("powercontrol", "turnded on ...");
         
-        // 创建电源控制检查定时器
-        esp_timer_create_args_t power_timer_args = {
-            .callback = [](void* arg) {
-                PowerManager* self = static_cast<PowerManager*>(arg);
-                self->PowrSwitch();
-            },
-            .arg = this,
-            .dispatch_method = ESP_TIMER_TASK,
-            .name = "power_cotrol_timer",
-            .skip_unhandled_events = true,
-        };
-        ESP_ERROR_CHECK(esp_timer_create(&power_timer_args, &power_timer_handle_));
-        ESP_ERROR_CHECK(esp_timer_start_periodic(power_timer_handle_, 200000));
         // 初始化充电引脚
         gpio_config_t io_conf = {};
         io_conf.intr_type = GPIO_INTR_DISABLE;
@@ -249,46 +306,44 @@ public:
         io_conf.pull_up_en = GPIO_PULLUP_DISABLE;     
         gpio_config(&io_conf);
 
-        // 创建电池电量检查定时器
-        esp_timer_create_args_t timer_args = {
+        InitializeAdc();
+        // 先同步采样一次，开机时的 USB 检测和电量显示依赖这次结果
+        CheckBatteryStatus();
+        xTaskCreate([](void* arg) {
+            static_cast<PowerManager*>(arg)->BatteryTask();
+        }, "battery", 3072, this, 1, &battery_task_handle_);
+
+        // 创建电源控制检查定时器
+        esp_timer_create_args_t power_timer_args = {
             .callback = [](void* arg) {
                 PowerManager* self = static_cast<PowerManager*>(arg);
-                self->CheckBatteryStatus();
+                self->PowrSwitch();
             },
             .arg = this,
             .dispatch_method = ESP_TIMER_TASK,
-            .name = "battery_check_timer",
+            .name = "power_cotrol_timer",
             .skip_unhandled_events = true,
         };
-        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_handle_));
-        ESP_ERROR_CHECK(esp_timer_start_periodic(timer_handle_, 1000000));
-
-        adc_oneshot_unit_init_cfg_t init_config = {
-            .unit_id = POWER_CBS_ADC_UNIT,
-            .ulp_mode = ADC_ULP_MODE_DISABLE,
-        };
-        ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config, &adc_handle_));
-
-        adc_oneshot_chan_cfg_t chan_config = {
-            .atten = ADC_ATTEN_DB_12,
-            .bitwidth = ADC_BITWIDTH_12,
-        };
-        ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle_, POWER_BATTERY_ADC_CHANNEL, &chan_config)); // 电池电量
-        ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle_, POWER_USBIN_ADC_CHANNEL, &chan_config)); // usb
+        ESP_ERROR_CHECK(esp_timer_create(&power_timer_args, &power_timer_handle_));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(power_timer_handle_, 200000));
     }
 
     ~PowerManager() {
-        if (timer_handle_) {
-            esp_timer_stop(timer_handle_);
-            esp_timer_delete(timer_handle_);
+        if (battery_task_handle_ != nullptr) {
+            vTaskDelete(battery_task_handle_);
         }
         if (power_timer_handle_) {
             esp_timer_stop(power_timer_handle_);
             esp_timer_delete(power_timer_handle_);
         }
         if (adc_handle_ != nullptr) {
-            adc_oneshot_del_unit(adc_handle_);
+            adc_continuous_deinit(adc_handle_);
+        }
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        if (adc_cali_handle_ != nullptr) {
+            adc_cali_delete_scheme_curve_fitting(adc_cali_handle_);
         }
+#endif
     }
 
     bool IsCharging() {
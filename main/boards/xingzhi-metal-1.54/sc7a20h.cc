@@ -1,149 +1,359 @@
 #include "sc7a20h.h"
 #include <esp_log.h>
 #include <driver/i2c_master.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
 
 
 #define TAG "Sc7a20hSensor"
 
 #define WHO_AM_I_REG 0x0F
 #define CTRL_REG1  0x20
+#define CTRL_REG2  0x21
+#define CTRL_REG3  0x22
 #define CTRL_REG4  0x23
+#define CTRL_REG5  0x24
 #define OUT_X_L_REG  0x28
-#define OUT_X_H_REG  0x29
-#define OUT_Y_L_REG  0x2A
-#define OUT_Y_H_REG  0x2B
-#define OUT_Z_L_REG  0x2C
-#define OUT_Z_H_REG  0x2D
+#define FIFO_CTRL_REG  0x2E
+#define FIFO_SRC_REG  0x2F
+#define INT1_CFG_REG  0x30
+#define INT1_SRC_REG  0x31
+#define INT1_THS_REG  0x32
+#define INT1_DURATION_REG  0x33
+#define INT2_CFG_REG  0x34
+#define INT2_SRC_REG  0x35
+#define INT2_THS_REG  0x36
+#define INT2_DURATION_REG  0x37
+#define CLICK_CFG_REG  0x38
+#define CLICK_SRC_REG  0x39
+#define CLICK_THS_REG  0x3A
+#define TIME_LIMIT_REG  0x3B
+#define TIME_LATENCY_REG  0x3C
+#define TIME_WINDOW_REG  0x3D
+
+// 多字节读取时子地址最高位置 1 以自动递增
+#define AUTO_INCREMENT  0x80
+
+// CTRL_REG3: 路由到 INT1 引脚的中断源
+#define I1_CLICK  0x80
+#define I1_AOI1  0x40
+#define I1_AOI2  0x20
+#define I1_WTM  0x04
+
+// CTRL_REG5
+#define FIFO_EN  0x40
+#define LIR_INT1  0x08
+#define LIR_INT2  0x02
+
+// FIFO_CTRL_REG 模式位
+#define FIFO_MODE_BYPASS  0x00
+#define FIFO_MODE_STREAM  0x80
+
+// FIFO_SRC_REG
+#define FIFO_SRC_OVRN  0x40
+#define FIFO_SRC_FSS_MASK  0x1F
+
+// INTx_SRC / CLICK_SRC
+#define SRC_IA  0x40
+#define CLICK_SRC_DCLICK  0x20
+
+// 100Hz 输出数据率，±2g 量程下阈值 1LSB = 16mg
+#define OUTPUT_DATA_RATE_HZ  100
+#define THRESHOLD_LSB_MG  16
+
+// task_events_ 中读取任务退出的标志
+#define TASK_EXITED_BIT  (1 << 0)
+
+static_assert(sizeof(Sc7a20hSample) == 6, "FIFO samples are read directly into Sc7a20hSample");
 
 Sc7a20hSensor::Sc7a20hSensor(i2c_master_bus_handle_t i2c_bus, uint8_t addr)
     : I2cDevice(i2c_bus, addr) {
 }
 
+Sc7a20hSensor::~Sc7a20hSensor() {
+    Stop();
+    if (task_events_ != nullptr) {
+        vEventGroupDelete(task_events_);
+    }
+}
+
+void Sc7a20hSensor::WriteRegister(uint8_t reg, uint8_t value) {
+    WriteReg(reg, value);
+}
+
+void Sc7a20hSensor::ReadRegisters(uint8_t reg, uint8_t* buffer, size_t length) {
+    ReadRegs(length > 1 ? (reg | AUTO_INCREMENT) : reg, buffer, length);
+}
+
 esp_err_t Sc7a20hSensor::Initialize() {
-    uint8_t who_am_i_buf[1] = {0};
-    ReadRegs(WHO_AM_I_REG, who_am_i_buf, 1); // 使用ReadRegs替代ReadReg
-    
-    uint8_t who_am_i = who_am_i_buf[0];
+    uint8_t who_am_i = 0;
+    ReadRegisters(WHO_AM_I_REG, &who_am_i, 1);
     if (who_am_i != 0x11) {
         ESP_LOGE(TAG, "无效的WHO_AM_I值: 0x%02X (期望值: 0x11)", who_am_i);
         return ESP_FAIL;
     }
 
-    // 配置加速度计: 100Hz输出数据率, ±4g量程
-    WriteReg(CTRL_REG1, 0x57);
-    WriteReg(CTRL_REG4, 0x01);
-    
+    // 配置加速度计: 100Hz输出数据率，块数据更新
+    WriteRegister(CTRL_REG1, 0x57);
+    WriteRegister(CTRL_REG4, 0x81);
+    // 高通滤波只作用于活动检测和敲击，去掉重力分量
+    WriteRegister(CTRL_REG2, 0x05);
+    // 锁存 INT1/INT2 事件，读取 SRC 寄存器后清除
+    WriteRegister(CTRL_REG5, LIR_INT1 | LIR_INT2);
+    WriteRegister(CTRL_REG3, 0);
+    WriteRegister(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
+    ctrl_reg3_ = 0;
+
     ESP_LOGI(TAG, "SC7A20H初始化成功");
     return ESP_OK;
 }
 
-esp_err_t Sc7a20hSensor::StartReading(float interval_ms) {
-    if (reading_) {
-        return ESP_OK; // 已经在读取中
-    }
-    
-    esp_timer_create_args_t timer_args = {
-        .callback = &Sc7a20hSensor::ReadTimerCallback,
-        .arg = this,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "sc7a20h_read_timer",
-        .skip_unhandled_events = true
-    };
-    
-    esp_err_t err = esp_timer_create(&timer_args, &read_timer_handle_);
+int Sc7a20hSensor::MgToThreshold(int mg) const {
+    int value = (mg + THRESHOLD_LSB_MG / 2) / THRESHOLD_LSB_MG;
+    return value < 1 ? 1 : (value > 0x7F ? 0x7F : value);
+}
+
+int Sc7a20hSensor::MsToDuration(int ms) const {
+    int value = ms * OUTPUT_DATA_RATE_HZ / 1000;
+    return value < 0 ? 0 : (value > 0x7F ? 0x7F : value);
+}
+
+void Sc7a20hSensor::SetInt1Routing(uint8_t mask, bool enable) {
+    if (enable) {
+        ctrl_reg3_ |= mask;
+    } else {
+        ctrl_reg3_ &= ~mask;
+    }
+    WriteRegister(CTRL_REG3, ctrl_reg3_);
+}
+
+void Sc7a20hSensor::ConfigureActivityInterrupt(int threshold_mg, int duration_ms) {
+    // INT1 发生器：任一轴高于阈值（OR 组合）
+    WriteRegister(INT1_THS_REG, MgToThreshold(threshold_mg));
+    WriteRegister(INT1_DURATION_REG, MsToDuration(duration_ms));
+    WriteRegister(INT1_CFG_REG, 0x2A);
+    SetInt1Routing(I1_AOI1, true);
+}
+
+void Sc7a20hSensor::ConfigureFreeFallInterrupt(int threshold_mg, int duration_ms) {
+    // INT2 发生器：三轴同时低于阈值（AND 组合）
+    WriteRegister(INT2_THS_REG, MgToThreshold(threshold_mg));
+    WriteRegister(INT2_DURATION_REG, MsToDuration(duration_ms));
+    WriteRegister(INT2_CFG_REG, 0x95);
+    SetInt1Routing(I1_AOI2, true);
+}
+
+void Sc7a20hSensor::ConfigureDoubleTapInterrupt(int threshold_mg, int time_limit_ms, int latency_ms, int window_ms) {
+    WriteRegister(CLICK_THS_REG, MgToThreshold(threshold_mg));
+    WriteRegister(TIME_LIMIT_REG, MsToDuration(time_limit_ms));
+    WriteRegister(TIME_LATENCY_REG, MsToDuration(latency_ms));
+    WriteRegister(TIME_WINDOW_REG, MsToDuration(window_ms));
+    // 三轴双击
+    WriteRegister(CLICK_CFG_REG, 0x2A);
+    SetInt1Routing(I1_CLICK, true);
+}
+
+esp_err_t Sc7a20hSensor::StartStreaming(uint8_t watermark, gpio_num_t int_gpio) {
+    if (streaming_) {
+        return ESP_OK;
+    }
+    if (watermark >= SC7A20H_FIFO_DEPTH) {
+        watermark = SC7A20H_FIFO_DEPTH - 1;
+    }
+    watermark_ = watermark;
+    // 没有中断引脚时，按 FIFO 填满到水位所需的时间轮询
+    poll_interval_ms_ = (watermark_ + 1) * 1000 / OUTPUT_DATA_RATE_HZ;
+
+    // 先经过 Bypass 清空 FIFO，再进入流模式
+    WriteRegister(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
+    WriteRegister(CTRL_REG5, FIFO_EN | LIR_INT1 | LIR_INT2);
+    WriteRegister(FIFO_CTRL_REG, FIFO_MODE_STREAM | watermark_);
+    SetInt1Routing(I1_WTM, true);
+    streaming_ = true;
+
+    esp_err_t err = StartTask(int_gpio);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "创建定时器失败 (err=0x%x)", err);
+        Stop();
         return err;
     }
-    
-    err = esp_timer_start_periodic(read_timer_handle_, (uint64_t)(interval_ms * 1000));
+    ESP_LOGI(TAG, "FIFO流模式已启动，水位 %d，%s", watermark_ + 1,
+        int_gpio_ != GPIO_NUM_NC ? "中断触发" : "轮询");
+    return ESP_OK;
+}
+
+esp_err_t Sc7a20hSensor::StartEventMonitor(gpio_num_t int_gpio, int poll_interval_ms) {
+    if (task_handle_ != nullptr) {
+        return ESP_OK;
+    }
+    poll_interval_ms_ = poll_interval_ms;
+    esp_err_t err = StartTask(int_gpio);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "启动定时器失败 (err=0x%x)", err);
-        esp_timer_delete(read_timer_handle_);
-        read_timer_handle_ = nullptr;
+        Stop();
         return err;
     }
-    
-    reading_ = true;
-    ESP_LOGI(TAG, "开始周期性读取，间隔 %.1f ms", interval_ms);
+    ESP_LOGI(TAG, "片上事件监测已启动，%s", int_gpio_ != GPIO_NUM_NC ? "中断触发" : "轮询");
     return ESP_OK;
 }
 
-esp_err_t Sc7a20hSensor::StopReading() {
-    if (!reading_) {
-        return ESP_OK; // 已经停止
+esp_err_t Sc7a20hSensor::StartTask(gpio_num_t int_gpio) {
+    // 先配置中断引脚，任何一步失败都退回轮询，任务不会无限期等待一个不会到来的通知
+    int_gpio_ = GPIO_NUM_NC;
+    if (int_gpio != GPIO_NUM_NC) {
+        gpio_config_t io_conf = {};
+        io_conf.intr_type = GPIO_INTR_POSEDGE;
+        io_conf.mode = GPIO_MODE_INPUT;
+        io_conf.pin_bit_mask = (1ULL << int_gpio);
+        io_conf.pull_down_en = GPIO_PULLDOWN_ENABLE;
+        io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
+        esp_err_t err = gpio_config(&io_conf);
+        if (err == ESP_OK) {
+            // ISR 服务可能已被其他驱动安装
+            err = gpio_install_isr_service(0);
+            if (err == ESP_ERR_INVALID_STATE) {
+                err = ESP_OK;
+            }
+        }
+        if (err == ESP_OK) {
+            err = gpio_isr_handler_add(int_gpio, IsrHandler, this);
+        }
+        if (err == ESP_OK) {
+            int_gpio_ = int_gpio;
+        } else {
+            ESP_LOGW(TAG, "INT1 引脚 %d 中断配置失败 (err=0x%x)，改为每 %d ms 轮询", int_gpio, err, poll_interval_ms_);
+        }
+    }
+
+    if (task_events_ == nullptr) {
+        task_events_ = xEventGroupCreate();
     }
-    
-    if (read_timer_handle_) {
-        esp_timer_stop(read_timer_handle_);
-        esp_timer_delete(read_timer_handle_);
-        read_timer_handle_ = nullptr;
+    xEventGroupClearBits(task_events_, TASK_EXITED_BIT);
+    stop_requested_ = false;
+    if (xTaskCreate([](void* arg) {
+            static_cast<Sc7a20hSensor*>(arg)->StreamingTask();
+            vTaskDelete(NULL);
+        }, "sc7a20h", 3072, this, 1, &task_handle_) != pdPASS) {
+        ESP_LOGE(TAG, "创建读取任务失败");
+        task_handle_ = nullptr;
+        if (int_gpio_ != GPIO_NUM_NC) {
+            gpio_isr_handler_remove(int_gpio_);
+            int_gpio_ = GPIO_NUM_NC;
+        }
+        return ESP_ERR_NO_MEM;
     }
-    
-    reading_ = false;
-    ESP_LOGI(TAG, "停止周期性读取");
     return ESP_OK;
 }
 
-// 静态定时器回调函数
-void Sc7a20hSensor::ReadTimerCallback(void* arg) {
-    Sc7a20hSensor* sensor = static_cast<Sc7a20hSensor*>(arg);
-    sensor->OnReadTimer();
-}
+esp_err_t Sc7a20hSensor::Stop() {
+    if (int_gpio_ != GPIO_NUM_NC) {
+        gpio_isr_handler_remove(int_gpio_);
+        int_gpio_ = GPIO_NUM_NC;
+    }
+    if (task_handle_ != nullptr) {
+        // 任务可能正在读写 I2C，通知它在本次处理结束后退出，等它退出后再操作寄存器
+        stop_requested_ = true;
+        xTaskNotifyGive(task_handle_);
+        xEventGroupWaitBits(task_events_, TASK_EXITED_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        task_handle_ = nullptr;
+    }
 
-// 定时器触发的读取操作
-void Sc7a20hSensor::OnReadTimer() {
-    int16_t x, y, z;
-    esp_err_t err = ReadAcceleration(&x, &y, &z);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "读取加速度数据失败 (err=0x%x)", err);
-    } else if (err == ESP_OK && acceleration_callback_) {
-        acceleration_callback_(accel_x, accel_y, accel_z);
+    if (streaming_) {
+        SetInt1Routing(I1_WTM, false);
+        WriteRegister(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
+        WriteRegister(CTRL_REG5, LIR_INT1 | LIR_INT2);
+        streaming_ = false;
+        ESP_LOGI(TAG, "FIFO流模式已停止");
     }
+    return ESP_OK;
 }
 
-esp_err_t Sc7a20hSensor::ReadAcceleration(int16_t* x, int16_t* y, int16_t* z) {
-    if (x == NULL || y == NULL || z == NULL) {
-        ESP_LOGE(TAG, "无效的输出指针");
-        return ESP_ERR_INVALID_ARG;
+void IRAM_ATTR Sc7a20hSensor::IsrHandler(void* arg) {
+    auto self = static_cast<Sc7a20hSensor*>(arg);
+    // 中断在任务创建之前就已注册
+    if (self->task_handle_ == nullptr) {
+        return;
     }
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->task_handle_, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
 
-    uint8_t data[6] = {0};
-    ReadRegs(OUT_X_L_REG, &data[0], 1);
-    ReadRegs(OUT_X_H_REG, &data[1], 1);
-    ReadRegs(OUT_Y_L_REG, &data[2], 1);
-    ReadRegs(OUT_Y_H_REG, &data[3], 1);
-    ReadRegs(OUT_Z_L_REG, &data[4], 1);
-    ReadRegs(OUT_Z_H_REG, &data[5], 1);
-
+void Sc7a20hSensor::StreamingTask() {
+    TickType_t wait = int_gpio_ != GPIO_NUM_NC ? portMAX_DELAY : pdMS_TO_TICKS(poll_interval_ms_);
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (stop_requested_) {
+            break;
+        }
+        ServiceInterrupt();
+    }
+    xEventGroupSetBits(task_events_, TASK_EXITED_BIT);
+}
 
-    // 组合高低字节(16位有符号数)
-    // int16_t raw_x = (int16_t)((data[1] << 8) | data[0]);
-    // int16_t raw_y = (int16_t)((data[3] << 8) | data[2]);
-    // int16_t raw_z = (int16_t)((data[5] << 8) | data[4]);
-    int16_t raw_x = (int16_t)((data[1] << 8) | data[0]) >> 4;
-    int16_t raw_y = (int16_t)((data[3] << 8) | data[2]) >> 4;
-    int16_t raw_z = (int16_t)((data[5] << 8) | data[4]) >> 4;
+void Sc7a20hSensor::ServiceInterrupt() {
+    if (streaming_) {
+        size_t count = ReadFifo(fifo_buffer_, SC7A20H_FIFO_DEPTH);
+        if (count > 0 && fifo_callback_) {
+            fifo_callback_(fifo_buffer_, count);
+        }
+    }
 
+    // 读取 SRC 寄存器同时清除锁存的中断
+    if (ctrl_reg3_ & I1_AOI1) {
+        uint8_t src = 0;
+        ReadRegisters(INT1_SRC_REG, &src, 1);
+        if ((src & SRC_IA) && event_callback_) {
+            event_callback_(kSc7a20hEventActivity);
+        }
+    }
+    if (ctrl_reg3_ & I1_AOI2) {
+        uint8_t src = 0;
+        ReadRegisters(INT2_SRC_REG, &src, 1);
+        if ((src & SRC_IA) && event_callback_) {
+            event_callback_(kSc7a20hEventFreeFall);
+        }
+    }
+    if (ctrl_reg3_ & I1_CLICK) {
+        uint8_t src = 0;
+        ReadRegisters(CLICK_SRC_REG, &src, 1);
+        if ((src & SRC_IA) && (src & CLICK_SRC_DCLICK) && event_callback_) {
+            event_callback_(kSc7a20hEventDoubleTap);
+        }
+    }
+}
 
-    // 转换为g单位（±4g量程时，1LSB = 4g / 2^14 ≈ 0.000244g）
-    accel_x = raw_x * 0.000244f;
-    accel_y = raw_y * 0.000244f;
-    accel_z = raw_z * 0.000244f;
+size_t Sc7a20hSensor::ReadFifo(Sc7a20hSample* samples, size_t max_samples) {
+    uint8_t fifo_src = 0;
+    ReadRegisters(FIFO_SRC_REG, &fifo_src, 1);
+    // 溢出时 FIFO 已满 32 个样本，FSS 只有 5 位
+    size_t count = (fifo_src & FIFO_SRC_OVRN) ? SC7A20H_FIFO_DEPTH : (fifo_src & FIFO_SRC_FSS_MASK);
+    if (count > max_samples) {
+        count = max_samples;
+    }
+    if (count == 0) {
+        return 0;
+    }
 
-    // // 打印原始数据用于调试
-    // ESP_LOGI(TAG, "原始数据字节: d0=0x%02X d1=0x%02X d2=0x%02X d3=0x%02X d4=0x%02X",
-    //          data[0], data[1], data[2], data[3], data[4]);
+    // FIFO 模式下 OUT_X_L..OUT_Z_H 自动回绕，一次事务读出全部样本，
+    // 小端字节序与 Sc7a20hSample 的布局一致，直接读入
+    ReadRegisters(OUT_X_L_REG, reinterpret_cast<uint8_t*>(samples), count * sizeof(Sc7a20hSample));
+    for (size_t i = 0; i < count; i++) {
+        samples[i].x >>= 4;
+        samples[i].y >>= 4;
+        samples[i].z >>= 4;
+    }
+    return count;
+}
 
-    // 打印浮点数格式的加速度值
-    ESP_LOGI(TAG, "加速度数据 X:%.2fg Y:%.2fg Z:%.2fg", accel_x, accel_y, accel_z);
+esp_err_t Sc7a20hSensor::ReadAcceleration(int16_t* x, int16_t* y, int16_t* z) {
+    if (x == NULL || y == NULL || z == NULL) {
+        ESP_LOGE(TAG, "无效的输出指针");
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    // 保存原始值
-    *x = raw_x;
-    *y = raw_y;
-    *z = raw_z;
+    uint8_t data[6] = {0};
+    ReadRegisters(OUT_X_L_REG, data, sizeof(data));
 
+    // 组合高低字节，数据左对齐为 12 位
+    *x = (int16_t)((data[1] << 8) | data[0]) >> 4;
+    *y = (int16_t)((data[3] << 8) | data[2]) >> 4;
+    *z = (int16_t)((data[5] << 8) | data[4]) >> 4;
     return ESP_OK;
-}
\ No newline at end of file
+}
@@ -3,41 +3,88 @@
 
 #include "i2c_device.h"
 #include "esp_err.h"
-#include "driver/i2c.h"
+#include <driver/gpio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <atomic>
 #include <functional>
 
+#define SC7A20H_FIFO_DEPTH 32
+
+struct Sc7a20hSample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+enum Sc7a20hEvent {
+    kSc7a20hEventActivity,
+    kSc7a20hEventFreeFall,
+    kSc7a20hEventDoubleTap,
+};
+
 class Sc7a20hSensor : public I2cDevice {
 public:
     Sc7a20hSensor(i2c_master_bus_handle_t i2c_bus, uint8_t addr = 0x19);
-    
+    virtual ~Sc7a20hSensor();
+
     esp_err_t Initialize();
-    esp_err_t StartReading(float interval_ms = 100);
-    esp_err_t StopReading();
-    
+
+    // FIFO 流模式：水位到达后通过 INT1 唤醒，一次突发读取全部样本。
+    // int_gpio 为 GPIO_NUM_NC 时按水位周期轮询 FIFO
+    esp_err_t StartStreaming(uint8_t watermark = SC7A20H_FIFO_DEPTH - 1, gpio_num_t int_gpio = GPIO_NUM_NC);
+    // 只处理片上事件，不开启 FIFO。事件在芯片内锁存，没有中断引脚时每 poll_interval_ms 读一次 SRC 寄存器
+    esp_err_t StartEventMonitor(gpio_num_t int_gpio = GPIO_NUM_NC, int poll_interval_ms = 1000);
+    // 停止 FIFO 和读取任务
+    esp_err_t Stop();
+    bool IsStreaming() const { return streaming_; }
+
+    // 片上中断配置，事件都路由到 INT1 引脚
+    void ConfigureActivityInterrupt(int threshold_mg, int duration_ms);
+    void ConfigureFreeFallInterrupt(int threshold_mg, int duration_ms);
+    void ConfigureDoubleTapInterrupt(int threshold_mg, int time_limit_ms, int latency_ms, int window_ms);
+
     esp_err_t ReadAcceleration(int16_t* x, int16_t* y, int16_t* z);
-    bool IsReading() const { return reading_; }
+    size_t ReadFifo(Sc7a20hSample* samples, size_t max_samples);
+
+    // 原始值转换为 g
+    static float ToG(int16_t raw) { return raw * 0.000244f; }
+
+    using FifoCallback = std::function<void(const Sc7a20hSample* samples, size_t count)>;
+    using EventCallback = std::function<void(Sc7a20hEvent event)>;
+
+    void OnFifoData(FifoCallback callback) { fifo_callback_ = callback; }
+    void OnEvent(EventCallback callback) { event_callback_ = callback; }
 
-    // 加速度数据回调函数类型
-    using AccelerationCallback = std::function<void(float x, float y, float z)>;
-    
-    // 设置加速度数据回调
-    void SetAccelerationCallback(AccelerationCallback callback) {
-        acceleration_callback_ = callback;
-    }
+protected:
+    // 所有寄存器访问都经过这两个方法，便于用模拟寄存器表替换
+    virtual void WriteRegister(uint8_t reg, uint8_t value);
+    virtual void ReadRegisters(uint8_t reg, uint8_t* buffer, size_t length);
+
+    void ServiceInterrupt();
 
 private:
-    bool reading_ = false;
-    esp_timer_handle_t read_timer_handle_ = nullptr;
-
-    static void ReadTimerCallback(void* arg);
-    void OnReadTimer();
-    
-    AccelerationCallback acceleration_callback_;
-    
-    // 添加存储加速度值的成员变量
-    float accel_x = 0.0f;
-    float accel_y = 0.0f;
-    float accel_z = 0.0f;
+    bool streaming_ = false;
+    uint8_t ctrl_reg3_ = 0;
+    uint8_t watermark_ = SC7A20H_FIFO_DEPTH - 1;
+    gpio_num_t int_gpio_ = GPIO_NUM_NC;
+    int poll_interval_ms_ = 1000;
+    TaskHandle_t task_handle_ = nullptr;
+    // Stop 通知任务退出后等待它自己结束，不在 I2C 事务中途删除任务
+    std::atomic<bool> stop_requested_ = false;
+    EventGroupHandle_t task_events_ = nullptr;
+    Sc7a20hSample fifo_buffer_[SC7A20H_FIFO_DEPTH];
+
+    FifoCallback fifo_callback_;
+    EventCallback event_callback_;
+
+    static void IsrHandler(void* arg);
+    esp_err_t StartTask(gpio_num_t int_gpio);
+    void StreamingTask();
+    void SetInt1Routing(uint8_t mask, bool enable);
+    int MgToThreshold(int mg) const;
+    int MsToDuration(int ms) const;
 };
 
-#endif // SC7A20H_H
\ No newline at end of file
+#endif // SC7A20H_H
@@ -24,6 +24,10 @@
 #include <esp_sleep.h>
 #include <wifi_station.h>
 #include "sc7a20h.h"
+#include "touch_gesture.h"
+#include "power_governor.h"
+
+#include <atomic>
 
 #define TAG "XINGZHI_METAL_1_54"
 
@@ -42,6 +46,8 @@ public:
         ESP_LOGI(TAG, "Get chip ID");
         uint8_t chip_id = ReadReg(0xA7);//0xAA
         ESP_LOGI(TAG, "Get chip ID: 0x%02X", chip_id);
+        // IrqCtl: 触摸期间周期性拉低 INT，并在触摸状态变化时产生脉冲
+        WriteReg(0xFA, 0x60);
         read_buffer_ = new uint8_t[6];
     }
 
@@ -49,29 +55,17 @@ public:
         delete[] read_buffer_;
     }
 
+    // 由 INT 唤醒后读取，一次突发读取即可得到完整的触摸点
     void UpdateTouchPoint() {
-        TouchPoint_t tp1,tp2;
-        ReadRegs(0x02, read_buffer_, 6);
-        tp1.num = read_buffer_[0] & 0x0F;
-        tp1.x = ((read_buffer_[1] & 0x0F) << 8) | read_buffer_[2];
-        tp1.y = ((read_buffer_[3] & 0x0F) << 8) | read_buffer_[4];
-        for (int i = 0; i < 6; i++) {
-        read_buffer_[i] = 0;}
-        vTaskDelay(pdMS_TO_TICKS(10));
         ReadRegs(0x02, read_buffer_, 6);
-        tp2.num = read_buffer_[0] & 0x0F;
-        tp2.x = ((read_buffer_[1] & 0x0F) << 8) | read_buffer_[2];
-        tp2.y = ((read_buffer_[3] & 0x0F) << 8) | read_buffer_[4];
-        if ((tp1.num==tp2.num) && (tp1.x==tp2.x))
-        {
-            tp_.num = tp2.num;
-            tp_.x = tp2.x;
-            tp_.y = tp2.y;
-        }else{
-            tp_.num = 0;
+        tp_.num = read_buffer_[0] & 0x0F;
+        if (tp_.num == 0) {
             tp_.x = 0;
             tp_.y = 0;
+            return;
         }
+        tp_.x = ((read_buffer_[1] & 0x0F) << 8) | read_buffer_[2];
+        tp_.y = ((read_buffer_[3] & 0x0F) << 8) | read_buffer_[4];
     }
 
     const TouchPoint_t &GetTouchPoint() {
@@ -86,6 +80,13 @@ private:
 
 class XINGZHI_METAL_1_54 : public DualNetworkBoard {
 private:
+    enum TouchKey {
+        kTouchKeyVolumeUp,
+        kTouchKeyChat,
+        kTouchKeyVolumeDown,
+    };
+    static constexpr int kTouchPollIntervalMs = 50;
+
     i2c_master_bus_handle_t i2c_bus_;
     Cst816x *cst816d_;
 
@@ -95,14 +96,13 @@ private:
     PowerManager* power_manager_;
     esp_lcd_panel_io_handle_t panel_io_ = nullptr;
     esp_lcd_panel_handle_t panel_ = nullptr;
-    int touch_press_num = 0;
-    int64_t touchpress_us = 0;
-    bool touch_released = true;
-    bool touch_40_600_detected = false;  // 新增：记录是否检测到(40,600)触摸点
-    bool single_click_pending = false;  // 新增：标记单次点击待处理
+    TaskHandle_t touch_task_handle_ = nullptr;
+    TouchGestureEngine* touch_gesture_ = nullptr;
     esp_err_t err;
     bool is_device_found = false;
-    Sc7a20hSensor* sc7a20h_sensor_;
+    bool is_sc7a20h_found_ = false;
+    Sc7a20hSensor* sc7a20h_sensor_ = nullptr;
+    std::atomic<bool> sleeping_ = false;
     void InitializePowerManager() {
         power_manager_ = new PowerManager(POWER_USB_IN);//USB是否插入
         power_manager_->OnChargingStatusChanged([this](bool is_charging) {
@@ -121,11 +121,15 @@ private:
             display_->SetChatMessage("system", "");
             display_->SetEmotion("sleepy");
             GetBacklight()->SetBrightness(1);
+            PowerGovernor::GetInstance().SetScreenOn(false);
+            sleeping_ = true;
         });
         power_save_timer_->OnExitSleepMode([this]() {
+            sleeping_ = false;
             display_->SetChatMessage("system", "");
             display_->SetEmotion("neutral");
             GetBacklight()->RestoreBrightness();
+            PowerGovernor::GetInstance().SetScreenOn(true);
         });
         power_save_timer_->OnShutdownRequest([this]() {
             ESP_LOGI(TAG, "Shutting down");
@@ -140,6 +144,15 @@ private:
         power_save_timer_->SetEnabled(true);
     }
 
+    void InitializePowerGovernor() {
+        auto& governor = PowerGovernor::GetInstance();
+        if (GetNetworkType() == NetworkType::ML307) {
+            // ML307 走 UART，light sleep 期间会丢失模组上报的数据
+            governor.SetProfile(kPowerProfileScreenOff, { 40, false, true, 1000, 45 });
+        }
+        governor.EnableFrequencyScaling(true);
+    }
+
     void InitializeI2c() {
         // Initialize I2C peripheral
         i2c_master_bus_config_t i2c_bus_cfg = {
@@ -161,6 +174,8 @@ private:
                 ESP_LOGI(TAG, "Device found at address 0x%02X", addr);
                 if (addr == 0x15) {
                     is_device_found = true;
+                } else if (addr == 0x19) {
+                    is_sc7a20h_found_ = true;
                 }
             }
         }
@@ -187,7 +202,9 @@ private:
     }
 
     void InitializeSC7A20HSensor() {
-            // 初始化传感器
+        if (!is_sc7a20h_found_) {
+            return;
+        }
         sc7a20h_sensor_ = new Sc7a20hSensor(i2c_bus_);
         esp_err_t err = sc7a20h_sensor_->Initialize();
         if (err != ESP_OK) {
@@ -195,15 +212,29 @@ private:
             return;
         }
 
-        // 设置加速度数据回调
-        sc7a20h_sensor_->SetAccelerationCallback([this](float x, float y, float z) {
-            UpdateAccelerationDisplay(x, y, z);
+        // 拿起唤醒由传感器片上检测，CPU 只在事件到来时处理。
+        // 只在息屏后响应，亮屏期间的磕碰不会重置省电计时；没有 FIFO 数据的使用者，不开启流模式
+        sc7a20h_sensor_->ConfigureActivityInterrupt(250, 50);
+        sc7a20h_sensor_->ConfigureFreeFallInterrupt(350, 30);
+        sc7a20h_sensor_->OnEvent([this](Sc7a20hEvent event) {
+            switch (event) {
+                case kSc7a20hEventActivity:
+                    if (sleeping_) {
+                        power_save_timer_->WakeUp();
+                    }
+                    break;
+                case kSc7a20hEventFreeFall:
+                    ESP_LOGW(TAG, "Free fall detected");
+                    break;
+                default:
+                    break;
+            }
         });
 
-        // 启动周期性读取（每100ms一次）
-        err = sc7a20h_sensor_->StartReading(1000);
+        // 事件在芯片内锁存，没有 INT 引脚时每秒读一次即可，不会丢失
+        err = sc7a20h_sensor_->StartEventMonitor(SC7A20H_INT_GPIO, 1000);
         if (err != ESP_OK) {
-            ESP_LOGE(TAG, "启动周期性读取失败 (err=0x%x)", err);
+            ESP_LOGE(TAG, "启动片上事件监测失败 (err=0x%x)", err);
         }
     }
     void UpdateAccelerationDisplay(float x, float y, float z) {
@@ -213,152 +244,82 @@ private:
             // custom_display_->SetAccelerationText(buffer);
         // }
     }
-    void touchpad_daemon(void *param) {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        int count = 0;
-        auto &board = (XINGZHI_METAL_1_54&)Board::GetInstance();
-        auto touchpad = board.GetTouchpad();
-        bool was_touched = false;
-        int count_double = 0;
-        // 长按检测相关变量
-        bool is_touching_40_600 = false;      // 是否正在触摸40,600位置
-        bool is_long_press_detected = false;  // 是否已检测到长按
-        int64_t touch_start_time = 0;         // 触摸开始时间(微秒)
-        const int64_t LONG_PRESS_THRESHOLD = 4000000;  // 5秒(微秒)
-        const int64_t CLICK_THRESHOLD = 300000;       // 单击判断阈值(300毫秒)
-
-        while (1) {
-            touchpad->UpdateTouchPoint();
-            // ESP_LOGI(TAG, "read_buffer_: %d %d %d",touchpad->GetTouchPoint().num,touchpad->GetTouchPoint().x,touchpad->GetTouchPoint().y);
-
-            // 音量减小逻辑 (60,600)
-            if ((touchpad->GetTouchPoint().x == 60) && (touchpad->GetTouchPoint().y == 600)) {
-                ESP_LOGI(TAG, "Volume down: %d %d", touchpad->GetTouchPoint().x, touchpad->GetTouchPoint().y);
-                if (!was_touched) {
-                    was_touched = true;
-                    auto codec = GetAudioCodec();
-                    auto volume = codec->output_volume() - 10;
-                    if (volume < 0) volume = 0;
-                    codec->SetOutputVolume(volume);
-                    GetDisplay()->ShowNotification(Lang::Strings::VOLUME + std::to_string(volume));
-                    count = 0;
-                } else {
-                    count++;
-                    if (count > 10) {
-                        was_touched = false;
-                        count = 0;
-                    }
-                }
-                // resetTouchCounters();  // 重置双击相关状态
-            }
-            // 音量增大逻辑 (20,600)
-            else if ((touchpad->GetTouchPoint().x == 20) && (touchpad->GetTouchPoint().y == 600)) {
-                ESP_LOGI(TAG, "Volume up: %d %d", touchpad->GetTouchPoint().x, touchpad->GetTouchPoint().y);
-                if (!was_touched) {
-                    was_touched = true;
-                    auto codec = GetAudioCodec();
-                    auto volume = codec->output_volume() + 10;
-                    if (volume > 100) volume = 100;
-                    codec->SetOutputVolume(volume);
-                    GetDisplay()->ShowNotification(Lang::Strings::VOLUME + std::to_string(volume));
-                    count = 0;
-                } else {
-                    count++;
-                    if (count > 10) {
-                        was_touched = false;
-                        count = 0;
-                    }
-                }
-            }
-            // 双击检测逻辑 (40,600)
-            else if ((touchpad->GetTouchPoint().x == 40) && (touchpad->GetTouchPoint().y == 600)) {
-                ESP_LOGI(TAG, "Touch detected at (40,600)");
-                // 首次检测到触摸
-                if (!is_touching_40_600) {
-                    is_touching_40_600 = true;
-                    struct timeval tv_now;
-                    gettimeofday(&tv_now, NULL);
-                    touch_start_time = (int64_t)tv_now.tv_sec * 1000000L + (int64_t)tv_now.tv_usec;
-                    is_long_press_detected = false;  // 重置长按标记
-                } else {
-                    // 已在触摸中，检查是否达到长按阈值
-                    if (!is_long_press_detected) {
-                        struct timeval tv_now;
-                        gettimeofday(&tv_now, NULL);
-                        int64_t now_us = (int64_t)tv_now.tv_sec * 1000000L + (int64_t)tv_now.tv_usec;
-                        
-                        if (now_us - touch_start_time >= LONG_PRESS_THRESHOLD) {
-                            // 长按操作示例
-                            auto& app = Application::GetInstance();
-                            // if (app.GetDeviceState() == kDeviceStateStarting || app.GetDeviceState() == kDeviceStateWifiConfiguring) {
-                                SwitchNetworkType();
-                            // }
-                            ESP_LOGI(TAG, "long press detected");
-                            is_long_press_detected=true;
-                        }
-                    }
+    static void IRAM_ATTR TouchIsrHandler(void* arg) {
+        auto self = static_cast<XINGZHI_METAL_1_54*>(arg);
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(self->touch_task_handle_, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+
+    void InitializeTouchGesture() {
+        TouchGestureConfig config;
+        config.tap_min_ms = 300;
+        config.long_press_ms = 4000;
+        config.repeat_delay_ms = 550;
+        config.repeat_interval_ms = 550;
+        touch_gesture_ = new TouchGestureEngine(config);
+
+        // CST816 的三个虚拟按键固定上报在 y=600 的位置
+        touch_gesture_->AddZone(kTouchKeyVolumeUp, 20, 600, 20, 600);
+        touch_gesture_->AddZone(kTouchKeyChat, 40, 600, 40, 600);
+        touch_gesture_->AddZone(kTouchKeyVolumeDown, 60, 600, 60, 600);
+
+        touch_gesture_->OnGesture(kTouchKeyVolumeUp, kTouchGestureRepeat, [this]() {
+            auto codec = GetAudioCodec();
+            auto volume = codec->output_volume() + 10;
+            if (volume > 100) volume = 100;
+            codec->SetOutputVolume(volume);
+            GetDisplay()->ShowNotification(Lang::Strings::VOLUME + std::to_string(volume));
+        });
+        touch_gesture_->OnGesture(kTouchKeyVolumeDown, kTouchGestureRepeat, [this]() {
+            auto codec = GetAudioCodec();
+            auto volume = codec->output_volume() - 10;
+            if (volume < 0) volume = 0;
+            codec->SetOutputVolume(volume);
+            GetDisplay()->ShowNotification(Lang::Strings::VOLUME + std::to_string(volume));
+        });
+        touch_gesture_->OnGesture(kTouchKeyChat, kTouchGestureTap, [this]() {
+            power_save_timer_->WakeUp();
+            auto& app = Application::GetInstance();
+            if (GetNetworkType() == NetworkType::WIFI) {
+                if (app.GetDeviceState() == kDeviceStateStarting && !WifiStation::GetInstance().IsConnected()) {
+                    auto& wifi_board = static_cast<WifiBoard&>(GetCurrentBoard());
+                    wifi_board.ResetWifiConfiguration();
                 }
-                was_touched = true;
-                count = 0;
             }
-            // 触摸释放检测 (0,0)
-            else if ((touchpad->GetTouchPoint().x == 0) && (touchpad->GetTouchPoint().y == 0)) {
-                // 处理40,600位置的释放
-                if (is_touching_40_600) {
-                    struct timeval tv_now;
-                    gettimeofday(&tv_now, NULL);
-                    int64_t now_us = (int64_t)tv_now.tv_sec * 1000000L + (int64_t)tv_now.tv_usec;
-                    int64_t touch_duration = now_us - touch_start_time;
-                    
-                    // 如果未检测到长按且触摸时间短于阈值，则视为单击
-                    if (!is_long_press_detected && touch_duration < LONG_PRESS_THRESHOLD && touch_duration > CLICK_THRESHOLD) {
-                        power_save_timer_->WakeUp();
-                        auto& app = Application::GetInstance();
-                        if (GetNetworkType() == NetworkType::WIFI) {
-                            if (app.GetDeviceState() == kDeviceStateStarting && !WifiStation::GetInstance().IsConnected()) {
-                                auto& wifi_board = static_cast<WifiBoard&>(GetCurrentBoard());
-                                wifi_board.ResetWifiConfiguration();
-                            }
-                        }
-                        app.ToggleChatState();
-                        ESP_LOGI(TAG, "one click");
-                    }
-                    // 重置触摸状态
-                    is_touching_40_600 = false;
-                    is_long_press_detected = false;
-                    ESP_LOGI(TAG, "触摸释放(40,600)");
-                }
-                // 处理其他触摸点的释放
-                if (was_touched) {
-                    was_touched = false;
-                    count = 0;
-                }
+            app.ToggleChatState();
+        });
+        touch_gesture_->OnGesture(kTouchKeyChat, kTouchGestureLongPress, [this]() {
+            ESP_LOGI(TAG, "Long press detected, switching network type");
+            SwitchNetworkType();
+        });
+    }
+
+    // 配置了 INT 引脚时，触摸任务平时阻塞在任务通知上，由 INT 下降沿唤醒，空闲时不读 I2C；
+    // 只有手指按住或手势有待处理的超时时才会定时醒来。没有 INT 引脚时只能按固定间隔轮询
+    void TouchTask() {
+        const bool use_interrupt = TOUCH_INT_GPIO != GPIO_NUM_NC;
+        bool notified = true;
+        while (true) {
+            int64_t now_ms = esp_timer_get_time() / 1000;
+            if (notified || touch_gesture_->IsTouching() || !use_interrupt) {
+                cst816d_->UpdateTouchPoint();
+                auto& tp = cst816d_->GetTouchPoint();
+                touch_gesture_->Feed(now_ms, tp.num > 0, tp.x, tp.y);
+            } else {
+                touch_gesture_->Tick(now_ms);
             }
-            // 其他触摸点处理
-            else {
-                ESP_LOGI(TAG, "Other touch point: %d %d", touchpad->GetTouchPoint().x, touchpad->GetTouchPoint().y);
-                // resetTouchCounters();
-                is_touching_40_600 = false;
-                is_long_press_detected = false;
-                
-                if (was_touched) {
-                    was_touched = false;
-                    count = 0;
+
+            int timeout_ms = touch_gesture_->GetNextTimeoutMs(now_ms);
+            if (touch_gesture_->IsTouching() || !use_interrupt) {
+                // 防止丢失释放事件，按住期间以较低频率补充读取
+                if (timeout_ms < 0 || timeout_ms > kTouchPollIntervalMs) {
+                    timeout_ms = kTouchPollIntervalMs;
                 }
             }
-                vTaskDelay(pdMS_TO_TICKS(50));
+            TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+            notified = ulTaskNotifyTake(pdTRUE, ticks) > 0;
         }
-        vTaskDelete(NULL);
-    }
-
-    // 新增：重置触摸计数器的辅助函数
-    void resetTouchCounters() {
-        touch_40_600_detected = false;
-        single_click_pending = false;
-        if (touch_released) {
-            touch_press_num = 0;
-            touchpress_us = 0;
-        } 
     }
 
     void InitCst816d() {
@@ -366,7 +327,27 @@ private:
         {
             ESP_LOGI(TAG, "Init CST816x");
             cst816d_ = new Cst816x(i2c_bus_, 0x15);
-            xTaskCreate([](void *param) {static_cast<XINGZHI_METAL_1_54*>(param)->touchpad_daemon(param);}, "tp", 4096, this, 1, NULL);
+            InitializeTouchGesture();
+            xTaskCreate([](void *param) {
+                static_cast<XINGZHI_METAL_1_54*>(param)->TouchTask();
+                vTaskDelete(NULL);
+            }, "touch", 4096, this, 1, &touch_task_handle_);
+
+            if (TOUCH_INT_GPIO != GPIO_NUM_NC) {
+                gpio_config_t int_conf = {};
+                int_conf.intr_type = GPIO_INTR_NEGEDGE;
+                int_conf.mode = GPIO_MODE_INPUT;
+                int_conf.pin_bit_mask = (1ULL << TOUCH_INT_GPIO);
+                int_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+                int_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+                ESP_ERROR_CHECK(gpio_config(&int_conf));
+                // ISR 服务可能已被其他驱动安装
+                esp_err_t ret = gpio_install_isr_service(0);
+                if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+                    ESP_ERROR_CHECK(ret);
+                }
+                ESP_ERROR_CHECK(gpio_isr_handler_add(TOUCH_INT_GPIO, TouchIsrHandler, this));
+            }
         }
     }
 
@@ -462,9 +443,10 @@ public:
         // InitializeGpio();      
         InitializePowerManager();
         InitializePowerSaveTimer();
+        InitializePowerGovernor();
         InitializeI2c();
         InitCst816d();//
-        // InitializeSC7A20HSensor();//陀螺仪
+        InitializeSC7A20HSensor();//陀螺仪
         InitializeSpi();
         // InitializeButtons();
         InitializeSt7789Display();
@@ -0,0 +1,205 @@
+#include "boot_sequence.h"
+#include "metrics.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <cinttypes>
+#include <cstring>
+
+#define TAG "BootSequence"
+
+// 每个阶段占用事件组的一位，FreeRTOS 事件组可用 24 位，最高一位用于通知有转交的调用
+#define BOOT_MAX_STAGES 23
+#define BOOT_DISPATCH_EVENT (1 << BOOT_MAX_STAGES)
+
+void BootProfiler::RecordStage(const char* name, int64_t start_us, int64_t end_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_.push_back({ name, start_us, end_us });
+}
+
+void BootProfiler::Mark(const char* name) {
+    int64_t now = esp_timer_get_time();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& milestone : milestones_) {
+            if (strcmp(milestone.name, name) == 0) {
+                return;
+            }
+        }
+        milestones_.push_back({ name, now, now });
+    }
+    // 指标名称需为静态字符串，里程碑数量很少，拼接后的名称一直保留
+    auto metric_name = new std::string(std::string("boot.") + name + "_ms");
+    Metrics::GetInstance().Gauge(metric_name->c_str())->Set(now / 1000);
+    ESP_LOGI(TAG, "Milestone %s at %" PRId64 " ms", name, now / 1000);
+}
+
+int64_t BootProfiler::GetMilestoneUs(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& milestone : milestones_) {
+        if (strcmp(milestone.name, name) == 0) {
+            return milestone.start_us;
+        }
+    }
+    return -1;
+}
+
+void BootProfiler::PrintReport() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ESP_LOGI(TAG, "Boot stages (ms since power on):");
+    for (auto& stage : stages_) {
+        ESP_LOGI(TAG, "  %-16s %6" PRId64 " -> %6" PRId64 " (%" PRId64 " ms)", stage.name,
+            stage.start_us / 1000, stage.end_us / 1000, (stage.end_us - stage.start_us) / 1000);
+    }
+    for (auto& milestone : milestones_) {
+        ESP_LOGI(TAG, "  * %-14s %6" PRId64, milestone.name, milestone.start_us / 1000);
+    }
+}
+
+BootSequence::BootSequence() {
+    event_group_ = xEventGroupCreate();
+}
+
+BootSequence::~BootSequence() {
+    vEventGroupDelete(event_group_);
+}
+
+void BootSequence::AddStage(const char* name, std::initializer_list<const char*> dependencies,
+    std::function<void()> callback, uint32_t stack_size) {
+    if (stages_.size() >= BOOT_MAX_STAGES) {
+        ESP_LOGE(TAG, "Too many boot stages, %s ignored", name);
+        return;
+    }
+    Stage stage = { name, {}, std::move(callback), stack_size };
+    for (auto dependency : dependencies) {
+        for (int i = 0; i < (int)stages_.size(); i++) {
+            if (strcmp(stages_[i].name, dependency) == 0) {
+                stage.dependencies.push_back(i);
+                break;
+            }
+        }
+    }
+    if (stage.dependencies.size() != dependencies.size()) {
+        ESP_LOGE(TAG, "Stage %s depends on an unregistered stage", name);
+    }
+    stages_.push_back(std::move(stage));
+}
+
+void BootSequence::Execute(int index) {
+    auto& stage = stages_[index];
+    int64_t start_us = esp_timer_get_time();
+    stage.callback();
+    BootProfiler::GetInstance().RecordStage(stage.name, start_us, esp_timer_get_time());
+    xEventGroupSetBits(event_group_, 1 << index);
+}
+
+void BootSequence::Dispatch(std::function<void()> callback) {
+    std::unique_lock<std::mutex> lock(dispatch_mutex_);
+    if (!running_ || IsRunTask()) {
+        lock.unlock();
+        callback();
+        return;
+    }
+    Dispatched dispatched = { std::move(callback) };
+    dispatched_.push_back(&dispatched);
+    xEventGroupSetBits(event_group_, BOOT_DISPATCH_EVENT);
+    dispatch_cv_.wait(lock, [&dispatched]() { return dispatched.done; });
+}
+
+void BootSequence::RunDispatched() {
+    xEventGroupClearBits(event_group_, BOOT_DISPATCH_EVENT);
+    std::unique_lock<std::mutex> lock(dispatch_mutex_);
+    while (!dispatched_.empty()) {
+        auto pending = std::move(dispatched_);
+        dispatched_.clear();
+        lock.unlock();
+        for (auto dispatched : pending) {
+            dispatched->callback();
+        }
+        lock.lock();
+        for (auto dispatched : pending) {
+            dispatched->done = true;
+        }
+        dispatch_cv_.notify_all();
+    }
+}
+
+void BootSequence::WaitFor(const char* name) {
+    for (int i = 0; i < (int)stages_.size(); i++) {
+        if (strcmp(stages_[i].name, name) == 0) {
+            xEventGroupWaitBits(event_group_, 1 << i, pdFALSE, pdTRUE, portMAX_DELAY);
+            return;
+        }
+    }
+    ESP_LOGE(TAG, "Wait for unregistered stage %s", name);
+}
+
+void BootSequence::Run() {
+    const EventBits_t all_bits = (1 << stages_.size()) - 1;
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex_);
+        run_task_ = xTaskGetCurrentTaskHandle();
+        running_ = true;
+    }
+    while (true) {
+        RunDispatched();
+        EventBits_t done = xEventGroupGetBits(event_group_);
+        if ((done & all_bits) == all_bits) {
+            break;
+        }
+
+        bool progressed = false;
+        EventBits_t running = 0;
+        for (int i = 0; i < (int)stages_.size(); i++) {
+            auto& stage = stages_[i];
+            if (stage.started) {
+                if ((done & (1 << i)) == 0) {
+                    running |= 1 << i;
+                }
+                continue;
+            }
+            bool ready = true;
+            for (int dependency : stage.dependencies) {
+                ready &= (done & (1 << dependency)) != 0;
+            }
+            if (!ready) {
+                continue;
+            }
+
+            stage.started = true;
+            progressed = true;
+            if (stage.stack_size == 0) {
+                Execute(i);
+                break;
+            }
+            struct Context {
+                BootSequence* sequence;
+                int index;
+            };
+            auto context = new Context{ this, i };
+            xTaskCreate([](void* arg) {
+                auto context = (Context*)arg;
+                context->sequence->Execute(context->index);
+                delete context;
+                vTaskDelete(NULL);
+            }, stage.name, stage.stack_size, context, uxTaskPriorityGet(NULL), NULL);
+            running |= 1 << i;
+        }
+
+        // 没有新阶段可以启动时，等待任一运行中的阶段完成或有转交的调用
+        if (!progressed && running != 0) {
+            xEventGroupWaitBits(event_group_, running | BOOT_DISPATCH_EVENT, pdFALSE, pdFALSE, portMAX_DELAY);
+        } else if (!progressed) {
+            ESP_LOGE(TAG, "Boot stages have unsatisfiable dependencies");
+            break;
+        }
+    }
+
+    // 之后的 Dispatch 直接执行，处理完已经排队的调用再返回
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex_);
+        running_ = false;
+    }
+    RunDispatched();
+}
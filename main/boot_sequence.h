@@ -0,0 +1,99 @@
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * 启动耗时统计：记录各启动阶段的开始、结束时间和若干里程碑（如唤醒词就绪、首次对话），
+ * 时间均为开机以来的毫秒数。里程碑只记录第一次，同时写入 boot.<name>_ms 指标。
+ */
+class BootProfiler {
+public:
+    static BootProfiler& GetInstance() {
+        static BootProfiler instance;
+        return instance;
+    }
+    BootProfiler(const BootProfiler&) = delete;
+    BootProfiler& operator=(const BootProfiler&) = delete;
+
+    void RecordStage(const char* name, int64_t start_us, int64_t end_us);
+    // name 需为静态字符串
+    void Mark(const char* name);
+    // 返回里程碑的时间（开机以来的微秒数），尚未到达时返回 -1
+    int64_t GetMilestoneUs(const char* name);
+    void PrintReport();
+
+private:
+    friend class BootProfilerTest;
+
+    BootProfiler() = default;
+
+    struct Span {
+        const char* name;
+        int64_t start_us;
+        int64_t end_us;
+    };
+
+    std::mutex mutex_;
+    std::vector<Span> stages_;
+    std::vector<Span> milestones_;
+};
+
+/*
+ * 按依赖关系并行执行的启动阶段。
+ * 依赖全部完成的阶段立即启动：stack_size 为 0 的阶段在调用 Run 的任务中执行，其余各自创建任务执行。
+ * 依赖的阶段必须先注册，Run 在所有阶段完成后返回。
+ * 启动期间调用 Run 的任务相当于主任务：并行阶段需要修改设备状态时用 Dispatch 转交给它串行执行。
+ */
+class BootSequence {
+public:
+    BootSequence();
+    ~BootSequence();
+
+    void AddStage(const char* name, std::initializer_list<const char*> dependencies,
+        std::function<void()> callback, uint32_t stack_size = 0);
+    void Run();
+    // 在调用 Run 的任务中执行 callback 并等待其完成；在该任务中调用或 Run 已返回时直接执行。
+    // 正在执行 stack_size 为 0 的阶段时，要等它结束才会处理
+    void Dispatch(std::function<void()> callback);
+    // 等待指定阶段完成，只能在其他阶段或 Run 之外的任务中调用
+    void WaitFor(const char* name);
+    bool IsRunTask() const { return xTaskGetCurrentTaskHandle() == run_task_; }
+
+private:
+    struct Stage {
+        const char* name;
+        std::vector<int> dependencies;
+        std::function<void()> callback;
+        uint32_t stack_size;
+        bool started = false;
+    };
+
+    struct Dispatched {
+        std::function<void()> callback;
+        bool done = false;
+    };
+
+    EventGroupHandle_t event_group_ = nullptr;
+    std::vector<Stage> stages_;
+    TaskHandle_t run_task_ = nullptr;
+    std::mutex dispatch_mutex_;
+    std::condition_variable dispatch_cv_;
+    std::vector<Dispatched*> dispatched_;
+    bool running_ = false;
+
+    void Execute(int index);
+    void RunDispatched();
+};
+
+#endif // BOOT_SEQUENCE_H
@@ -0,0 +1,18 @@
+#ifndef _DEVICE_STATE_H_
+#define _DEVICE_STATE_H_
+
+enum DeviceState {
+    kDeviceStateUnknown,
+    kDeviceStateStarting,
+    kDeviceStateWifiConfiguring,
+    kDeviceStateIdle,
+    kDeviceStateConnecting,
+    kDeviceStateListening,
+    kDeviceStateSpeaking,
+    kDeviceStateUpgrading,
+    kDeviceStateActivating,
+    kDeviceStateAudioTesting,
+    kDeviceStateFatalError
+};
+
+#endif // _DEVICE_STATE_H_
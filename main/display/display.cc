@@ -267,6 +267,17 @@ void Display::SetPreviewImage(const lv_img_dsc_t* image) {
 //     lv_label_set_text(chat_message_label_, content);
 // }
 
+void Display::SetRefreshPeriod(int period_ms) {
+    if (display_ == nullptr) {
+        return;
+    }
+    DisplayLockGuard lock(this);
+    lv_timer_t* refresh_timer = lv_display_get_refr_timer(display_);
+    if (refresh_timer != nullptr) {
+        lv_timer_set_period(refresh_timer, period_ms);
+    }
+}
+
 void Display::SetTheme(const std::string& theme_name) {
     current_theme_name_ = theme_name;
     Settings settings("display", true);
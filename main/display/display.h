@@ -30,6 +30,7 @@ public:
     virtual void SetTheme(const std::string& theme_name);
     virtual std::string GetTheme() { return current_theme_name_; }
     virtual void UpdateStatusBar(bool update_all = false);
+    virtual void SetRefreshPeriod(int period_ms);
 
     inline int width() const { return width_; }
     inline int height() const { return height_; }
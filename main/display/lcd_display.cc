@@ -12,6 +12,7 @@
 #include "settings.h"
 
 #include "board.h"
+#include "trace.h"
 
 #define TAG "LcdDisplay"
 LV_FONT_DECLARE(font_puhui_16_4);
@@ -420,6 +421,7 @@ void LcdDisplay::SetupUI() {
 #define  MAX_MESSAGES 20
 #endif
 void LcdDisplay::SetChatMessage(const char* role, const char* content) {
+    TRACE_SCOPE("display.chat_message");
     DisplayLockGuard lock(this);
     if (content_ == nullptr) {
         return;
@@ -890,6 +892,7 @@ void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
 #endif
 #if 0
 void LcdDisplay::SetEmotion(const char* emotion) {
+    TRACE_SCOPE("display.emotion");
     struct Emotion {
         const char* icon;
         const char* text;
@@ -947,6 +950,7 @@ void LcdDisplay::SetEmotion(const char* emotion) {
 }
 #else
 void LcdDisplay::SetEmotion(const char* emotion) {
+    TRACE_SCOPE("display.emotion");
     struct Emotion {
         const char* icon;
         const char* text;
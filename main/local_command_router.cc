@@ -0,0 +1,76 @@
+#include "local_command_router.h"
+
+#include <algorithm>
+
+#define LOCAL_COMMAND_VOLUME_STEP 10
+#define LOCAL_COMMAND_BRIGHTNESS_STEP 20
+// 本地调暗不熄屏，需要关闭屏幕时交给云端
+#define LOCAL_COMMAND_MIN_BRIGHTNESS 10
+
+struct LocalCommandPhrases {
+    LocalCommand command;
+    const char* cn;
+    const char* en;
+};
+
+// MultiNet 中文模型使用空格分隔的拼音，英文模型使用小写英文
+static const LocalCommandPhrases kPhrases[] = {
+    { kLocalCommandVolumeUp, "yin liang tiao da", "volume up" },
+    { kLocalCommandVolumeUp, "da sheng yi dian", "turn it up" },
+    { kLocalCommandVolumeUp, "da sheng dian", "louder" },
+    { kLocalCommandVolumeDown, "yin liang tiao xiao", "volume down" },
+    { kLocalCommandVolumeDown, "xiao sheng yi dian", "turn it down" },
+    { kLocalCommandVolumeDown, "xiao sheng dian", "quieter" },
+    { kLocalCommandBrighter, "liang yi dian", "brighter" },
+    { kLocalCommandBrighter, "ping mu tiao liang", "brightness up" },
+    { kLocalCommandDimmer, "an yi dian", "dimmer" },
+    { kLocalCommandDimmer, "ping mu tiao an", "brightness down" },
+    { kLocalCommandStop, "ting zhi", "stop" },
+    { kLocalCommandStop, "an jing", "be quiet" },
+    { kLocalCommandStop, "bie shuo le", "never mind" },
+};
+
+std::vector<std::pair<int, std::string>> LocalCommandRouter::GetPhrases(const std::string& language) {
+    std::vector<std::pair<int, std::string>> phrases;
+    for (auto& phrase : kPhrases) {
+        phrases.emplace_back(phrase.command, language == "cn" ? phrase.cn : phrase.en);
+    }
+    return phrases;
+}
+
+bool LocalCommandRouter::Route(int command, const LocalCommandState& state, LocalCommandAction& action) {
+    action = LocalCommandAction();
+    switch (command) {
+    case kLocalCommandVolumeUp:
+    case kLocalCommandVolumeDown: {
+        int step = command == kLocalCommandVolumeUp ? LOCAL_COMMAND_VOLUME_STEP : -LOCAL_COMMAND_VOLUME_STEP;
+        action.tool = "self.audio_speaker.set_volume";
+        action.argument = "volume";
+        action.value = std::clamp(state.volume + step, 0, 100);
+        return true;
+    }
+    case kLocalCommandBrighter:
+    case kLocalCommandDimmer: {
+        if (state.brightness < 0) {
+            return false;
+        }
+        int step = command == kLocalCommandBrighter ? LOCAL_COMMAND_BRIGHTNESS_STEP : -LOCAL_COMMAND_BRIGHTNESS_STEP;
+        action.tool = "self.screen.set_brightness";
+        action.argument = "brightness";
+        action.value = std::clamp(state.brightness + step, std::min(state.brightness, LOCAL_COMMAND_MIN_BRIGHTNESS), 100);
+        return true;
+    }
+    case kLocalCommandStop:
+        action.stop = true;
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::string LocalCommandRouter::GetArgumentsJson(const LocalCommandAction& action) {
+    if (action.argument.empty()) {
+        return "{}";
+    }
+    return "{\"" + action.argument + "\":" + std::to_string(action.value) + "}";
+}
@@ -0,0 +1,46 @@
+#ifndef LOCAL_COMMAND_ROUTER_H
+#define LOCAL_COMMAND_ROUTER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// 本地命令词编号，与识别模型中注册的命令一一对应
+enum LocalCommand {
+    kLocalCommandVolumeUp,
+    kLocalCommandVolumeDown,
+    kLocalCommandBrighter,
+    kLocalCommandDimmer,
+    kLocalCommandStop,
+    kLocalCommandCount
+};
+
+struct LocalCommandState {
+    int volume = 0;
+    // 没有背光时为 -1
+    int brightness = -1;
+};
+
+struct LocalCommandAction {
+    // 只结束本次唤醒，不调用工具
+    bool stop = false;
+    std::string tool;
+    std::string argument;
+    int value = 0;
+};
+
+/*
+ * 把本地识别到的命令词映射为设备上的 MCP 工具调用，不依赖 ESP-IDF，可以在主机上测试。
+ * 相对调节（调大、亮一点）按当前状态算出目标值，与云端 LLM 调用的是同一个工具。
+ */
+class LocalCommandRouter {
+public:
+    // 模型语言为 "cn" 时返回拼音命令词，否则返回英文命令词；同一命令可以有多种说法
+    static std::vector<std::pair<int, std::string>> GetPhrases(const std::string& language);
+    // 返回 false 表示本地无法处理，交给云端
+    static bool Route(int command, const LocalCommandState& state, LocalCommandAction& action);
+    // 工具参数，如 {"volume":70}
+    static std::string GetArgumentsJson(const LocalCommandAction& action);
+};
+
+#endif // LOCAL_COMMAND_ROUTER_H
@@ -13,6 +13,8 @@
 #include "application.h"
 #include "display.h"
 #include "board.h"
+#include "metrics.h"
+#include "trace.h"
 
 #define TAG "MCP"
 
@@ -45,6 +47,24 @@ void McpServer::AddCommonTools() {
             return board.GetDeviceStatusJson();
         });
 
+    AddTool("self.get_metrics",
+        "Provides the runtime metrics of the device: counters, gauges and latency histograms "
+        "(audio queue drops, encode/decode time, reconnects, free memory, etc.).\n"
+        "Use this tool only when the user asks about the device performance or diagnostics.",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            return Metrics::GetInstance().GetSnapshotJson();
+        });
+
+#if CONFIG_USE_TRACE
+    AddTool("self.debug.dump_trace",
+        "Dump the recorded performance trace of the device to the debug server. For developers only.",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            return Trace::Dump();
+        });
+#endif
+
     AddTool("self.audio_speaker.set_volume", 
         "Set the volume of the audio speaker. If the current volume is unknown, you must call `self.get_device_status` tool first and then call this tool.",
         PropertyList({
@@ -305,19 +325,16 @@ void McpServer::GetToolsList(int id, const std::string& cursor) {
     ReplyResult(id, json);
 }
 
-void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size) {
+McpTool* McpServer::FindTool(const std::string& name) {
     auto tool_iter = std::find_if(tools_.begin(), tools_.end(), 
-                                 [&tool_name](const McpTool* tool) { 
-                                     return tool->name() == tool_name; 
+                                 [&name](const McpTool* tool) { 
+                                     return tool->name() == name; 
                                  });
-    
-    if (tool_iter == tools_.end()) {
-        ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
-        ReplyError(id, "Unknown tool: " + tool_name);
-        return;
-    }
+    return tool_iter == tools_.end() ? nullptr : *tool_iter;
+}
 
-    PropertyList arguments = (*tool_iter)->properties();
+bool McpServer::ParseToolArguments(const McpTool* tool, const cJSON* tool_arguments, PropertyList& arguments, std::string& error) {
+    arguments = tool->properties();
     try {
         for (auto& argument : arguments) {
             bool found = false;
@@ -336,14 +353,51 @@ void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* to
             }
 
             if (!argument.has_default_value() && !found) {
-                ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
-                ReplyError(id, "Missing valid argument: " + argument.name());
-                return;
+                error = "Missing valid argument: " + argument.name();
+                return false;
             }
         }
     } catch (const std::exception& e) {
-        ESP_LOGE(TAG, "tools/call: %s", e.what());
-        ReplyError(id, e.what());
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+bool McpServer::CallTool(const std::string& name, const cJSON* arguments, std::string& result) {
+    auto tool = FindTool(name);
+    if (tool == nullptr) {
+        ESP_LOGW(TAG, "Local call: Unknown tool: %s", name.c_str());
+        return false;
+    }
+    PropertyList properties;
+    std::string error;
+    if (!ParseToolArguments(tool, arguments, properties, error)) {
+        ESP_LOGE(TAG, "Local call %s: %s", name.c_str(), error.c_str());
+        return false;
+    }
+    try {
+        result = tool->Call(properties);
+    } catch (const std::exception& e) {
+        ESP_LOGE(TAG, "Local call %s: %s", name.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size) {
+    auto tool = FindTool(tool_name);
+    if (tool == nullptr) {
+        ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
+        ReplyError(id, "Unknown tool: " + tool_name);
+        return;
+    }
+
+    PropertyList arguments;
+    std::string error;
+    if (!ParseToolArguments(tool, tool_arguments, arguments, error)) {
+        ESP_LOGE(TAG, "tools/call: %s", error.c_str());
+        ReplyError(id, error);
         return;
     }
 
@@ -355,9 +409,9 @@ void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* to
     esp_pthread_set_cfg(&cfg);
 
     // Use a thread to call the tool to avoid blocking the main thread
-    tool_call_thread_ = std::thread([this, id, tool_iter, arguments = std::move(arguments)]() {
+    tool_call_thread_ = std::thread([this, id, tool, arguments = std::move(arguments)]() {
         try {
-            ReplyResult(id, (*tool_iter)->Call(arguments));
+            ReplyResult(id, tool->Call(arguments));
         } catch (const std::exception& e) {
             ESP_LOGE(TAG, "tools/call: %s", e.what());
             ReplyError(id, e.what());
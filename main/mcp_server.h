@@ -261,6 +261,8 @@ public:
     void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
     void ParseMessage(const cJSON* json);
     void ParseMessage(const std::string& message);
+    // 设备端直接调用工具（如本地命令词），在调用者的任务中同步执行
+    bool CallTool(const std::string& name, const cJSON* arguments, std::string& result);
 
 private:
     McpServer();
@@ -273,6 +275,8 @@ private:
 
     void GetToolsList(int id, const std::string& cursor);
     void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size);
+    McpTool* FindTool(const std::string& name);
+    bool ParseToolArguments(const McpTool* tool, const cJSON* tool_arguments, PropertyList& arguments, std::string& error);
 
     std::vector<McpTool*> tools_;
     std::thread tool_call_thread_;
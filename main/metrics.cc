@@ -0,0 +1,124 @@
+#include "metrics.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cJSON.h>
+#include <cstring>
+
+#define TAG "Metrics"
+
+void MetricHistogram::Record(int32_t value) {
+    int bucket = 0;
+    while (bucket < bucket_count_ && value > bounds_[bucket]) {
+        bucket++;
+    }
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+
+    int32_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+template <typename T, size_t N, typename Init>
+T* Metrics::Register(Entry<T> (&entries)[N], std::atomic<int>& count, const char* name, T* overflow, Init init) {
+    // 读取方只看 count 之前的条目，新条目初始化完成后才发布 count
+    int n = count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i].metric;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    n = count.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i].metric;
+        }
+    }
+    if (n >= static_cast<int>(N)) {
+        ESP_LOGW(TAG, "Too many metrics, %s is not exported", name);
+        return overflow;
+    }
+    entries[n].name = name;
+    init(entries[n].metric);
+    count.store(n + 1, std::memory_order_release);
+    return &entries[n].metric;
+}
+
+MetricCounter* Metrics::Counter(const char* name) {
+    return Register(counters_, counter_count_, name, &overflow_counter_, [](MetricCounter&) {});
+}
+
+MetricGauge* Metrics::Gauge(const char* name) {
+    return Register(gauges_, gauge_count_, name, &overflow_gauge_, [](MetricGauge&) {});
+}
+
+MetricHistogram* Metrics::Histogram(const char* name, std::initializer_list<int32_t> bounds) {
+    return Register(histograms_, histogram_count_, name, &overflow_histogram_, [&bounds](MetricHistogram& histogram) {
+        for (auto bound : bounds) {
+            if (histogram.bucket_count_ >= METRICS_HISTOGRAM_MAX_BUCKETS) {
+                break;
+            }
+            histogram.bounds_[histogram.bucket_count_++] = bound;
+        }
+    });
+}
+
+std::string Metrics::GetSnapshotJson() {
+    /*
+     * {
+     *   "uptime": 123,
+     *   "counters": { "audio.send_dropped": 2 },
+     *   "gauges": { "heap.free_sram": 81234 },
+     *   "histograms": {
+     *     "opus.decode_us": { "le": [1000, 2000], "counts": [10, 3, 0], "sum": 15000, "max": 2100 }
+     *   }
+     * }
+     */
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "uptime", esp_timer_get_time() / 1000000);
+
+    cJSON* counters = cJSON_CreateObject();
+    int n = counter_count_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        cJSON_AddNumberToObject(counters, counters_[i].name, counters_[i].metric.value());
+    }
+    cJSON_AddItemToObject(root, "counters", counters);
+
+    cJSON* gauges = cJSON_CreateObject();
+    n = gauge_count_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        cJSON_AddNumberToObject(gauges, gauges_[i].name, gauges_[i].metric.value());
+    }
+    cJSON_AddItemToObject(root, "gauges", gauges);
+
+    cJSON* histograms = cJSON_CreateObject();
+    n = histogram_count_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        auto& histogram = histograms_[i].metric;
+        cJSON* item = cJSON_CreateObject();
+        cJSON* le = cJSON_CreateArray();
+        cJSON* counts = cJSON_CreateArray();
+        for (int j = 0; j < histogram.bucket_count_; j++) {
+            cJSON_AddItemToArray(le, cJSON_CreateNumber(histogram.bounds_[j]));
+        }
+        for (int j = 0; j <= histogram.bucket_count_; j++) {
+            cJSON_AddItemToArray(counts, cJSON_CreateNumber(histogram.counts_[j].load(std::memory_order_relaxed)));
+        }
+        cJSON_AddItemToObject(item, "le", le);
+        cJSON_AddItemToObject(item, "counts", counts);
+        // double 可精确表示 2^53 以内的整数
+        cJSON_AddNumberToObject(item, "sum", static_cast<double>(histogram.sum_.load(std::memory_order_relaxed)));
+        cJSON_AddNumberToObject(item, "max", histogram.max_.load(std::memory_order_relaxed));
+        cJSON_AddItemToObject(histograms, histograms_[i].name, item);
+    }
+    cJSON_AddItemToObject(root, "histograms", histograms);
+
+    auto json_str = cJSON_PrintUnformatted(root);
+    std::string json(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return json;
+}
@@ -0,0 +1,98 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+
+#define METRICS_MAX_COUNTERS 32
+#define METRICS_MAX_GAUGES 16
+#define METRICS_MAX_HISTOGRAMS 8
+#define METRICS_HISTOGRAM_MAX_BUCKETS 8
+
+/*
+ * 热路径只做一次 relaxed 原子操作，不加锁。
+ * 各指标在首次使用时注册，建议缓存返回的指针：
+ *   static auto dropped = Metrics::GetInstance().Counter("audio.send_dropped");
+ *   dropped->Increment();
+ */
+class MetricCounter {
+public:
+    void Increment(uint32_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value_{0};
+};
+
+class MetricGauge {
+public:
+    void Set(int32_t value) { value_.store(value, std::memory_order_relaxed); }
+    void Add(int32_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int32_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> value_{0};
+};
+
+// 固定桶直方图，桶上界在注册时给定，最后一个桶收集超出上界的样本。
+// sum_ 用 64 位累加，微秒级耗时按每秒几十个样本计算，32 位约一小时就会回绕；
+// 32 位芯片上 64 位原子操作由 IDF 的 atomic 库以很短的临界区实现
+class MetricHistogram {
+public:
+    void Record(int32_t value);
+
+private:
+    friend class Metrics;
+
+    int32_t bounds_[METRICS_HISTOGRAM_MAX_BUCKETS];
+    int bucket_count_ = 0;
+    std::atomic<uint32_t> counts_[METRICS_HISTOGRAM_MAX_BUCKETS + 1] = {};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<int32_t> max_{0};
+};
+
+class Metrics {
+public:
+    static Metrics& GetInstance() {
+        static Metrics instance;
+        return instance;
+    }
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // 名称需为静态字符串；超出容量时返回一个不导出的占位指标，调用方无需判空
+    MetricCounter* Counter(const char* name);
+    MetricGauge* Gauge(const char* name);
+    MetricHistogram* Histogram(const char* name, std::initializer_list<int32_t> bounds);
+
+    std::string GetSnapshotJson();
+
+private:
+    Metrics() = default;
+
+    template <typename T>
+    struct Entry {
+        const char* name;
+        T metric;
+    };
+
+    std::mutex register_mutex_;
+    Entry<MetricCounter> counters_[METRICS_MAX_COUNTERS];
+    Entry<MetricGauge> gauges_[METRICS_MAX_GAUGES];
+    Entry<MetricHistogram> histograms_[METRICS_MAX_HISTOGRAMS];
+    std::atomic<int> counter_count_{0};
+    std::atomic<int> gauge_count_{0};
+    std::atomic<int> histogram_count_{0};
+
+    MetricCounter overflow_counter_;
+    MetricGauge overflow_gauge_;
+    MetricHistogram overflow_histogram_;
+
+    template <typename T, size_t N, typename Init>
+    T* Register(Entry<T> (&entries)[N], std::atomic<int>& count, const char* name, T* overflow, Init init);
+};
+
+#endif // METRICS_H
@@ -5,24 +5,32 @@
 
 #include <cJSON.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <esp_partition.h>
 #include <esp_ota_ops.h>
 #include <esp_app_format.h>
 #include <esp_efuse.h>
 #include <esp_efuse_table.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #ifdef SOC_HMAC_SUPPORTED
 #include <esp_hmac.h>
 #endif
 
+#include <sys/time.h>
 #include <cstring>
+#include <memory>
 #include <vector>
 #include <sstream>
 #include <algorithm>
 
 #define TAG "Ota"
 
+#define OTA_CACHE_MAX_ETAG_LENGTH   256
 
 Ota::Ota() {
+    current_version_ = esp_app_get_description()->version;
+
 #ifdef ESP_EFUSE_BLOCK_USR_DATA
     // Read Serial Number from efuse user_data
     uint8_t serial_number[33] = {0};
@@ -72,10 +80,8 @@ Http* Ota::SetupHttp() {
  */
 bool Ota::CheckVersion() {
     auto& board = Board::GetInstance();
-    auto app_desc = esp_app_get_description();
 
     // Check if there is a new firmware version available
-    current_version_ = app_desc->version;
     ESP_LOGI(TAG, "Current version: %s", current_version_.c_str());
 
     std::string url = GetCheckVersionUrl();
@@ -85,6 +91,10 @@ bool Ota::CheckVersion() {
     }
 
     auto http = std::unique_ptr<Http>(SetupHttp());
+    LoadCache(url);
+    if (!cached_etag_.empty()) {
+        http->SetHeader("If-None-Match", cached_etag_);
+    }
 
     std::string data = board.GetJson();
     std::string method = data.length() > 0 ? "POST" : "GET";
@@ -96,14 +106,129 @@ bool Ota::CheckVersion() {
     }
 
     auto status_code = http->GetStatusCode();
+    // 带 If-None-Match 的 POST 在 ETag 匹配时，按 RFC 9110 应答 412 而不是 304，两者都表示配置没有变化
+    if (status_code == 304 || (status_code == 412 && !cached_etag_.empty())) {
+        http->Close();
+        ESP_LOGI(TAG, "Config not modified, using cached config");
+        ApplyCachedConfig();
+        return true;
+    }
     if (status_code != 200) {
         ESP_LOGE(TAG, "Failed to check version, status code: %d", status_code);
         return false;
     }
 
+    std::string etag = http->GetResponseHeader("ETag");
     data = http->ReadAll();
     http->Close();
 
+    if (!ParseResponse(data)) {
+        return false;
+    }
+
+    // 有新版本或需要激活时下次启动必须等待检查结果，不保留缓存
+    if (has_new_version_ || has_activation_code_ || has_activation_challenge_) {
+        ClearCache();
+    } else {
+        SaveCache(url, etag);
+    }
+    return true;
+}
+
+bool Ota::LoadCachedConfig() {
+    LoadCache(GetCheckVersionUrl());
+    if (cached_digest_.empty()) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Using cached config, etag: %s", cached_etag_.c_str());
+    ApplyCachedConfig();
+    return true;
+}
+
+void Ota::ApplyCachedConfig() {
+    // 缓存只在没有新版本、不需要激活时写入，协议参数在上次解析时已写入 NVS
+    has_new_version_ = false;
+    has_activation_code_ = false;
+    has_activation_challenge_ = false;
+    has_server_time_ = false;
+    has_mqtt_config_ = (cached_protocols_ & kCachedMqtt) != 0;
+    has_websocket_config_ = (cached_protocols_ & kCachedWebsocket) != 0;
+    config_digest_ = cached_digest_;
+}
+
+void Ota::LoadCache(const std::string& url) {
+    Settings settings("ota_cache", false);
+    // 固件升级或更换检查地址后缓存失效
+    if (settings.GetString("version") != current_version_ || settings.GetString("url") != url) {
+        cached_etag_.clear();
+        cached_digest_.clear();
+        cached_protocols_ = 0;
+        return;
+    }
+    cached_etag_ = settings.GetString("etag");
+    cached_digest_ = settings.GetString("digest");
+    cached_protocols_ = settings.GetInt("protocols");
+}
+
+int Ota::GetProtocols() const {
+    return (has_mqtt_config_ ? kCachedMqtt : 0) | (has_websocket_config_ ? kCachedWebsocket : 0);
+}
+
+bool Ota::RequiresRestart() const {
+    if (has_new_version_ || has_activation_code_ || has_activation_challenge_) {
+        return true;
+    }
+    // 没有缓存时协议按本次检查结果创建，无从比较
+    return !cached_digest_.empty() && GetProtocols() != cached_protocols_;
+}
+
+void Ota::SaveCache(const std::string& url, const std::string& etag) {
+    int protocols = GetProtocols();
+    // 内容没有变化时不重复写 flash
+    if (config_digest_ == cached_digest_ && etag == cached_etag_ && protocols == cached_protocols_) {
+        return;
+    }
+    Settings settings("ota_cache", true);
+    settings.SetString("version", current_version_);
+    settings.SetString("url", url);
+    settings.SetString("etag", etag.length() < OTA_CACHE_MAX_ETAG_LENGTH ? etag : "");
+    settings.SetString("digest", config_digest_);
+    settings.SetInt("protocols", protocols);
+}
+
+void Ota::ClearCache() {
+    if (cached_digest_.empty()) {
+        return;
+    }
+    Settings settings("ota_cache", true);
+    settings.EraseAll();
+}
+
+// 对固件、激活和协议配置计算 FNV-1a 摘要，server_time 每次都变，不参与计算
+static std::string GetConfigDigest(cJSON* root) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (auto name : { "firmware", "activation", "mqtt", "websocket" }) {
+        cJSON* section = cJSON_GetObjectItem(root, name);
+        if (section == nullptr) {
+            continue;
+        }
+        char* json = cJSON_PrintUnformatted(section);
+        if (json == nullptr) {
+            continue;
+        }
+        std::string text = std::string(name) + ":" + json;
+        cJSON_free(json);
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+    return buffer;
+}
+
+bool Ota::ParseResponse(const std::string& data) {
     // Response: { "firmware": { "version": "1.0.0", "url": "http://" } }
     // Parse the JSON response and check if the version is newer
     // If it is, set has_new_version_ to true and store the new version and URL
@@ -235,6 +360,7 @@ bool Ota::CheckVersion() {
         ESP_LOGW(TAG, "No firmware section found!");
     }
 
+    config_digest_ = GetConfigDigest(root);
     cJSON_Delete(root);
     return true;
 }
@@ -13,6 +13,13 @@ public:
     ~Ota();
 
     bool CheckVersion();
+    // 上次检查结果对当前固件和检查地址仍然有效时，直接按缓存的协议配置返回 true
+    bool LoadCachedConfig();
+    // 本次检查得到的固件、激活和协议配置是否与缓存不同
+    bool HasConfigChanged() const { return config_digest_ != cached_digest_; }
+    // 按缓存启动后的重新检查是否需要重启：有新固件、需要激活，或协议从 MQTT 与 WebSocket 之间切换。
+    // 令牌、地址等协议参数已写入 NVS，打开音频通道时重新读取，不需要重启
+    bool RequiresRestart() const;
     esp_err_t Activate();
     bool HasActivationChallenge() { return has_activation_challenge_; }
     bool HasNewVersion() { return has_new_version_; }
@@ -46,12 +53,28 @@ private:
     std::string serial_number_;
     int activation_timeout_ms_ = 30000;
 
+    enum : int {
+        kCachedMqtt = 1,
+        kCachedWebsocket = 2,
+    };
+    // 检查结果缓存，保存在 NVS 的 ota_cache 命名空间
+    std::string cached_etag_;
+    std::string cached_digest_;
+    int cached_protocols_ = 0;
+    std::string config_digest_;
+
     void Upgrade(const std::string& firmware_url);
     std::function<void(int progress, size_t speed)> upgrade_callback_;
     std::vector<int> ParseVersion(const std::string& version);
     bool IsNewVersionAvailable(const std::string& currentVersion, const std::string& newVersion);
     std::string GetActivationPayload();
     Http* SetupHttp();
+    void LoadCache(const std::string& url);
+    void SaveCache(const std::string& url, const std::string& etag);
+    void ClearCache();
+    int GetProtocols() const;
+    void ApplyCachedConfig();
+    bool ParseResponse(const std::string& data);
 };
 
 #endif // _OTA_H
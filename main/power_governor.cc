@@ -0,0 +1,212 @@
+#include "power_governor.h"
+#include "board.h"
+#include "display.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cJSON.h>
+
+#define TAG "PowerGovernor"
+
+static const char* const STATE_NAMES[] = {
+    "unknown",
+    "starting",
+    "configuring",
+    "idle",
+    "connecting",
+    "listening",
+    "speaking",
+    "upgrading",
+    "activating",
+    "audio_testing",
+    "fatal_error",
+};
+
+PowerGovernor::PowerGovernor() : max_freq_mhz_(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ) {
+    profiles_[kPowerProfilePerformance] = { max_freq_mhz_, false, false, 33, 120 };
+    profiles_[kPowerProfileActive] = { max_freq_mhz_, false, false, 33, 180 };
+    profiles_[kPowerProfileIdle] = { 80, false, true, 100, 60 };
+    profiles_[kPowerProfileScreenOff] = { 40, true, true, 1000, 25 };
+
+    esp_err_t ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "power_governor", &cpu_lock_);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGI(TAG, "Power management not supported");
+        cpu_lock_ = nullptr;
+    } else {
+        ESP_ERROR_CHECK(ret);
+    }
+}
+
+PowerGovernor::~PowerGovernor() {
+    if (cpu_lock_ != nullptr) {
+        esp_pm_lock_delete(cpu_lock_);
+    }
+}
+
+void PowerGovernor::Start(DeviceState state) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_ = state;
+        last_update_us_ = esp_timer_get_time();
+        started_ = true;
+    }
+    Apply(state);
+}
+
+void PowerGovernor::SetDeviceState(DeviceState state) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_) {
+            return;
+        }
+    }
+    Apply(state);
+}
+
+void PowerGovernor::EnableFrequencyScaling(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frequency_scaling_ = enabled;
+}
+
+void PowerGovernor::SetProfile(PowerProfileType type, const PowerProfile& profile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    profiles_[type] = profile;
+}
+
+void PowerGovernor::SetScreenOn(bool screen_on) {
+    DeviceState state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (screen_on_ == screen_on) {
+            return;
+        }
+        screen_on_ = screen_on;
+        if (!started_) {
+            return;
+        }
+        state = state_;
+    }
+    Apply(state);
+}
+
+PowerProfileType PowerGovernor::GetProfileType(DeviceState state) const {
+    switch (state) {
+        case kDeviceStateConnecting:
+        case kDeviceStateListening:
+        case kDeviceStateSpeaking:
+            return kPowerProfileActive;
+        case kDeviceStateIdle:
+            return screen_on_ ? kPowerProfileIdle : kPowerProfileScreenOff;
+        default:
+            return kPowerProfilePerformance;
+    }
+}
+
+void PowerGovernor::Account(int64_t now_us) {
+    int64_t elapsed_us = now_us - last_update_us_;
+    last_update_us_ = now_us;
+    auto& energy = energy_[state_];
+    energy.duration_us += elapsed_us;
+    energy.charge_mas += profiles_[profile_type_].estimated_current_ma * (elapsed_us / 1000000.0);
+}
+
+void PowerGovernor::Apply(DeviceState state) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Account(esp_timer_get_time());
+        state_ = state;
+        profile_type_ = GetProfileType(state);
+        apply_pending_ = true;
+        if (applying_) {
+            // 正在下发的线程（也可能是本线程外层的调用）会在下一轮取到这个档位
+            return;
+        }
+        applying_ = true;
+    }
+
+    while (true) {
+        PowerProfile profile;
+        bool modem_sleep_changed;
+        bool frequency_scaling;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!apply_pending_) {
+                applying_ = false;
+                return;
+            }
+            apply_pending_ = false;
+            state = state_;
+            profile = profiles_[profile_type_];
+            // 启动阶段网络尚未初始化，只在档位的模组省电设置变化时才下发
+            modem_sleep_changed = modem_sleep_ != profile.modem_sleep;
+            modem_sleep_ = profile.modem_sleep;
+            frequency_scaling = frequency_scaling_;
+        }
+        // 下发过程可能回调到板级代码（例如唤醒 PowerSaveTimer 后又调用 SetScreenOn），不能持锁
+        ApplyProfile(state, profile, modem_sleep_changed, frequency_scaling);
+    }
+}
+
+void PowerGovernor::ApplyProfile(DeviceState state, const PowerProfile& profile, bool modem_sleep_changed, bool frequency_scaling) {
+    auto& board = Board::GetInstance();
+    if (modem_sleep_changed) {
+        board.SetPowerSaveMode(profile.modem_sleep);
+    }
+    board.GetDisplay()->SetRefreshPeriod(profile.lvgl_refresh_ms);
+
+    if (frequency_scaling) {
+        // 先持锁再改配置，切到高性能档时不会经过一段低频窗口
+        bool need_lock = profile.min_freq_mhz >= max_freq_mhz_;
+        if (cpu_lock_ != nullptr && need_lock && !cpu_lock_held_) {
+            esp_pm_lock_acquire(cpu_lock_);
+            cpu_lock_held_ = true;
+        }
+        esp_pm_config_t pm_config = {
+            .max_freq_mhz = max_freq_mhz_,
+            .min_freq_mhz = profile.min_freq_mhz,
+            .light_sleep_enable = profile.light_sleep,
+        };
+        esp_err_t ret = esp_pm_configure(&pm_config);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "esp_pm_configure failed: %s", esp_err_to_name(ret));
+        }
+        if (cpu_lock_ != nullptr && !need_lock && cpu_lock_held_) {
+            esp_pm_lock_release(cpu_lock_);
+            cpu_lock_held_ = false;
+        }
+    }
+
+    ESP_LOGI(TAG, "State %s: %d-%d MHz, light sleep %d, modem sleep %d, refresh %d ms",
+        STATE_NAMES[state], profile.min_freq_mhz, max_freq_mhz_,
+        profile.light_sleep, profile.modem_sleep, profile.lvgl_refresh_ms);
+}
+
+std::string PowerGovernor::GetEnergyReportJson() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) {
+        Account(esp_timer_get_time());
+    }
+
+    cJSON* root = cJSON_CreateObject();
+    double total_mah = 0;
+    for (int i = 0; i <= kDeviceStateFatalError; i++) {
+        if (energy_[i].duration_us == 0) {
+            continue;
+        }
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "seconds", energy_[i].duration_us / 1000000);
+        cJSON_AddNumberToObject(item, "mah", energy_[i].charge_mas / 3600.0);
+        cJSON_AddItemToObject(root, STATE_NAMES[i], item);
+        total_mah += energy_[i].charge_mas / 3600.0;
+    }
+    cJSON_AddNumberToObject(root, "total_mah", total_mah);
+    auto json_str = cJSON_PrintUnformatted(root);
+    std::string json(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return json;
+}
+
+void PowerGovernor::PrintEnergyReport() {
+    ESP_LOGI(TAG, "Energy: %s", GetEnergyReportJson().c_str());
+}
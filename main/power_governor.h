@@ -0,0 +1,87 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <esp_pm.h>
+
+#include <mutex>
+#include <string>
+
+#include "device_state.h"
+
+enum PowerProfileType {
+    kPowerProfilePerformance,   // 启动、配网、升级等
+    kPowerProfileActive,        // 连接、聆听、说话
+    kPowerProfileIdle,          // 待机，仅唤醒词负载
+    kPowerProfileScreenOff,     // 待机且屏幕已关闭
+    kPowerProfileCount
+};
+
+struct PowerProfile {
+    int min_freq_mhz;           // 动态调频下限，等于最大频率时不调频
+    bool light_sleep;
+    bool modem_sleep;           // Wi-Fi / 4G 模组省电
+    int lvgl_refresh_ms;        // 屏幕刷新周期
+    int estimated_current_ma;   // 该档位的估计电流，用于能耗统计
+};
+
+/*
+ * 功耗调度器：随设备状态变化切换 CPU 频率、light sleep、
+ * 模组省电和屏幕刷新率，并按状态累计时长与估计耗电量。
+ * CPU 频率与 light sleep 需要板子调用 EnableFrequencyScaling 后才会接管，
+ * 避免与仍由 PowerSaveTimer 配置 esp_pm 的板子冲突。
+ *
+ * 状态可能同时从多个任务改变（主任务、省电定时器、板级回调），硬件设置同一时间只由一个线程下发：
+ * 其他线程只记录最新档位，由正在下发的线程循环到没有新档位为止，最终生效的总是最后一次的档位。
+ */
+class PowerGovernor {
+public:
+    static PowerGovernor& GetInstance() {
+        static PowerGovernor instance;
+        return instance;
+    }
+    PowerGovernor(const PowerGovernor&) = delete;
+    PowerGovernor& operator=(const PowerGovernor&) = delete;
+
+    void Start(DeviceState state);
+    void SetDeviceState(DeviceState state);
+    void EnableFrequencyScaling(bool enabled);
+    void SetProfile(PowerProfileType type, const PowerProfile& profile);
+    void SetScreenOn(bool screen_on);
+
+    std::string GetEnergyReportJson();
+    void PrintEnergyReport();
+
+private:
+    PowerGovernor();
+    ~PowerGovernor();
+
+    struct StateEnergy {
+        int64_t duration_us = 0;
+        double charge_mas = 0;  // 毫安秒
+    };
+
+    std::mutex mutex_;
+    PowerProfile profiles_[kPowerProfileCount];
+    StateEnergy energy_[kDeviceStateFatalError + 1];
+    DeviceState state_ = kDeviceStateUnknown;
+    PowerProfileType profile_type_ = kPowerProfilePerformance;
+    int64_t last_update_us_ = 0;
+    bool started_ = false;
+    bool modem_sleep_ = false;
+    bool screen_on_ = true;
+    bool frequency_scaling_ = false;
+    int max_freq_mhz_;
+    // 有新档位等待下发；applying_ 表示已有线程在下发，两者都由 mutex_ 保护
+    bool apply_pending_ = false;
+    bool applying_ = false;
+    // 以下只由正在下发的线程访问
+    esp_pm_lock_handle_t cpu_lock_ = nullptr;
+    bool cpu_lock_held_ = false;
+
+    PowerProfileType GetProfileType(DeviceState state) const;
+    void Account(int64_t now_us);
+    void Apply(DeviceState state);
+    void ApplyProfile(DeviceState state, const PowerProfile& profile, bool modem_sleep_changed, bool frequency_scaling);
+};
+
+#endif // POWER_GOVERNOR_H
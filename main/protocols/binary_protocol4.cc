@@ -0,0 +1,341 @@
+#include "binary_protocol4.h"
+
+#include <cmath>
+#include <cstring>
+
+#define CBOR_MAX_DEPTH 16
+
+// 服务端与设备端共用的键表，只能在末尾追加；前 24 个键编码后只占一个字节
+static const char* const kCborKeys[] = {
+    "type", "session_id", "state", "mode", "text", "reason", "emotion", "payload",
+    "version", "transport", "features", "audio_params", "format", "sample_rate", "channels", "frame_duration",
+    "descriptors", "states", "jsonrpc", "method", "params", "id", "result", "name",
+    "arguments", "error", "code", "message", "voice", "cache", "key", "hit",
+};
+static const int kCborKeyCount = sizeof(kCborKeys) / sizeof(kCborKeys[0]);
+
+static void WriteVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t BinaryProtocol4::EncodeAudio(uint32_t sequence, uint32_t& last_timestamp,
+                                      const std::vector<const AudioStreamPacket*>& packets, std::string& out) {
+    size_t size = 8;
+    for (auto packet : packets) {
+        size += packet->payload.size() + 8;
+    }
+    out.clear();
+    out.reserve(size);
+    out.push_back((char)kFrameAudio);
+    WriteVarint(out, sequence);
+    WriteVarint(out, packets.size());
+    for (auto packet : packets) {
+        int32_t delta = (int32_t)(packet->timestamp - last_timestamp);
+        WriteVarint(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        last_timestamp = packet->timestamp;
+        WriteVarint(out, packet->payload.size());
+        out.append((const char*)packet->payload.data(), packet->payload.size());
+    }
+    return packets.size();
+}
+
+bool BinaryProtocol4::Decode(const uint8_t* data, size_t size, uint32_t& last_timestamp, Frame& frame) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    if (p >= end) {
+        return false;
+    }
+    frame.type = (FrameType)*p++;
+    if (!ReadVarint(p, end, frame.sequence)) {
+        return false;
+    }
+
+    if (frame.type == kFrameControl) {
+        frame.control = DecodeCbor(p, end - p);
+        return frame.control != nullptr;
+    }
+    if (frame.type != kFrameAudio) {
+        return false;
+    }
+
+    uint32_t count;
+    if (!ReadVarint(p, end, count) || count > size) {
+        return false;
+    }
+    frame.packets.resize(count);
+    uint32_t timestamp = last_timestamp;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t delta, length;
+        if (!ReadVarint(p, end, delta)) {
+            return false;
+        }
+        timestamp += (uint32_t)((int32_t)(delta >> 1) ^ -(int32_t)(delta & 1));
+        if (!ReadVarint(p, end, length) || length > (size_t)(end - p)) {
+            return false;
+        }
+        auto& packet = frame.packets[i];
+        packet.timestamp = timestamp;
+        packet.payload.assign(p, p + length);
+        p += length;
+    }
+    if (p != end) {
+        return false;
+    }
+    last_timestamp = timestamp;
+    return true;
+}
+
+static void WriteCborHead(std::string& out, uint8_t major, uint64_t value) {
+    major <<= 5;
+    if (value < 24) {
+        out.push_back((char)(major | value));
+        return;
+    }
+    int bytes;
+    if (value <= 0xFF) {
+        out.push_back((char)(major | 24));
+        bytes = 1;
+    } else if (value <= 0xFFFF) {
+        out.push_back((char)(major | 25));
+        bytes = 2;
+    } else if (value <= 0xFFFFFFFF) {
+        out.push_back((char)(major | 26));
+        bytes = 4;
+    } else {
+        out.push_back((char)(major | 27));
+        bytes = 8;
+    }
+    for (int i = bytes - 1; i >= 0; i--) {
+        out.push_back((char)(value >> (i * 8)));
+    }
+}
+
+static void WriteCborString(std::string& out, const char* text, size_t length) {
+    WriteCborHead(out, 3, length);
+    out.append(text, length);
+}
+
+static void WriteCborString(std::string& out, const char* text) {
+    WriteCborString(out, text, strlen(text));
+}
+
+static void WriteCborKey(std::string& out, const char* key) {
+    for (int i = 0; i < kCborKeyCount; i++) {
+        if (strcmp(kCborKeys[i], key) == 0) {
+            WriteCborHead(out, 0, i);
+            return;
+        }
+    }
+    WriteCborString(out, key);
+}
+
+void BinaryProtocol4::EncodeCbor(const cJSON* item, std::string& out) {
+    if (cJSON_IsObject(item) || cJSON_IsArray(item)) {
+        bool is_object = cJSON_IsObject(item);
+        WriteCborHead(out, is_object ? 5 : 4, cJSON_GetArraySize(item));
+        const cJSON* child;
+        cJSON_ArrayForEach(child, item) {
+            if (is_object) {
+                WriteCborKey(out, child->string);
+            }
+            EncodeCbor(child, out);
+        }
+    } else if (cJSON_IsString(item) || cJSON_IsRaw(item)) {
+        WriteCborString(out, item->valuestring);
+    } else if (cJSON_IsNumber(item)) {
+        double value = item->valuedouble;
+        if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+            if (value >= 0) {
+                WriteCborHead(out, 0, (uint64_t)value);
+            } else {
+                WriteCborHead(out, 1, (uint64_t)(-1 - (int64_t)value));
+            }
+        } else if ((double)(float)value == value) {
+            float f = (float)value;
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            out.push_back((char)0xFA);
+            for (int i = 3; i >= 0; i--) {
+                out.push_back((char)(bits >> (i * 8)));
+            }
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            out.push_back((char)0xFB);
+            for (int i = 7; i >= 0; i--) {
+                out.push_back((char)(bits >> (i * 8)));
+            }
+        }
+    } else if (cJSON_IsTrue(item)) {
+        out.push_back((char)0xF5);
+    } else if (cJSON_IsFalse(item)) {
+        out.push_back((char)0xF4);
+    } else {
+        out.push_back((char)0xF6);
+    }
+}
+
+void BinaryProtocol4::EncodeControl(uint32_t sequence, const ControlMessage& message, std::string& out) {
+    out.clear();
+    out.push_back((char)kFrameControl);
+    WriteVarint(out, sequence);
+    WriteCborHead(out, 5, message.fields().size());
+    for (auto& field : message.fields()) {
+        WriteCborKey(out, field.key);
+        if (field.kind == ControlMessage::kString) {
+            WriteCborString(out, field.value.data(), field.value.size());
+        } else if (field.kind == ControlMessage::kBool) {
+            out.push_back(field.value == "true" ? (char)0xF5 : (char)0xF4);
+        } else {
+            auto item = cJSON_Parse(field.value.c_str());
+            if (item != nullptr) {
+                EncodeCbor(item, out);
+                cJSON_Delete(item);
+            } else {
+                // 不是合法的 JSON，按字符串发送，由服务端报错
+                WriteCborString(out, field.value.data(), field.value.size());
+            }
+        }
+    }
+}
+
+static bool ReadCborHead(const uint8_t*& p, const uint8_t* end, uint8_t& major, uint8_t& info, uint64_t& value) {
+    if (p >= end) {
+        return false;
+    }
+    major = *p >> 5;
+    info = *p & 0x1F;
+    p++;
+    if (info < 24) {
+        value = info;
+        return true;
+    }
+    if (info > 27) {
+        // 不支持不定长编码
+        return false;
+    }
+    int bytes = 1 << (info - 24);
+    if (end - p < bytes) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | *p++;
+    }
+    return true;
+}
+
+static cJSON* ReadCborItem(const uint8_t*& p, const uint8_t* end, int depth) {
+    uint8_t major, info;
+    uint64_t value;
+    if (depth > CBOR_MAX_DEPTH || !ReadCborHead(p, end, major, info, value)) {
+        return nullptr;
+    }
+    switch (major) {
+    case 0:
+        return cJSON_CreateNumber((double)value);
+    case 1:
+        return cJSON_CreateNumber(-1.0 - (double)value);
+    case 2:
+    case 3: {
+        if (value > (uint64_t)(end - p)) {
+            return nullptr;
+        }
+        std::string text((const char*)p, value);
+        p += value;
+        return cJSON_CreateString(text.c_str());
+    }
+    case 4:
+    case 5: {
+        if (value > (uint64_t)(end - p)) {
+            return nullptr;
+        }
+        cJSON* container = major == 4 ? cJSON_CreateArray() : cJSON_CreateObject();
+        for (uint64_t i = 0; i < value; i++) {
+            std::string key;
+            if (major == 5) {
+                uint8_t key_major, key_info;
+                uint64_t key_value;
+                if (!ReadCborHead(p, end, key_major, key_info, key_value)) {
+                    cJSON_Delete(container);
+                    return nullptr;
+                }
+                if (key_major == 0 && key_value < (uint64_t)kCborKeyCount) {
+                    key = kCborKeys[key_value];
+                } else if (key_major == 3 && key_value <= (uint64_t)(end - p)) {
+                    key.assign((const char*)p, key_value);
+                    p += key_value;
+                } else {
+                    cJSON_Delete(container);
+                    return nullptr;
+                }
+            }
+            cJSON* child = ReadCborItem(p, end, depth + 1);
+            if (child == nullptr) {
+                cJSON_Delete(container);
+                return nullptr;
+            }
+            if (major == 5) {
+                cJSON_AddItemToObject(container, key.c_str(), child);
+            } else {
+                cJSON_AddItemToArray(container, child);
+            }
+        }
+        return container;
+    }
+    case 7:
+        if (info == 20) {
+            return cJSON_CreateFalse();
+        } else if (info == 21) {
+            return cJSON_CreateTrue();
+        } else if (info == 22 || info == 23) {
+            return cJSON_CreateNull();
+        } else if (info == 25) {
+            // 半精度浮点
+            int exponent = (value >> 10) & 0x1F;
+            int mantissa = value & 0x3FF;
+            double number = exponent == 0 ? std::ldexp(mantissa, -24) :
+                exponent == 31 ? (mantissa == 0 ? INFINITY : NAN) : std::ldexp(mantissa + 1024, exponent - 25);
+            return cJSON_CreateNumber(value & 0x8000 ? -number : number);
+        } else if (info == 26) {
+            uint32_t bits = (uint32_t)value;
+            float number;
+            memcpy(&number, &bits, sizeof(number));
+            return cJSON_CreateNumber(number);
+        } else if (info == 27) {
+            double number;
+            memcpy(&number, &value, sizeof(number));
+            return cJSON_CreateNumber(number);
+        }
+        return nullptr;
+    default:
+        // 不支持 tag
+        return nullptr;
+    }
+}
+
+cJSON* BinaryProtocol4::DecodeCbor(const uint8_t* data, size_t size) {
+    const uint8_t* p = data;
+    cJSON* item = ReadCborItem(p, data + size, 0);
+    if (item != nullptr && p != data + size) {
+        cJSON_Delete(item);
+        return nullptr;
+    }
+    return item;
+}
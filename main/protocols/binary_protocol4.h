@@ -0,0 +1,50 @@
+#ifndef BINARY_PROTOCOL4_H
+#define BINARY_PROTOCOL4_H
+
+#include "protocol.h"
+
+#include <cJSON.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * 二进制协议 v4：音频和控制消息都用 WebSocket 二进制帧传输，整数均为 varint（LEB128）。
+ *   |type 1u|sequence varint|body|
+ * 音频帧（type 0）可以合并多帧 Opus：
+ *   |count varint|timestamp_delta zigzag|size varint|opus|...|timestamp_delta zigzag|size varint|opus|
+ *   每帧写与同一方向上一帧的时间戳差值（跨消息，连接建立时上一帧按 0 计），稳态下只占一个字节；
+ *   sequence 为第一帧的序号，之后每帧加一。
+ * 控制帧（type 1）的 body 为 CBOR 编码的 JSON 对象，常用键名按 kCborKeys 替换为整数。
+ * 两个方向各自计数，音频帧和控制帧共用序号。hello 仍以文本帧交换，用于协商版本。
+ */
+class BinaryProtocol4 {
+public:
+    enum FrameType : uint8_t {
+        kFrameAudio = 0,
+        kFrameControl = 1,
+    };
+
+    struct Frame {
+        FrameType type;
+        uint32_t sequence;
+        // 音频帧，时间戳已还原，采样率和帧长由调用者填写
+        std::vector<AudioStreamPacket> packets;
+        // 控制帧，调用者负责释放
+        cJSON* control = nullptr;
+    };
+
+    // 把若干帧音频编码为一个消息，返回占用的序号数。last_timestamp 为本方向上一帧的时间戳，编码后更新
+    static uint32_t EncodeAudio(uint32_t sequence, uint32_t& last_timestamp,
+                                const std::vector<const AudioStreamPacket*>& packets, std::string& out);
+    // 控制消息直接写成 CBOR，只有 Raw 字段需要经过 cJSON 解析
+    static void EncodeControl(uint32_t sequence, const ControlMessage& message, std::string& out);
+    // 消息必须恰好读完，有多余的字节时也返回 false；解码成功的音频帧才更新 last_timestamp
+    static bool Decode(const uint8_t* data, size_t size, uint32_t& last_timestamp, Frame& frame);
+
+    static void EncodeCbor(const cJSON* item, std::string& out);
+    // data 必须恰好是一个 CBOR 数据项
+    static cJSON* DecodeCbor(const uint8_t* data, size_t size);
+};
+
+#endif // BINARY_PROTOCOL4_H
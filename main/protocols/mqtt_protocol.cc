@@ -2,8 +2,12 @@
 #include "board.h"
 #include "application.h"
 #include "settings.h"
+#include "metrics.h"
+#include "trace.h"
+#include "link_quality_monitor.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <ml307_mqtt.h>
 #include <ml307_udp.h>
 #include <cstring>
@@ -12,7 +16,21 @@
 
 #define TAG "MQTT"
 
-MqttProtocol::MqttProtocol() {
+// 决定连接的参数拼接在一起，用于判断 NVS 中的参数是否已更新
+static std::string GetConnectionSettings(Settings& settings) {
+    std::string result;
+    for (auto key : { "endpoint", "client_id", "username", "password", "publish_topic" }) {
+        result += settings.GetString(key);
+        result += '\n';
+    }
+    result += std::to_string(settings.GetInt("keepalive", 120));
+    return result;
+}
+
+MqttProtocol::MqttProtocol()
+    : bundler_([this](uint8_t flags, uint32_t timestamp, uint32_t sequence, const uint8_t* payload, size_t size) {
+          return SendUdpPacket(flags, timestamp, sequence, payload, size);
+      }) {
     event_group_handle_ = xEventGroupCreate();
 }
 
@@ -32,12 +50,15 @@ bool MqttProtocol::Start() {
 }
 
 bool MqttProtocol::StartMqttClient(bool report_error) {
+    static auto connects = Metrics::GetInstance().Counter("mqtt.connects");
+    connects->Increment();
     if (mqtt_ != nullptr) {
         ESP_LOGW(TAG, "Mqtt client already started");
         delete mqtt_;
     }
 
     Settings settings("mqtt", false);
+    connected_settings_ = GetConnectionSettings(settings);
     auto endpoint = settings.GetString("endpoint");
     auto client_id = settings.GetString("client_id");
     auto username = settings.GetString("username");
@@ -114,7 +135,16 @@ bool MqttProtocol::SendText(const std::string& text) {
     if (publish_topic_.empty()) {
         return false;
     }
-    if (!mqtt_->Publish(publish_topic_, text)) {
+    {
+        // 控制消息（如 listen stop）之前的音频要先到达服务端
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        bundler_.Flush();
+    }
+    bool success = mqtt_->Publish(publish_topic_, text);
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordSend(success);
+    }
+    if (!success) {
         ESP_LOGE(TAG, "Failed to publish message: %s", text.c_str());
         SetError(Lang::Strings::SERVER_ERROR);
         return false;
@@ -122,30 +152,55 @@ bool MqttProtocol::SendText(const std::string& text) {
     return true;
 }
 
+void MqttProtocol::SendMetrics(const std::string& metrics) {
+    // 空闲时 MQTT 长连接仍然保持，不需要等音频通道打开
+    if (mqtt_ == nullptr || !mqtt_->IsConnected()) {
+        return;
+    }
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "metrics").AddRaw("payload", metrics);
+    SendControl(message);
+}
+
 bool MqttProtocol::SendAudio(const AudioStreamPacket& packet) {
+    TRACE_SCOPE("mqtt.send_audio");
     std::lock_guard<std::mutex> lock(channel_mutex_);
     if (udp_ == nullptr) {
         return false;
     }
+    return bundler_.Add(packet);
+}
+
+// 由 bundler_ 调用，调用者持有 channel_mutex_
+bool MqttProtocol::SendUdpPacket(uint8_t flags, uint32_t timestamp, uint32_t sequence, const uint8_t* payload,
+                                 size_t size) {
+    if (udp_ == nullptr) {
+        return false;
+    }
 
     std::string nonce(aes_nonce_);
-    *(uint16_t*)&nonce[2] = htons(packet.payload.size());
-    *(uint32_t*)&nonce[8] = htonl(packet.timestamp);
-    *(uint32_t*)&nonce[12] = htonl(++local_sequence_);
+    nonce[1] = flags;
+    *(uint16_t*)&nonce[2] = htons(size);
+    *(uint32_t*)&nonce[8] = htonl(timestamp);
+    *(uint32_t*)&nonce[12] = htonl(sequence);
 
     std::string encrypted;
-    encrypted.resize(aes_nonce_.size() + packet.payload.size());
+    encrypted.resize(aes_nonce_.size() + size);
     memcpy(encrypted.data(), nonce.data(), nonce.size());
 
     size_t nc_off = 0;
     uint8_t stream_block[16] = {0};
-    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet.payload.size(), &nc_off, (uint8_t*)nonce.c_str(), stream_block,
-        (uint8_t*)packet.payload.data(), (uint8_t*)&encrypted[nonce.size()]) != 0) {
+    if (mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off, (uint8_t*)nonce.c_str(), stream_block,
+        payload, (uint8_t*)&encrypted[nonce.size()]) != 0) {
         ESP_LOGE(TAG, "Failed to encrypt audio data");
         return false;
     }
 
-    return udp_->Send(encrypted) > 0;
+    bool success = udp_->Send(encrypted) > 0;
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordSend(success);
+    }
+    return success;
 }
 
 void MqttProtocol::CloseAudioChannel() {
@@ -155,13 +210,12 @@ void MqttProtocol::CloseAudioChannel() {
             delete udp_;
             udp_ = nullptr;
         }
+        bundler_.Clear();
     }
 
-    std::string message = "{";
-    message += "\"session_id\":\"" + session_id_ + "\",";
-    message += "\"type\":\"goodbye\"";
-    message += "}";
-    SendText(message);
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "goodbye");
+    SendControl(message);
 
     if (on_audio_channel_closed_ != nullptr) {
         on_audio_channel_closed_();
@@ -169,11 +223,21 @@ void MqttProtocol::CloseAudioChannel() {
 }
 
 bool MqttProtocol::OpenAudioChannel() {
+    static auto opens = Metrics::GetInstance().Counter("protocol.channel_opens");
+    opens->Increment();
     if (mqtt_ == nullptr || !mqtt_->IsConnected()) {
         ESP_LOGI(TAG, "MQTT is not connected, try to connect now");
         if (!StartMqttClient(true)) {
             return false;
         }
+    } else {
+        Settings settings("mqtt", false);
+        if (GetConnectionSettings(settings) != connected_settings_) {
+            ESP_LOGI(TAG, "MQTT settings updated, reconnect with the new settings");
+            if (!StartMqttClient(true)) {
+                return false;
+            }
+        }
     }
 
     error_occurred_ = false;
@@ -181,75 +245,143 @@ bool MqttProtocol::OpenAudioChannel() {
     xEventGroupClearBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 
     auto message = GetHelloMessage();
+    int64_t hello_time = esp_timer_get_time();
     if (!SendText(message)) {
         return false;
     }
 
-    // 等待服务器响应
+    // 等待服务器响应，hello 的往返时间作为链路时延的采样
     EventBits_t bits = xEventGroupWaitBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(10000));
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordRtt((esp_timer_get_time() - hello_time) / 1000);
+    }
     if (!(bits & MQTT_PROTOCOL_SERVER_HELLO_EVENT)) {
         ESP_LOGE(TAG, "Failed to receive server hello");
         SetError(Lang::Strings::SERVER_TIMEOUT);
         return false;
     }
 
+    ConnectUdp();
+
+    if (on_audio_channel_opened_ != nullptr) {
+        on_audio_channel_opened_();
+    }
+    return true;
+}
+
+// 在当前网络上创建 UDP 连接，加密参数和序号沿用，服务端按 nonce 识别会话
+void MqttProtocol::ConnectUdp() {
     std::lock_guard<std::mutex> lock(channel_mutex_);
     if (udp_ != nullptr) {
         delete udp_;
     }
     udp_ = Board::GetInstance().CreateUdp();
     udp_->OnMessage([this](const std::string& data) {
-        /*
-         * UDP Encrypted OPUS Packet Format:
-         * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
-         * |payload payload_len|
-         */
-        if (data.size() < sizeof(aes_nonce_)) {
-            ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
-            return;
-        }
-        if (data[0] != 0x01) {
-            ESP_LOGE(TAG, "Invalid audio packet type: %x", data[0]);
-            return;
-        }
-        uint32_t timestamp = ntohl(*(uint32_t*)&data[8]);
-        uint32_t sequence = ntohl(*(uint32_t*)&data[12]);
-        if (sequence < remote_sequence_) {
-            ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
-            return;
-        }
-        if (sequence != remote_sequence_ + 1) {
-            ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
-        }
+        OnUdpMessage(data);
+    });
+    udp_->Connect(udp_server_, udp_port_);
 
-        size_t decrypted_size = data.size() - aes_nonce_.size();
-        size_t nc_off = 0;
-        uint8_t stream_block[16] = {0};
-        auto nonce = (uint8_t*)data.data();
-        auto encrypted = (uint8_t*)data.data() + aes_nonce_.size();
-        AudioStreamPacket packet;
-        packet.sample_rate = server_sample_rate_;
-        packet.frame_duration = server_frame_duration_;
-        packet.timestamp = timestamp;
-        packet.payload.resize(decrypted_size);
-        int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, (uint8_t*)packet.payload.data());
-        if (ret != 0) {
-            ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
-            return;
-        }
+    // 合并帧数按网络类型选择，双网络板卡切换网络后重新计算
+    bool cellular = Board::GetInstance().GetBoardType() == "ml307";
+    int frames = cellular ? CONFIG_MQTT_UDP_BUNDLE_FRAMES_4G : CONFIG_MQTT_UDP_BUNDLE_FRAMES_WIFI;
+    // 切换前未发出的帧在新连接上补发
+    bundler_.Configure(server_bundle_ ? frames : 1,
+        (cellular ? MQTT_UDP_PATH_MTU_4G : MQTT_UDP_PATH_MTU_WIFI) - MQTT_UDP_IP_HEADER_SIZE - aes_nonce_.size());
+}
+
+void MqttProtocol::OnUdpMessage(const std::string& data) {
+    TRACE_SCOPE("mqtt.recv_audio");
+    /*
+     * UDP Encrypted OPUS Packet Format:
+     * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
+     * |payload payload_len|
+     * flags 含 MQTT_UDP_FLAG_BUNDLE 时 payload 为 |size 2u|opus|size 2u|opus|...，
+     * timestamp 和 sequence 属于第一帧，之后每帧时间戳加一个帧长、序号加一
+     */
+    if (data.size() < aes_nonce_.size()) {
+        ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
+        return;
+    }
+    if (data[0] != 0x01) {
+        ESP_LOGE(TAG, "Invalid audio packet type: %x", data[0]);
+        return;
+    }
+    uint32_t timestamp = ntohl(*(uint32_t*)&data[8]);
+    uint32_t sequence = ntohl(*(uint32_t*)&data[12]);
+    if (sequence < remote_sequence_) {
+        ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
+        return;
+    }
+    if (sequence != remote_sequence_ + 1) {
+        static auto sequence_gaps = Metrics::GetInstance().Counter("audio.rx_sequence_gaps");
+        sequence_gaps->Increment();
+        ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
+    }
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordReceive(remote_sequence_ == 0 ? 0 : (int)(sequence - remote_sequence_ - 1));
+    }
+
+    size_t decrypted_size = data.size() - aes_nonce_.size();
+    size_t nc_off = 0;
+    uint8_t stream_block[16] = {0};
+    auto nonce = (uint8_t*)data.data();
+    auto encrypted = (uint8_t*)data.data() + aes_nonce_.size();
+    AudioStreamPacket packet;
+    packet.sample_rate = server_sample_rate_;
+    packet.frame_duration = server_frame_duration_;
+    packet.timestamp = timestamp;
+    packet.payload.resize(decrypted_size);
+    int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, (uint8_t*)packet.payload.data());
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
+        return;
+    }
+    last_incoming_time_ = std::chrono::steady_clock::now();
+
+    if (!(data[1] & MQTT_UDP_FLAG_BUNDLE)) {
         if (on_incoming_audio_ != nullptr) {
             on_incoming_audio_(std::move(packet));
         }
         remote_sequence_ = sequence;
-        last_incoming_time_ = std::chrono::steady_clock::now();
-    });
+        return;
+    }
 
-    udp_->Connect(udp_server_, udp_port_);
+    std::vector<AudioStreamPacket> packets;
+    if (!UdpAudioBundler::Unpack(packet.payload.data(), packet.payload.size(), timestamp, server_sample_rate_,
+                                 server_frame_duration_, packets)) {
+        ESP_LOGE(TAG, "Invalid bundled audio packet, size: %u", (unsigned)decrypted_size);
+        return;
+    }
+    if (on_incoming_audio_ != nullptr) {
+        for (auto& frame : packets) {
+            on_incoming_audio_(std::move(frame));
+        }
+    }
+    if (!packets.empty()) {
+        remote_sequence_ = sequence + packets.size() - 1;
+    }
+}
 
-    if (on_audio_channel_opened_ != nullptr) {
-        on_audio_channel_opened_();
+void MqttProtocol::OnNetworkChanged() {
+    // 用原来的 client_id 重新连接，服务端会接管原来的会话
+    ESP_LOGI(TAG, "Network changed, reconnect to endpoint");
+    if (!StartMqttClient(false)) {
+        // 连接失败已经提示过错误，无法再发送 goodbye，直接关闭音频通道
+        bool opened;
+        {
+            std::lock_guard<std::mutex> lock(channel_mutex_);
+            opened = udp_ != nullptr;
+            delete udp_;
+            udp_ = nullptr;
+        }
+        if (opened && on_audio_channel_closed_ != nullptr) {
+            on_audio_channel_closed_();
+        }
+        return;
+    }
+    if (udp_ != nullptr) {
+        ConnectUdp();
     }
-    return true;
 }
 
 std::string MqttProtocol::GetHelloMessage() {
@@ -265,6 +397,8 @@ std::string MqttProtocol::GetHelloMessage() {
 #if CONFIG_IOT_PROTOCOL_MCP
     cJSON_AddBoolToObject(features, "mcp", true);
 #endif
+    // 设备总能接收合并包，服务端在回复的 udp.bundle 中表示是否接收合并包
+    cJSON_AddBoolToObject(features, "udp_bundle", true);
     cJSON_AddItemToObject(root, "features", features);
     cJSON* audio_params = cJSON_CreateObject();
     cJSON_AddStringToObject(audio_params, "format", "opus");
@@ -320,8 +454,12 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
     aes_nonce_ = DecodeHexString(nonce);
     mbedtls_aes_init(&aes_ctx_);
     mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)DecodeHexString(key).c_str(), 128);
-    local_sequence_ = 0;
+    server_bundle_ = cJSON_IsTrue(cJSON_GetObjectItem(udp, "bundle"));
     remote_sequence_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        bundler_.Reset();
+    }
     xEventGroupSetBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 }
 
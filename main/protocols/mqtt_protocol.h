@@ -3,6 +3,7 @@
 
 
 #include "protocol.h"
+#include "udp_audio_bundle.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
@@ -30,11 +31,15 @@ public:
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
+    void SendMetrics(const std::string& metrics) override;
+    void OnNetworkChanged() override;
 
 private:
     EventGroupHandle_t event_group_handle_;
 
     std::string publish_topic_;
+    // 当前连接使用的参数，与 NVS 中的不同时（OTA 后台检查更新了令牌或地址）下次打开音频通道前重连
+    std::string connected_settings_;
 
     std::mutex channel_mutex_;
     Mqtt* mqtt_ = nullptr;
@@ -43,10 +48,15 @@ private:
     std::string aes_nonce_;
     std::string udp_server_;
     int udp_port_;
-    uint32_t local_sequence_;
     uint32_t remote_sequence_;
+    // 服务端在 hello 中同意合并后，按当前网络类型决定每包最多合并的帧数；发送序号由 bundler_ 计数
+    bool server_bundle_ = false;
+    UdpAudioBundler bundler_;
 
     bool StartMqttClient(bool report_error=false);
+    void ConnectUdp();
+    void OnUdpMessage(const std::string& data);
+    bool SendUdpPacket(uint8_t flags, uint32_t timestamp, uint32_t sequence, const uint8_t* payload, size_t size);
     void ParseServerHello(const cJSON* root);
     std::string DecodeHexString(const std::string& hex_string);
 
@@ -1,9 +1,16 @@
 #include "protocol.h"
+#include "board.h"
+#include "metrics.h"
 
 #include <esp_log.h>
+#include <cstdio>
 
 #define TAG "Protocol"
 
+Protocol::Protocol() {
+    link_monitor_ = Board::GetInstance().GetLinkQualityMonitor();
+}
+
 void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
     on_incoming_json_ = callback;
 }
@@ -24,7 +31,59 @@ void Protocol::OnNetworkError(std::function<void(const std::string& message)> ca
     on_network_error_ = callback;
 }
 
+bool Protocol::SendAudioFrames(const std::list<AudioStreamPacket>& packets) {
+    for (auto& packet : packets) {
+        if (!SendAudio(packet)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void AppendJsonString(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+std::string ControlMessage::ToJson() const {
+    std::string json = "{";
+    for (size_t i = 0; i < fields_.size(); i++) {
+        auto& field = fields_[i];
+        if (i > 0) {
+            json += ',';
+        }
+        json += '"';
+        json += field.key;
+        json += "\":";
+        if (field.kind == kString) {
+            AppendJsonString(json, field.value);
+        } else {
+            json += field.value;
+        }
+    }
+    json += '}';
+    return json;
+}
+
+bool Protocol::SendControl(const ControlMessage& message) {
+    return SendText(message.ToJson());
+}
+
 void Protocol::SetError(const std::string& message) {
+    static auto errors = Metrics::GetInstance().Counter("protocol.errors");
+    errors->Increment();
     error_occurred_ = true;
     if (on_network_error_ != nullptr) {
         on_network_error_(message);
@@ -32,37 +91,43 @@ void Protocol::SetError(const std::string& message) {
 }
 
 void Protocol::SendAbortSpeaking(AbortReason reason) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"abort\"";
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "abort");
     if (reason == kAbortReasonWakeWordDetected) {
-        message += ",\"reason\":\"wake_word_detected\"";
+        message.Add("reason", "wake_word_detected");
     }
-    message += "}";
-    SendText(message);
+    SendControl(message);
 }
 
 void Protocol::SendWakeWordDetected(const std::string& wake_word) {
-    std::string json = "{\"session_id\":\"" + session_id_ + 
-                      "\",\"type\":\"listen\",\"state\":\"detect\",\"text\":\"" + wake_word + "\"}";
-    SendText(json);
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "listen").Add("state", "detect").Add("text", wake_word);
+    SendControl(message);
 }
 
 void Protocol::SendStartListening(ListeningMode mode) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\"";
-    message += ",\"type\":\"listen\",\"state\":\"start\"";
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "listen").Add("state", "start");
     if (mode == kListeningModeRealtime) {
-        message += ",\"mode\":\"realtime\"";
+        message.Add("mode", "realtime");
     } else if (mode == kListeningModeAutoStop) {
-        message += ",\"mode\":\"auto\"";
+        message.Add("mode", "auto");
     } else {
-        message += ",\"mode\":\"manual\"";
+        message.Add("mode", "manual");
     }
-    message += "}";
-    SendText(message);
+    SendControl(message);
 }
 
 void Protocol::SendStopListening() {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"listen\",\"state\":\"stop\"}";
-    SendText(message);
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "listen").Add("state", "stop");
+    SendControl(message);
+}
+
+void Protocol::SendTtsCacheResult(const std::string& key, bool hit) {
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "tts").Add("state", "cache").Add("key", key).AddBool("hit", hit);
+    SendControl(message);
 }
 
 void Protocol::SendIotDescriptors(const std::string& descriptors) {
@@ -86,38 +151,48 @@ void Protocol::SendIotDescriptors(const std::string& descriptors) {
             continue;
         }
 
-        cJSON* messageRoot = cJSON_CreateObject();
-        cJSON_AddStringToObject(messageRoot, "session_id", session_id_.c_str());
-        cJSON_AddStringToObject(messageRoot, "type", "iot");
-        cJSON_AddBoolToObject(messageRoot, "update", true);
-
-        cJSON* descriptorArray = cJSON_CreateArray();
-        cJSON_AddItemToArray(descriptorArray, cJSON_Duplicate(descriptor, 1));
-        cJSON_AddItemToObject(messageRoot, "descriptors", descriptorArray);
-
-        char* message = cJSON_PrintUnformatted(messageRoot);
-        if (message == nullptr) {
+        char* printed = cJSON_PrintUnformatted(descriptor);
+        if (printed == nullptr) {
             ESP_LOGE(TAG, "Failed to print JSON message for IoT descriptor at index %d", i);
-            cJSON_Delete(messageRoot);
             continue;
         }
 
-        SendText(std::string(message));
-        cJSON_free(message);
-        cJSON_Delete(messageRoot);
+        ControlMessage message;
+        message.Add("session_id", session_id_).Add("type", "iot").AddBool("update", true);
+        message.AddRaw("descriptors", "[" + std::string(printed) + "]");
+        SendControl(message);
+        cJSON_free(printed);
     }
 
     cJSON_Delete(root);
 }
 
 void Protocol::SendIotStates(const std::string& states) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"iot\",\"update\":true,\"states\":" + states + "}";
-    SendText(message);
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "iot").AddBool("update", true).AddRaw("states", states);
+    SendControl(message);
 }
 
 void Protocol::SendMcpMessage(const std::string& payload) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"mcp\",\"payload\":" + payload + "}";
-    SendText(message);
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "mcp").AddRaw("payload", payload);
+    SendControl(message);
+}
+
+void Protocol::SendMetrics(const std::string& metrics) {
+    // 发送失败会触发网络错误提示，通道未打开时不上报
+    if (!IsAudioChannelOpened()) {
+        return;
+    }
+    ControlMessage message;
+    message.Add("session_id", session_id_).Add("type", "metrics").AddRaw("payload", metrics);
+    SendControl(message);
+}
+
+void Protocol::OnNetworkChanged() {
+    if (IsAudioChannelOpened()) {
+        CloseAudioChannel();
+    }
 }
 
 bool Protocol::IsTimeout() const {
@@ -6,6 +6,7 @@
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <list>
 
 struct AudioStreamPacket {
     int sample_rate = 0;
@@ -30,6 +31,39 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+/*
+ * 控制消息的顶层字段，由传输层按协议序列化：文本帧为 JSON，二进制协议 v4 直接编码为 CBOR，
+ * 不必先拼 JSON 文本再解析。Raw 字段的值是其他模块生成的 JSON 文本（MCP 消息、IoT 状态、指标），原样嵌入。
+ */
+class ControlMessage {
+public:
+    enum Kind { kString, kBool, kRaw };
+    struct Field {
+        const char* key;
+        Kind kind;
+        std::string value;
+    };
+
+    ControlMessage& Add(const char* key, const std::string& value) {
+        fields_.push_back({ key, kString, value });
+        return *this;
+    }
+    ControlMessage& AddBool(const char* key, bool value) {
+        fields_.push_back({ key, kBool, value ? "true" : "false" });
+        return *this;
+    }
+    ControlMessage& AddRaw(const char* key, const std::string& json) {
+        fields_.push_back({ key, kRaw, json });
+        return *this;
+    }
+
+    const std::vector<Field>& fields() const { return fields_; }
+    std::string ToJson() const;
+
+private:
+    std::vector<Field> fields_;
+};
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -41,8 +75,11 @@ enum ListeningMode {
     kListeningModeRealtime // 需要 AEC 支持
 };
 
+class LinkQualityMonitor;
+
 class Protocol {
 public:
+    Protocol();
     virtual ~Protocol() = default;
 
     inline int server_sample_rate() const {
@@ -54,6 +91,10 @@ public:
     inline const std::string& session_id() const {
         return session_id_;
     }
+    // 服务端在 hello 中确认支持句子级 TTS 缓存
+    inline bool server_tts_cache() const {
+        return server_tts_cache_;
+    }
 
     void OnIncomingAudio(std::function<void(AudioStreamPacket&& packet)> callback);
     void OnIncomingJson(std::function<void(const cJSON* root)> callback);
@@ -66,6 +107,8 @@ public:
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
     virtual bool SendAudio(const AudioStreamPacket& packet) = 0;
+    // 发送队列中积压的音频，支持合并帧的协议可以一次发出；默认逐帧发送，失败时停止
+    virtual bool SendAudioFrames(const std::list<AudioStreamPacket>& packets);
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -73,6 +116,11 @@ public:
     virtual void SendIotDescriptors(const std::string& descriptors);
     virtual void SendIotStates(const std::string& states);
     virtual void SendMcpMessage(const std::string& message);
+    virtual void SendMetrics(const std::string& metrics);
+    // 回复服务端的缓存探测，命中时服务端不再下发这句音频
+    virtual void SendTtsCacheResult(const std::string& key, bool hit);
+    // 板卡切换了网络接口，需在主任务中调用；默认关闭音频通道，下次对话时在新网络上重新打开
+    virtual void OnNetworkChanged();
 
 protected:
     std::function<void(const cJSON* root)> on_incoming_json_;
@@ -84,10 +132,15 @@ protected:
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
     bool error_occurred_ = false;
+    bool server_tts_cache_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
+    // 不支持切换网络的板卡为空
+    LinkQualityMonitor* link_monitor_ = nullptr;
 
     virtual bool SendText(const std::string& text) = 0;
+    // 发送控制消息，默认序列化为 JSON 后调用 SendText
+    virtual bool SendControl(const ControlMessage& message);
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
 };
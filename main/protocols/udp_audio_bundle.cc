@@ -0,0 +1,79 @@
+#include "udp_audio_bundle.h"
+
+UdpAudioBundler::UdpAudioBundler(Sender sender) : sender_(sender) {
+}
+
+bool UdpAudioBundler::Configure(int max_frames, size_t max_size) {
+    max_frames_ = max_frames;
+    max_size_ = max_size;
+    return Flush();
+}
+
+void UdpAudioBundler::Reset() {
+    Clear();
+    sequence_ = 0;
+}
+
+void UdpAudioBundler::Clear() {
+    buffer_.clear();
+    count_ = 0;
+}
+
+bool UdpAudioBundler::Add(const AudioStreamPacket& packet) {
+    if (max_frames_ <= 1) {
+        return sender_(0, packet.timestamp, ++sequence_, packet.payload.data(), packet.payload.size());
+    }
+
+    // 超过路径 MTU 会在 IP 层分片，丢一片整包作废，放不下时先把已合并的帧发出去
+    if (count_ > 0 && buffer_.size() + 2 + packet.payload.size() > max_size_) {
+        if (!Flush()) {
+            return false;
+        }
+    }
+    if (count_ == 0) {
+        timestamp_ = packet.timestamp;
+    }
+    buffer_.push_back((char)(packet.payload.size() >> 8));
+    buffer_.push_back((char)packet.payload.size());
+    buffer_.append((const char*)packet.payload.data(), packet.payload.size());
+    count_++;
+    if (count_ >= max_frames_) {
+        return Flush();
+    }
+    return true;
+}
+
+bool UdpAudioBundler::Flush() {
+    if (count_ == 0) {
+        return true;
+    }
+    uint32_t sequence = sequence_ + 1;
+    sequence_ += count_;
+    bool success = sender_(MQTT_UDP_FLAG_BUNDLE, timestamp_, sequence, (const uint8_t*)buffer_.data(), buffer_.size());
+    Clear();
+    return success;
+}
+
+bool UdpAudioBundler::Unpack(const uint8_t* payload, size_t size, uint32_t timestamp, int sample_rate,
+                             int frame_duration, std::vector<AudioStreamPacket>& packets) {
+    // 先检查完整个包再交给解码，避免只播放半个包
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + size;
+    packets.clear();
+    while (p < end) {
+        if (end - p < 2 || end - p - 2 < ((p[0] << 8) | p[1])) {
+            packets.clear();
+            return false;
+        }
+        size_t length = (p[0] << 8) | p[1];
+        p += 2;
+        AudioStreamPacket packet;
+        packet.sample_rate = sample_rate;
+        packet.frame_duration = frame_duration;
+        packet.timestamp = timestamp + (uint32_t)(packets.size() * frame_duration);
+        packet.payload.assign(p, p + length);
+        packets.push_back(std::move(packet));
+        p += length;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef UDP_AUDIO_BUNDLE_H
+#define UDP_AUDIO_BUNDLE_H
+
+#include "protocol.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// UDP 包头 flags 字段，置位时 payload 为多帧 |size 2u|opus|size 2u|opus|...
+#define MQTT_UDP_FLAG_BUNDLE 0x01
+// 路径 MTU 估计，4G 按 IPv6 最小 MTU 留出隧道开销
+#define MQTT_UDP_PATH_MTU_WIFI 1500
+#define MQTT_UDP_PATH_MTU_4G 1280
+#define MQTT_UDP_IP_HEADER_SIZE 28
+
+/*
+ * MQTT + UDP 音频通道的多帧合并：
+ *   |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|payload|
+ * flags 含 MQTT_UDP_FLAG_BUNDLE 时 payload 为 |size 2u|opus|size 2u|opus|...，
+ * 包头的 timestamp 和 sequence 属于第一帧，之后每帧时间戳加一个帧长、序号加一。
+ * 发送端攒够设定的帧数，或下一帧会让包超过路径 MTU 时发出；包头的填写和加密由发送回调完成。
+ * 调用者负责加锁。
+ */
+class UdpAudioBundler {
+public:
+    // sequence 为第一帧的序号，从 1 开始，每帧占用一个
+    using Sender = std::function<bool(uint8_t flags, uint32_t timestamp, uint32_t sequence,
+                                      const uint8_t* payload, size_t size)>;
+
+    explicit UdpAudioBundler(Sender sender);
+
+    // 每包最多合并 max_frames 帧，payload 不超过 max_size；max_frames 不大于 1 时逐帧发送。已合并的帧先发出
+    bool Configure(int max_frames, size_t max_size);
+    // 新会话开始时清空未发出的帧，序号从头计数
+    void Reset();
+    // 丢弃未发出的帧，序号不变
+    void Clear();
+    bool Add(const AudioStreamPacket& packet);
+    // 发出已合并的帧，控制消息之前调用，保证之前的音频先到达服务端
+    bool Flush();
+
+    // 拆开合并包，第一帧的时间戳为 timestamp，之后每帧加 frame_duration。整个包合法时才返回 true
+    static bool Unpack(const uint8_t* payload, size_t size, uint32_t timestamp, int sample_rate, int frame_duration,
+                       std::vector<AudioStreamPacket>& packets);
+
+private:
+    Sender sender_;
+    int max_frames_ = 1;
+    size_t max_size_ = 0;
+    uint32_t sequence_ = 0;
+    // 等待合并的明文，按帧加上长度前缀
+    std::string buffer_;
+    int count_ = 0;
+    uint32_t timestamp_ = 0;
+};
+
+#endif // UDP_AUDIO_BUNDLE_H
@@ -3,15 +3,23 @@
 #include "system_info.h"
 #include "application.h"
 #include "settings.h"
+#include "metrics.h"
+#include "trace.h"
+#include "link_quality_monitor.h"
+#include "binary_protocol4.h"
 
 #include <cstring>
 #include <cJSON.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <arpa/inet.h>
 #include "assets/lang_config.h"
 
 #define TAG "WS"
 
+// v4 一个消息最多合并的 Opus 帧数，60ms 一帧时约 0.6 秒
+#define BP4_MAX_FRAMES_PER_MESSAGE 10
+
 WebsocketProtocol::WebsocketProtocol() {
     event_group_handle_ = xEventGroupCreate();
 }
@@ -29,10 +37,16 @@ bool WebsocketProtocol::Start() {
 }
 
 bool WebsocketProtocol::SendAudio(const AudioStreamPacket& packet) {
+    TRACE_SCOPE("ws.send_audio");
     if (websocket_ == nullptr) {
         return false;
     }
 
+    if (version_ == 4) {
+        return SendAudioProtocol4({ &packet });
+    }
+
+    bool success;
     if (version_ == 2) {
         std::string serialized;
         serialized.resize(sizeof(BinaryProtocol2) + packet.payload.size());
@@ -44,7 +58,7 @@ bool WebsocketProtocol::SendAudio(const AudioStreamPacket& packet) {
         bp2->payload_size = htonl(packet.payload.size());
         memcpy(bp2->payload, packet.payload.data(), packet.payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        success = websocket_->Send(serialized.data(), serialized.size(), true);
     } else if (version_ == 3) {
         std::string serialized;
         serialized.resize(sizeof(BinaryProtocol3) + packet.payload.size());
@@ -54,10 +68,70 @@ bool WebsocketProtocol::SendAudio(const AudioStreamPacket& packet) {
         bp3->payload_size = htons(packet.payload.size());
         memcpy(bp3->payload, packet.payload.data(), packet.payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        success = websocket_->Send(serialized.data(), serialized.size(), true);
     } else {
-        return websocket_->Send(packet.payload.data(), packet.payload.size(), true);
+        success = websocket_->Send(packet.payload.data(), packet.payload.size(), true);
+    }
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordSend(success);
+    }
+    return success;
+}
+
+bool WebsocketProtocol::SendAudioFrames(const std::list<AudioStreamPacket>& packets) {
+    if (version_ != 4) {
+        return Protocol::SendAudioFrames(packets);
+    }
+
+    // 网络卡顿时队列里会积压多帧，合并发送可以省掉每帧的 WebSocket 帧头和发送调用
+    std::vector<const AudioStreamPacket*> bundle;
+    bundle.reserve(BP4_MAX_FRAMES_PER_MESSAGE);
+    for (auto& packet : packets) {
+        bundle.push_back(&packet);
+        if (bundle.size() == BP4_MAX_FRAMES_PER_MESSAGE) {
+            if (!SendAudioProtocol4(bundle)) {
+                return false;
+            }
+            bundle.clear();
+        }
+    }
+    return bundle.empty() || SendAudioProtocol4(bundle);
+}
+
+bool WebsocketProtocol::SendAudioProtocol4(const std::vector<const AudioStreamPacket*>& packets) {
+    if (websocket_ == nullptr) {
+        return false;
+    }
+
+    std::string serialized;
+    tx_sequence_ += BinaryProtocol4::EncodeAudio(tx_sequence_, tx_timestamp_, packets, serialized);
+    bool success = websocket_->Send(serialized.data(), serialized.size(), true);
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordSend(success);
+    }
+    return success;
+}
+
+bool WebsocketProtocol::SendControl(const ControlMessage& message) {
+    if (version_ != 4) {
+        return Protocol::SendControl(message);
+    }
+    if (websocket_ == nullptr) {
+        return false;
+    }
+
+    std::string serialized;
+    BinaryProtocol4::EncodeControl(tx_sequence_++, message, serialized);
+    bool success = websocket_->Send(serialized.data(), serialized.size(), true);
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordSend(success);
+    }
+    if (!success) {
+        ESP_LOGE(TAG, "Failed to send control: %s", message.ToJson().c_str());
+        SetError(Lang::Strings::SERVER_ERROR);
+        return false;
     }
+    return true;
 }
 
 bool WebsocketProtocol::SendText(const std::string& text) {
@@ -65,7 +139,11 @@ bool WebsocketProtocol::SendText(const std::string& text) {
         return false;
     }
 
-    if (!websocket_->Send(text)) {
+    bool success = websocket_->Send(text);
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordSend(success);
+    }
+    if (!success) {
         ESP_LOGE(TAG, "Failed to send text: %s", text.c_str());
         SetError(Lang::Strings::SERVER_ERROR);
         return false;
@@ -86,6 +164,8 @@ void WebsocketProtocol::CloseAudioChannel() {
 }
 
 bool WebsocketProtocol::OpenAudioChannel() {
+    static auto opens = Metrics::GetInstance().Counter("protocol.channel_opens");
+    opens->Increment();
     if (websocket_ != nullptr) {
         delete websocket_;
     }
@@ -99,6 +179,10 @@ bool WebsocketProtocol::OpenAudioChannel() {
     }
 
     error_occurred_ = false;
+    tx_sequence_ = 0;
+    rx_sequence_ = 0;
+    tx_timestamp_ = 0;
+    rx_timestamp_ = 0;
 
     websocket_ = Board::GetInstance().CreateWebSocket();
     
@@ -115,7 +199,10 @@ bool WebsocketProtocol::OpenAudioChannel() {
 
     websocket_->OnData([this](const char* data, size_t len, bool binary) {
         if (binary) {
-            if (on_incoming_audio_ != nullptr) {
+            TRACE_SCOPE("ws.recv_audio");
+            if (version_ == 4) {
+                OnBinaryProtocol4((const uint8_t*)data, len);
+            } else if (on_incoming_audio_ != nullptr) {
                 if (version_ == 2) {
                     BinaryProtocol2* bp2 = (BinaryProtocol2*)data;
                     bp2->version = ntohs(bp2->version);
@@ -152,18 +239,7 @@ bool WebsocketProtocol::OpenAudioChannel() {
         } else {
             // Parse JSON data
             auto root = cJSON_Parse(data);
-            auto type = cJSON_GetObjectItem(root, "type");
-            if (cJSON_IsString(type)) {
-                if (strcmp(type->valuestring, "hello") == 0) {
-                    ParseServerHello(root);
-                } else {
-                    if (on_incoming_json_ != nullptr) {
-                        on_incoming_json_(root);
-                    }
-                }
-            } else {
-                ESP_LOGE(TAG, "Missing message type, data: %s", data);
-            }
+            OnJson(root);
             cJSON_Delete(root);
         }
         last_incoming_time_ = std::chrono::steady_clock::now();
@@ -185,12 +261,17 @@ bool WebsocketProtocol::OpenAudioChannel() {
 
     // Send hello message to describe the client
     auto message = GetHelloMessage();
+    int64_t hello_time = esp_timer_get_time();
+    // hello 总是文本帧，服务端据此协商版本
     if (!SendText(message)) {
         return false;
     }
 
     // Wait for server hello
     EventBits_t bits = xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(10000));
+    if (link_monitor_ != nullptr) {
+        link_monitor_->RecordRtt((esp_timer_get_time() - hello_time) / 1000);
+    }
     if (!(bits & WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT)) {
         ESP_LOGE(TAG, "Failed to receive server hello");
         SetError(Lang::Strings::SERVER_TIMEOUT);
@@ -204,6 +285,52 @@ bool WebsocketProtocol::OpenAudioChannel() {
     return true;
 }
 
+void WebsocketProtocol::OnJson(const cJSON* root) {
+    auto type = cJSON_GetObjectItem(root, "type");
+    if (!cJSON_IsString(type)) {
+        ESP_LOGE(TAG, "Missing message type");
+        return;
+    }
+    if (strcmp(type->valuestring, "hello") == 0) {
+        ParseServerHello(root);
+    } else if (on_incoming_json_ != nullptr) {
+        on_incoming_json_(root);
+    }
+}
+
+void WebsocketProtocol::OnBinaryProtocol4(const uint8_t* data, size_t len) {
+    static auto sequence_gaps = Metrics::GetInstance().Counter("audio.rx_sequence_gaps");
+    BinaryProtocol4::Frame frame;
+    if (!BinaryProtocol4::Decode(data, len, rx_timestamp_, frame)) {
+        ESP_LOGE(TAG, "Invalid v4 frame, len: %u", (unsigned)len);
+        if (frame.control != nullptr) {
+            cJSON_Delete(frame.control);
+        }
+        return;
+    }
+    if (frame.sequence != rx_sequence_) {
+        ESP_LOGW(TAG, "Sequence gap: expected %lu, got %lu", (unsigned long)rx_sequence_, (unsigned long)frame.sequence);
+        sequence_gaps->Increment();
+    }
+
+    if (frame.type == BinaryProtocol4::kFrameControl) {
+        rx_sequence_ = frame.sequence + 1;
+        OnJson(frame.control);
+        cJSON_Delete(frame.control);
+        return;
+    }
+
+    rx_sequence_ = frame.sequence + frame.packets.size();
+    if (on_incoming_audio_ == nullptr) {
+        return;
+    }
+    for (auto& packet : frame.packets) {
+        packet.sample_rate = server_sample_rate_;
+        packet.frame_duration = server_frame_duration_;
+        on_incoming_audio_(std::move(packet));
+    }
+}
+
 std::string WebsocketProtocol::GetHelloMessage() {
     // keys: message type, version, audio_params (format, sample_rate, channels)
     cJSON* root = cJSON_CreateObject();
@@ -215,6 +342,9 @@ std::string WebsocketProtocol::GetHelloMessage() {
 #endif
 #if CONFIG_IOT_PROTOCOL_MCP
     cJSON_AddBoolToObject(features, "mcp", true);
+#endif
+#if CONFIG_USE_TTS_CACHE
+    cJSON_AddBoolToObject(features, "tts_cache", true);
 #endif
     cJSON_AddItemToObject(root, "features", features);
     cJSON_AddStringToObject(root, "transport", "websocket");
@@ -238,12 +368,26 @@ void WebsocketProtocol::ParseServerHello(const cJSON* root) {
         return;
     }
 
+    // 服务端不支持 v4 时按它回复的版本通信，未回复版本的旧服务端按 v1 处理
+    if (version_ == 4) {
+        auto version = cJSON_GetObjectItem(root, "version");
+        int server_version = cJSON_IsNumber(version) ? version->valueint : 1;
+        if (server_version < 4) {
+            ESP_LOGW(TAG, "Server does not support v4, fall back to v%d", server_version);
+            version_ = server_version;
+        }
+    }
+
     auto session_id = cJSON_GetObjectItem(root, "session_id");
     if (cJSON_IsString(session_id)) {
         session_id_ = session_id->valuestring;
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
+    // 下行消息有序的 WebSocket 才能按 sentence_start 划分每句的音频
+    auto features = cJSON_GetObjectItem(root, "features");
+    server_tts_cache_ = cJSON_IsObject(features) && cJSON_IsTrue(cJSON_GetObjectItem(features, "tts_cache"));
+
     auto audio_params = cJSON_GetObjectItem(root, "audio_params");
     if (cJSON_IsObject(audio_params)) {
         auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
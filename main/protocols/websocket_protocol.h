@@ -17,6 +17,7 @@ public:
 
     bool Start() override;
     bool SendAudio(const AudioStreamPacket& packet) override;
+    bool SendAudioFrames(const std::list<AudioStreamPacket>& packets) override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
@@ -25,9 +26,18 @@ private:
     EventGroupHandle_t event_group_handle_;
     WebSocket* websocket_ = nullptr;
     int version_ = 1;
+    // v4 两个方向的帧序号和上一帧音频的时间戳，每次打开通道时清零
+    uint32_t tx_sequence_ = 0;
+    uint32_t rx_sequence_ = 0;
+    uint32_t tx_timestamp_ = 0;
+    uint32_t rx_timestamp_ = 0;
 
     void ParseServerHello(const cJSON* root);
+    void OnJson(const cJSON* root);
+    void OnBinaryProtocol4(const uint8_t* data, size_t len);
+    bool SendAudioProtocol4(const std::vector<const AudioStreamPacket*>& packets);
     bool SendText(const std::string& text) override;
+    bool SendControl(const ControlMessage& message) override;
     std::string GetHelloMessage();
 };
 
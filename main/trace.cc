@@ -0,0 +1,163 @@
+#include "trace.h"
+
+#if CONFIG_USE_TRACE
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <esp_cpu.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#define TAG "Trace"
+
+struct TraceEvent {
+    int64_t timestamp_us;
+    const char* name;
+    // 任务名取自 TCB，任务删除后导出的名称可能失效，只影响显示
+    const char* task_name;
+    TraceEventType type;
+};
+
+struct TraceRing {
+    TraceEvent* events = nullptr;
+    std::atomic<uint32_t> head{0};
+};
+
+// 每个核心一个环形缓冲区，同一核心上的多个写者通过 fetch_add 分配槽位
+static TraceRing rings_[portNUM_PROCESSORS];
+static uint32_t ring_mask_ = 0;
+static std::atomic<bool> recording_{false};
+
+void Trace::Initialize() {
+    if (ring_mask_ != 0) {
+        return;
+    }
+    // 向下取整到 2 的幂，用掩码代替取模
+    uint32_t size = 1;
+    while (size * 2 <= CONFIG_TRACE_BUFFER_EVENTS) {
+        size *= 2;
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        auto events = (TraceEvent*)heap_caps_calloc(size, sizeof(TraceEvent), MALLOC_CAP_SPIRAM);
+        if (events == nullptr) {
+            events = (TraceEvent*)heap_caps_calloc(size, sizeof(TraceEvent), MALLOC_CAP_INTERNAL);
+        }
+        if (events == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate trace buffer");
+            return;
+        }
+        rings_[core].events = events;
+    }
+    ring_mask_ = size - 1;
+    recording_ = true;
+    ESP_LOGI(TAG, "Trace enabled, %lu events per core", size);
+}
+
+void Trace::Record(TraceEventType type, const char* name) {
+    if (!recording_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    auto& ring = rings_[esp_cpu_get_core_id()];
+    uint32_t index = ring.head.fetch_add(1, std::memory_order_relaxed) & ring_mask_;
+    auto& event = ring.events[index];
+    event.timestamp_us = esp_timer_get_time();
+    event.name = name;
+    event.task_name = pcTaskGetName(NULL);
+    event.type = type;
+}
+
+void Trace::Clear() {
+    for (auto& ring : rings_) {
+        ring.head = 0;
+    }
+}
+
+bool Trace::Dump(const std::string& server) {
+    if (ring_mask_ == 0) {
+        return false;
+    }
+
+    int sockfd = -1;
+    sockaddr_in server_addr = {};
+    if (!server.empty()) {
+        size_t colon_pos = server.find(':');
+        if (colon_pos == std::string::npos) {
+            ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", server.c_str());
+            return false;
+        }
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(std::stoi(server.substr(colon_pos + 1)));
+        inet_pton(AF_INET, server.substr(0, colon_pos).c_str(), &server_addr.sin_addr);
+        sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sockfd < 0) {
+            ESP_LOGW(TAG, "Failed to create UDP socket");
+            return false;
+        }
+    }
+
+    recording_ = false;
+    // 等待正在写入的事件完成
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    /*
+     * 每个事件一行文本，UDP 模式下按数据报打包多行：
+     * TRACE <timestamp_us> <B|E|i> <core> <task> <name>
+     */
+    char packet[1400];
+    size_t packet_len = 0;
+    auto flush = [&]() {
+        if (packet_len == 0) {
+            return;
+        }
+        if (sockfd >= 0) {
+            sendto(sockfd, packet, packet_len, 0, (sockaddr*)&server_addr, sizeof(server_addr));
+            // 避免发送过快导致接收端丢包
+            vTaskDelay(pdMS_TO_TICKS(2));
+        } else {
+            fwrite(packet, 1, packet_len, stdout);
+            fflush(stdout);
+        }
+        packet_len = 0;
+    };
+
+    uint32_t size = ring_mask_ + 1;
+    size_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        auto& ring = rings_[core];
+        uint32_t head = ring.head.load();
+        uint32_t start = head > size ? head - size : 0;
+        for (uint32_t i = start; i < head; i++) {
+            const auto& event = ring.events[i & ring_mask_];
+            char line[128];
+            int len = snprintf(line, sizeof(line), "TRACE %lld %c %d %s %s\n",
+                event.timestamp_us, (char)event.type, core, event.task_name, event.name);
+            if (len <= 0 || len >= (int)sizeof(line)) {
+                continue;
+            }
+            if (packet_len + len > sizeof(packet)) {
+                flush();
+            }
+            memcpy(packet + packet_len, line, len);
+            packet_len += len;
+            total++;
+        }
+    }
+    flush();
+
+    if (sockfd >= 0) {
+        close(sockfd);
+    }
+    ESP_LOGI(TAG, "Dumped %u trace events to %s", total, server.empty() ? "serial" : server.c_str());
+
+    Clear();
+    recording_ = true;
+    return true;
+}
+
+#endif // CONFIG_USE_TRACE
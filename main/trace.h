@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "sdkconfig.h"
+
+/*
+ * 热路径事件追踪，仅在 CONFIG_USE_TRACE 打开时编译进固件。
+ * 事件名必须是不含空格的字符串常量，记录时只保存指针。
+ *
+ *   TRACE_SCOPE("opus.decode");          // 作用域内的 begin/end
+ *   TRACE_INSTANT("audio.incoming");     // 单点事件
+ *
+ * 导出格式见 scripts/trace_to_chrome.py
+ */
+#if CONFIG_USE_TRACE
+
+#include <cstdint>
+#include <string>
+
+enum TraceEventType : uint8_t {
+    kTraceEventBegin = 'B',
+    kTraceEventEnd = 'E',
+    kTraceEventInstant = 'i',
+};
+
+class Trace {
+public:
+    static void Initialize();
+    static void Record(TraceEventType type, const char* name);
+    static void Clear();
+    // 导出期间暂停记录，导出后清空缓冲区；server 为空时输出到串口
+    static bool Dump(const std::string& server = CONFIG_TRACE_UDP_SERVER);
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name_(name) {
+        Trace::Record(kTraceEventBegin, name_);
+    }
+    ~TraceScope() {
+        Trace::Record(kTraceEventEnd, name_);
+    }
+
+private:
+    const char* name_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_BEGIN(name) Trace::Record(kTraceEventBegin, name)
+#define TRACE_END(name) Trace::Record(kTraceEventEnd, name)
+#define TRACE_INSTANT(name) Trace::Record(kTraceEventInstant, name)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#else
+
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_SCOPE(name) do {} while (0)
+
+#endif // CONFIG_USE_TRACE
+
+#endif // TRACE_H
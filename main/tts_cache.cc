@@ -0,0 +1,380 @@
+#include "tts_cache.h"
+#include "metrics.h"
+
+#include <esp_log.h>
+#include <esp_crc.h>
+#include <esp_timer.h>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "TtsCache"
+
+#define TTS_CACHE_MAGIC 0x31435454  // "TTC1"
+#define TTS_CACHE_MAX_SENTENCE_BYTES (32 * 1024)
+#define TTS_CACHE_MAX_PENDING 8
+// 记住最近出现过的句子，第二次出现时才写入
+#define TTS_CACHE_SEEN_KEYS 128
+// 两次擦除之间让出 CPU，给唤醒词检测等任务追上进度
+#ifndef TTS_CACHE_ERASE_INTERVAL_MS
+#define TTS_CACHE_ERASE_INTERVAL_MS 20
+#endif
+
+struct TtsCacheHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint64_t key;
+    uint32_t payload_size;
+    uint32_t payload_crc;
+    uint16_t sample_rate;
+    uint16_t frame_count;
+    uint8_t frame_duration;
+    uint8_t reserved[3];
+    uint32_t header_crc;    // 覆盖之前的所有字段
+} __attribute__((packed));
+
+static uint32_t RecordSize(uint32_t payload_size) {
+    return (sizeof(TtsCacheHeader) + payload_size + 3) & ~3u;
+}
+
+static uint32_t HeaderCrc(const TtsCacheHeader& header) {
+    return esp_crc32_le(0, (const uint8_t*)&header, offsetof(TtsCacheHeader, header_crc));
+}
+
+uint64_t TtsCache::MakeKey(const std::string& voice, int sample_rate, const std::string& text) {
+    // FNV-1a 64，输入为 "音色\n采样率\n文本" 的 UTF-8 字节
+    std::string input = voice + "\n" + std::to_string(sample_rate) + "\n" + text;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : input) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::string TtsCache::KeyToString(uint64_t key) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)key);
+    return buffer;
+}
+
+bool TtsCache::Initialize() {
+    partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "tts_cache");
+    if (partition_ == nullptr) {
+        ESP_LOGW(TAG, "No tts_cache partition, TTS cache disabled");
+        return false;
+    }
+    xTaskCreate([](void* arg) {
+        auto cache = (TtsCache*)arg;
+        cache->WriterTask();
+        vTaskDelete(NULL);
+    }, "tts_cache", 4096, this, 1, &writer_task_handle_);
+    return true;
+}
+
+void TtsCache::WriterTask() {
+    Scan();
+    ready_ = true;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (writable_) {
+            Record* record;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (pending_.empty()) {
+                    break;
+                }
+                record = &pending_.front();
+            }
+            // 写到一半变为不可写时保留记录，下次空闲时继续
+            if (!WriteRecord(*record)) {
+                break;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.pop_front();
+        }
+    }
+}
+
+/*
+ * 启动后按 4 字节步长查找有效的记录头，序号最大的记录之后就是日志头部。
+ * 记录不会跨过分区末尾，擦除总是从记录头所在的最旧扇区开始，所以不会留下指向已擦除数据的记录头。
+ */
+void TtsCache::Scan() {
+    int64_t start_time = esp_timer_get_time();
+    const uint32_t partition_size = partition_->size;
+    std::vector<uint8_t> window(partition_->erase_size + sizeof(TtsCacheHeader));
+    uint32_t window_start = 0;
+    uint32_t window_size = 0;
+    uint32_t max_sequence = 0;
+    bool found = false;
+    uint32_t head = 0;
+    std::unordered_map<uint64_t, Entry> entries;
+
+    uint32_t pos = 0;
+    while (pos + sizeof(TtsCacheHeader) <= partition_size) {
+        if (pos < window_start || pos + sizeof(TtsCacheHeader) > window_start + window_size) {
+            window_start = pos;
+            window_size = std::min<uint32_t>(window.size(), partition_size - pos);
+            if (esp_partition_read(partition_, window_start, window.data(), window_size) != ESP_OK) {
+                break;
+            }
+        }
+
+        TtsCacheHeader header;
+        memcpy(&header, window.data() + (pos - window_start), sizeof(header));
+        if (header.magic != TTS_CACHE_MAGIC || header.header_crc != HeaderCrc(header) ||
+            header.payload_size > TTS_CACHE_MAX_SENTENCE_BYTES || pos + RecordSize(header.payload_size) > partition_size) {
+            pos += 4;
+            continue;
+        }
+
+        uint32_t size = RecordSize(header.payload_size);
+        auto it = entries.find(header.key);
+        if (it == entries.end() || it->second.sequence < header.sequence) {
+            entries[header.key] = Entry{ pos, size, header.sequence };
+        }
+        if (!found || header.sequence > max_sequence) {
+            found = true;
+            max_sequence = header.sequence;
+            head = pos + size;
+        }
+        pos += size;
+    }
+
+    // 没有找到记录时从头开始，写入前逐个扇区擦除
+    const uint32_t sector_size = partition_->erase_size;
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = std::move(entries);
+    sequence_ = found ? max_sequence + 1 : 0;
+    head_ = head;
+    erased_end_ = found ? (head + sector_size - 1) / sector_size * sector_size : 0;
+    ESP_LOGI(TAG, "%u sentences cached, head at 0x%lx, scan took %lld ms", (unsigned)entries_.size(),
+        (unsigned long)head_, (esp_timer_get_time() - start_time) / 1000);
+}
+
+void TtsCache::EraseSector(uint32_t offset) {
+    static auto erases = Metrics::GetInstance().Counter("tts_cache.erases");
+    const uint32_t sector_size = partition_->erase_size;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            auto& entry = it->second;
+            if (entry.offset < offset + sector_size && entry.offset + entry.size > offset) {
+                it = entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    esp_partition_erase_range(partition_, offset, sector_size);
+    erases->Increment();
+}
+
+bool TtsCache::WriteRecord(const Record& record) {
+    static auto stored = Metrics::GetInstance().Counter("tts_cache.stored");
+    const uint32_t size = RecordSize(record.payload.size());
+    if (head_ + size > partition_->size) {
+        // 记录不跨过分区末尾，回到开头；末尾剩下的旧记录在下一轮擦除
+        std::lock_guard<std::mutex> lock(mutex_);
+        head_ = 0;
+        erased_end_ = 0;
+    }
+
+    while (erased_end_ < head_ + size) {
+        if (!writable_) {
+            return false;
+        }
+        EraseSector(erased_end_);
+        erased_end_ += partition_->erase_size;
+        vTaskDelay(pdMS_TO_TICKS(TTS_CACHE_ERASE_INTERVAL_MS));
+    }
+
+    TtsCacheHeader header = {};
+    header.magic = TTS_CACHE_MAGIC;
+    header.sequence = sequence_;
+    header.key = record.key;
+    header.payload_size = record.payload.size();
+    header.payload_crc = esp_crc32_le(0, record.payload.data(), record.payload.size());
+    header.sample_rate = record.sample_rate;
+    header.frame_count = record.frame_count;
+    header.frame_duration = record.frame_duration;
+    header.header_crc = HeaderCrc(header);
+
+    // 先写数据再写记录头，断电时不会留下有效的记录头
+    uint32_t offset = head_;
+    if (esp_partition_write(partition_, offset + sizeof(header), record.payload.data(), record.payload.size()) != ESP_OK ||
+        esp_partition_write(partition_, offset, &header, sizeof(header)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write record at 0x%lx", (unsigned long)offset);
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[record.key] = Entry{ offset, size, sequence_ };
+        stored->Increment();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequence_++;
+    head_ = offset + size;
+    return true;
+}
+
+static bool ParseFrames(const std::vector<uint8_t>& payload, int sample_rate, int frame_duration, int frame_count,
+    uint32_t timestamp, std::list<AudioStreamPacket>& packets) {
+    std::list<AudioStreamPacket> frames;
+    size_t pos = 0;
+    while (pos < payload.size()) {
+        if (payload.size() - pos < 2) {
+            return false;
+        }
+        size_t frame_size = payload[pos] | (payload[pos + 1] << 8);
+        pos += 2;
+        if (payload.size() - pos < frame_size) {
+            return false;
+        }
+        frames.emplace_back(AudioStreamPacket{
+            .sample_rate = sample_rate,
+            .frame_duration = frame_duration,
+            .timestamp = timestamp,
+            .payload = std::vector<uint8_t>(payload.begin() + pos, payload.begin() + pos + frame_size)
+        });
+        pos += frame_size;
+        timestamp += frame_duration;
+    }
+    if ((int)frames.size() != frame_count) {
+        return false;
+    }
+    packets.splice(packets.end(), frames);
+    return true;
+}
+
+bool TtsCache::Lookup(uint64_t key, uint32_t timestamp, std::list<AudioStreamPacket>& packets) {
+    static auto hits = Metrics::GetInstance().Counter("tts_cache.hits");
+    static auto misses = Metrics::GetInstance().Counter("tts_cache.misses");
+    static auto bytes_saved = Metrics::GetInstance().Counter("tts_cache.bytes_saved");
+    if (!ready_) {
+        misses->Increment();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending = std::find_if(pending_.begin(), pending_.end(), [key](const Record& record) { return record.key == key; });
+    if (pending != pending_.end()) {
+        // 还没写入 flash 的句子直接从内存播放
+        ParseFrames(pending->payload, pending->sample_rate, pending->frame_duration, pending->frame_count, timestamp, packets);
+        hits->Increment();
+        bytes_saved->Increment(pending->payload.size());
+        return true;
+    }
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        misses->Increment();
+        return false;
+    }
+
+    Entry entry = it->second;
+    TtsCacheHeader header;
+    std::vector<uint8_t> payload;
+    bool valid = esp_partition_read(partition_, entry.offset, &header, sizeof(header)) == ESP_OK &&
+        header.magic == TTS_CACHE_MAGIC && header.key == key && header.header_crc == HeaderCrc(header);
+    if (valid) {
+        payload.resize(header.payload_size);
+        valid = esp_partition_read(partition_, entry.offset + sizeof(header), payload.data(), payload.size()) == ESP_OK &&
+            esp_crc32_le(0, payload.data(), payload.size()) == header.payload_crc &&
+            ParseFrames(payload, header.sample_rate, header.frame_duration, header.frame_count, timestamp, packets);
+    }
+    if (!valid) {
+        ESP_LOGW(TAG, "Corrupted record %s, dropped", KeyToString(key).c_str());
+        entries_.erase(it);
+        misses->Increment();
+        return false;
+    }
+
+    // 落在较旧一半的记录重新写到日志头部，避免常用的句子被淘汰
+    uint32_t age = (head_ + partition_->size - entry.offset) % partition_->size;
+    if (age > partition_->size / 2 && pending_.size() < TTS_CACHE_MAX_PENDING) {
+        Record record;
+        record.key = key;
+        record.sample_rate = header.sample_rate;
+        record.frame_duration = header.frame_duration;
+        record.frame_count = header.frame_count;
+        record.payload = std::move(payload);
+        pending_.emplace_back(std::move(record));
+    }
+
+    hits->Increment();
+    bytes_saved->Increment(header.payload_size);
+    return true;
+}
+
+void TtsCache::BeginSentence(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recording_ = false;
+    if (!ready_ || entries_.find(key) != entries_.end() ||
+        std::any_of(pending_.begin(), pending_.end(), [key](const Record& record) { return record.key == key; })) {
+        return;
+    }
+    auto seen = std::find(seen_keys_.begin(), seen_keys_.end(), key);
+    if (seen == seen_keys_.end()) {
+        seen_keys_.push_back(key);
+        if (seen_keys_.size() > TTS_CACHE_SEEN_KEYS) {
+            seen_keys_.pop_front();
+        }
+        return;
+    }
+    seen_keys_.erase(seen);
+    recording_ = true;
+    recording_record_ = Record();
+    recording_record_.key = key;
+}
+
+void TtsCache::AppendFrame(const AudioStreamPacket& packet) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recording_) {
+        return;
+    }
+    auto& record = recording_record_;
+    if (record.payload.size() + 2 + packet.payload.size() > TTS_CACHE_MAX_SENTENCE_BYTES ||
+        (record.frame_count > 0 && (packet.sample_rate != record.sample_rate || packet.frame_duration != record.frame_duration))) {
+        recording_ = false;
+        record.payload = std::vector<uint8_t>();
+        return;
+    }
+    record.sample_rate = packet.sample_rate;
+    record.frame_duration = packet.frame_duration;
+    record.frame_count++;
+    record.payload.push_back(packet.payload.size() & 0xFF);
+    record.payload.push_back(packet.payload.size() >> 8);
+    record.payload.insert(record.payload.end(), packet.payload.begin(), packet.payload.end());
+}
+
+void TtsCache::EndSentence() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!recording_) {
+            return;
+        }
+        recording_ = false;
+        if (recording_record_.frame_count == 0 || pending_.size() >= TTS_CACHE_MAX_PENDING) {
+            recording_record_.payload = std::vector<uint8_t>();
+            return;
+        }
+        pending_.emplace_back(std::move(recording_record_));
+        recording_record_ = Record();
+    }
+    if (writable_) {
+        xTaskNotifyGive(writer_task_handle_);
+    }
+}
+
+void TtsCache::CancelSentence() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recording_ = false;
+    recording_record_.payload = std::vector<uint8_t>();
+}
+
+void TtsCache::SetWritable(bool writable) {
+    writable_ = writable;
+    if (writable && writer_task_handle_ != nullptr) {
+        xTaskNotifyGive(writer_task_handle_);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef TTS_CACHE_H
+#define TTS_CACHE_H
+
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol.h"
+
+/*
+ * 句子级 TTS 缓存。以 (音色, 下行采样率, 文本) 的哈希为键，把一句话收到的 Opus 帧保存到 tts_cache 分区，
+ * 服务端探测到命中时不再下发这句音频，设备直接从 flash 播放。
+ *
+ * 分区按环形日志使用：记录依次追加到日志头部，写入某个扇区前才擦除它，被擦除的总是最旧的扇区，
+ * 各扇区轮流擦除，次数基本一致（回到分区开头时末尾放不下的扇区留到下一轮）。
+ * 命中时如果记录已经落在较旧的一半，会重新写到头部，淘汰顺序接近 LRU。
+ * 同一句话第二次出现时才写入，只出现一次的回答不消耗 flash 寿命；写 flash 只在设备空闲时进行。
+ */
+class TtsCache {
+public:
+    static TtsCache& GetInstance() {
+        static TtsCache instance;
+        return instance;
+    }
+    TtsCache(const TtsCache&) = delete;
+    TtsCache& operator=(const TtsCache&) = delete;
+
+    // 服务端按同样的规则计算，见 docs/websocket.md
+    static uint64_t MakeKey(const std::string& voice, int sample_rate, const std::string& text);
+    static std::string KeyToString(uint64_t key);
+
+    // 找不到 tts_cache 分区时返回 false，缓存保持禁用；索引在写入任务中建立，不占用启动时间
+    bool Initialize();
+
+    // 读出一整句的音频帧，找不到或校验失败时返回 false。
+    // 第一帧的时间戳为 timestamp，之后每帧加上帧时长，服务端 AEC 据此对齐播放时间
+    bool Lookup(uint64_t key, uint32_t timestamp, std::list<AudioStreamPacket>& packets);
+
+    // 按下行消息的顺序调用：sentence_start 时开始录制，之后的音频帧属于这一句，直到下一句或 TTS 结束
+    void BeginSentence(uint64_t key);
+    void AppendFrame(const AudioStreamPacket& packet);
+    void EndSentence();
+    void CancelSentence();
+
+    // 擦写 flash 会短暂阻塞从 flash 执行的任务，只在空闲时允许
+    void SetWritable(bool writable);
+
+private:
+    // 主机测试直接驱动扫描和写入，模拟重启
+    friend class TtsCacheTest;
+
+    struct Entry {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t sequence;
+    };
+
+    struct Record {
+        uint64_t key = 0;
+        int sample_rate = 0;
+        int frame_duration = 0;
+        int frame_count = 0;
+        // |size 2u|opus|size 2u|opus|...
+        std::vector<uint8_t> payload;
+    };
+
+    TtsCache() = default;
+
+    const esp_partition_t* partition_ = nullptr;
+    TaskHandle_t writer_task_handle_ = nullptr;
+    std::atomic<bool> ready_ = false;
+    std::atomic<bool> writable_ = false;
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    uint32_t head_ = 0;
+    // [head_, erased_end_) 已擦除，可以直接写入
+    uint32_t erased_end_ = 0;
+    uint32_t sequence_ = 0;
+    std::list<Record> pending_;
+
+    // 只在网络任务和主任务中访问，由 mutex_ 保护
+    std::deque<uint64_t> seen_keys_;
+    bool recording_ = false;
+    Record recording_record_;
+
+    void WriterTask();
+    void Scan();
+    bool WriteRecord(const Record& record);
+    void EraseSector(uint32_t offset);
+};
+
+#endif // TTS_CACHE_H
@@ -1,54 +1,178 @@
 import socket
+import struct
 import wave
 import argparse
 
 
 '''
-  Create a UDP socket and bind it to the server's IP:8000.
-  Listen for incoming messages and print them to the console.
-  Save the audio to a WAV file.
+  Receive multi-tap audio debug packets from the device (UDP, default 0.0.0.0:8000).
+  Each packet carries tap id, per-tap sequence and a capture timestamp, so lost
+  packets can be detected and every tap can be placed on a common timeline.
+  On exit, one WAV per tap is written plus a time-aligned multi-channel WAV.
+
+  Packet header (little-endian, see main/audio_processing/audio_debugger.h):
+    magic "AD", version, tap, codec, reserved, sample_rate(u16),
+    sequence(u32), timestamp_us(u64), samples(u16), payload_size(u16)
 '''
-def main(samplerate, channels):
+
+HEADER = struct.Struct('<2sBBBBHIQHH')
+TAP_NAMES = ['mic', 'reference', 'afe_output', 'decoded', 'output']
+CODEC_PCM16 = 0
+CODEC_IMA_ADPCM = 1
+
+IMA_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+]
+IMA_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def decode_adpcm(payload, samples):
+    predictor, index = struct.unpack_from('<hB', payload, 0)
+    out = []
+    for byte in payload[4:]:
+        for nibble in (byte & 0x0F, byte >> 4):
+            if len(out) >= samples:
+                break
+            step = IMA_STEP_TABLE[index]
+            delta = step >> 3
+            if nibble & 4:
+                delta += step
+            if nibble & 2:
+                delta += step >> 1
+            if nibble & 1:
+                delta += step >> 2
+            predictor += -delta if nibble & 8 else delta
+            predictor = max(-32768, min(32767, predictor))
+            index = max(0, min(88, index + IMA_INDEX_TABLE[nibble]))
+            out.append(predictor)
+    return out
+
+
+def decode_packet(message):
+    if len(message) < HEADER.size:
+        return None
+    magic, version, tap, codec, _, sample_rate, sequence, timestamp_us, samples, payload_size = \
+        HEADER.unpack_from(message, 0)
+    if magic != b'AD' or version != 1:
+        return None
+    payload = message[HEADER.size:HEADER.size + payload_size]
+    if codec == CODEC_IMA_ADPCM:
+        pcm = decode_adpcm(payload, samples)
+    elif codec == CODEC_PCM16:
+        pcm = list(struct.unpack(f'<{samples}h', payload[:samples * 2]))
+    else:
+        return None
+    return tap, sample_rate, sequence, timestamp_us, pcm
+
+
+class TapStream:
+    def __init__(self, tap):
+        self.tap = tap
+        self.name = TAP_NAMES[tap] if tap < len(TAP_NAMES) else f'tap{tap}'
+        self.sample_rate = 0
+        self.packets = []
+        self.last_sequence = None
+        self.lost = 0
+
+    def add(self, sample_rate, sequence, timestamp_us, pcm):
+        if self.last_sequence is not None and sequence != self.last_sequence + 1:
+            gap = (sequence - self.last_sequence - 1) & 0xFFFFFFFF
+            self.lost += gap
+            print(f"[{self.name}] lost {gap} packets before sequence {sequence}")
+        self.last_sequence = sequence
+        self.sample_rate = sample_rate
+        self.packets.append((timestamp_us, pcm))
+
+    def render(self, start_us, end_us, sample_rate):
+        # 按时间戳放到公共时间轴上，丢包处补零；采样率不同时线性插值
+        length = int((end_us - start_us) * sample_rate / 1000000)
+        out = [0] * length
+        ratio = self.sample_rate / sample_rate
+        for timestamp_us, pcm in self.packets:
+            position = int(round((timestamp_us - start_us) * sample_rate / 1000000))
+            count = int(len(pcm) / ratio)
+            for i in range(count):
+                j = position + i
+                if j < 0 or j >= length:
+                    continue
+                src = i * ratio
+                k = int(src)
+                frac = src - k
+                a = pcm[k]
+                b = pcm[k + 1] if k + 1 < len(pcm) else a
+                out[j] = int(a + (b - a) * frac)
+        return out
+
+
+def write_wav(filename, channels, sample_rate, frames):
+    with wave.open(filename, 'wb') as wav_file:
+        wav_file.setnchannels(len(channels))
+        wav_file.setsampwidth(2)
+        wav_file.setframerate(sample_rate)
+        interleaved = [sample for frame in zip(*channels) for sample in frame]
+        wav_file.writeframes(struct.pack(f'<{len(interleaved)}h', *interleaved))
+    print(f"WAV file '{filename}' saved, {len(channels)} channels, {frames} frames")
+
+
+def save(streams, samplerate, prefix):
+    streams = [s for s in sorted(streams.values(), key=lambda s: s.tap) if s.packets]
+    if not streams:
+        print("No audio received")
+        return
+    start_us = min(s.packets[0][0] for s in streams)
+    end_us = max(ts + len(pcm) * 1000000 // s.sample_rate for s in streams for ts, pcm in s.packets)
+
+    for stream in streams:
+        pcm = stream.render(start_us, end_us, stream.sample_rate)
+        write_wav(f"{prefix}_{stream.name}.wav", [pcm], stream.sample_rate, len(pcm))
+        print(f"  [{stream.name}] {stream.sample_rate} Hz, {len(stream.packets)} packets, {stream.lost} lost")
+
+    channels = [s.render(start_us, end_us, samplerate) for s in streams]
+    names = '+'.join(s.name for s in streams)
+    write_wav(f"{prefix}_aligned.wav", channels, samplerate, len(channels[0]))
+    print(f"  aligned channel order: {names}")
+
+
+def main(port, samplerate, prefix):
     # Create a UDP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    server_socket.bind(('0.0.0.0', 8000))
-
-    # Create WAV file with parameters
-    filename = f"{samplerate}_{channels}.wav"
-    wav_file = wave.open(filename, "wb")
-    wav_file.setnchannels(channels)     # channels parameter
-    wav_file.setsampwidth(2)            # 2 bytes per sample (16-bit)
-    wav_file.setframerate(samplerate)   # samplerate parameter
+    server_socket.bind(('0.0.0.0', port))
+    streams = {}
 
-    print(f"Start saving audio from 0.0.0.0:8000 to {filename}...")
+    print(f"Start receiving audio debug data on 0.0.0.0:{port}, press Ctrl+C to save...")
 
     try:
         while True:
-            # Receive a message from the client
-            message, address = server_socket.recvfrom(8000)
-            
-            # Write PCM data to WAV file
-            wav_file.writeframes(message)
-
-            # Print length of the message
-            print(f"Received {len(message)} bytes from {address}")
-    
+            message, address = server_socket.recvfrom(8192)
+            packet = decode_packet(message)
+            if packet is None:
+                print(f"Ignored invalid packet of {len(message)} bytes from {address}")
+                continue
+            tap, sample_rate, sequence, timestamp_us, pcm = packet
+            stream = streams.setdefault(tap, TapStream(tap))
+            stream.add(sample_rate, sequence, timestamp_us, pcm)
+
     except KeyboardInterrupt:
         print("\nStopping recording...")
-    
+
     finally:
-        # Close files and socket
-        wav_file.close()
         server_socket.close()
-        print(f"WAV file '{filename}' saved successfully")
+        save(streams, samplerate, prefix)
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='UDP音频数据接收器，保存为WAV文件')
-    parser.add_argument('--samplerate', '-s', type=int, default=16000, 
-                        help='采样率 (默认: 16000)')
-    parser.add_argument('--channels', '-c', type=int, default=2, 
-                        help='声道数 (默认: 2)')
-    
+    parser = argparse.ArgumentParser(description='UDP多抓取点音频调试数据接收器，按时间戳对齐后保存为WAV文件')
+    parser.add_argument('--port', '-p', type=int, default=8000,
+                        help='UDP监听端口 (默认: 8000)')
+    parser.add_argument('--samplerate', '-s', type=int, default=16000,
+                        help='对齐后多声道WAV的采样率 (默认: 16000)')
+    parser.add_argument('--output', '-o', type=str, default='audio_debug',
+                        help='输出文件名前缀 (默认: audio_debug)')
+
     args = parser.parse_args()
-    main(args.samplerate, args.channels)
+    main(args.port, args.samplerate, args.output)
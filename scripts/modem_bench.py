@@ -0,0 +1,276 @@
+import argparse
+import os
+import socket
+import statistics
+import struct
+import threading
+import time
+import tty
+
+
+'''
+  Compare the two ML307 data paths for UDP audio on a Linux host:
+    at   every datagram is an AT+MIPSEND command with a hex payload, and the
+         device waits for OK before sending the next one; downlink datagrams
+         arrive as +MIPURC lines (CONFIG_USE_ML307_PPP disabled)
+    ppp  datagrams are IPv4/UDP packets in HDLC frames, with no per-packet
+         command round trip (CONFIG_USE_ML307_PPP enabled)
+  The modem side runs on a pty and paces every byte at the UART baud rate
+  (10 bits per byte). It relays payloads to a local UDP echo server.
+  LCP/IPCP negotiation is not simulated. Only the data path after dialing
+  is measured.
+
+  Both sides of the link are modelled here, so the numbers show what the
+  protocol overhead costs at a given baud rate. They do not test the
+  firmware: on the device the HDLC framing is done by lwIP's PPPoS.
+
+  Usage: python3 scripts/modem_bench.py [--baud 921600] [--size 120] [--count 300]
+'''
+
+FLAG, ESCAPE = 0x7E, 0x7D
+DEVICE_IP, SERVER_IP = '10.0.0.2', '10.0.0.1'
+
+
+def fcs16(data):
+    fcs = 0xFFFF
+    for byte in data:
+        fcs ^= byte
+        for _ in range(8):
+            fcs = (fcs >> 1) ^ 0x8408 if fcs & 1 else fcs >> 1
+    return fcs ^ 0xFFFF
+
+
+def hdlc_encode(protocol, payload):
+    # Address/control and protocol field compression are negotiated by default
+    body = bytes([protocol]) + payload
+    body += struct.pack('<H', fcs16(body))
+    out = bytearray([FLAG])
+    for byte in body:
+        # ACCM is 0 after LCP, so only the flag and escape bytes are escaped
+        if byte in (FLAG, ESCAPE):
+            out += bytes([ESCAPE, byte ^ 0x20])
+        else:
+            out.append(byte)
+    out.append(FLAG)
+    return bytes(out)
+
+
+class HdlcDecoder:
+    def __init__(self):
+        self.frame = bytearray()
+        self.escaped = False
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if byte == FLAG:
+                if len(self.frame) > 3 and fcs16(self.frame[:-2]) == struct.unpack('<H', self.frame[-2:])[0]:
+                    frames.append(bytes(self.frame[:-2]))
+                self.frame.clear()
+            elif byte == ESCAPE:
+                self.escaped = True
+            else:
+                self.frame.append(byte ^ 0x20 if self.escaped else byte)
+                self.escaped = False
+        return frames
+
+
+def checksum(data):
+    if len(data) % 2:
+        data += b'\0'
+    total = sum(struct.unpack('!%dH' % (len(data) // 2), data))
+    total = (total >> 16) + (total & 0xFFFF)
+    return ~(total + (total >> 16)) & 0xFFFF
+
+
+def ipv4_udp(src, dst, port, payload):
+    udp = struct.pack('!HHHH', port, port, 8 + len(payload), 0) + payload
+    header = struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), 0, 0, 64, 17, 0,
+                         socket.inet_aton(src), socket.inet_aton(dst))
+    header = header[:10] + struct.pack('!H', checksum(header)) + header[12:]
+    return header + udp
+
+
+class PacedPort:
+    # Both directions of the simulated UART take len * 10 / baud seconds per write
+    def __init__(self, fd, baud):
+        self.fd = fd
+        self.byte_time = 10.0 / baud
+        self.lock = threading.Lock()
+        self.bytes_written = 0
+
+    def write(self, data):
+        with self.lock:
+            time.sleep(len(data) * self.byte_time)
+            os.write(self.fd, data)
+            self.bytes_written += len(data)
+
+    def read(self):
+        data = os.read(self.fd, 4096)
+        # The modem only sees the bytes after they crossed the wire
+        time.sleep(len(data) * self.byte_time)
+        return data
+
+
+class ModemSimulator(threading.Thread):
+    def __init__(self, mode, port, server):
+        super().__init__(daemon=True)
+        self.mode = mode
+        self.port = port
+        self.server = server
+        self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.udp.connect(server)
+        threading.Thread(target=self.downlink, daemon=True).start()
+
+    def run(self):
+        if self.mode == 'ppp':
+            decoder = HdlcDecoder()
+            while True:
+                for frame in decoder.feed(self.port.read()):
+                    if frame[0] == 0x21:  # IPv4
+                        self.udp.send(frame[1 + 28:])
+            return
+        buffer = b''
+        while True:
+            buffer += self.port.read()
+            while b'\r\n' in buffer:
+                line, buffer = buffer.split(b'\r\n', 1)
+                self.command(line.decode())
+
+    def command(self, line):
+        if line.startswith('AT+MIPSEND='):
+            _, length, payload = line[11:].split(',', 2)
+            self.udp.send(bytes.fromhex(payload))
+            self.port.write(b'\r\n+MIPSEND: 0,%d\r\n\r\nOK\r\n' % int(length))
+        elif line.startswith('AT'):
+            self.port.write(b'\r\nOK\r\n')
+
+    def downlink(self):
+        while True:
+            payload = self.udp.recv(2048)
+            if self.mode == 'ppp':
+                packet = ipv4_udp(SERVER_IP, DEVICE_IP, self.server[1], payload)
+                self.port.write(hdlc_encode(0x21, packet))
+            else:
+                self.port.write(b'+MIPURC: "rudp",0,%d,%s\r\n' % (len(payload), payload.hex().encode()))
+
+
+class Device:
+    # Host-side stand-in for the firmware's view of the UART
+    def __init__(self, mode, fd, server_port):
+        self.mode = mode
+        self.fd = fd
+        self.server_port = server_port
+        self.received = []
+        self.ok = threading.Semaphore(0)
+        self.cond = threading.Condition()
+        self.bytes_written = 0
+        threading.Thread(target=self.reader, daemon=True).start()
+
+    def send(self, payload):
+        if self.mode == 'ppp':
+            data = hdlc_encode(0x21, ipv4_udp(DEVICE_IP, SERVER_IP, self.server_port, payload))
+        else:
+            data = b'AT+MIPSEND=0,%d,%s\r\n' % (len(payload), payload.hex().encode())
+        os.write(self.fd, data)
+        self.bytes_written += len(data)
+        if self.mode == 'at':
+            # Each AT command waits for its response before the next one
+            self.ok.acquire()
+
+    def reader(self):
+        decoder = HdlcDecoder()
+        buffer = b''
+        while True:
+            data = os.read(self.fd, 4096)
+            if self.mode == 'ppp':
+                payloads = [frame[1 + 28:] for frame in decoder.feed(data) if frame[0] == 0x21]
+            else:
+                payloads = []
+                buffer += data
+                while b'\r\n' in buffer:
+                    line, buffer = buffer.split(b'\r\n', 1)
+                    if line == b'OK':
+                        self.ok.release()
+                    elif line.startswith(b'+MIPURC:'):
+                        payloads.append(bytes.fromhex(line.split(b',', 3)[3].decode()))
+            if payloads:
+                with self.cond:
+                    self.received.extend((time.monotonic(), p) for p in payloads)
+                    self.cond.notify_all()
+
+    def wait_for(self, count, timeout=10):
+        with self.cond:
+            return self.cond.wait_for(lambda: len(self.received) >= count, timeout)
+
+
+def echo_server():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('127.0.0.1', 0))
+
+    def loop():
+        while True:
+            data, address = sock.recvfrom(2048)
+            sock.sendto(data, address)
+    threading.Thread(target=loop, daemon=True).start()
+    return sock.getsockname()
+
+
+def run(mode, baud, size, count):
+    server = echo_server()
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    port = PacedPort(master, baud)
+    ModemSimulator(mode, port, server).start()
+    device = Device(mode, slave, server[1])
+
+    # Latency: one datagram at a time, like a 60 ms Opus frame on an idle link
+    rtts = []
+    complete = True
+    for i in range(count):
+        payload = struct.pack('!I', i) + os.urandom(size - 4)
+        start = time.monotonic()
+        device.send(payload)
+        complete = device.wait_for(i + 1) and complete
+        rtts.append((device.received[-1][0] - start) * 1000)
+    uplink_bytes = device.bytes_written / count
+    downlink_bytes = port.bytes_written / count
+
+    # Throughput: send back to back and count echoes
+    device.received.clear()
+    start = time.monotonic()
+    for i in range(count):
+        device.send(struct.pack('!I', i) + os.urandom(size - 4))
+    complete = device.wait_for(count) and complete
+    elapsed = time.monotonic() - start
+    rtts.sort()
+    return {
+        'mode': mode,
+        'up': uplink_bytes,
+        'down': downlink_bytes,
+        'median': statistics.median(rtts),
+        'p95': rtts[int(len(rtts) * 0.95) - 1],
+        'pps': len(device.received) / elapsed,
+        'complete': complete,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark ML307 AT socket vs PPP data paths on a pty')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--size', type=int, default=120, help='UDP payload size, bytes')
+    parser.add_argument('--count', type=int, default=300)
+    args = parser.parse_args()
+
+    print('baud %d, payload %d bytes, %d packets' % (args.baud, args.size, args.count))
+    print('%-4s %12s %12s %10s %10s %10s' % ('mode', 'uplink B/pkt', 'dnlink B/pkt', 'median ms', 'p95 ms', 'pkt/s'))
+    for mode in ('at', 'ppp'):
+        r = run(mode, args.baud, args.size, args.count)
+        print('%-4s %12.0f %12.0f %10.2f %10.2f %10.0f' % (r['mode'], r['up'], r['down'], r['median'], r['p95'], r['pps']))
+        if not r['complete']:
+            print('     some echoes were lost, the figures above cover the received ones')
+
+
+if __name__ == '__main__':
+    main()
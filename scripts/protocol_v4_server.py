@@ -0,0 +1,553 @@
+import argparse
+import base64
+import hashlib
+import json
+import socket
+import struct
+import threading
+import time
+import uuid
+
+
+'''
+  Reference stand-in server for WebSocket binary protocol v4
+  (main/protocols/binary_protocol4.h). Standard library only.
+
+  Server mode echoes every utterance back as TTS: the Opus frames recorded
+  between "listen start" and "listen stop" are returned in real time,
+  --bundle frames per WebSocket message. In auto mode there is no VAD, so
+  listening stops after --listen-seconds. Clients asking for a version
+  below 4 get a v1 hello and raw Opus frames, which also exercises the
+  device's fallback path.
+
+  Bench mode prints bytes on the wire for v1/v2/v3/v4 control and audio
+  messages, WebSocket framing included, and the per-message parse cost of
+  JSON text against CBOR in host Python. The parse numbers compare the C
+  json module with the pure Python CBOR decoder below, so they only bound
+  the host side. The device-side encode cost is measured by
+  tests/host/binary_protocol4_test.cc.
+
+  Usage:
+    python3 scripts/protocol_v4_server.py [--port 8000] [--bundle 3]
+    python3 scripts/protocol_v4_server.py --bench [--opus-size 100]
+'''
+
+# Must match kCborKeys in binary_protocol4.cc; append only
+CBOR_KEYS = [
+    'type', 'session_id', 'state', 'mode', 'text', 'reason', 'emotion', 'payload',
+    'version', 'transport', 'features', 'audio_params', 'format', 'sample_rate', 'channels', 'frame_duration',
+    'descriptors', 'states', 'jsonrpc', 'method', 'params', 'id', 'result', 'name',
+    'arguments', 'error', 'code', 'message', 'voice', 'cache', 'key', 'hit',
+]
+CBOR_KEY_INDEX = {key: i for i, key in enumerate(CBOR_KEYS)}
+
+FRAME_AUDIO, FRAME_CONTROL = 0, 1
+WS_GUID = '258EAFA5-E914-47DA-95CA-C5AB0DC85B11'
+OP_TEXT, OP_BINARY, OP_CLOSE, OP_PING, OP_PONG = 0x1, 0x2, 0x8, 0x9, 0xA
+
+
+def write_varint(out, value):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while shift < 35:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+    raise ValueError('varint too long')
+
+
+def zigzag(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def cbor_head(out, major, value):
+    major <<= 5
+    if value < 24:
+        out.append(major | value)
+    elif value <= 0xFF:
+        out += bytes([major | 24, value])
+    elif value <= 0xFFFF:
+        out.append(major | 25)
+        out += struct.pack('>H', value)
+    elif value <= 0xFFFFFFFF:
+        out.append(major | 26)
+        out += struct.pack('>I', value)
+    else:
+        out.append(major | 27)
+        out += struct.pack('>Q', value)
+
+
+def cbor_encode(item, out):
+    if isinstance(item, dict):
+        cbor_head(out, 5, len(item))
+        for key, value in item.items():
+            if key in CBOR_KEY_INDEX:
+                cbor_head(out, 0, CBOR_KEY_INDEX[key])
+            else:
+                cbor_encode(key, out)
+            cbor_encode(value, out)
+    elif isinstance(item, list):
+        cbor_head(out, 4, len(item))
+        for value in item:
+            cbor_encode(value, out)
+    elif isinstance(item, str):
+        data = item.encode()
+        cbor_head(out, 3, len(data))
+        out += data
+    elif item is True:
+        out.append(0xF5)
+    elif item is False:
+        out.append(0xF4)
+    elif item is None:
+        out.append(0xF6)
+    elif isinstance(item, float) and not item.is_integer():
+        packed = struct.pack('>f', item)
+        if struct.unpack('>f', packed)[0] == item:
+            out.append(0xFA)
+            out += packed
+        else:
+            out.append(0xFB)
+            out += struct.pack('>d', item)
+    else:
+        value = int(item)
+        if value >= 0:
+            cbor_head(out, 0, value)
+        else:
+            cbor_head(out, 1, -1 - value)
+    return out
+
+
+def cbor_decode(data, pos=0, depth=0):
+    if depth > 16:
+        raise ValueError('CBOR nesting too deep')
+    initial = data[pos]
+    pos += 1
+    major, info = initial >> 5, initial & 0x1F
+    if info < 24:
+        value = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        value = int.from_bytes(data[pos:pos + size], 'big')
+        if pos + size > len(data):
+            raise ValueError('truncated')
+        pos += size
+    else:
+        raise ValueError('indefinite length is not supported')
+
+    if major == 0:
+        return value, pos
+    if major == 1:
+        return -1 - value, pos
+    if major in (2, 3):
+        if pos + value > len(data):
+            raise ValueError('truncated')
+        text = data[pos:pos + value].decode()
+        return text, pos + value
+    if major == 4:
+        items = []
+        for _ in range(value):
+            item, pos = cbor_decode(data, pos, depth + 1)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        items = {}
+        for _ in range(value):
+            key, pos = cbor_decode(data, pos, depth + 1)
+            if isinstance(key, int):
+                key = CBOR_KEYS[key]
+            items[key], pos = cbor_decode(data, pos, depth + 1)
+        return items, pos
+    if major == 7:
+        if info == 20:
+            return False, pos
+        if info == 21:
+            return True, pos
+        if info in (22, 23):
+            return None, pos
+        if info == 25:
+            return struct.unpack('>e', value.to_bytes(2, 'big'))[0], pos
+        if info == 26:
+            return struct.unpack('>f', value.to_bytes(4, 'big'))[0], pos
+        if info == 27:
+            return struct.unpack('>d', value.to_bytes(8, 'big'))[0], pos
+    raise ValueError('unsupported CBOR item 0x%02x' % initial)
+
+
+def encode_audio(sequence, previous, frames):
+    '''frames: list of (timestamp, opus). previous is the timestamp of the last frame sent
+    in this direction (0 after connecting); returns (message, new previous).'''
+    out = bytearray([FRAME_AUDIO])
+    write_varint(out, sequence)
+    write_varint(out, len(frames))
+    for timestamp, opus in frames:
+        delta = (timestamp - previous + 0x80000000) % 0x100000000 - 0x80000000
+        write_varint(out, zigzag(delta))
+        previous = timestamp
+        write_varint(out, len(opus))
+        out += opus
+    return bytes(out), previous
+
+
+def encode_control(sequence, message):
+    out = bytearray([FRAME_CONTROL])
+    write_varint(out, sequence)
+    return bytes(cbor_encode(message, out))
+
+
+def decode(data, previous=0):
+    '''Returns (type, sequence, body, previous), body is a message dict or a list of
+    (timestamp, opus). previous is the timestamp of the last audio frame received in this
+    direction; it is returned unchanged for control messages.'''
+    frame_type = data[0]
+    sequence, pos = read_varint(data, 1)
+    if frame_type == FRAME_CONTROL:
+        message, pos = cbor_decode(data, pos)
+        if pos != len(data):
+            raise ValueError('trailing bytes after control message')
+        return frame_type, sequence, message, previous
+    if frame_type != FRAME_AUDIO:
+        raise ValueError('unknown frame type %d' % frame_type)
+    count, pos = read_varint(data, pos)
+    frames = []
+    timestamp = previous
+    for _ in range(count):
+        value, pos = read_varint(data, pos)
+        timestamp = (timestamp + unzigzag(value)) & 0xFFFFFFFF
+        size, pos = read_varint(data, pos)
+        if pos + size > len(data):
+            raise ValueError('truncated')
+        frames.append((timestamp, data[pos:pos + size]))
+        pos += size
+    if pos != len(data):
+        raise ValueError('trailing bytes after audio message')
+    return frame_type, sequence, frames, timestamp
+
+
+class WebSocketConnection:
+    def __init__(self, sock):
+        self.sock = sock
+        self.reader = sock.makefile('rb')
+        self.lock = threading.Lock()
+        self.headers = {}
+
+    def handshake(self):
+        request = b''
+        while not request.endswith(b'\r\n\r\n'):
+            line = self.reader.readline()
+            if not line:
+                return False
+            request += line
+        for line in request.decode().split('\r\n')[1:]:
+            if ':' in line:
+                name, value = line.split(':', 1)
+                self.headers[name.strip().lower()] = value.strip()
+        key = self.headers.get('sec-websocket-key')
+        if key is None:
+            return False
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        self.sock.sendall(('HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n'
+                           'Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n' % accept).encode())
+        return True
+
+    def read_exact(self, size):
+        data = self.reader.read(size)
+        if len(data) < size:
+            raise ConnectionError('closed')
+        return data
+
+    def receive(self):
+        '''Returns (opcode, payload) of the next data message, or (None, None) on close.'''
+        message, message_opcode = b'', None
+        while True:
+            first, second = self.read_exact(2)
+            fin, opcode, length = first & 0x80, first & 0x0F, second & 0x7F
+            if length == 126:
+                length = struct.unpack('>H', self.read_exact(2))[0]
+            elif length == 127:
+                length = struct.unpack('>Q', self.read_exact(8))[0]
+            mask = self.read_exact(4) if second & 0x80 else None
+            payload = self.read_exact(length)
+            if mask:
+                payload = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+            if opcode == OP_CLOSE:
+                return None, None
+            if opcode == OP_PING:
+                self.send(OP_PONG, payload)
+                continue
+            if opcode == OP_PONG:
+                continue
+            if opcode != 0:
+                message_opcode = opcode
+            message += payload
+            if fin:
+                return message_opcode, message
+
+    def send(self, opcode, payload):
+        header = bytearray([0x80 | opcode])
+        if len(payload) < 126:
+            header.append(len(payload))
+        elif len(payload) < 0x10000:
+            header += struct.pack('>BH', 126, len(payload))
+        else:
+            header += struct.pack('>BQ', 127, len(payload))
+        with self.lock:
+            self.sock.sendall(bytes(header) + payload)
+
+
+class Session:
+    def __init__(self, conn, args):
+        self.conn = conn
+        self.args = args
+        self.version = 1
+        self.session_id = str(uuid.uuid4())
+        self.tx_sequence = 0
+        self.rx_sequence = 0
+        self.tx_timestamp = 0
+        self.rx_timestamp = 0
+        self.recording = []
+        self.listening = False
+        self.listen_timer = None
+        self.speaking = threading.Event()
+
+    def log(self, *values):
+        if not getattr(self.args, 'quiet', False):
+            print(*values)
+
+    def send_json(self, message):
+        message.setdefault('session_id', self.session_id)
+        if self.version == 4:
+            self.conn.send(OP_BINARY, encode_control(self.tx_sequence, message))
+            self.tx_sequence += 1
+        else:
+            self.conn.send(OP_TEXT, json.dumps(message).encode())
+
+    def send_opus(self, frames):
+        if self.version == 4:
+            message, self.tx_timestamp = encode_audio(self.tx_sequence, self.tx_timestamp, frames)
+            self.conn.send(OP_BINARY, message)
+            self.tx_sequence += len(frames)
+        else:
+            for _, opus in frames:
+                self.conn.send(OP_BINARY, opus)
+
+    def run(self):
+        while True:
+            opcode, payload = self.conn.receive()
+            if opcode is None:
+                return
+            if opcode == OP_TEXT:
+                self.on_message(json.loads(payload))
+            elif self.version == 4:
+                frame_type, sequence, body, self.rx_timestamp = decode(payload, self.rx_timestamp)
+                if sequence != self.rx_sequence:
+                    self.log('sequence gap: expected %d, got %d' % (self.rx_sequence, sequence))
+                if frame_type == FRAME_CONTROL:
+                    self.rx_sequence = sequence + 1
+                    self.on_message(body)
+                else:
+                    self.rx_sequence = sequence + len(body)
+                    self.on_audio(body)
+            else:
+                self.on_audio([(0, payload)])
+
+    def on_message(self, message):
+        self.log('<', json.dumps(message, ensure_ascii=False)[:200])
+        kind = message.get('type')
+        if kind == 'hello':
+            requested = int(self.conn.headers.get('protocol-version', message.get('version', 1)))
+            hello = {
+                'type': 'hello',
+                'transport': 'websocket',
+                'version': 4 if requested >= 4 else 1,
+                'session_id': self.session_id,
+                'audio_params': {'format': 'opus', 'sample_rate': 16000, 'channels': 1,
+                                 'frame_duration': message.get('audio_params', {}).get('frame_duration', 60)},
+            }
+            features = self.server_features(message.get('features', {}))
+            if features:
+                hello['features'] = features
+            # The hello reply is always a text frame
+            self.conn.send(OP_TEXT, json.dumps(hello).encode())
+            self.version = hello['version']
+            self.log('session %s, protocol v%d' % (self.session_id, self.version))
+        elif kind == 'listen' and message.get('state') == 'start':
+            self.speaking.clear()
+            self.recording = []
+            self.listening = True
+            if message.get('mode') == 'auto':
+                self.listen_timer = threading.Timer(self.args.listen_seconds, self.stop_listening)
+                self.listen_timer.start()
+        elif kind == 'listen' and message.get('state') == 'stop':
+            self.stop_listening()
+        elif kind == 'abort':
+            self.speaking.clear()
+
+    def server_features(self, device_features):
+        '''Features to confirm in the server hello; subclasses extend this.'''
+        return {}
+
+    def on_audio(self, frames):
+        if self.listening:
+            self.recording.extend(opus for _, opus in frames)
+
+    def stop_listening(self):
+        if not self.listening:
+            return
+        self.listening = False
+        if self.listen_timer:
+            self.listen_timer.cancel()
+        frames, self.recording = self.recording, []
+        self.log('recorded %d frames' % len(frames))
+        threading.Thread(target=self.speak, args=(frames,), daemon=True).start()
+
+    def speak(self, frames):
+        self.speaking.set()
+        self.send_json({'type': 'stt', 'text': '(echo %d frames)' % len(frames)})
+        self.send_json({'type': 'llm', 'emotion': 'happy', 'text': '😀'})
+        self.send_json({'type': 'tts', 'state': 'start'})
+        self.send_json({'type': 'tts', 'state': 'sentence_start', 'text': 'echo'})
+        frame_seconds = self.args.frame_duration / 1000.0
+        start = time.monotonic()
+        for i in range(0, len(frames), self.args.bundle):
+            if not self.speaking.is_set():
+                break
+            bundle = [((i + j) * self.args.frame_duration, opus) for j, opus in enumerate(frames[i:i + self.args.bundle])]
+            # Stay one bundle ahead of playback
+            delay = start + (i - self.args.bundle) * frame_seconds - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            self.send_opus(bundle)
+        self.send_json({'type': 'tts', 'state': 'stop'})
+
+
+def serve(args, session_class=Session):
+    log = (lambda *values: None) if getattr(args, 'quiet', False) else print
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(('0.0.0.0', args.port))
+    server.listen()
+    log('listening on ws://0.0.0.0:%d/' % args.port)
+
+    def handle(sock, address):
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        conn = WebSocketConnection(sock)
+        try:
+            if conn.handshake():
+                log('connected', address, 'Protocol-Version', conn.headers.get('protocol-version'))
+                session_class(conn, args).run()
+        except (ConnectionError, OSError, ValueError) as e:
+            log('connection error:', e)
+        finally:
+            sock.close()
+            log('disconnected', address)
+
+    while True:
+        sock, address = server.accept()
+        threading.Thread(target=handle, args=(sock, address), daemon=True).start()
+
+
+def ws_overhead(size, masked):
+    # Client to server frames carry a 4-byte mask
+    header = 2 if size < 126 else 4 if size < 0x10000 else 10
+    return header + (4 if masked else 0)
+
+
+BENCH_MESSAGES = [
+    ('up', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'listen', 'state': 'start', 'mode': 'auto'}),
+    ('up', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'listen', 'state': 'stop'}),
+    ('up', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'listen', 'state': 'detect', 'text': '你好小智'}),
+    ('up', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'abort', 'reason': 'wake_word_detected'}),
+    ('up', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'mcp', 'payload': {
+        'jsonrpc': '2.0', 'id': 1, 'result': {'content': [{'type': 'text', 'text': 'true'}], 'isError': False}}}),
+    ('down', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'stt', 'text': '今天天气怎么样'}),
+    ('down', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'llm', 'emotion': 'happy', 'text': '😀'}),
+    ('down', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'tts', 'state': 'start'}),
+    ('down', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'tts', 'state': 'sentence_start',
+              'text': '今天北京晴，最高气温二十三度。'}),
+    ('down', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'tts', 'state': 'stop'}),
+    ('down', {'session_id': 'b8f5c3a2-6e1d-4f7a-9c0b-2d3e4f5a6b7c', 'type': 'mcp', 'payload': {
+        'jsonrpc': '2.0', 'method': 'tools/call', 'id': 1,
+        'params': {'name': 'self.light.set_rgb', 'arguments': {'r': 255, 'g': 0, 'b': 0}}}}),
+]
+
+
+def time_per_call(function, argument, repeat):
+    start = time.perf_counter()
+    for _ in range(repeat):
+        function(argument)
+    return (time.perf_counter() - start) / repeat * 1e6
+
+
+def bench(args):
+    print('Control messages (bytes on the wire include WebSocket framing)')
+    print('%-4s %-24s %6s %6s %8s %8s' % ('dir', 'message', 'json', 'v4', 'json us', 'cbor us'))
+    totals = [0, 0, 0.0, 0.0]
+    for direction, message in BENCH_MESSAGES:
+        masked = direction == 'up'
+        text = json.dumps(message, ensure_ascii=False, separators=(',', ':')).encode()
+        binary = encode_control(1000, message)
+        assert decode(binary)[2] == message
+        json_bytes = len(text) + ws_overhead(len(text), masked)
+        v4_bytes = len(binary) + ws_overhead(len(binary), masked)
+        json_us = time_per_call(json.loads, text, args.repeat)
+        cbor_us = time_per_call(decode, binary, args.repeat)
+        name = message['type'] + ('.' + message['state'] if 'state' in message else '')
+        print('%-4s %-24s %6d %6d %8.2f %8.2f' % (direction, name, json_bytes, v4_bytes, json_us, cbor_us))
+        totals = [totals[0] + json_bytes, totals[1] + v4_bytes, totals[2] + json_us, totals[3] + cbor_us]
+    print('%-29s %6d %6d %8.2f %8.2f' % ('total', *totals))
+    print('Parse times are host Python: C json module vs pure Python CBOR, not device numbers.')
+
+    print()
+    size = args.opus_size
+    print('Audio, %d-byte Opus frames of %d ms, uplink (masked), bytes per frame' % (size, args.frame_duration))
+    print('%-8s %8s %8s %10s' % ('version', 'bundle', 'B/frame', 'overhead'))
+    opus = bytes(size)
+    for version, header in (('v1', 0), ('v2', 16), ('v3', 4)):
+        per_frame = size + header + ws_overhead(size + header, True)
+        print('%-8s %8d %8.1f %9.1f%%' % (version, 1, per_frame, (per_frame - size) * 100.0 / size))
+    for bundle in (1, 2, 3, 5, 10):
+        # Sequence and timestamp an hour into the session, following the previous message
+        base = 3600 * 1000 // args.frame_duration
+        frames = [((base + i) * args.frame_duration, opus) for i in range(bundle)]
+        message, _ = encode_audio(base, (base - 1) * args.frame_duration, frames)
+        per_frame = (len(message) + ws_overhead(len(message), True)) / bundle
+        print('%-8s %8d %8.1f %9.1f%%' % ('v4', bundle, per_frame, (per_frame - size) * 100.0 / size))
+    previous = (base - 1) * args.frame_duration
+    message, _ = encode_audio(base, previous, [(base * args.frame_duration, opus)] * 3)
+    v2 = struct.pack('>HHIII', 2, 0, 0, 0, size) + opus
+    v2_us = time_per_call(lambda data: struct.unpack_from('>HHIII', data), v2, args.repeat)
+    v4_us = time_per_call(lambda data: decode(data, previous), message, args.repeat)
+    print('parse: v2 header %.2f us/frame, v4 %.2f us/message of 3 frames (host Python)' % (v2_us, v4_us))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stand-in server and benchmark for WebSocket protocol v4')
+    parser.add_argument('--port', type=int, default=8000)
+    parser.add_argument('--bundle', type=int, default=3, help='Opus frames per downlink message')
+    parser.add_argument('--frame-duration', type=int, default=60, help='Opus frame duration, ms')
+    parser.add_argument('--listen-seconds', type=float, default=4, help='Recording length in auto mode')
+    parser.add_argument('--bench', action='store_true', help='Print wire size and parse cost, then exit')
+    parser.add_argument('--opus-size', type=int, default=100, help='Opus frame size for --bench, bytes')
+    parser.add_argument('--repeat', type=int, default=20000, help='Parse iterations for --bench')
+    args = parser.parse_args()
+    if args.bench:
+        bench(args)
+    else:
+        serve(args)
+
+
+if __name__ == '__main__':
+    main()
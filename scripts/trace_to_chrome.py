@@ -0,0 +1,110 @@
+import argparse
+import json
+import socket
+import sys
+
+
+'''
+  Convert trace dumps from the device (CONFIG_USE_TRACE) into Chrome trace JSON.
+  Each event line looks like:
+      TRACE <timestamp_us> <B|E|i> <core> <task> <name>
+  Lines may come from a saved serial log (other log lines are ignored)
+  or be received over UDP when CONFIG_TRACE_UDP_SERVER is set.
+  Open the output in chrome://tracing or https://ui.perfetto.dev
+'''
+def parse_lines(lines):
+    events = []
+    for line in lines:
+        # Serial logs may carry a prefix before the marker
+        index = line.find("TRACE ")
+        if index < 0:
+            continue
+        parts = line[index:].split()
+        if len(parts) != 6:
+            continue
+        _, timestamp, phase, core, task, name = parts
+        try:
+            events.append((int(timestamp), phase, int(core), task, name))
+        except ValueError:
+            continue
+    # Rings are dumped per core, merge them on the time axis
+    events.sort(key=lambda event: event[0])
+    return events
+
+
+def receive_udp(port, idle_timeout):
+    server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    server_socket.bind(('0.0.0.0', port))
+    print(f"Waiting for trace dump on 0.0.0.0:{port}...")
+    lines = []
+    server_socket.settimeout(None)
+    try:
+        while True:
+            message, _ = server_socket.recvfrom(2048)
+            lines.extend(message.decode('utf-8', errors='replace').splitlines())
+            # Stop once the device has been quiet for a while after the first packet
+            server_socket.settimeout(idle_timeout)
+    except socket.timeout:
+        pass
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server_socket.close()
+    return lines
+
+
+def to_chrome_trace(events):
+    thread_ids = {}
+    trace_events = []
+    for timestamp, phase, core, task, name in events:
+        if task not in thread_ids:
+            thread_ids[task] = len(thread_ids) + 1
+            trace_events.append({
+                "name": "thread_name", "ph": "M", "pid": 1, "tid": thread_ids[task],
+                "args": {"name": task},
+            })
+        event = {
+            "name": name,
+            "ph": phase,
+            "ts": timestamp,
+            "pid": 1,
+            "tid": thread_ids[task],
+            "args": {"core": core},
+        }
+        if phase == "i":
+            event["s"] = "t"
+        trace_events.append(event)
+    return {"traceEvents": trace_events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert device trace dumps into Chrome trace JSON")
+    parser.add_argument("input", nargs="*", help="serial log files containing TRACE lines")
+    parser.add_argument("-u", "--udp", type=int, help="receive the dump over UDP on this port instead")
+    parser.add_argument("-t", "--timeout", type=float, default=3.0, help="UDP idle timeout in seconds")
+    parser.add_argument("-o", "--output", default="trace.json", help="output file")
+    args = parser.parse_args()
+
+    if args.udp:
+        lines = receive_udp(args.udp, args.timeout)
+    elif args.input:
+        lines = []
+        for path in args.input:
+            with open(path, encoding="utf-8", errors="replace") as f:
+                lines.extend(f.readlines())
+    else:
+        lines = sys.stdin.readlines()
+
+    events = parse_lines(lines)
+    if not events:
+        print("No trace events found")
+        return 1
+
+    with open(args.output, "w") as f:
+        json.dump(to_chrome_trace(events), f)
+    print(f"Wrote {len(events)} events to {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,305 @@
+import argparse
+import base64
+import json
+import os
+import random
+import socket
+import threading
+import time
+
+from protocol_v4_server import OP_BINARY, OP_TEXT, Session, WebSocketConnection, serve
+
+
+'''
+  Stand-in server and host test for the sentence-level TTS cache
+  (main/tts_cache.h, "TTS" in docs/websocket.md).
+
+  Server mode extends the v4 stand-in server: every reply is a short
+  scripted list of sentences (a greeting, one of a few confirmations and a
+  unique answer) with synthetic Opus frames derived from the text. When the
+  device hello carries features.tts_cache, the server confirms it and keeps
+  a per-connection count of fully streamed sentences. From the third
+  occurrence on it probes with "cache": true and holds the downlink until
+  the device answers; on a hit the sentence's audio is skipped.
+
+  Test mode starts the server on a local port and drives it with a
+  simulated device over a real socket. The device follows the firmware
+  rules: the same key, admission on second sight, new records pending
+  until the device is idle, and pending records served from memory. Every
+  sentence the device plays, from the network or from the cache, is
+  checked against the frames the server synthesized for that text.
+
+  Usage:
+    python3 scripts/tts_cache_server.py [--port 8000]
+    python3 scripts/tts_cache_server.py --test [--turns 50]
+'''
+
+GREETING = '你好，有什么可以帮你的？'
+CONFIRMATIONS = ['好的，已经帮你调好了。', '没问题。', '抱歉，我没有听清楚，请再说一遍。']
+
+
+def make_key(voice, sample_rate, text):
+    '''FNV-1a 64 of "voice\\nsample_rate\\ntext", same as TtsCache::MakeKey.'''
+    value = 0xcbf29ce484222325
+    for c in ('%s\n%d\n%s' % (voice, sample_rate, text)).encode():
+        value = ((value ^ c) * 0x100000001b3) & 0xFFFFFFFFFFFFFFFF
+    return '%016x' % value
+
+
+def synthesize(text, frame_duration):
+    '''Stand-in TTS: about 4 characters per second, 60-140 byte frames, stable per text.'''
+    rng = random.Random(text)
+    count = max(3, len(text) * 250 // frame_duration)
+    return [bytes(rng.getrandbits(8) for _ in range(rng.randint(60, 140))) for _ in range(count)]
+
+
+def reply_for_turn(turn):
+    sentences = [GREETING] if turn % 4 == 0 else []
+    sentences.append(CONFIRMATIONS[turn % len(CONFIRMATIONS)])
+    sentences.append('这是第 %d 轮的回答。' % turn)
+    return sentences
+
+
+class CacheSession(Session):
+    def __init__(self, conn, args):
+        super().__init__(conn, args)
+        self.tts_cache = False
+        self.turn = 0
+        self.streamed = {}
+        self.cache_reply = None
+        self.cache_event = threading.Event()
+        self.stats = args.stats
+
+    def server_features(self, device_features):
+        self.tts_cache = bool(device_features.get('tts_cache'))
+        return {'tts_cache': True} if self.tts_cache else {}
+
+    def on_message(self, message):
+        if message.get('type') == 'tts' and message.get('state') == 'cache':
+            self.cache_reply = message
+            self.cache_event.set()
+            return
+        super().on_message(message)
+
+    def speak(self, frames):
+        self.speaking.set()
+        self.send_json({'type': 'stt', 'text': '(%d frames)' % len(frames)})
+        self.send_json({'type': 'tts', 'state': 'start'})
+        frame_seconds = self.args.frame_duration / 1000.0
+        for text in reply_for_turn(self.turn):
+            if not self.speaking.is_set():
+                break
+            key = make_key(self.args.voice, 16000, text)
+            sentence = {'type': 'tts', 'state': 'sentence_start', 'text': text, 'voice': self.args.voice}
+            # The device stores a sentence the second time it is streamed in full
+            probe = self.tts_cache and self.streamed.get(key, 0) >= 2
+            if probe:
+                sentence['cache'] = True
+                self.cache_event.clear()
+                sent = time.monotonic()
+            self.send_json(sentence)
+            if probe:
+                # On a hit the device answers when the cached sentence is nearly played out
+                if not self.cache_event.wait(30):
+                    print('no cache reply for %s' % key)
+                    break
+                self.stats['probe_ms'].append((time.monotonic() - sent) * 1000)
+                if self.cache_reply.get('key') != key:
+                    print('cache reply for %s, expected %s' % (self.cache_reply.get('key'), key))
+                if self.cache_reply.get('hit'):
+                    self.stats['hits'] += 1
+                    self.stats['saved_bytes'] += sum(len(f) for f in synthesize(text, self.args.frame_duration))
+                    continue
+                self.stats['misses'] += 1
+            audio = synthesize(text, self.args.frame_duration)
+            start = time.monotonic()
+            for i, opus in enumerate(audio):
+                if self.args.realtime:
+                    delay = start + (i - 1) * frame_seconds - time.monotonic()
+                    if delay > 0:
+                        time.sleep(delay)
+                self.send_opus([(i * self.args.frame_duration, opus)])
+            self.stats['sent_bytes'] += sum(len(f) for f in audio)
+            self.streamed[key] = self.streamed.get(key, 0) + 1
+        self.send_json({'type': 'tts', 'state': 'stop'})
+        self.turn += 1
+
+
+class SimulatedDevice:
+    '''Device side of the cache protocol over protocol v1 (JSON text frames, raw Opus).'''
+
+    def __init__(self, port, frame_duration, capacity):
+        self.sock = socket.create_connection(('127.0.0.1', port))
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(('GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                           'Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\nProtocol-Version: 1\r\n\r\n' % key).encode())
+        self.conn = WebSocketConnection(self.sock)
+        response = b''
+        while not response.endswith(b'\r\n\r\n'):
+            response += self.conn.reader.readline()
+        assert b' 101 ' in response.split(b'\r\n')[0], response
+        self.frame_duration = frame_duration
+        self.capacity = capacity
+        self.server_tts_cache = False
+        self.server_sample_rate = 16000
+        self.session_id = ''
+        self.store = {}     # key -> frames, insertion order approximates the flash log
+        self.pending = {}   # written to the store when idle
+        self.seen = []
+        self.recording = None
+        self.sentence = None
+        self.played = []    # (text, frames, from_cache)
+
+    def send_json(self, message):
+        self.conn.send(OP_TEXT, json.dumps(message, ensure_ascii=False).encode())
+
+    def hello(self):
+        self.send_json({'type': 'hello', 'version': 1, 'transport': 'websocket', 'features': {'tts_cache': True},
+                        'audio_params': {'format': 'opus', 'sample_rate': 16000, 'channels': 1,
+                                         'frame_duration': self.frame_duration}})
+        opcode, payload = self.conn.receive()
+        hello = json.loads(payload)
+        self.session_id = hello.get('session_id', '')
+        self.server_tts_cache = bool(hello.get('features', {}).get('tts_cache'))
+        self.server_sample_rate = hello.get('audio_params', {}).get('sample_rate', 16000)
+
+    def lookup(self, key):
+        if key in self.pending:
+            return self.pending[key]
+        if key in self.store:
+            # A hit near eviction is rewritten at the head of the log
+            self.store[key] = self.store.pop(key)
+            return self.store[key]
+        return None
+
+    def begin_sentence(self, key):
+        self.recording = None
+        if key in self.store or key in self.pending:
+            return
+        if key not in self.seen:
+            self.seen = (self.seen + [key])[-128:]
+            return
+        self.seen.remove(key)
+        self.recording = (key, [])
+
+    def end_sentence(self):
+        if self.recording and self.recording[1]:
+            self.pending[self.recording[0]] = self.recording[1]
+        self.recording = None
+        if self.sentence:
+            self.played.append(self.sentence)
+        self.sentence = None
+
+    def go_idle(self):
+        for key, frames in self.pending.items():
+            self.store[key] = frames
+            while len(self.store) > self.capacity:
+                self.store.pop(next(iter(self.store)))
+        self.pending = {}
+
+    def converse(self):
+        self.send_json({'session_id': self.session_id, 'type': 'listen', 'state': 'start', 'mode': 'manual'})
+        for i in range(3):
+            self.conn.send(OP_BINARY, bytes([i]) * 40)
+        self.send_json({'session_id': self.session_id, 'type': 'listen', 'state': 'stop'})
+        while True:
+            opcode, payload = self.conn.receive()
+            if opcode == OP_BINARY:
+                assert self.sentence is not None, 'audio outside a sentence'
+                self.sentence[1].append(payload)
+                if self.recording:
+                    self.recording[1].append(payload)
+                continue
+            message = json.loads(payload)
+            if message.get('type') != 'tts':
+                continue
+            state = message.get('state')
+            if state == 'stop':
+                self.end_sentence()
+                self.go_idle()
+                return
+            if state != 'sentence_start':
+                continue
+            self.end_sentence()
+            text = message['text']
+            self.sentence = (text, [], False)
+            if not self.server_tts_cache:
+                continue
+            key = make_key(message.get('voice', ''), self.server_sample_rate, text)
+            if not message.get('cache'):
+                self.begin_sentence(key)
+                continue
+            frames = self.lookup(key)
+            if frames is not None:
+                self.sentence = (text, list(frames), True)
+            else:
+                self.begin_sentence(key)
+            self.send_json({'session_id': self.session_id, 'type': 'tts', 'state': 'cache',
+                            'key': key, 'hit': frames is not None})
+
+
+def test(args):
+    stats = {'hits': 0, 'misses': 0, 'sent_bytes': 0, 'saved_bytes': 0, 'probe_ms': []}
+    args.stats = stats
+    args.realtime = False
+    args.quiet = True
+    listener = socket.socket()
+    listener.bind(('127.0.0.1', 0))
+    args.port = listener.getsockname()[1]
+    listener.close()
+    threading.Thread(target=serve, args=(args, CacheSession), daemon=True).start()
+    for _ in range(50):
+        try:
+            socket.create_connection(('127.0.0.1', args.port)).close()
+            break
+        except OSError:
+            time.sleep(0.05)
+
+    device = SimulatedDevice(args.port, args.frame_duration, args.capacity)
+    device.hello()
+    assert device.server_tts_cache, 'server did not confirm tts_cache'
+    expected_sentences = 0
+    for turn in range(args.turns):
+        device.converse()
+        expected_sentences += len(reply_for_turn(turn))
+    assert len(device.played) == expected_sentences, (len(device.played), expected_sentences)
+    cached = 0
+    for text, frames, from_cache in device.played:
+        assert frames == synthesize(text, args.frame_duration), 'wrong audio for %s' % text
+        cached += from_cache
+    assert cached == stats['hits']
+
+    total = stats['sent_bytes'] + stats['saved_bytes']
+    probe_ms = sorted(stats['probe_ms'])
+    print('%d turns, %d sentences, %d played from cache, %d probe misses' % (
+        args.turns, expected_sentences, stats['hits'], stats['misses']))
+    print('downlink Opus bytes: %d without cache, %d with cache (-%.1f%%)' % (
+        total, stats['sent_bytes'], stats['saved_bytes'] * 100.0 / total))
+    if probe_ms:
+        print('probe round trip on loopback: median %.2f ms, max %.2f ms' % (probe_ms[len(probe_ms) // 2], probe_ms[-1]))
+    print('device cache: %d stored, %d unique sentences never written' % (
+        len(device.store), len(device.seen)))
+    print('all %d sentences matched the server audio' % expected_sentences)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stand-in server and host test for the sentence-level TTS cache')
+    parser.add_argument('--port', type=int, default=8000)
+    parser.add_argument('--frame-duration', type=int, default=60, help='Opus frame duration, ms')
+    parser.add_argument('--voice', default='default', help='Voice name sent in sentence_start')
+    parser.add_argument('--bundle', type=int, default=1)
+    parser.add_argument('--listen-seconds', type=float, default=4, help='Recording length in auto mode')
+    parser.add_argument('--test', action='store_true', help='Run the simulated device against the server, then exit')
+    parser.add_argument('--turns', type=int, default=50, help='Conversation turns for --test')
+    parser.add_argument('--capacity', type=int, default=40, help='Sentences the simulated device can store')
+    args = parser.parse_args()
+    if args.test:
+        test(args)
+    else:
+        args.stats = {'hits': 0, 'misses': 0, 'sent_bytes': 0, 'saved_bytes': 0, 'probe_ms': []}
+        args.realtime = True
+        serve(args, CacheSession)
+
+
+if __name__ == '__main__':
+    main()
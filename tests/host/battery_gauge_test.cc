@@ -0,0 +1,115 @@
+#include "battery_gauge.h"
+#include "host_test.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * 回放 data/ 下的电池电压序列，格式见 data/gen_battery_traces.py。
+ * 序列由独立的电芯模型生成（不同的 OCV 表、二阶 RC 极化、电流波动和温度），
+ * 不是由本类的 OCV 曲线反推得到的。
+ * 检查放电时电量只降不升、充电时只升不降，以及与开路电压对应电量的误差；
+ * 同时给出不做内阻补偿和滤波、直接查表的误差作为对照。
+ */
+
+struct TraceSample {
+    int seconds;
+    int battery_mv;
+    int load_ma;
+    bool charging;
+    int true_level;
+};
+
+static std::vector<TraceSample> LoadTrace(const char* name) {
+    std::string path = std::string(HOST_TEST_DATA_DIR) + "/" + name;
+    FILE* file = fopen(path.c_str(), "r");
+    CHECK(file != nullptr);
+    std::vector<TraceSample> trace;
+    TraceSample sample;
+    int charging;
+    while (fscanf(file, "%d,%d,%d,%d,%d", &sample.seconds, &sample.battery_mv, &sample.load_ma,
+                  &charging, &sample.true_level) == 5) {
+        sample.charging = charging != 0;
+        trace.push_back(sample);
+    }
+    fclose(file);
+    CHECK(!trace.empty());
+    return trace;
+}
+
+struct ReplayStats {
+    int max_error = 0;
+    int max_naive_error = 0;
+    int final_error = 0;
+};
+
+static ReplayStats Replay(const char* name) {
+    auto trace = LoadTrace(name);
+    BatteryGauge gauge;
+    ReplayStats stats;
+    int last_level = -1;
+    bool last_charging = false;
+    int samples_since_switch = 0;
+    for (const auto& sample : trace) {
+        gauge.AddSample(sample.battery_mv, sample.load_ma, sample.charging);
+        int level = gauge.GetLevel();
+        CHECK(level >= 0 && level <= 100);
+
+        if (sample.charging != last_charging) {
+            samples_since_switch = 0;
+            last_charging = sample.charging;
+        }
+        samples_since_switch++;
+        // 滑动窗口填满之后才约束方向
+        if (samples_since_switch > 9) {
+            if (sample.charging) {
+                CHECK(level >= last_level);
+            } else {
+                CHECK(level <= last_level);
+            }
+        }
+        last_level = level;
+
+        // 充电电流未知，充电期间只检查方向
+        if (!sample.charging && samples_since_switch > 9) {
+            int error = std::abs(level - sample.true_level);
+            int naive_error = std::abs(BatteryGauge::OcvToLevel(sample.battery_mv) - sample.true_level);
+            stats.max_error = std::max(stats.max_error, error);
+            stats.max_naive_error = std::max(stats.max_naive_error, naive_error);
+            stats.final_error = error;
+        }
+    }
+    printf("%-26s %4zu s: max error %d%%, final %d%%; uncompensated lookup max error %d%%\n",
+        name, trace.size(), stats.max_error, stats.final_error, stats.max_naive_error);
+    return stats;
+}
+
+int main() {
+    // 对话中的负载阶跃：说话时不应掉电量
+    auto conversation = Replay("battery_conversation.csv");
+    CHECK(conversation.max_error <= 5);
+    CHECK(conversation.final_error <= 3);
+    CHECK(conversation.max_naive_error > conversation.max_error);
+
+    // 接近截止电压时曲线最陡
+    auto low = Replay("battery_low.csv");
+    CHECK(low.max_error <= 5);
+
+    // 充电 15 分钟后拔掉，重新收敛
+    auto charge = Replay("battery_charge.csv");
+    CHECK(charge.final_error <= 3);
+    // 拔掉后充电极化要数分钟才消退，期间偏低
+    CHECK(charge.max_error <= 12);
+
+    // 5 °C 时串联内阻翻倍，超出固定的内阻补偿
+    auto cold = Replay("battery_cold.csv");
+    CHECK(cold.max_error <= 12);
+    CHECK(cold.max_naive_error > cold.max_error);
+
+    CHECK(BatteryGauge::OcvToLevel(3300) == 0);
+    CHECK(BatteryGauge::OcvToLevel(3850) == 50);
+    CHECK(BatteryGauge::OcvToLevel(4300) == 100);
+    printf("battery traces passed\n");
+    return 0;
+}
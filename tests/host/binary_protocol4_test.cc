@@ -0,0 +1,400 @@
+#include "binary_protocol4.h"
+#include "board.h"
+#include "host_test.h"
+
+#include <chrono>
+#include <cstring>
+#include <list>
+#include <tuple>
+#include <vector>
+
+/*
+ * 二进制协议 v4 的主机测试：
+ * - 音频消息跨多条消息编解码往返，时间戳按流状态写成差值，回退和回绕时的负差值正确还原
+ * - 多帧合并为一条消息时序号按帧递增，比逐帧发送省下的字节数
+ * - 截断、多余字节和格式错误的消息被拒绝，解码失败不改变流状态
+ * - Protocol 的各个 Send* 生成的控制消息直接编码为 CBOR，与原来“拼 JSON、cJSON 解析、再编码”的结果逐字节相同
+ * - 编码结果能解码回等价的 JSON，字符串中的引号和控制字符正确转义
+ * - 控制消息两条编码路径的耗时和解码耗时（主机上测得，只打印不断言）
+ */
+
+class TestBoard : public Board {
+public:
+    Display* GetDisplay() override { return nullptr; }
+    void SetPowerSaveMode(bool enabled) override {}
+};
+
+Board& Board::GetInstance() {
+    static TestBoard board;
+    return board;
+}
+
+// 记录 Send* 生成的控制消息
+class RecordingProtocol : public Protocol {
+public:
+    std::vector<ControlMessage> messages;
+
+    RecordingProtocol() {
+        session_id_ = "a1b2c3d4";
+    }
+
+    bool Start() override { return true; }
+    bool OpenAudioChannel() override { return true; }
+    void CloseAudioChannel() override {}
+    bool IsAudioChannelOpened() const override { return true; }
+    bool SendAudio(const AudioStreamPacket& packet) override { return true; }
+
+protected:
+    bool SendText(const std::string& text) override { return true; }
+    bool SendControl(const ControlMessage& message) override {
+        messages.push_back(message);
+        return true;
+    }
+};
+
+static std::vector<ControlMessage> SampleMessages() {
+    RecordingProtocol protocol;
+    protocol.SendWakeWordDetected("你好小智");
+    protocol.SendStartListening(kListeningModeAutoStop);
+    protocol.SendStartListening(kListeningModeRealtime);
+    protocol.SendStopListening();
+    protocol.SendAbortSpeaking(kAbortReasonWakeWordDetected);
+    protocol.SendTtsCacheResult("3f2a9c", true);
+    protocol.SendIotDescriptors("[{\"name\":\"Speaker\",\"properties\":{\"volume\":{\"type\":\"number\"}}}]");
+    protocol.SendIotStates("[{\"name\":\"Speaker\",\"state\":{\"volume\":70}}]");
+    protocol.SendMcpMessage("{\"jsonrpc\":\"2.0\",\"id\":3,\"result\":{\"content\":[{\"type\":\"text\",\"text\":\"true\"}],\"isError\":false}}");
+    protocol.SendMetrics("{\"audio.decode_ms\":{\"p50\":2.5,\"p95\":4},\"wifi.rssi\":-52}");
+    return protocol.messages;
+}
+
+// 原来的路径：JSON 文本经 cJSON 解析后编码
+static void EncodeViaJson(uint32_t sequence, const ControlMessage& message, std::string& out) {
+    auto root = cJSON_Parse(message.ToJson().c_str());
+    CHECK(root != nullptr);
+    out.clear();
+    out.push_back((char)BinaryProtocol4::kFrameControl);
+    out.push_back((char)sequence);
+    BinaryProtocol4::EncodeCbor(root, out);
+    cJSON_Delete(root);
+}
+
+static std::string Print(const cJSON* item) {
+    char* text = cJSON_PrintUnformatted(item);
+    std::string result = text;
+    cJSON_free(text);
+    return result;
+}
+
+// 按 60 ms 一帧生成时间戳连续的音频包，负载长度随帧变化
+static std::list<AudioStreamPacket> MakePackets(uint32_t first_timestamp, int count, size_t size = 100) {
+    std::list<AudioStreamPacket> packets;
+    for (int i = 0; i < count; i++) {
+        AudioStreamPacket packet;
+        packet.timestamp = first_timestamp + i * 60;
+        packet.payload.resize(size + i % 7);
+        for (size_t j = 0; j < packet.payload.size(); j++) {
+            packet.payload[j] = (uint8_t)(i * 31 + j);
+        }
+        packets.push_back(std::move(packet));
+    }
+    return packets;
+}
+
+static std::vector<const AudioStreamPacket*> Pointers(const std::list<AudioStreamPacket>& packets) {
+    std::vector<const AudioStreamPacket*> result;
+    for (auto& packet : packets) {
+        result.push_back(&packet);
+    }
+    return result;
+}
+
+static bool DecodeString(const std::string& data, uint32_t& timestamp, BinaryProtocol4::Frame& frame) {
+    frame = BinaryProtocol4::Frame();
+    bool decoded = BinaryProtocol4::Decode((const uint8_t*)data.data(), data.size(), timestamp, frame);
+    if (!decoded) {
+        cJSON_Delete(frame.control);
+    }
+    return decoded;
+}
+
+// 解码结果与原始音频包逐一比较
+static void CheckPackets(const BinaryProtocol4::Frame& frame, const std::vector<const AudioStreamPacket*>& packets) {
+    CHECK(frame.type == BinaryProtocol4::kFrameAudio);
+    CHECK(frame.packets.size() == packets.size());
+    for (size_t i = 0; i < packets.size(); i++) {
+        CHECK(frame.packets[i].timestamp == packets[i]->timestamp);
+        CHECK(frame.packets[i].payload == packets[i]->payload);
+    }
+}
+
+// 编码端和解码端各自维护流状态，逐条消息往返
+static void TestAudioRoundTrip() {
+    auto packets = MakePackets(3600000, 50);
+    uint32_t tx_sequence = 0, tx_timestamp = 0, rx_timestamp = 0;
+    for (auto packet : Pointers(packets)) {
+        std::string out;
+        CHECK(BinaryProtocol4::EncodeAudio(tx_sequence, tx_timestamp, { packet }, out) == 1);
+        CHECK(tx_timestamp == packet->timestamp);
+
+        BinaryProtocol4::Frame frame;
+        CHECK(DecodeString(out, rx_timestamp, frame));
+        CHECK(frame.sequence == tx_sequence);
+        CheckPackets(frame, { packet });
+        CHECK(rx_timestamp == packet->timestamp);
+        tx_sequence++;
+    }
+
+    // 第一条消息相对 0 写出完整的时间戳，之后每帧的差值 60 ms 只占一个字节：
+    // 类型 1 + 序号 1 + 帧数 1 + 时间戳差值 1 + 长度 1 + 负载
+    auto& last = packets.back();
+    std::string out;
+    uint32_t timestamp = last.timestamp - 60;
+    BinaryProtocol4::EncodeAudio(100, timestamp, { &last }, out);
+    CHECK(out.size() == 5 + last.payload.size());
+}
+
+// 多帧合并为一条消息，序号按帧递增
+static void TestBundling() {
+    auto packets = MakePackets(1000, 9);
+    auto pointers = Pointers(packets);
+    uint32_t tx_sequence = 7, tx_timestamp = 940, rx_timestamp = 940;
+
+    std::string bundled;
+    size_t bundled_bytes = 0;
+    for (size_t offset = 0; offset < pointers.size(); offset += 3) {
+        std::vector<const AudioStreamPacket*> group(pointers.begin() + offset, pointers.begin() + offset + 3);
+        uint32_t sequence = tx_sequence;
+        tx_sequence += BinaryProtocol4::EncodeAudio(tx_sequence, tx_timestamp, group, bundled);
+        CHECK(tx_sequence == sequence + 3);
+        bundled_bytes += bundled.size();
+
+        BinaryProtocol4::Frame frame;
+        CHECK(DecodeString(bundled, rx_timestamp, frame));
+        CHECK(frame.sequence == sequence);
+        CheckPackets(frame, group);
+    }
+    CHECK(tx_sequence == 16);
+    CHECK(rx_timestamp == packets.back().timestamp);
+
+    // 逐帧发送时每帧都要一个类型、序号和帧数；合并后这部分每条消息只出现一次
+    uint32_t sequence = 7, timestamp = 940;
+    size_t single_bytes = 0;
+    for (auto packet : pointers) {
+        std::string out;
+        sequence += BinaryProtocol4::EncodeAudio(sequence, timestamp, { packet }, out);
+        single_bytes += out.size();
+    }
+    CHECK(single_bytes - bundled_bytes == 6 * 3);
+    printf("audio bundling: 9 frames %zu bytes one per message, %zu bytes three per message\n", single_bytes,
+        bundled_bytes);
+}
+
+// 时间戳回退（新一轮对话重新计时）和 32 位回绕时差值为负数，按 zigzag 编码
+static void TestNegativeDeltas() {
+    uint32_t timestamps[] = { 5000, 5060, 0, 60, 4294967236u, 24, 2000000000u, 4294967295u, 0 };
+    std::list<AudioStreamPacket> packets;
+    for (uint32_t timestamp : timestamps) {
+        AudioStreamPacket packet;
+        packet.timestamp = timestamp;
+        packet.payload.assign(3, (uint8_t)timestamp);
+        packets.push_back(std::move(packet));
+    }
+    auto pointers = Pointers(packets);
+
+    uint32_t tx_timestamp = 0, rx_timestamp = 0;
+    std::string out;
+    BinaryProtocol4::EncodeAudio(0, tx_timestamp, pointers, out);
+    BinaryProtocol4::Frame frame;
+    CHECK(DecodeString(out, rx_timestamp, frame));
+    CheckPackets(frame, pointers);
+    CHECK(rx_timestamp == 0);
+
+    // 回退 60 ms 编码为 zigzag 119，回绕 60 ms 编码为 120，都只占一个字节
+    for (auto& [from, to, zigzag] : std::vector<std::tuple<uint32_t, uint32_t, uint8_t>> {
+             { 120, 60, 119 }, { 4294967276u, 40, 120 }, { 40, 4294967276u, 119 } }) {
+        AudioStreamPacket packet;
+        packet.timestamp = to;
+        uint32_t timestamp = from;
+        BinaryProtocol4::EncodeAudio(0, timestamp, { &packet }, out);
+        CHECK(out.size() == 5);
+        CHECK((uint8_t)out[3] == zigzag);
+        timestamp = from;
+        CHECK(DecodeString(out, timestamp, frame));
+        CHECK(frame.packets[0].timestamp == to);
+    }
+}
+
+// 截断、多余字节和格式错误的消息都被拒绝，且不改变流状态
+static void TestMalformed() {
+    auto packets = MakePackets(60, 2, 4);
+    auto pointers = Pointers(packets);
+    std::string audio;
+    uint32_t timestamp = 0;
+    BinaryProtocol4::EncodeAudio(300, timestamp, pointers, audio);
+
+    ControlMessage message;
+    message.Add("type", "listen").Add("state", "start").AddRaw("payload", "{\"a\":[1,2,{\"b\":null}]}");
+    std::string control;
+    BinaryProtocol4::EncodeControl(300, message, control);
+
+    BinaryProtocol4::Frame frame;
+    for (auto& data : { audio, control }) {
+        for (size_t length = 0; length < data.size(); length++) {
+            timestamp = 1234;
+            CHECK(!DecodeString(data.substr(0, length), timestamp, frame));
+            CHECK(timestamp == 1234);
+        }
+        timestamp = 1234;
+        CHECK(!DecodeString(data + '\0', timestamp, frame));
+        CHECK(timestamp == 1234);
+        CHECK(DecodeString(data, timestamp, frame));
+        cJSON_Delete(frame.control);
+    }
+
+    timestamp = 0;
+    // 未知类型
+    CHECK(!DecodeString(std::string("\x07\x00", 2), timestamp, frame));
+    // 序号的 varint 超过 5 个字节
+    CHECK(!DecodeString(std::string("\x01\xff\xff\xff\xff\xff\x01\x00", 8), timestamp, frame));
+    // 帧数比消息还长
+    CHECK(!DecodeString(std::string("\x01\x00\x40\x00\x00", 5), timestamp, frame));
+    // 负载长度超出消息
+    CHECK(!DecodeString(std::string("\x01\x00\x01\x02\x05\xaa\xbb", 7), timestamp, frame));
+    // 控制消息后面跟着第二个 CBOR 数据项
+    CHECK(!DecodeString(control + control.substr(2), timestamp, frame));
+    // CBOR 中的字符串长度超出消息
+    CHECK(!DecodeString(std::string("\x02\x00\xa1\x68type", 7), timestamp, frame));
+    CHECK(timestamp == 0);
+}
+
+static void TestSameBytesAsJsonPath() {
+    auto messages = SampleMessages();
+    CHECK(messages.size() == 10);
+    uint32_t sequence = 0;
+    for (auto& message : messages) {
+        std::string direct, via_json;
+        BinaryProtocol4::EncodeControl(sequence, message, direct);
+        EncodeViaJson(sequence, message, via_json);
+        CHECK(direct == via_json);
+
+        BinaryProtocol4::Frame frame;
+        uint32_t timestamp = 0;
+        CHECK(BinaryProtocol4::Decode((const uint8_t*)direct.data(), direct.size(), timestamp, frame));
+        CHECK(frame.type == BinaryProtocol4::kFrameControl);
+        CHECK(frame.sequence == sequence);
+        auto expected = cJSON_Parse(message.ToJson().c_str());
+        CHECK(Print(frame.control) == Print(expected));
+        cJSON_Delete(expected);
+        cJSON_Delete(frame.control);
+        sequence++;
+    }
+}
+
+static void TestEscaping() {
+    ControlMessage message;
+    message.Add("text", "say \"hi\"\\\n\t").AddBool("hit", false);
+    auto root = cJSON_Parse(message.ToJson().c_str());
+    CHECK(root != nullptr);
+    CHECK(strcmp(cJSON_GetObjectItem(root, "text")->valuestring, "say \"hi\"\\\n\t") == 0);
+    CHECK(cJSON_IsFalse(cJSON_GetObjectItem(root, "hit")));
+    cJSON_Delete(root);
+
+    // Raw 字段不是合法 JSON 时按字符串编码
+    ControlMessage broken;
+    broken.AddRaw("payload", "{oops");
+    std::string out;
+    BinaryProtocol4::EncodeControl(0, broken, out);
+    BinaryProtocol4::Frame frame;
+    uint32_t timestamp = 0;
+    CHECK(BinaryProtocol4::Decode((const uint8_t*)out.data(), out.size(), timestamp, frame));
+    CHECK(strcmp(cJSON_GetObjectItem(frame.control, "payload")->valuestring, "{oops") == 0);
+    cJSON_Delete(frame.control);
+}
+
+template <typename F>
+static double MeasureUs(const std::vector<ControlMessage>& messages, F encode) {
+    const int rounds = 2000;
+    std::string out;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (auto& message : messages) {
+            encode(message, out);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / rounds / messages.size();
+}
+
+static void BenchmarkEncode() {
+    auto messages = SampleMessages();
+    // 不含 Raw 字段的消息（listen、abort、tts 缓存结果）完全不经过 cJSON
+    std::vector<ControlMessage> plain(messages.begin(), messages.begin() + 6);
+    auto direct = [](const ControlMessage& message, std::string& out) { BinaryProtocol4::EncodeControl(1, message, out); };
+    auto via_json = [](const ControlMessage& message, std::string& out) { EncodeViaJson(1, message, out); };
+    double plain_direct = MeasureUs(plain, direct);
+    double plain_json = MeasureUs(plain, via_json);
+    double all_direct = MeasureUs(messages, direct);
+    double all_json = MeasureUs(messages, via_json);
+    printf("control encode (host): plain messages %.2f us direct vs %.2f us via JSON, "
+        "all messages %.2f us vs %.2f us\n", plain_direct, plain_json, all_direct, all_json);
+}
+
+// 下行解码：CBOR 控制消息与同内容的 JSON 文本经 cJSON_Parse 对比，以及单帧音频消息
+static void BenchmarkDecode() {
+    auto messages = SampleMessages();
+    std::vector<std::string> encoded, texts;
+    for (auto& message : messages) {
+        encoded.emplace_back();
+        BinaryProtocol4::EncodeControl(1, message, encoded.back());
+        texts.push_back(message.ToJson());
+    }
+    auto packets = MakePackets(3600000, 1);
+    std::string audio;
+    uint32_t timestamp = 3600000 - 60;
+    BinaryProtocol4::EncodeAudio(1, timestamp, Pointers(packets), audio);
+
+    const int rounds = 2000;
+    BinaryProtocol4::Frame frame;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (auto& data : encoded) {
+            uint32_t state = 0;
+            CHECK(DecodeString(data, state, frame));
+            cJSON_Delete(frame.control);
+        }
+    }
+    double cbor_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (auto& text : texts) {
+            auto root = cJSON_Parse(text.c_str());
+            CHECK(root != nullptr);
+            cJSON_Delete(root);
+        }
+    }
+    double json_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds * 10; i++) {
+        uint32_t state = 3600000 - 60;
+        CHECK(DecodeString(audio, state, frame));
+    }
+    double audio_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    printf("decode (host): control %.2f us CBOR vs %.2f us cJSON_Parse, audio message %.2f us\n",
+        cbor_us / rounds / messages.size(), json_us / rounds / texts.size(), audio_us / rounds / 10);
+}
+
+int main() {
+    TestAudioRoundTrip();
+    TestBundling();
+    TestNegativeDeltas();
+    TestMalformed();
+    TestSameBytesAsJsonPath();
+    TestEscaping();
+    BenchmarkEncode();
+    BenchmarkDecode();
+    printf("binary protocol v4 tests passed\n");
+    return 0;
+}
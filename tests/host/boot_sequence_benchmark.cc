@@ -0,0 +1,255 @@
+#include "boot_sequence.h"
+#include "host_test.h"
+
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*
+ * 启动阶段在主机上的模拟，使用真实的 BootSequence 和 BootProfiler，各阶段用固定耗时的替身代替：
+ * - 按设备上测得的各阶段耗时（缩短 kTimeScale 倍）分别串行和按依赖并行启动，
+ *   由 BootProfiler 的里程碑给出唤醒词就绪、进入待机和首次对话的时间；耗时只打印，不做断言
+ * - 并行阶段反复切换设备状态，检查状态切换和回调都在启动任务中执行且互不重叠，
+ *   唤醒词阶段根据状态决定是否开始检测时不会与配网的状态切换交错
+ */
+
+static const int kTimeScale = 4;
+// 唤醒词就绪后用户说出唤醒词的时长
+static const int kWakeWordUtteranceMs = 600;
+
+// 清空单例中上一次模拟的记录
+class BootProfilerTest {
+public:
+    static void Clear() {
+        auto& profiler = BootProfiler::GetInstance();
+        std::lock_guard<std::mutex> lock(profiler.mutex_);
+        profiler.stages_.clear();
+        profiler.milestones_.clear();
+    }
+
+    static size_t StageCount() {
+        auto& profiler = BootProfiler::GetInstance();
+        std::lock_guard<std::mutex> lock(profiler.mutex_);
+        return profiler.stages_.size();
+    }
+};
+
+// 与 Application::SetDeviceState 相同的转交方式，记录执行所在的任务和是否重叠
+class FakeDevice {
+public:
+    enum State { kStarting, kWifiConfiguring, kActivating, kIdle, kListening };
+
+    BootSequence* boot = nullptr;
+    TaskHandle_t run_task = nullptr;
+    std::atomic<int> transitions{0};
+    std::atomic<int> off_task{0};
+    std::atomic<int> overlaps{0};
+    State state = kStarting;
+
+    void SetState(State next) {
+        if (boot != nullptr && !boot->IsRunTask()) {
+            boot->Dispatch([this, next]() {
+                SetState(next);
+            });
+            return;
+        }
+        if (inside_.exchange(true)) {
+            overlaps++;
+        }
+        if (xTaskGetCurrentTaskHandle() != run_task) {
+            off_task++;
+        }
+        state = next;
+        if (next == kListening) {
+            BootProfiler::GetInstance().Mark("first_conversation");
+        }
+        // 状态回调（屏幕、LED、功耗调度）的耗时
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        transitions++;
+        inside_ = false;
+    }
+
+private:
+    std::atomic<bool> inside_{false};
+};
+
+static void Work(int device_ms) {
+    vTaskDelay(pdMS_TO_TICKS(device_ms / kTimeScale));
+}
+
+struct StageTimes {
+    int audio_ms;
+    int network_ms;
+    int wake_word_ms;
+    int ota_ms;
+    int protocol_ms;
+};
+
+// 各里程碑距开始的时间，换算为设备上的毫秒，未到达为 -1
+struct BootResult {
+    int64_t wake_word_ready_ms;
+    int64_t ready_ms;
+    int64_t first_conversation_ms;
+    bool detection_started;
+};
+
+static int64_t MilestoneMs(const char* name, int64_t start_us) {
+    int64_t us = BootProfiler::GetInstance().GetMilestoneUs(name);
+    return us < 0 ? -1 : (us - start_us) / 1000 * kTimeScale;
+}
+
+// 与 Application::Start 相同的依赖关系和里程碑
+static BootResult SimulateBoot(const StageTimes& times, bool parallel, bool wifi_config, FakeDevice& device) {
+    BootProfilerTest::Clear();
+    BootSequence boot;
+    device.boot = &boot;
+    device.run_task = xTaskGetCurrentTaskHandle();
+    device.state = FakeDevice::kStarting;
+    std::atomic<bool> detection_started{false};
+    uint32_t stack = parallel ? 4096 * 2 : 0;
+
+    int64_t start = esp_timer_get_time();
+    boot.AddStage("audio", {}, [&]() {
+        Work(times.audio_ms);
+    });
+    boot.AddStage("network", { "audio" }, [&]() {
+        // 没有保存的 WiFi 时，扫描后进入配网
+        Work(times.network_ms / 4);
+        if (wifi_config) {
+            device.SetState(FakeDevice::kWifiConfiguring);
+        }
+        Work(times.network_ms - times.network_ms / 4);
+    }, stack);
+    boot.AddStage("wake_word", { "audio" }, [&]() {
+        Work(times.wake_word_ms);
+        boot.Dispatch([&]() {
+            if (device.state != FakeDevice::kWifiConfiguring) {
+                detection_started = true;
+            }
+        });
+        BootProfiler::GetInstance().Mark("wake_word_ready");
+    }, stack);
+    boot.AddStage("ota", { "network" }, [&]() {
+        device.SetState(FakeDevice::kActivating);
+        Work(times.ota_ms);
+    }, stack);
+    boot.AddStage("protocol", { "ota" }, [&]() {
+        Work(times.protocol_ms);
+    });
+    boot.Run();
+    device.boot = nullptr;
+    device.SetState(wifi_config ? FakeDevice::kWifiConfiguring : FakeDevice::kIdle);
+    BootProfiler::GetInstance().Mark("ready");
+    CHECK(BootProfilerTest::StageCount() == 5);
+
+    // 用户在唤醒词就绪时开始说唤醒词，识别到之后、且进入待机之后才能开始对话
+    if (detection_started && device.state == FakeDevice::kIdle) {
+        int64_t heard_us = BootProfiler::GetInstance().GetMilestoneUs("wake_word_ready") +
+            kWakeWordUtteranceMs * 1000 / kTimeScale;
+        int64_t wait_us = heard_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+        }
+        device.SetState(FakeDevice::kListening);
+    }
+
+    return { MilestoneMs("wake_word_ready", start), MilestoneMs("ready", start),
+        MilestoneMs("first_conversation", start), detection_started };
+}
+
+static void PrintResult(const char* name, const BootResult& result) {
+    printf("  %-10s %16lld %8lld %20lld\n", name, (long long)result.wake_word_ready_ms, (long long)result.ready_ms,
+        (long long)result.first_conversation_ms);
+}
+
+static void BenchmarkBoot() {
+    // 设备上的典型耗时：编解码初始化、联网、唤醒词模型加载、版本检查、协议连接
+    const StageTimes times = { 120, 1600, 700, 450, 300 };
+    int serial_sum = times.audio_ms + times.network_ms + times.wake_word_ms + times.ota_ms + times.protocol_ms;
+    int critical_path = times.audio_ms + std::max(times.network_ms + times.ota_ms + times.protocol_ms, times.wake_word_ms);
+
+    FakeDevice device;
+    auto serial = SimulateBoot(times, false, false, device);
+    auto parallel = SimulateBoot(times, true, false, device);
+    printf("boot milestones, device ms (sum of stages %d, critical path %d):\n", serial_sum, critical_path);
+    printf("  %-10s %16s %8s %20s\n", "", "wake word ready", "ready", "first conversation");
+    PrintResult("serial", serial);
+    PrintResult("parallel", parallel);
+
+    for (auto& result : { serial, parallel }) {
+        CHECK(result.detection_started);
+        CHECK(result.wake_word_ready_ms >= 0 && result.ready_ms >= 0 && result.first_conversation_ms >= 0);
+        // 首次对话要等唤醒词就绪并进入待机
+        CHECK(result.first_conversation_ms >= result.wake_word_ready_ms);
+        CHECK(result.first_conversation_ms >= result.ready_ms);
+    }
+    CHECK(device.off_task == 0);
+    CHECK(device.overlaps == 0);
+}
+
+// 配网提示早于唤醒词加载完成：状态切换在启动任务中执行，唤醒词阶段看到配网状态后不开始检测
+static void TestWifiConfigDuringWakeWordLoad() {
+    const StageTimes times = { 40, 1600, 800, 40, 40 };
+    FakeDevice device;
+    auto result = SimulateBoot(times, true, true, device);
+    CHECK(!result.detection_started);
+    CHECK(result.wake_word_ready_ms >= 0);
+    CHECK(result.first_conversation_ms < 0);
+    CHECK(device.off_task == 0);
+    CHECK(device.overlaps == 0);
+}
+
+// 多个并行阶段同时反复切换状态，所有切换都在启动任务中依次执行，Run 返回前全部完成
+static void TestConcurrentTransitions() {
+    for (int round = 0; round < 20; round++) {
+        FakeDevice device;
+        BootSequence boot;
+        device.boot = &boot;
+        device.run_task = xTaskGetCurrentTaskHandle();
+        const char* names[] = { "a", "b", "c", "d" };
+        for (auto name : names) {
+            boot.AddStage(name, {}, [&device]() {
+                for (int i = 0; i < 25; i++) {
+                    device.SetState(i % 2 ? FakeDevice::kActivating : FakeDevice::kIdle);
+                }
+            }, 4096);
+        }
+        boot.AddStage("e", { "a", "b" }, [&device]() {
+            device.SetState(FakeDevice::kIdle);
+        });
+        boot.Run();
+        device.boot = nullptr;
+        CHECK(device.transitions == 4 * 25 + 1);
+        CHECK(device.off_task == 0);
+        CHECK(device.overlaps == 0);
+    }
+}
+
+// 其他阶段可以等待指定阶段完成
+static void TestWaitFor() {
+    BootSequence boot;
+    std::atomic<bool> slow_done{false};
+    std::atomic<bool> observed{false};
+    boot.AddStage("slow", {}, [&]() {
+        vTaskDelay(pdMS_TO_TICKS(50));
+        slow_done = true;
+    }, 4096);
+    boot.AddStage("fast", {}, [&]() {
+        boot.WaitFor("slow");
+        observed = slow_done.load();
+    }, 4096);
+    boot.Run();
+    CHECK(observed);
+}
+
+int main() {
+    BenchmarkBoot();
+    TestWifiConfigDuringWakeWordLoad();
+    TestConcurrentTransitions();
+    TestWaitFor();
+    printf("boot sequence tests passed\n");
+    return 0;
+}
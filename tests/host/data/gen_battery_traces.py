@@ -0,0 +1,139 @@
+import math
+import random
+
+'''
+  Generates the battery traces replayed by battery_gauge_test.cc.
+
+  Each line is "seconds,battery_mv,load_ma,charging,true_level", one sample
+  per second as PowerManager takes them. battery_mv and load_ma are the
+  fields PowerManager logs ("Battery %d mV load %d mA ..."), so a capture
+  from a device can be converted to the same format; true_level is the
+  coulomb-counted state of charge, left empty for captures.
+
+  The cell is modelled independently of BatteryGauge, so the replay
+  measures the gauge against a different battery, not against its own
+  lookup table:
+  - OCV follows a 21-point table of a 1000 mAh NMC pouch cell (every 5%
+    of charge). It is not the gauge's 12-point curve: the two differ by
+    up to 15 mV above 10%, as between two cells of the same chemistry,
+    and by more below the knee.
+  - A second-order Thevenin model gives the terminal voltage: a series
+    resistance plus two RC branches (20 s and 300 s), so the voltage sags
+    and relaxes gradually after load steps instead of jumping by I*R.
+  - The series resistance rises as the temperature drops (Arrhenius,
+    doubling from 25 C to about 5 C), and the usable capacity falls by
+    0.5% per degree below 25 C.
+  - The simulation runs in 10 ms steps. The actual current is the state's
+    current times a slowly drifting factor (0.7-1.3), plus Wi-Fi TX bursts
+    of 250 mA lasting 2-20 ms. The sampled voltage is the average over a
+    105 ms ADC burst (64 samples at 611 Hz), plus 6 mV of ADC noise.
+  - The charger runs constant current at 450 mA up to 4.2 V, then
+    constant voltage.
+  The gauge only sees the device-state current estimate, as on the device.
+
+  Usage: python3 tests/host/data/gen_battery_traces.py
+'''
+
+OCV_TABLE = [3350, 3570, 3665, 3705, 3728, 3748, 3766, 3786, 3808, 3832, 3855,
+             3878, 3905, 3936, 3968, 4002, 4038, 4076, 4115, 4157, 4195]
+LOAD_MA = {'idle': 90, 'listening': 160, 'speaking': 380}
+CAPACITY_MAH = 1000
+R0_MOHM = 110
+R1_MOHM, TAU1_S = 45, 20.0
+R2_MOHM, TAU2_S = 55, 300.0
+CHARGE_MA = 450
+CHARGE_MV = 4200
+STEP_S = 0.01
+ADC_WINDOW_S = 64 / 611.0
+
+
+def ocv(soc):
+    '''Open-circuit voltage at a state of charge between 0 and 1.'''
+    x = max(0.0, min(1.0, soc)) * (len(OCV_TABLE) - 1)
+    i = min(int(x), len(OCV_TABLE) - 2)
+    return OCV_TABLE[i] + (x - i) * (OCV_TABLE[i + 1] - OCV_TABLE[i])
+
+
+def series_resistance(temperature_c):
+    # Arrhenius with 24 kJ/mol: about 2x from 25 C down to 5 C
+    return R0_MOHM * math.exp(2900 * (1 / (273.15 + temperature_c) - 1 / 298.15))
+
+
+def conversation(rng, seconds):
+    '''Turns of about 5 s listening and 8 s speaking, separated by idle gaps.'''
+    states = []
+    while len(states) < seconds:
+        states += ['idle'] * rng.randint(5, 60)
+        for _ in range(rng.randint(1, 4)):
+            states += ['listening'] * rng.randint(3, 7) + ['speaking'] * rng.randint(4, 14)
+    return states[:seconds]
+
+
+class Cell:
+    def __init__(self, level, temperature_c):
+        self.capacity_mah = CAPACITY_MAH * (1 - 0.005 * max(0.0, 25 - temperature_c))
+        self.soc = level / 100.0
+        self.r0 = series_resistance(temperature_c)
+        self.v1 = 0.0   # mV across each RC branch
+        self.v2 = 0.0
+
+    def step(self, current_ma):
+        '''Advances STEP_S with a discharge current (negative when charging), returns the terminal mV.'''
+        self.soc -= current_ma * STEP_S / 3600.0 / self.capacity_mah
+        self.soc = max(0.0, min(1.0, self.soc))
+        for name, r, tau in (('v1', R1_MOHM, TAU1_S), ('v2', R2_MOHM, TAU2_S)):
+            v = getattr(self, name)
+            target = current_ma * r / 1000.0
+            setattr(self, name, target + (v - target) * math.exp(-STEP_S / tau))
+        return ocv(self.soc) - current_ma * self.r0 / 1000.0 - self.v1 - self.v2
+
+    def charge_current(self):
+        '''Constant current until the terminal voltage reaches CHARGE_MV, then constant voltage.'''
+        headroom = CHARGE_MV - (ocv(self.soc) - self.v1 - self.v2)
+        return -max(0.0, min(CHARGE_MA, headroom * 1000.0 / self.r0))
+
+
+def write(name, level, schedule, seed, temperature_c=25):
+    rng = random.Random(seed)
+    cell = Cell(level, temperature_c)
+    factor = 1.0
+    steps_per_second = int(round(1 / STEP_S))
+    adc_steps = int(round(ADC_WINDOW_S / STEP_S))
+    with open(name, 'w') as f:
+        for t, (state, charging) in enumerate(schedule):
+            factor = max(0.7, min(1.3, factor + rng.gauss(0, 0.05)))
+            burst_left = 0
+            samples = []
+            for step in range(steps_per_second):
+                if charging:
+                    current = cell.charge_current()
+                else:
+                    current = LOAD_MA[state] * factor
+                    if burst_left == 0 and rng.random() < 0.02:
+                        burst_left = rng.randint(1, 2)
+                    if burst_left > 0:
+                        current += 250
+                        burst_left -= 1
+                mv = cell.step(current)
+                # PowerManager samples at the start of each second
+                if step < adc_steps:
+                    samples.append(mv)
+            mv = sum(samples) / len(samples) + rng.gauss(0, 6)
+            f.write('%d,%d,%d,%d,%d\n' % (t, round(mv), LOAD_MA[state], charging, round(cell.soc * 100)))
+
+
+def main():
+    rng = random.Random(1)
+    # 30 minutes of conversation from 72%
+    write('battery_conversation.csv', 72, [(s, 0) for s in conversation(rng, 1800)], 2)
+    # 10 minutes near cut-off
+    write('battery_low.csv', 9, [(s, 0) for s in conversation(rng, 600)], 3)
+    # idle, 15 minutes on the charger, then unplugged
+    schedule = [('idle', 0)] * 120 + [('idle', 1)] * 900 + [(s, 0) for s in conversation(rng, 600)]
+    write('battery_charge.csv', 40, schedule, 4)
+    # 20 minutes of conversation at 5 C: twice the series resistance
+    write('battery_cold.csv', 60, [(s, 0) for s in conversation(rng, 1200)], 5, temperature_c=5)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,269 @@
+#include "http_connection_pool.h"
+#include "host_test.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * 连接池复用的空闲连接已失效时的重发：
+ * - 服务器读完请求后断开、没有回响应：GET 换新连接重发一次，POST 不重发，服务器只收到一次
+ * - 服务器回完响应后关闭空闲连接：GET 换新连接重发，POST 直接失败，服务器没有收到这次请求
+ * - 新建的连接失败时不重发
+ */
+
+// 本机 HTTP 服务器，每个连接一个线程，按设定丢弃请求或在响应后关闭连接
+class StaleServer {
+public:
+    StaleServer() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(bind(listen_fd_, (sockaddr*)&address, sizeof(address)) == 0);
+        socklen_t length = sizeof(address);
+        getsockname(listen_fd_, (sockaddr*)&address, &length);
+        port_ = ntohs(address.sin_port);
+        CHECK(listen(listen_fd_, 8) == 0);
+        std::thread([this]() {
+            while (true) {
+                int fd = accept(listen_fd_, nullptr, nullptr);
+                if (fd < 0) {
+                    return;
+                }
+                std::thread([this, fd]() { Serve(fd); }).detach();
+            }
+        }).detach();
+    }
+
+    int port() const { return port_; }
+
+    // 之后收到的 count 个请求读完后直接断开，不回响应
+    void DropRequests(int count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop_ = count;
+    }
+
+    // 下一个响应发出后关闭连接，响应中不带 Connection: close，客户端仍把连接放回连接池
+    void CloseAfterResponse() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_after_response_ = true;
+    }
+
+    int requests(const std::string& method) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return method == "POST" ? posts_ : gets_;
+    }
+
+    int connections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connections_;
+    }
+
+private:
+    int listen_fd_;
+    int port_;
+    std::mutex mutex_;
+    int drop_ = 0;
+    bool close_after_response_ = false;
+    int gets_ = 0;
+    int posts_ = 0;
+    int connections_ = 0;
+
+    void Serve(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_++;
+        }
+        std::string buffer;
+        char chunk[1024];
+        while (true) {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                int n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                buffer.append(chunk, n);
+            }
+            std::string headers = buffer.substr(0, header_end + 2);
+            buffer.erase(0, header_end + 4);
+            std::string method = headers.substr(0, headers.find(' '));
+            size_t content_length = 0;
+            const char* field = strcasestr(headers.c_str(), "\r\ncontent-length:");
+            if (field != nullptr) {
+                content_length = strtoul(field + 17, nullptr, 10);
+            }
+            while (buffer.size() < content_length) {
+                int n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                buffer.append(chunk, n);
+            }
+            buffer.erase(0, content_length);
+
+            bool drop;
+            bool close_after_response;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                (method == "POST" ? posts_ : gets_)++;
+                drop = drop_ > 0;
+                if (drop) {
+                    drop_--;
+                }
+                close_after_response = !drop && close_after_response_;
+                close_after_response_ = false;
+            }
+            if (drop) {
+                close(fd);
+                return;
+            }
+            std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+            send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+            if (close_after_response) {
+                close(fd);
+                return;
+            }
+        }
+    }
+};
+
+class PosixTransport : public Transport {
+public:
+    ~PosixTransport() { Disconnect(); }
+
+    bool Connect(const char* host, int port) override {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, host, &address.sin_addr);
+        if (connect(fd_, (sockaddr*)&address, sizeof(address)) != 0) {
+            Disconnect();
+            return false;
+        }
+        connected_ = true;
+        return true;
+    }
+
+    void Disconnect() override {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        connected_ = false;
+    }
+
+    int Send(const char* data, size_t length) override {
+        int n = send(fd_, data, length, MSG_NOSIGNAL);
+        if (n <= 0) {
+            connected_ = false;
+        }
+        return n;
+    }
+
+    int Receive(char* buffer, size_t buffer_size) override {
+        int n = recv(fd_, buffer, buffer_size, 0);
+        if (n <= 0) {
+            connected_ = false;
+        }
+        return n;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+static HttpConnectionPool* pool;
+static std::string url;
+
+// 发送一个请求并读完响应，成功时连接回到连接池
+static bool Request(const std::string& method) {
+    PooledHttp http(*pool);
+    if (method == "POST") {
+        http.SetContent("{\"event\":\"stale\"}");
+    }
+    if (!http.Open(method, url)) {
+        return false;
+    }
+    CHECK(http.GetStatusCode() == 200);
+    CHECK(http.ReadAll() == "ok");
+    http.Close();
+    return true;
+}
+
+// 服务器处理过请求但连接断开：只有 GET 重发
+static void TestDroppedRequest(StaleServer& server) {
+    int connections = server.connections();
+    server.DropRequests(1);
+    CHECK(Request("GET"));
+    CHECK(server.requests("GET") == 4);
+    CHECK(server.connections() == connections + 1);
+
+    server.DropRequests(1);
+    CHECK(!Request("POST"));
+    CHECK(server.requests("POST") == 1);
+    CHECK(server.connections() == connections + 1);
+
+    // 失败的连接已丢弃，下一个 POST 使用新连接
+    CHECK(Request("POST"));
+    CHECK(server.requests("POST") == 2);
+    CHECK(server.connections() == connections + 2);
+}
+
+// 服务器关闭了空闲连接：GET 换新连接重发，POST 失败且服务器没有收到
+static void TestClosedIdleConnection(StaleServer& server) {
+    server.CloseAfterResponse();
+    CHECK(Request("GET"));
+    int gets = server.requests("GET");
+    int connections = server.connections();
+    CHECK(Request("GET"));
+    CHECK(server.requests("GET") == gets + 1);
+    CHECK(server.connections() == connections + 1);
+
+    int posts = server.requests("POST");
+    server.CloseAfterResponse();
+    CHECK(Request("GET"));
+    CHECK(!Request("POST"));
+    CHECK(server.requests("POST") == posts);
+    CHECK(Request("POST"));
+    CHECK(server.requests("POST") == posts + 1);
+}
+
+// 新建的连接上服务器断开时不重发
+static void TestFreshConnectionNotRetried(StaleServer& server) {
+    pool->Clear();
+    int gets = server.requests("GET");
+    server.DropRequests(1);
+    CHECK(!Request("GET"));
+    CHECK(server.requests("GET") == gets + 1);
+}
+
+int main() {
+    StaleServer server;
+    pool = new HttpConnectionPool([](bool tls, int timeout_ms) -> Transport* { return new PosixTransport(); });
+    url = "http://127.0.0.1:" + std::to_string(server.port()) + "/xiaozhi/ota/";
+
+    // 第一个请求建立连接，之后的请求复用
+    CHECK(Request("GET"));
+    CHECK(Request("GET"));
+    CHECK(server.connections() == 1);
+
+    TestDroppedRequest(server);
+    TestClosedIdleConnection(server);
+    TestFreshConnectionNotRetried(server);
+    delete pool;
+    printf("http connection pool tests passed\n");
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "link_quality_monitor.h"
+#include "host_test.h"
+
+#include <functional>
+#include <vector>
+
+/*
+ * 双网络切换策略在脚本化断网场景下的模拟，与 DualNetworkBoard::FailoverTask 一样每秒调用一次 Step，
+ * 按返回的动作启动 4G 或切换；这里只模拟两条链路：
+ * Wi-Fi 为首选网络并在开机时连上，4G 启动后约 10 秒注册上网络。
+ * 对话期间协议层每秒上报 16 次发送和 16 个收包，当前链路断开时发送失败，质量差时按比例丢包。
+ */
+
+static const int kModemStartSeconds = 10;
+
+struct Script {
+    std::function<bool(int)> wifi_up = [](int) { return true; };
+    std::function<bool(int)> wifi_lossy = [](int) { return false; };
+    std::function<bool(int)> speaking = [](int) { return false; };
+    bool modem_available = true;   // false 模拟没有 SIM 卡，4G 启动失败
+};
+
+struct Event {
+    int t;
+    bool to_wifi;
+};
+
+struct Trace {
+    std::vector<Event> switches;
+    int modem_start_at = -1;       // 第一次成功启动 4G 的时刻
+    int modem_attempts = 0;
+    int failed_sends = 0;          // 对话期间在断开的链路上发送失败的次数
+};
+
+static Trace Simulate(const Script& script, int seconds) {
+    LinkQualityMonitor monitor;
+    Trace trace;
+    bool on_wifi = true;
+    bool modem_started = false;
+    int modem_ready_at = -1;
+
+    for (int t = 0; t < seconds; t++) {
+        bool wifi_up = script.wifi_up(t);
+        bool modem_up = modem_started && t >= modem_ready_at;
+        bool active_up = on_wifi ? wifi_up : modem_up;
+        bool standby_up = on_wifi ? modem_up : wifi_up;
+        bool speaking = script.speaking(t);
+        if (speaking) {
+            for (int i = 0; i < 16; i++) {
+                monitor.RecordSend(active_up);
+                trace.failed_sends += active_up ? 0 : 1;
+            }
+            if (active_up) {
+                bool lossy = on_wifi && script.wifi_lossy(t);
+                for (int i = 0; i < 16; i++) {
+                    monitor.RecordReceive(lossy && i % 3 == 0 ? 1 : 0);
+                }
+            }
+        }
+
+        // Wi-Fi 一直启动着，备用链路是否已启动只看 4G
+        bool standby_started = on_wifi ? modem_started : true;
+        auto action = monitor.Step(t * 1000LL, active_up, standby_up, standby_started, !speaking);
+        if (action == kFailoverSwitch) {
+            on_wifi = !on_wifi;
+            monitor.OnSwitched(t * 1000LL, on_wifi);
+            trace.switches.push_back({ t, on_wifi });
+            continue;
+        }
+        if (action == kFailoverStartStandby) {
+            CHECK(!modem_started);
+            trace.modem_attempts++;
+            if (script.modem_available) {
+                modem_started = true;
+                modem_ready_at = t + kModemStartSeconds;
+                trace.modem_start_at = t;
+            }
+        }
+    }
+    return trace;
+}
+
+// 一直正常的 Wi-Fi 上反复对话，不启动 4G
+static void TestHealthyLinkKeepsStandbyOff() {
+    Script script;
+    script.speaking = [](int t) { return t % 60 < 20; };
+    auto trace = Simulate(script, 600);
+    CHECK(trace.modem_attempts == 0);
+    CHECK(trace.switches.empty());
+}
+
+// 对话中 Wi-Fi 断开 70 秒：第一个坏窗口启动 4G，注册上后立即切换；Wi-Fi 恢复 30 秒后在空闲时切回
+static void TestOutageDuringConversation() {
+    Script script;
+    script.wifi_up = [](int t) { return !(t >= 50 && t < 120); };
+    script.speaking = [](int t) { return t < 80 || (t >= 150 && t < 170); };
+    auto trace = Simulate(script, 300);
+    CHECK(trace.modem_start_at == 50);
+    CHECK(trace.switches.size() == 2);
+    CHECK(!trace.switches[0].to_wifi && trace.switches[0].t == 50 + kModemStartSeconds);
+    // Wi-Fi 120 秒恢复，等 30 秒，且 150~170 秒在对话中，对话结束后才切回
+    CHECK(trace.switches[1].to_wifi && trace.switches[1].t == 170);
+    printf("outage 50-120 s: 4G started at %d s, failover at %d s, back to Wi-Fi at %d s, %d failed sends\n",
+        trace.modem_start_at, trace.switches[0].t, trace.switches[1].t, trace.failed_sends);
+}
+
+// 2 秒的短暂中断只准备备用链路，不切换
+static void TestShortBlip() {
+    Script script;
+    script.wifi_up = [](int t) { return !(t >= 30 && t < 32); };
+    script.speaking = [](int t) { return t < 60; };
+    auto trace = Simulate(script, 120);
+    CHECK(trace.modem_start_at == 30);
+    CHECK(trace.switches.empty());
+}
+
+// Wi-Fi 在线但丢包严重：切到 4G，空闲时切回；切回后保持期内 Wi-Fi 又变差，保持期满才再次切走，
+// 由于切回后很快又变差，下次切回的等待时间加倍
+static void TestLossyRelapse() {
+    Script script;
+    script.wifi_lossy = [](int t) { return (t >= 20 && t < 40) || (t >= 120 && t < 170); };
+    script.speaking = [](int t) { return t < 45 || (t >= 110 && t < 180); };
+    auto trace = Simulate(script, 400);
+    CHECK(trace.switches.size() == 4);
+    // 4G 注册前不切换，注册后立即切走
+    CHECK(!trace.switches[0].to_wifi && trace.switches[0].t == 20 + kModemStartSeconds);
+    // Wi-Fi 恢复 30 秒后空闲，但切换后的 60 秒保持期未满
+    CHECK(trace.switches[1].to_wifi && trace.switches[1].t == trace.switches[0].t + 60);
+    CHECK(!trace.switches[2].to_wifi && trace.switches[2].t == trace.switches[1].t + 60);
+    CHECK(trace.switches[3].to_wifi && trace.switches[3].t - trace.switches[2].t >= 60);
+    printf("lossy relapse: switches at");
+    for (const auto& e : trace.switches) {
+        printf(" %d s (%s)", e.t, e.to_wifi ? "wifi" : "4g");
+    }
+    printf("\n");
+}
+
+// 切到 4G 后保持 60 秒，4G 质量变差但仍在线时不立即切回
+static void TestDwellAfterSwitch() {
+    LinkQualityMonitor monitor;
+    CHECK(monitor.Evaluate(0, false, true, false) == kLinkPrepare);
+    monitor.Evaluate(1000, false, true, false);
+    CHECK(monitor.Evaluate(2000, false, true, false) == kLinkSwitch);
+    monitor.OnSwitched(2000, false);
+    for (int t = 3; t < 62; t++) {
+        for (int i = 0; i < 10; i++) {
+            monitor.RecordSend(false);
+        }
+        CHECK(monitor.Evaluate(t * 1000LL, true, true, false) != kLinkSwitch);
+    }
+    for (int i = 0; i < 10; i++) {
+        monitor.RecordSend(false);
+    }
+    CHECK(monitor.Evaluate(62000, true, true, false) == kLinkSwitch);
+    // 当前链路断开时不等待保持时间
+    monitor.OnSwitched(62000, true);
+    monitor.Evaluate(63000, false, true, false);
+    monitor.Evaluate(64000, false, true, false);
+    CHECK(monitor.Evaluate(65000, false, true, false) == kLinkSwitch);
+}
+
+// 没有 SIM 卡：变差期间每 10 秒重试一次启动 4G，不切换
+static void TestStandbyUnavailable() {
+    Script script;
+    script.wifi_up = [](int t) { return !(t >= 10 && t < 70); };
+    script.speaking = [](int t) { return t < 100; };
+    script.modem_available = false;
+    auto trace = Simulate(script, 120);
+    CHECK(trace.switches.empty());
+    CHECK(trace.modem_attempts == 6);
+}
+
+// 备用链路只在开始变差时启动，已启动时不再启动，启动失败后按间隔重试
+static void TestStepStartsStandbyOnDemand() {
+    LinkQualityMonitor monitor;
+    CHECK(monitor.Step(0, true, false, false, true) == kFailoverNone);
+    CHECK(monitor.Step(1000, false, false, false, true) == kFailoverStartStandby);
+    // 启动失败：10 秒内不重试
+    for (int t = 2; t < 11; t++) {
+        CHECK(monitor.Step(t * 1000LL, false, false, false, true) == kFailoverNone);
+    }
+    CHECK(monitor.Step(11000, false, false, false, true) == kFailoverStartStandby);
+    // 启动成功但尚未注册：继续等待，不重复启动
+    CHECK(monitor.Step(12000, false, false, true, true) == kFailoverNone);
+    CHECK(monitor.Step(30000, false, false, true, true) == kFailoverNone);
+    CHECK(monitor.Step(31000, false, true, true, true) == kFailoverSwitch);
+}
+
+int main() {
+    TestHealthyLinkKeepsStandbyOff();
+    TestOutageDuringConversation();
+    TestShortBlip();
+    TestLossyRelapse();
+    TestDwellAfterSwitch();
+    TestStandbyUnavailable();
+    TestStepStartsStandbyOnDemand();
+    printf("link quality monitor tests passed\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "local_command_router.h"
+#include "host_test.h"
+
+#include <set>
+
+/*
+ * 本地命令词到 MCP 工具调用的映射：相对调节的步长和边界、没有背光时交给云端、
+ * 停止只结束唤醒，以及中英文命令词表的完整性。
+ */
+
+static const char* kVolumeTool = "self.audio_speaker.set_volume";
+static const char* kBrightnessTool = "self.screen.set_brightness";
+
+static LocalCommandAction RouteOk(int command, int volume, int brightness) {
+    LocalCommandState state;
+    state.volume = volume;
+    state.brightness = brightness;
+    LocalCommandAction action;
+    CHECK(LocalCommandRouter::Route(command, state, action));
+    return action;
+}
+
+static void TestVolume() {
+    auto action = RouteOk(kLocalCommandVolumeUp, 60, -1);
+    CHECK(!action.stop && action.tool == kVolumeTool && action.value == 70);
+    CHECK(LocalCommandRouter::GetArgumentsJson(action) == "{\"volume\":70}");
+    CHECK(RouteOk(kLocalCommandVolumeDown, 60, -1).value == 50);
+    // 到达边界后保持在 0~100
+    CHECK(RouteOk(kLocalCommandVolumeUp, 95, -1).value == 100);
+    CHECK(RouteOk(kLocalCommandVolumeUp, 100, -1).value == 100);
+    CHECK(RouteOk(kLocalCommandVolumeDown, 5, -1).value == 0);
+}
+
+static void TestBrightness() {
+    auto action = RouteOk(kLocalCommandBrighter, 50, 40);
+    CHECK(action.tool == kBrightnessTool && action.value == 60);
+    CHECK(LocalCommandRouter::GetArgumentsJson(action) == "{\"brightness\":60}");
+    CHECK(RouteOk(kLocalCommandBrighter, 50, 90).value == 100);
+    CHECK(RouteOk(kLocalCommandDimmer, 50, 60).value == 40);
+    // 本地调暗不低于 10，不会熄屏；已经低于 10 时保持不变
+    CHECK(RouteOk(kLocalCommandDimmer, 50, 25).value == 10);
+    CHECK(RouteOk(kLocalCommandDimmer, 50, 5).value == 5);
+
+    // 没有背光的板卡交给云端
+    LocalCommandState state;
+    state.brightness = -1;
+    LocalCommandAction action_without_backlight;
+    CHECK(!LocalCommandRouter::Route(kLocalCommandBrighter, state, action_without_backlight));
+    CHECK(!LocalCommandRouter::Route(kLocalCommandDimmer, state, action_without_backlight));
+}
+
+static void TestStopAndUnknown() {
+    auto action = RouteOk(kLocalCommandStop, 50, 50);
+    CHECK(action.stop && action.tool.empty());
+    CHECK(LocalCommandRouter::GetArgumentsJson(action) == "{}");
+
+    // 未知命令返回 false，并清除上一次的结果
+    LocalCommandState state;
+    action = RouteOk(kLocalCommandVolumeUp, 50, 50);
+    CHECK(!LocalCommandRouter::Route(kLocalCommandCount, state, action));
+    CHECK(!LocalCommandRouter::Route(-1, state, action));
+    CHECK(action.tool.empty() && !action.stop);
+}
+
+// 每个命令在两种语言下都有说法，说法不重复；中文模型只接受小写拼音和空格
+static void TestPhrases() {
+    const char* languages[] = { "cn", "en" };
+    for (auto language : languages) {
+        auto phrases = LocalCommandRouter::GetPhrases(language);
+        std::set<int> commands;
+        std::set<std::string> texts;
+        for (auto& phrase : phrases) {
+            CHECK(phrase.first >= 0 && phrase.first < kLocalCommandCount);
+            CHECK(!phrase.second.empty());
+            CHECK(texts.insert(phrase.second).second);
+            commands.insert(phrase.first);
+            for (char c : phrase.second) {
+                CHECK((c >= 'a' && c <= 'z') || c == ' ');
+            }
+        }
+        CHECK((int)commands.size() == kLocalCommandCount);
+    }
+    // 非中文模型都使用英文命令词
+    CHECK(LocalCommandRouter::GetPhrases("ja") == LocalCommandRouter::GetPhrases("en"));
+}
+
+int main() {
+    TestVolume();
+    TestBrightness();
+    TestStopAndUnknown();
+    TestPhrases();
+    printf("local command router tests passed\n");
+    return 0;
+}
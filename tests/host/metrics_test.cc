@@ -0,0 +1,113 @@
+#include "metrics.h"
+#include "host_test.h"
+
+#include <cJSON.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * 指标注册表：重复注册返回同一指标、超出容量返回占位指标，
+ * 多线程累加不丢计数，直方图 sum 超过 32 位后仍然准确。
+ */
+
+static cJSON* Snapshot() {
+    auto json = Metrics::GetInstance().GetSnapshotJson();
+    cJSON* root = cJSON_Parse(json.c_str());
+    CHECK(root != nullptr);
+    return root;
+}
+
+static double Field(cJSON* root, const char* group, const char* name) {
+    cJSON* item = cJSON_GetObjectItem(cJSON_GetObjectItem(root, group), name);
+    CHECK(cJSON_IsNumber(item));
+    return item->valuedouble;
+}
+
+static void TestRegistration() {
+    auto& metrics = Metrics::GetInstance();
+    auto counter = metrics.Counter("test.counter");
+    CHECK(metrics.Counter("test.counter") == counter);
+    counter->Increment();
+    counter->Increment(2);
+    metrics.Gauge("test.gauge")->Set(-3);
+    metrics.Gauge("test.gauge")->Add(1);
+
+    // 同名直方图保留首次注册的桶
+    auto histogram = metrics.Histogram("test.histogram", { 10, 20 });
+    CHECK(metrics.Histogram("test.histogram", { 1 }) == histogram);
+    histogram->Record(5);
+    histogram->Record(10);
+    histogram->Record(15);
+    histogram->Record(99);
+
+    cJSON* root = Snapshot();
+    CHECK(Field(root, "counters", "test.counter") == 3);
+    CHECK(Field(root, "gauges", "test.gauge") == -2);
+    cJSON* item = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "histograms"), "test.histogram");
+    CHECK(item != nullptr);
+    cJSON* counts = cJSON_GetObjectItem(item, "counts");
+    CHECK(cJSON_GetArraySize(counts) == 3);
+    CHECK(cJSON_GetArrayItem(counts, 0)->valueint == 2);
+    CHECK(cJSON_GetArrayItem(counts, 1)->valueint == 1);
+    CHECK(cJSON_GetArrayItem(counts, 2)->valueint == 1);
+    CHECK(cJSON_GetObjectItem(item, "sum")->valuedouble == 129);
+    CHECK(cJSON_GetObjectItem(item, "max")->valuedouble == 99);
+    cJSON_Delete(root);
+}
+
+static void TestOverflow() {
+    auto& metrics = Metrics::GetInstance();
+    static std::vector<std::string> names;
+    for (int i = 0; i < METRICS_MAX_COUNTERS + 2; i++) {
+        names.push_back("test.overflow." + std::to_string(i));
+    }
+    MetricCounter* last = nullptr;
+    for (auto& name : names) {
+        last = metrics.Counter(name.c_str());
+        CHECK(last != nullptr);
+    }
+    // 占位指标可以正常使用，但不导出
+    last->Increment();
+    cJSON* root = Snapshot();
+    CHECK(cJSON_GetArraySize(cJSON_GetObjectItem(root, "counters")) == METRICS_MAX_COUNTERS);
+    CHECK(cJSON_GetObjectItem(cJSON_GetObjectItem(root, "counters"), names.back().c_str()) == nullptr);
+    cJSON_Delete(root);
+}
+
+static void TestConcurrentRecord() {
+    auto& metrics = Metrics::GetInstance();
+    // 四个线程各记录 1250 个 1 秒的耗时（微秒），总和 5e9 超过 uint32 上限
+    const int kThreads = 4;
+    const int kSamples = 1250;
+    const int32_t kValue = 1000000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&metrics]() {
+            auto histogram = metrics.Histogram("test.decode_us", { 1000, 100000 });
+            for (int i = 0; i < kSamples; i++) {
+                histogram->Record(kValue);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    cJSON* root = Snapshot();
+    cJSON* item = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "histograms"), "test.decode_us");
+    CHECK(item != nullptr);
+    CHECK(cJSON_GetArrayItem(cJSON_GetObjectItem(item, "counts"), 2)->valueint == kThreads * kSamples);
+    CHECK(cJSON_GetObjectItem(item, "sum")->valuedouble == 5e9);
+    CHECK(cJSON_GetObjectItem(item, "max")->valuedouble == kValue);
+    cJSON_Delete(root);
+}
+
+int main() {
+    TestRegistration();
+    TestOverflow();
+    TestConcurrentRecord();
+    printf("metrics tests passed\n");
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "opus_frame_encoder.h"
+#include "opus_decode_rate.h"
+#include "polyphase_resampler.h"
+#include "host_test.h"
+
+#include <opus.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <vector>
+
+/*
+ * 下行 TTS 的解码路径对比：服务器按 24 kHz 编码，设备输出为 16/48 kHz（Opus 支持的采样率）时，
+ * 按 24 kHz 解码后重采样，与按 OpusDecodeSampleRate 选出的输出采样率直接解码。
+ * 给出每秒音频的解码和重采样 CPU 时间，以及相对按输出采样率生成的参考信号的信噪比；
+ * 44.1 kHz 不是 Opus 支持的采样率，仍然解码后重采样，只作为对照。
+ * CPU 时间只用于比较两条路径，不做断言；信噪比要求直接解码不差于重采样。
+ */
+
+static const int kStreamSampleRate = 24000;
+static const int kFrameDuration = 60;
+static const int kSeconds = 4;
+
+// 类似浊音的信号：基频 110~210 Hz 缓慢变化，25 次谐波（最高约 5.3 kHz），按 4 Hz 的音节包络起伏。
+// 按时间解析计算，任何采样率下都是同一个带限信号
+static double Speech(double t) {
+    const double kPi = 3.14159265358979323846;
+    double phase = 2 * kPi * (160 * t - 50 / (2 * kPi * 0.7) * cos(2 * kPi * 0.7 * t));
+    double value = 0;
+    for (int k = 1; k <= 25; k++) {
+        value += sin(k * phase) / k;
+    }
+    double envelope = 0.55 + 0.45 * sin(2 * kPi * 4 * t);
+    return 6000 * envelope * value;
+}
+
+static std::vector<int16_t> Generate(int sample_rate) {
+    std::vector<int16_t> pcm(sample_rate * kSeconds);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (int16_t)lrint(Speech((double)i / sample_rate));
+    }
+    return pcm;
+}
+
+// 用固件的上行编码器按服务器的采样率和帧长编码
+static std::vector<std::vector<uint8_t>> Encode() {
+    auto pcm = Generate(kStreamSampleRate);
+    OpusFrameEncoder encoder(kStreamSampleRate, kFrameDuration, 2);
+    encoder.SetDtx(false);
+    std::vector<std::vector<uint8_t>> packets;
+    size_t frame_samples = kStreamSampleRate * kFrameDuration / 1000;
+    for (size_t offset = 0; offset + frame_samples <= pcm.size(); offset += frame_samples) {
+        CHECK(encoder.Write(pcm.data() + offset, frame_samples));
+        packets.emplace_back();
+        CHECK(encoder.EncodeFrame(packets.back()));
+    }
+    return packets;
+}
+
+struct PathResult {
+    double decode_us = 0;
+    double resample_us = 0;
+    double snr_db = 0;
+};
+
+static double CpuMicros(clock_t start) {
+    return (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC;
+}
+
+// 在 0~40 ms 的延迟内找到与参考信号最相关的位置，按最小二乘增益对齐后计算信噪比，跳过开头 200 ms
+static double Snr(const std::vector<int16_t>& reference, const std::vector<int16_t>& decoded, int sample_rate) {
+    size_t skip = sample_rate / 5;
+    size_t max_lag = sample_rate / 25;
+    size_t length = std::min(reference.size(), decoded.size()) - max_lag - skip;
+    double best_correlation = -1;
+    size_t best_lag = 0;
+    for (size_t lag = 0; lag <= max_lag; lag++) {
+        double xy = 0, yy = 0;
+        for (size_t i = skip; i < skip + length; i++) {
+            xy += (double)reference[i] * decoded[i + lag];
+            yy += (double)decoded[i + lag] * decoded[i + lag];
+        }
+        double correlation = yy > 0 ? xy / sqrt(yy) : 0;
+        if (correlation > best_correlation) {
+            best_correlation = correlation;
+            best_lag = lag;
+        }
+    }
+
+    double xy = 0, yy = 0;
+    for (size_t i = skip; i < skip + length; i++) {
+        xy += (double)reference[i] * decoded[i + best_lag];
+        yy += (double)decoded[i + best_lag] * decoded[i + best_lag];
+    }
+    double gain = yy > 0 ? xy / yy : 0;
+    double signal = 0, noise = 0;
+    for (size_t i = skip; i < skip + length; i++) {
+        double error = reference[i] - gain * decoded[i + best_lag];
+        signal += (double)reference[i] * reference[i];
+        noise += error * error;
+    }
+    return 10 * log10(signal / std::max(noise, 1.0));
+}
+
+// 按 decode_sample_rate 解码全部数据包，与输出采样率不同时再重采样，重复 repeat 次取平均耗时
+static PathResult Run(const std::vector<std::vector<uint8_t>>& packets, int decode_sample_rate, int output_sample_rate,
+                      int repeat) {
+    PathResult result;
+    std::vector<int16_t> output;
+    int frame_samples = decode_sample_rate * kFrameDuration / 1000;
+    std::vector<int16_t> frame(frame_samples);
+    std::vector<int16_t> resampled;
+    for (int round = 0; round < repeat; round++) {
+        int error;
+        OpusDecoder* decoder = opus_decoder_create(decode_sample_rate, 1, &error);
+        CHECK(decoder != nullptr);
+        PolyphaseResampler resampler;
+        bool resampling = decode_sample_rate != output_sample_rate;
+        if (resampling) {
+            CHECK(resampler.Configure(decode_sample_rate, output_sample_rate));
+        }
+        output.clear();
+
+        for (const auto& packet : packets) {
+            clock_t start = clock();
+            int samples = opus_decode(decoder, packet.data(), packet.size(), frame.data(), frame_samples, 0);
+            result.decode_us += CpuMicros(start);
+            CHECK(samples == frame_samples);
+
+            if (resampling) {
+                start = clock();
+                resampled.resize(resampler.GetOutputSamples(samples));
+                size_t produced = resampler.Process(frame.data(), samples, resampled.data());
+                result.resample_us += CpuMicros(start);
+                output.insert(output.end(), resampled.begin(), resampled.begin() + produced);
+            } else {
+                output.insert(output.end(), frame.begin(), frame.end());
+            }
+        }
+        opus_decoder_destroy(decoder);
+    }
+
+    double audio_seconds = (double)packets.size() * kFrameDuration / 1000 * repeat;
+    result.decode_us /= audio_seconds;
+    result.resample_us /= audio_seconds;
+    result.snr_db = Snr(Generate(output_sample_rate), output, output_sample_rate);
+    return result;
+}
+
+static void Print(const char* path, int output_sample_rate, const PathResult& result) {
+    printf("%-26s %6d %10.0f %10.0f %10.0f %8.1f\n", path, output_sample_rate, result.decode_us, result.resample_us,
+        result.decode_us + result.resample_us, result.snr_db);
+}
+
+int main(int argc, char** argv) {
+    int repeat = argc > 1 ? atoi(argv[1]) : 1;
+    auto packets = Encode();
+    printf("%zu packets of %d ms at %d Hz\n", packets.size(), kFrameDuration, kStreamSampleRate);
+    printf("%-26s %6s %10s %10s %10s %8s\n", "path", "output", "decode", "resample", "us/s audio", "SNR dB");
+
+    for (int output_sample_rate : { 16000, 48000 }) {
+        CHECK(OpusDecodeSampleRate(output_sample_rate, kStreamSampleRate) == output_sample_rate);
+        auto resampled = Run(packets, kStreamSampleRate, output_sample_rate, repeat);
+        auto direct = Run(packets, output_sample_rate, output_sample_rate, repeat);
+        Print("decode 24k + resample", output_sample_rate, resampled);
+        Print("decode at output rate", output_sample_rate, direct);
+        CHECK(direct.snr_db > resampled.snr_db - 0.5);
+    }
+
+    // 44.1 kHz 仍按码流采样率解码后重采样
+    CHECK(OpusDecodeSampleRate(44100, kStreamSampleRate) == kStreamSampleRate);
+    Print("decode 24k + resample", 44100, Run(packets, kStreamSampleRate, 44100, repeat));
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include "ota.h"
+#include "settings.h"
+#include "system_info.h"
+#include "http_connection_pool.h"
+#include "host_test.h"
+
+#include <esp_ota_ops.h>
+#include <nvs_flash.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * OTA 配置缓存对照本机的替身服务器：
+ * - 首次启动正常检查并写入缓存，之后按缓存启动，后台重新检查时带 If-None-Match，配置未变（POST 为 412，GET 为 304）时不写 flash
+ * - 服务器轮换令牌或更换地址：不需要重启，新参数写入 NVS，供下次打开音频通道时读取
+ * - 有新固件、需要激活或协议类型变化时需要重启；固件版本变化后缓存失效
+ */
+
+// 本机 HTTP 服务器，每个连接一个线程，支持 keep-alive 与 If-None-Match
+class StandInServer {
+public:
+    StandInServer() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(bind(listen_fd_, (sockaddr*)&address, sizeof(address)) == 0);
+        socklen_t length = sizeof(address);
+        getsockname(listen_fd_, (sockaddr*)&address, &length);
+        port_ = ntohs(address.sin_port);
+        CHECK(listen(listen_fd_, 8) == 0);
+        std::thread([this]() {
+            while (true) {
+                int fd = accept(listen_fd_, nullptr, nullptr);
+                if (fd < 0) {
+                    return;
+                }
+                std::thread([this, fd]() { Serve(fd); }).detach();
+            }
+        }).detach();
+    }
+
+    int port() const { return port_; }
+
+    void SetConfig(const std::string& body, const std::string& etag) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        body_ = body;
+        etag_ = etag;
+    }
+
+    int requests() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+
+    int not_modified() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return not_modified_;
+    }
+
+    int connections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connections_;
+    }
+
+private:
+    int listen_fd_;
+    int port_;
+    std::mutex mutex_;
+    std::string body_;
+    std::string etag_;
+    int requests_ = 0;
+    int not_modified_ = 0;
+    int connections_ = 0;
+
+    void Serve(int fd) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_++;
+        }
+        std::string buffer;
+        char chunk[1024];
+        while (true) {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                int n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                buffer.append(chunk, n);
+            }
+            std::string headers = buffer.substr(0, header_end + 2);
+            buffer.erase(0, header_end + 4);
+            std::string method = headers.substr(0, headers.find(' '));
+            size_t content_length = 0;
+            std::string if_none_match;
+            size_t pos = 0;
+            while (pos < headers.size()) {
+                size_t end = headers.find("\r\n", pos);
+                std::string line = headers.substr(pos, end - pos);
+                pos = end + 2;
+                size_t colon = line.find(':');
+                if (colon == std::string::npos) {
+                    continue;
+                }
+                std::string name = line.substr(0, colon);
+                std::string value = line.substr(line.find_first_not_of(' ', colon + 1));
+                for (auto& c : name) {
+                    c = tolower(c);
+                }
+                if (name == "content-length") {
+                    content_length = std::stoul(value);
+                } else if (name == "if-none-match") {
+                    if_none_match = value;
+                }
+            }
+            while (buffer.size() < content_length) {
+                int n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                buffer.append(chunk, n);
+            }
+            buffer.erase(0, content_length);
+
+            std::string response;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requests_++;
+                if (!if_none_match.empty() && if_none_match == etag_) {
+                    not_modified_++;
+                    // 条件请求只有 GET/HEAD 回 304，其他方法条件不满足时回 412
+                    if (method == "GET" || method == "HEAD") {
+                        response = "HTTP/1.1 304 Not Modified\r\nETag: " + etag_ + "\r\n\r\n";
+                    } else {
+                        response = "HTTP/1.1 412 Precondition Failed\r\nETag: " + etag_ + "\r\nContent-Length: 0\r\n\r\n";
+                    }
+                } else {
+                    response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nETag: " + etag_ +
+                        "\r\nContent-Length: " + std::to_string(body_.size()) + "\r\n\r\n" + body_;
+                }
+            }
+            send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+        }
+    }
+};
+
+class PosixTransport : public Transport {
+public:
+    ~PosixTransport() { Disconnect(); }
+
+    bool Connect(const char* host, int port) override {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, host, &address.sin_addr);
+        if (connect(fd_, (sockaddr*)&address, sizeof(address)) != 0) {
+            Disconnect();
+            return false;
+        }
+        connected_ = true;
+        return true;
+    }
+
+    void Disconnect() override {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        connected_ = false;
+    }
+
+    int Send(const char* data, size_t length) override {
+        int n = send(fd_, data, length, MSG_NOSIGNAL);
+        if (n <= 0) {
+            connected_ = false;
+        }
+        return n;
+    }
+
+    int Receive(char* buffer, size_t buffer_size) override {
+        int n = recv(fd_, buffer, buffer_size, 0);
+        if (n <= 0) {
+            connected_ = false;
+        }
+        return n;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+class TestBoard : public Board {
+public:
+    HttpConnectionPool pool{ [](bool tls, int timeout_ms) -> Transport* { return new PosixTransport(); } };
+
+    Display* GetDisplay() override { return nullptr; }
+    void SetPowerSaveMode(bool enabled) override {}
+    Http* CreateHttp() override { return new PooledHttp(pool); }
+};
+
+Board& Board::GetInstance() {
+    static TestBoard board;
+    return board;
+}
+
+static esp_app_desc_t app_description = { 0, 0, {}, "1.6.0", "xiaozhi" };
+
+const esp_app_desc_t* esp_app_get_description() {
+    return &app_description;
+}
+
+std::string SystemInfo::GetMacAddress() {
+    return "02:00:00:00:00:01";
+}
+
+// 本测试不涉及升级和分区状态
+void esp_restart() { abort(); }
+const esp_partition_t* esp_ota_get_running_partition() { return nullptr; }
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) { return nullptr; }
+esp_err_t esp_ota_get_state_partition(const esp_partition_t*, esp_ota_img_states_t*) { return ESP_FAIL; }
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_FAIL; }
+esp_err_t esp_ota_begin(const esp_partition_t*, size_t, esp_ota_handle_t*) { return ESP_FAIL; }
+esp_err_t esp_ota_write(esp_ota_handle_t, const void*, size_t) { return ESP_FAIL; }
+esp_err_t esp_ota_end(esp_ota_handle_t) { return ESP_FAIL; }
+esp_err_t esp_ota_abort(esp_ota_handle_t) { return ESP_FAIL; }
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t*) { return ESP_FAIL; }
+
+// 响应中不带 server_time，否则解析时 settimeofday 会改动主机的系统时间
+static std::string WebsocketConfig(const std::string& token, const std::string& firmware = "1.6.0") {
+    return "{\"firmware\":{\"version\":\"" + firmware + "\",\"url\":\"http://127.0.0.1/fw.bin\"},"
+        "\"websocket\":{\"url\":\"wss://api.example.com/xiaozhi/v1/\",\"token\":\"" + token + "\",\"version\":3}}";
+}
+
+static std::string SettingsString(const char* ns, const char* key) {
+    Settings settings(ns, false);
+    return settings.GetString(key);
+}
+
+// 与 Application 按缓存启动的流程一致：先用缓存，再在后台重新检查
+struct Revalidation {
+    bool cached;
+    bool restart;
+    bool changed;
+};
+
+static Revalidation BootAndRevalidate() {
+    Ota boot_ota;
+    Revalidation result = {};
+    result.cached = boot_ota.LoadCachedConfig();
+    Ota ota;
+    CHECK(ota.CheckVersion());
+    result.restart = ota.RequiresRestart();
+    result.changed = ota.HasConfigChanged();
+    return result;
+}
+
+int main() {
+    StandInServer server;
+    {
+        Settings wifi("wifi", true);
+        wifi.SetString("ota_url", "http://127.0.0.1:" + std::to_string(server.port()) + "/xiaozhi/ota/");
+    }
+
+    // 首次启动：没有缓存，正常检查后写入缓存
+    server.SetConfig(WebsocketConfig("token-a"), "\"v1\"");
+    {
+        Ota ota;
+        CHECK(!ota.LoadCachedConfig());
+        CHECK(ota.CheckVersion());
+        CHECK(ota.HasWebsocketConfig() && !ota.HasNewVersion());
+        CHECK(!ota.RequiresRestart());
+        CHECK(SettingsString("websocket", "token") == "token-a");
+    }
+
+    // 按缓存启动，配置没有变化：检查请求是 POST，服务器回 412，不重启，不写 flash
+    int writes = HostNvsWrites();
+    auto result = BootAndRevalidate();
+    CHECK(result.cached && !result.restart && !result.changed);
+    CHECK(server.not_modified() == 1);
+    CHECK(HostNvsWrites() == writes);
+
+    // 令牌轮换：不重启，新令牌已写入 NVS，缓存更新后再次检查又是 412
+    server.SetConfig(WebsocketConfig("token-b"), "\"v2\"");
+    result = BootAndRevalidate();
+    CHECK(result.cached && !result.restart && result.changed);
+    CHECK(SettingsString("websocket", "token") == "token-b");
+    result = BootAndRevalidate();
+    CHECK(result.cached && !result.restart && !result.changed);
+    CHECK(server.not_modified() == 2);
+
+    // 协议从 WebSocket 切换到 MQTT：需要重启以创建新的协议对象
+    server.SetConfig("{\"mqtt\":{\"endpoint\":\"mqtt.example.com:8883\",\"client_id\":\"c1\",\"username\":\"u\","
+        "\"password\":\"p\",\"publish_topic\":\"device-server\"}}", "\"v3\"");
+    result = BootAndRevalidate();
+    CHECK(result.cached && result.restart);
+    CHECK(SettingsString("mqtt", "endpoint") == "mqtt.example.com:8883");
+
+    // MQTT 密码轮换：不重启，MqttProtocol 打开音频通道时发现参数变化后重连
+    server.SetConfig("{\"mqtt\":{\"endpoint\":\"mqtt.example.com:8883\",\"client_id\":\"c1\",\"username\":\"u\","
+        "\"password\":\"p2\",\"publish_topic\":\"device-server\"}}", "\"v4\"");
+    result = BootAndRevalidate();
+    CHECK(result.cached && !result.restart && result.changed);
+    CHECK(SettingsString("mqtt", "password") == "p2");
+
+    // 服务器要求激活：重启并清除缓存，下次启动走正常的检查流程
+    server.SetConfig("{\"activation\":{\"code\":\"123456\",\"message\":\"xiaozhi.me\"},"
+        "\"mqtt\":{\"endpoint\":\"mqtt.example.com:8883\"}}", "\"v5\"");
+    result = BootAndRevalidate();
+    CHECK(result.cached && result.restart);
+    {
+        Ota ota;
+        CHECK(!ota.LoadCachedConfig());
+    }
+
+    // 有新固件：重启升级
+    server.SetConfig(WebsocketConfig("token-c"), "\"v6\"");
+    {
+        Ota ota;
+        CHECK(ota.CheckVersion());
+    }
+    server.SetConfig(WebsocketConfig("token-c", "1.7.0"), "\"v7\"");
+    result = BootAndRevalidate();
+    CHECK(result.cached && result.restart);
+
+    // 升级后的固件不使用旧版本的缓存
+    server.SetConfig(WebsocketConfig("token-c"), "\"v8\"");
+    {
+        Ota ota;
+        CHECK(ota.CheckVersion());
+    }
+    strcpy(app_description.version, "1.6.1");
+    {
+        Ota ota;
+        CHECK(!ota.LoadCachedConfig());
+    }
+
+    printf("ota config: %d requests (%d not modified) over %d connections\n",
+        server.requests(), server.not_modified(), server.connections());
+    printf("ota config tests passed\n");
+    return 0;
+}
@@ -0,0 +1,332 @@
+#include "playback_pipeline.h"
+#include "background_task.h"
+#include "metrics.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <initializer_list>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * 播放流水线的主机模拟：假的编解码芯片按采样率逐个描述符消耗 DMA 缓冲，
+ * 写满时阻塞，播空时补零并记录真实的静音次数；GetOutputPendingUs 与 AudioCodec 的计算方式相同。
+ * 被测的是 Application 使用的 PlaybackPipeline：先在后台任务中安排下一帧解码，再阻塞写入当前帧。
+ * 对照组是改动前的串行方式：后台任务中解码一帧、同步写入、再取下一帧。
+ *
+ * 所有时长按 kTimeScale 缩短，比例与设备一致：24 kHz 输出，100 ms 一帧，DMA 3 x 240 帧（30 ms）。
+ */
+
+static const int kTimeScale = 2;
+static const int kSampleRate = 24000;
+static const int kFrameDurationMs = 100;
+static const int kFrameSamples = kSampleRate * kFrameDurationMs / 1000;
+static const int kDmaDescNum = 3;
+static const int kDmaFrameNum = 240;
+
+static void SleepScaledUs(int64_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us / kTimeScale));
+}
+
+class FakeCodec {
+public:
+    FakeCodec() : dma_thread_([this]() { DmaLoop(); }) {}
+    ~FakeCodec() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        dma_thread_.join();
+    }
+
+    // 与 AudioCodec::OutputData 相同：DMA 播空后从当前位置重新计数
+    void OutputData(const std::vector<int16_t>& data) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 按描述符写入，缓冲区满时等待 DMA 释放；等待期间 DMA 可能已经播空，同样重新计数
+        for (size_t offset = 0; offset < data.size(); offset += kDmaFrameNum) {
+            cv_.wait(lock, [this]() {
+                return (int32_t)(written_ + kDmaFrameNum - dma_sent_ * kDmaFrameNum) <= kDmaDescNum * kDmaFrameNum;
+            });
+            uint32_t sent_frames = dma_sent_ * kDmaFrameNum;
+            if ((int32_t)(sent_frames - written_) > 0) {
+                written_ = sent_frames;
+            }
+            descriptors_.push_back(data[offset]);
+            written_ += kDmaFrameNum;
+        }
+    }
+
+    int GetOutputPendingUs() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int32_t pending = std::clamp((int32_t)(written_ - dma_sent_ * kDmaFrameNum), (int32_t)0,
+            (int32_t)(kDmaDescNum * kDmaFrameNum));
+        return (int64_t)pending * 1000000 / kSampleRate;
+    }
+
+    // 开始播放后 DMA 补零的描述符数，即喇叭上真实出现的静音
+    int silent_descriptors() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return silent_descriptors_;
+    }
+
+    // 按播放顺序记录每个描述符的第一个采样，即帧编号
+    std::vector<int16_t> played() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return played_;
+    }
+
+    void WaitDrained() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return descriptors_.empty(); });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<int16_t> descriptors_;
+    std::vector<int16_t> played_;
+    uint32_t dma_sent_ = 0;
+    uint32_t written_ = 0;
+    int silent_descriptors_ = 0;
+    int trailing_silence_ = 0;
+    bool stop_ = false;
+    std::thread dma_thread_;
+
+    void DmaLoop() {
+        auto period = std::chrono::microseconds((int64_t)kDmaFrameNum * 1000000 / kSampleRate / kTimeScale);
+        auto next = std::chrono::steady_clock::now() + period;
+        while (true) {
+            std::this_thread::sleep_until(next);
+            next += period;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) {
+                return;
+            }
+            if (descriptors_.empty()) {
+                // 只统计两段数据之间的静音，播完最后一帧之后的不算
+                if (!played_.empty()) {
+                    trailing_silence_++;
+                }
+            } else {
+                silent_descriptors_ += trailing_silence_;
+                trailing_silence_ = 0;
+                if (played_.empty() || played_.back() != descriptors_.front()) {
+                    played_.push_back(descriptors_.front());
+                }
+                descriptors_.pop_front();
+            }
+            dma_sent_++;
+            cv_.notify_all();
+        }
+    }
+};
+
+// 假解码：耗时 decode_us，输出一帧编号为 id 的 PCM
+static void FakeDecode(int id, int64_t decode_us, std::vector<int16_t>& pcm) {
+    SleepScaledUs(decode_us);
+    pcm.assign(kFrameSamples, (int16_t)id);
+}
+
+struct RunResult {
+    int underruns = 0;          // 流水线统计的 audio.pcm_underruns
+    int silent_descriptors = 0; // 假芯片记录的真实静音
+    std::vector<int16_t> played;
+};
+
+// 改动前：一个后台任务里解码、同步写入，写完才取下一帧
+static RunResult RunSerial(int frames, int64_t decode_us) {
+    FakeCodec codec;
+    std::vector<int16_t> pcm;
+    for (int id = 1; id <= frames; id++) {
+        FakeDecode(id, decode_us, pcm);
+        codec.OutputData(pcm);
+    }
+    codec.WaitDrained();
+    RunResult result;
+    result.silent_descriptors = codec.silent_descriptors();
+    result.played = codec.played();
+    return result;
+}
+
+// 驱动真实的 PlaybackPipeline，等待条件与 Application::AudioOutputLoop 相同；队列、解码和 FIFO 都为空时返回
+class PlaybackPipelineTest {
+public:
+    PlaybackPipelineTest(FakeCodec& codec, BackgroundTask& background_task, int64_t decode_us)
+        : pipeline_(mutex_, cv_, queue_, &background_task, 2, kFrameSamples) {
+        // 包的时间戳作为帧编号
+        pipeline_.OnDecode([decode_us](AudioStreamPacket&& packet, PcmSlot* slot) {
+            FakeDecode(packet.timestamp, decode_us, slot->pcm);
+            return true;
+        });
+        pipeline_.OnOutput([&codec](PcmSlot* slot) {
+            codec.OutputData(slot->pcm);
+        });
+        pipeline_.OnQueryOutputPending([&codec]() {
+            return codec.GetOutputPendingUs();
+        });
+    }
+
+    void Push(int id) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            AudioStreamPacket packet;
+            packet.timestamp = id;
+            queue_.push_back(std::move(packet));
+        }
+        cv_.notify_all();
+    }
+
+    // 对应 ResetDecoder：清空队列和已解码的帧，正在解码的帧完成后被丢弃。
+    // 设备上播放任务不会退出，这里把下一句一起放入，避免 Run 在两者之间判定为空闲而返回
+    void Reset(std::initializer_list<int> next_sentence) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.clear();
+            pipeline_.Clear();
+            for (int id : next_sentence) {
+                AudioStreamPacket packet;
+                packet.timestamp = id;
+                queue_.push_back(std::move(packet));
+            }
+        }
+        cv_.notify_all();
+    }
+
+    void Run() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() {
+                    return pipeline_.HasFilled() || pipeline_.CanDecodeNextPacket() || pipeline_.Idle();
+                });
+                if (pipeline_.Idle()) {
+                    return;
+                }
+            }
+            pipeline_.Step();
+        }
+    }
+
+    bool AllSlotsFree() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PcmSlot* slots[2] = { pipeline_.fifo_.AcquireFree(), pipeline_.fifo_.AcquireFree() };
+        bool free = slots[0] != nullptr && slots[1] != nullptr;
+        for (auto slot : slots) {
+            if (slot != nullptr) {
+                pipeline_.fifo_.Release(slot);
+            }
+        }
+        return free;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::list<AudioStreamPacket> queue_;
+    PlaybackPipeline pipeline_;
+};
+
+static int Underruns() {
+    static auto underruns = Metrics::GetInstance().Counter("audio.pcm_underruns");
+    return underruns->value();
+}
+
+static RunResult RunPipelined(BackgroundTask& background_task, int frames, int64_t decode_us) {
+    FakeCodec codec;
+    PlaybackPipelineTest pipeline(codec, background_task, decode_us);
+    int underruns = Underruns();
+    // 网络先到齐，只考察解码和播放
+    for (int id = 1; id <= frames; id++) {
+        pipeline.Push(id);
+    }
+    pipeline.Run();
+    codec.WaitDrained();
+    CHECK(pipeline.AllSlotsFree());
+    RunResult result;
+    result.underruns = Underruns() - underruns;
+    result.silent_descriptors = codec.silent_descriptors();
+    result.played = codec.played();
+    return result;
+}
+
+static void CheckOrder(const std::vector<int16_t>& played, int frames) {
+    CHECK((int)played.size() == frames);
+    for (int i = 0; i < frames; i++) {
+        CHECK(played[i] == i + 1);
+    }
+}
+
+static void TestDecodeCost(BackgroundTask& background_task, int64_t decode_us) {
+    const int frames = 12;
+    auto serial = RunSerial(frames, decode_us);
+    auto pipelined = RunPipelined(background_task, frames, decode_us);
+    CheckOrder(serial.played, frames);
+    CheckOrder(pipelined.played, frames);
+    printf("decode %3d ms per %d ms frame, DMA %d ms: serial %d silent descriptors, pipelined %d (counted %d underruns)\n",
+        (int)(decode_us / 1000), kFrameDurationMs, kDmaDescNum * kDmaFrameNum * 1000 / kSampleRate,
+        serial.silent_descriptors, pipelined.silent_descriptors, pipelined.underruns);
+
+    // 解码比帧短就不应该出现静音，允许主机调度抖动造成的一个描述符；串行时解码超过 DMA 缓冲时长必然播空
+    CHECK(pipelined.silent_descriptors <= 1);
+    CHECK(pipelined.underruns <= 1);
+    if (decode_us > kDmaDescNum * kDmaFrameNum * 1000000LL / kSampleRate) {
+        CHECK(serial.silent_descriptors >= frames / 2);
+    }
+}
+
+// 解码比实时还慢时，underrun 计数与真实的静音一致地出现
+static void TestSlowDecoder(BackgroundTask& background_task) {
+    const int frames = 8;
+    auto result = RunPipelined(background_task, frames, 130000);
+    CheckOrder(result.played, frames);
+    CHECK(result.silent_descriptors > 0);
+    CHECK(result.underruns >= frames / 2);
+    printf("decode 130 ms per 100 ms frame: %d silent descriptors, %d counted underruns\n",
+        result.silent_descriptors, result.underruns);
+}
+
+// 播放中途重置：正在解码和已解码未播放的帧都被丢弃，槽位全部归还，之后的新句子照常播放
+static void TestResetMidStream(BackgroundTask& background_task) {
+    FakeCodec codec;
+    PlaybackPipelineTest pipeline(codec, background_task, 40000);
+    for (int id = 1; id <= 10; id++) {
+        pipeline.Push(id);
+    }
+    std::thread render([&pipeline]() { pipeline.Run(); });
+    SleepScaledUs(350000);
+    pipeline.Reset({ 101, 102, 103 });
+    render.join();
+    codec.WaitDrained();
+    CHECK(pipeline.AllSlotsFree());
+
+    auto played = codec.played();
+    CHECK(played.size() >= 6);
+    // 新句子完整播放，且在旧句子之后
+    CHECK(played[played.size() - 3] == 101 && played[played.size() - 2] == 102 && played.back() == 103);
+    // 旧句子按顺序播放到重置时为止，剩余的帧没有播放
+    int old_frames = (int)played.size() - 3;
+    for (int i = 0; i < old_frames; i++) {
+        CHECK(played[i] == i + 1);
+    }
+    CHECK(old_frames < 10);
+    printf("reset after 350 ms: %d old frames played, new sentence intact\n", old_frames);
+}
+
+int main() {
+    // 后台任务与设备上一样常驻，不析构
+    auto background_task = new BackgroundTask();
+    TestDecodeCost(*background_task, 20000);
+    TestDecodeCost(*background_task, 45000);
+    TestDecodeCost(*background_task, 80000);
+    TestSlowDecoder(*background_task);
+    TestResetMidStream(*background_task);
+    printf("pcm fifo pipeline tests passed\n");
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "playout_clock.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+
+/*
+ * 播放时钟在 10 分钟会话上的时间戳精度。
+ * 模拟的 I2S 以偏离标称值 ppm 的时钟播放 24 kHz 音频，DMA 为 6 块 x 240 帧，每包 60 ms；
+ * 写入在 DMA 满时阻塞，解码耗时随机，网络偶尔断流造成欠载。DMA 水位按整块统计，与设备上一致。
+ * 上行随机查询最近 300 ms 内的采集时刻，与模拟器记录的真实播放区间对比。
+ */
+
+static const int kSampleRate = 24000;
+static const int kFrameSamples = kSampleRate * 60 / 1000;
+static const int kBlockSamples = 240;
+static const int kBlocks = 6;
+static const double kSessionUs = 600e6;
+
+struct Played {
+    double start_us;
+    uint32_t timestamp;
+};
+
+struct Result {
+    int drift_ppm;
+    int lookups;
+    int presence_mismatches;
+    double mean_error_ms;
+    double max_error_ms;
+    double last_minute_max_error_ms;
+};
+
+class I2sSimulator {
+public:
+    explicit I2sSimulator(double ppm) : sample_us_(1e6 / kSampleRate * (1 + ppm * 1e-6)) {}
+
+    // now_us 时已播放的采样数
+    long PlayedSamples(double now_us) const {
+        if (origin_us_ < 0) {
+            return written_;
+        }
+        long played = origin_samples_ + (long)((now_us - origin_us_) / sample_us_);
+        return std::min(played, written_);
+    }
+
+    // 写入一帧：DMA 空了则从现在重新开始播放，DMA 满了则阻塞，返回这一帧的真实开始时间
+    double Write(double& now_us) {
+        if (PlayedSamples(now_us) >= written_) {
+            origin_us_ = now_us;
+            origin_samples_ = written_;
+        }
+        while (written_ + kFrameSamples - PlayedSamples(now_us) > kBlocks * kBlockSamples) {
+            now_us += 1000;
+        }
+        double start = origin_us_ + (written_ - origin_samples_) * sample_us_;
+        written_ += kFrameSamples;
+        return start;
+    }
+
+    // 写入后 DMA 中尚未播放的时长，正在播放的块整块计入
+    int PendingUs(double now_us) const {
+        long finished = PlayedSamples(now_us) / kBlockSamples * kBlockSamples;
+        return (int)((written_ - finished) * 1000000L / kSampleRate);
+    }
+
+    double frame_us() const { return kFrameSamples * sample_us_; }
+
+private:
+    double sample_us_;
+    long written_ = 0;
+    double origin_us_ = -1;
+    long origin_samples_ = 0;
+};
+
+static Result Simulate(double ppm, unsigned seed) {
+    PlayoutClock clock(32);
+    I2sSimulator i2s(ppm);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::deque<Played> history;
+    Result result = {};
+    double error_sum = 0;
+    double now = 0;
+    uint32_t timestamp = 1000;
+
+    while (now < kSessionUs) {
+        // 约 1% 的包之前有 200~700 ms 的断流
+        if (uniform(rng) < 0.01) {
+            now += 200000 + uniform(rng) * 500000;
+        }
+        double start = i2s.Write(now);
+        history.push_back({ start, timestamp });
+        if (history.size() > 20) {
+            history.pop_front();
+        }
+        clock.OnRender(timestamp, kFrameSamples, kSampleRate, (int64_t)now, i2s.PendingUs(now));
+
+        for (int q = 0; q < 2; q++) {
+            double capture = now - uniform(rng) * 300000;
+            bool playing = false;
+            double expected = 0;
+            for (auto it = history.rbegin(); it != history.rend(); ++it) {
+                if (capture >= it->start_us && capture < it->start_us + i2s.frame_us()) {
+                    expected = it->timestamp + (capture - it->start_us) / i2s.frame_us() * 60;
+                    playing = true;
+                    break;
+                }
+            }
+            uint32_t got = clock.Lookup((int64_t)capture);
+            if (playing && got != 0) {
+                // Lookup 返回整毫秒，按截断比较
+                double error = std::fabs((double)got - floor(expected));
+                error_sum += error;
+                result.lookups++;
+                result.max_error_ms = std::max(result.max_error_ms, error);
+                if (now > kSessionUs - 60e6) {
+                    result.last_minute_max_error_ms = std::max(result.last_minute_max_error_ms, error);
+                }
+            } else if (playing != (got != 0)) {
+                result.presence_mismatches++;
+            }
+        }
+        timestamp += 60;
+        now += 20000 * uniform(rng);
+    }
+    result.drift_ppm = clock.drift_ppm();
+    result.mean_error_ms = error_sum / result.lookups;
+    return result;
+}
+
+int main() {
+    const double ppms[] = { 0, 100, -200, 500 };
+    for (double ppm : ppms) {
+        Result result = Simulate(ppm, 3);
+        printf("ppm %+4.0f: drift estimate %+4d, %d lookups, mean error %.2f ms, max %.1f ms "
+            "(last minute %.1f ms), presence mismatches %d\n", ppm, result.drift_ppm, result.lookups,
+            result.mean_error_ms, result.max_error_ms, result.last_minute_max_error_ms, result.presence_mismatches);
+        CHECK(std::abs(result.drift_ppm - (int)ppm) <= 10);
+        CHECK(result.lookups > 15000);
+        CHECK(result.mean_error_ms < 0.5);
+        // 漂移每个 4 秒窗口只修正残差的 1/4，收敛前的误差随 ppm 增大；收敛后误差不随会话时长累积
+        CHECK(result.max_error_ms <= 5);
+        CHECK(result.last_minute_max_error_ms <= 1);
+        // 只允许断流边界上不足一个采样的舍入
+        CHECK(result.presence_mismatches <= result.lookups / 1000);
+    }
+    printf("playout clock tests passed\n");
+    return 0;
+}
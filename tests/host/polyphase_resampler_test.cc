@@ -0,0 +1,164 @@
+#include "polyphase_resampler.h"
+#include "host_test.h"
+
+#include <esp_heap_caps.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+/*
+ * 多相重采样器的频率响应和内存占用：
+ * - 通带增益、降采样的混叠抑制、升采样的镜像抑制，每个预设比例都测
+ * - 按 30 ms 分块处理时输出数与 GetOutputSamples 一致，双声道互不串扰
+ * - 同比例的实例共用一份滤波器组，大滤波器组放在 PSRAM，没有 PSRAM 时退回内部 RAM
+ */
+
+struct Ratio {
+    int input_sample_rate;
+    int output_sample_rate;
+};
+
+static const Ratio kRatios[] = {
+    { 16000, 24000 },
+    { 24000, 16000 },
+    { 16000, 48000 },
+    { 48000, 16000 },
+    { 44100, 16000 },
+    { 16000, 44100 },
+};
+
+// 按 30 ms 分块送入正弦，跳过前 300 ms 的建立时间，返回声道 channel 的输出
+static std::vector<double> ResampleTone(const Ratio& ratio, double frequency, int channels, int channel = 0) {
+    PolyphaseResampler resampler;
+    CHECK(resampler.Configure(ratio.input_sample_rate, ratio.output_sample_rate, channels));
+    int frames = ratio.input_sample_rate * 30 / 1000;
+    std::vector<int16_t> input(frames * channels);
+    std::vector<int16_t> output;
+    std::vector<double> result;
+    long n = 0;
+    size_t total_frames = 0;
+    for (int block = 0; block < 50; block++) {
+        for (int i = 0; i < frames; i++, n++) {
+            for (int c = 0; c < channels; c++) {
+                // 第二声道是静音，用于检查串扰
+                double amplitude = c == 0 ? 16000 : 0;
+                input[i * channels + c] = (int16_t)lrint(amplitude * sin(2 * M_PI * frequency * n / ratio.input_sample_rate));
+            }
+        }
+        size_t expected = resampler.GetOutputSamples(input.size());
+        output.resize(expected);
+        size_t produced = resampler.Process(input.data(), input.size(), output.data());
+        CHECK(produced == expected);
+        CHECK(produced % channels == 0);
+        total_frames += produced / channels;
+        if (block >= 10) {
+            for (size_t i = channel; i < produced; i += channels) {
+                result.push_back(output[i]);
+            }
+        }
+    }
+    // 输出采样数与采样率之比只差滤波器延迟
+    long ideal = (long)50 * frames * ratio.output_sample_rate / ratio.input_sample_rate;
+    CHECK(std::labs((long)total_frames - ideal) <= 96);
+    return result;
+}
+
+// 单一频点的幅度（Goertzel），相对输入幅度 16000 的 dB
+static double ToneLevel(const std::vector<double>& samples, double frequency, int sample_rate) {
+    double w = 2 * M_PI * frequency / sample_rate;
+    double re = 0;
+    double im = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        re += samples[i] * cos(w * i);
+        im -= samples[i] * sin(w * i);
+    }
+    double amplitude = 2 * sqrt(re * re + im * im) / samples.size();
+    return 20 * log10(std::max(amplitude, 1e-3) / 16000);
+}
+
+static double RmsLevel(const std::vector<double>& samples) {
+    double energy = 0;
+    for (double v : samples) {
+        energy += v * v;
+    }
+    double rms = sqrt(energy / samples.size());
+    return 20 * log10(std::max(rms, 1e-3) / (16000 / sqrt(2)));
+}
+
+static void TestFrequencyResponse() {
+    for (const auto& ratio : kRatios) {
+        int out_rate = ratio.output_sample_rate;
+        int low_rate = std::min(ratio.input_sample_rate, ratio.output_sample_rate);
+        double passband[3];
+        const double frequencies[] = { 1000, 3400, 6000 };
+        for (int i = 0; i < 3; i++) {
+            passband[i] = ToneLevel(ResampleTone(ratio, frequencies[i], 1), frequencies[i], out_rate);
+            CHECK(std::fabs(passband[i]) < 0.2);
+        }
+
+        double rejection;
+        if (ratio.input_sample_rate > ratio.output_sample_rate) {
+            // 高于输出奈奎斯特频率 2 kHz 的输入，输出中的全部能量都是混叠
+            rejection = RmsLevel(ResampleTone(ratio, low_rate / 2 + 2000, 1));
+        } else {
+            // 3 kHz 输入在 fs_in - 3 kHz 处的镜像
+            auto output = ResampleTone(ratio, 3000, 1);
+            rejection = ToneLevel(output, low_rate - 3000, out_rate);
+        }
+        CHECK(rejection < -70);
+
+        // 双声道第二声道静音，不应从第一声道串入
+        auto silent = ResampleTone(ratio, 1000, 2, 1);
+        for (double v : silent) {
+            CHECK(v == 0);
+        }
+        printf("%5d -> %5d: 1k %+.2f dB, 3.4k %+.2f dB, 6k %+.2f dB, %s rejection %.1f dB\n",
+            ratio.input_sample_rate, out_rate, passband[0], passband[1], passband[2],
+            ratio.input_sample_rate > out_rate ? "alias" : "image", rejection);
+    }
+}
+
+static void TestSharedFilterBank() {
+    size_t internal_before = HostHeapCapsUsed(MALLOC_CAP_INTERNAL);
+    size_t spiram_before = HostHeapCapsUsed(MALLOC_CAP_SPIRAM);
+    {
+        // 16k→44.1k：441 相位 x 32 抽头 = 28224 字节，只分配一份，放在 PSRAM
+        std::vector<std::unique_ptr<PolyphaseResampler>> resamplers;
+        for (int i = 0; i < 4; i++) {
+            resamplers.emplace_back(new PolyphaseResampler());
+            CHECK(resamplers.back()->Configure(16000, 44100, i % 2 + 1));
+        }
+        CHECK(HostHeapCapsUsed(MALLOC_CAP_SPIRAM) - spiram_before == 441 * 32 * sizeof(int16_t));
+        CHECK(HostHeapCapsUsed(MALLOC_CAP_INTERNAL) == internal_before);
+
+        // 小滤波器组留在内部 RAM；重新配置时释放旧的引用
+        resamplers[0]->Configure(24000, 16000);
+        resamplers[1]->Configure(24000, 16000);
+        CHECK(HostHeapCapsUsed(MALLOC_CAP_INTERNAL) - internal_before == 2 * 48 * sizeof(int16_t));
+        CHECK(HostHeapCapsUsed(MALLOC_CAP_SPIRAM) - spiram_before == 441 * 32 * sizeof(int16_t));
+        resamplers[2]->Configure(24000, 16000);
+        resamplers[3]->Configure(24000, 16000);
+        CHECK(HostHeapCapsUsed(MALLOC_CAP_SPIRAM) == spiram_before);
+    }
+    CHECK(HostHeapCapsUsed(MALLOC_CAP_INTERNAL) == internal_before);
+
+    // 没有 PSRAM 的板子退回内部 RAM
+    HostHeapCapsSetSpiramAvailable(false);
+    {
+        PolyphaseResampler resampler;
+        CHECK(resampler.Configure(44100, 16000));
+        CHECK(HostHeapCapsUsed(MALLOC_CAP_INTERNAL) - internal_before == 160 * 64 * sizeof(int16_t));
+        auto output = ResampleTone({ 44100, 16000 }, 1000, 1);
+        CHECK(std::fabs(ToneLevel(output, 1000, 16000)) < 0.2);
+    }
+    HostHeapCapsSetSpiramAvailable(true);
+    CHECK(HostHeapCapsUsed(MALLOC_CAP_INTERNAL) == internal_before);
+}
+
+int main() {
+    TestFrequencyResponse();
+    TestSharedFilterBank();
+    printf("polyphase resampler tests passed\n");
+    return 0;
+}
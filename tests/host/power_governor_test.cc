@@ -0,0 +1,276 @@
+#include "power_governor.h"
+#include "board.h"
+#include "display.h"
+#include "host_test.h"
+
+#include <esp_timer.h>
+#include <cJSON.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * 功耗调度器的主机测试：
+ * 1. 冻结时钟模拟一天的状态和亮灭屏变化，检查按状态累计的时长与 mAh
+ * 2. 多个线程同时切换状态和屏幕，假板子检测硬件设置是否有重叠下发，最终配置是否与最终状态一致
+ * 3. 下发模组省电时板级代码回调 SetScreenOn（PowerSaveTimer 唤醒的路径）不能死锁
+ */
+
+#define MAX_FREQ_MHZ CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+
+struct HardwareState {
+    bool modem_sleep = false;
+    int refresh_ms = 0;
+    esp_pm_config_t pm_config = {};
+    bool lock_held = false;
+    int pm_configure_count = 0;
+};
+
+static std::mutex hardware_mutex;
+static HardwareState hardware;
+static std::atomic<int> hardware_callers{0};
+static std::atomic<int> overlaps{0};
+static std::function<void(bool)> on_power_save_mode;
+
+// 每个硬件调用都登记自己，同一时间有两个调用即为重叠
+class HardwareCall {
+public:
+    HardwareCall() {
+        if (hardware_callers.fetch_add(1) != 0) {
+            overlaps++;
+        }
+        // 放大竞争窗口
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+    ~HardwareCall() {
+        hardware_callers--;
+    }
+};
+
+class FakeDisplay : public Display {
+public:
+    void SetRefreshPeriod(int period_ms) override {
+        HardwareCall call;
+        std::lock_guard<std::mutex> lock(hardware_mutex);
+        hardware.refresh_ms = period_ms;
+    }
+};
+
+class FakeBoard : public Board {
+public:
+    Display* GetDisplay() override { return &display_; }
+    void SetPowerSaveMode(bool enabled) override {
+        {
+            HardwareCall call;
+            std::lock_guard<std::mutex> lock(hardware_mutex);
+            hardware.modem_sleep = enabled;
+        }
+        if (on_power_save_mode) {
+            on_power_save_mode(enabled);
+        }
+    }
+
+private:
+    FakeDisplay display_;
+};
+
+Board& Board::GetInstance() {
+    static FakeBoard board;
+    return board;
+}
+
+struct esp_pm_lock {};
+static esp_pm_lock cpu_lock;
+
+esp_err_t esp_pm_configure(const void* config) {
+    HardwareCall call;
+    std::lock_guard<std::mutex> lock(hardware_mutex);
+    hardware.pm_config = *static_cast<const esp_pm_config_t*>(config);
+    hardware.pm_configure_count++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char* name, esp_pm_lock_handle_t* out_handle) {
+    *out_handle = &cpu_lock;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+    HardwareCall call;
+    std::lock_guard<std::mutex> lock(hardware_mutex);
+    CHECK(!hardware.lock_held);
+    hardware.lock_held = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+    HardwareCall call;
+    std::lock_guard<std::mutex> lock(hardware_mutex);
+    CHECK(hardware.lock_held);
+    hardware.lock_held = false;
+    return ESP_OK;
+}
+
+static HardwareState Snapshot() {
+    std::lock_guard<std::mutex> lock(hardware_mutex);
+    return hardware;
+}
+
+// 硬件状态与档位一致：模组省电、刷新率、调频下限、light sleep 以及 CPU 锁
+static void CheckProfile(const PowerProfile& profile) {
+    auto state = Snapshot();
+    CHECK(state.modem_sleep == profile.modem_sleep);
+    CHECK(state.refresh_ms == profile.lvgl_refresh_ms);
+    CHECK(state.pm_config.max_freq_mhz == MAX_FREQ_MHZ);
+    CHECK(state.pm_config.min_freq_mhz == profile.min_freq_mhz);
+    CHECK(state.pm_config.light_sleep_enable == profile.light_sleep);
+    CHECK(state.lock_held == (profile.min_freq_mhz >= MAX_FREQ_MHZ));
+}
+
+// 与 PowerGovernor 构造函数中的默认档位相同
+static const PowerProfile kPerformance = { MAX_FREQ_MHZ, false, false, 33, 120 };
+static const PowerProfile kActive = { MAX_FREQ_MHZ, false, false, 33, 180 };
+static const PowerProfile kIdle = { 80, false, true, 100, 60 };
+static const PowerProfile kScreenOff = { 40, true, true, 1000, 25 };
+
+static double ReportNumber(cJSON* root, const char* state, const char* field) {
+    cJSON* item = cJSON_GetObjectItem(root, state);
+    if (item == nullptr) {
+        return 0;
+    }
+    cJSON* value = cJSON_GetObjectItem(item, field);
+    CHECK(cJSON_IsNumber(value));
+    return value->valuedouble;
+}
+
+static void TestEnergyAccounting(PowerGovernor& governor) {
+    HostTimerSetFrozen(true);
+    governor.EnableFrequencyScaling(true);
+    governor.Start(kDeviceStateStarting);
+    CheckProfile(kPerformance);
+
+    // 一天：启动 20 秒，每小时两次 3 分钟的对话，其余待机；待机 1 分钟后灭屏
+    const int64_t second = 1000000;
+    double expected_mas[kDeviceStateFatalError + 1] = {};
+    int64_t expected_seconds[kDeviceStateFatalError + 1] = {};
+    auto stay = [&](DeviceState state, int current_ma, int64_t seconds) {
+        HostTimerAdvance(seconds * second);
+        expected_mas[state] += current_ma * seconds;
+        expected_seconds[state] += seconds;
+    };
+
+    stay(kDeviceStateStarting, kPerformance.estimated_current_ma, 20);
+    for (int half_hour = 0; half_hour < 48; half_hour++) {
+        governor.SetDeviceState(kDeviceStateConnecting);
+        CheckProfile(kActive);
+        stay(kDeviceStateConnecting, kActive.estimated_current_ma, 2);
+        governor.SetDeviceState(kDeviceStateListening);
+        stay(kDeviceStateListening, kActive.estimated_current_ma, 90);
+        governor.SetDeviceState(kDeviceStateSpeaking);
+        stay(kDeviceStateSpeaking, kActive.estimated_current_ma, 88);
+        governor.SetDeviceState(kDeviceStateIdle);
+        CheckProfile(kIdle);
+        stay(kDeviceStateIdle, kIdle.estimated_current_ma, 60);
+        governor.SetScreenOn(false);
+        CheckProfile(kScreenOff);
+        stay(kDeviceStateIdle, kScreenOff.estimated_current_ma, 1800 - 240);
+        governor.SetScreenOn(true);
+        CheckProfile(kIdle);
+    }
+
+    auto json = governor.GetEnergyReportJson();
+    cJSON* root = cJSON_Parse(json.c_str());
+    CHECK(root != nullptr);
+    double total_mah = 0;
+    static const char* const names[] = { "unknown", "starting", "configuring", "idle", "connecting",
+        "listening", "speaking", "upgrading", "activating", "audio_testing", "fatal_error" };
+    for (int i = 0; i <= kDeviceStateFatalError; i++) {
+        CHECK(ReportNumber(root, names[i], "seconds") == expected_seconds[i]);
+        CHECK(std::fabs(ReportNumber(root, names[i], "mah") - expected_mas[i] / 3600.0) < 1e-6);
+        total_mah += expected_mas[i] / 3600.0;
+    }
+    cJSON* total = cJSON_GetObjectItem(root, "total_mah");
+    CHECK(std::fabs(total->valuedouble - total_mah) < 1e-6);
+    cJSON_Delete(root);
+
+    int64_t day_seconds = 0;
+    for (auto seconds : expected_seconds) {
+        day_seconds += seconds;
+    }
+    CHECK(day_seconds == 20 + 48 * 1800);
+    printf("simulated day: %.1f mAh (%.1f mA average), always-active profile would be %.1f mAh\n",
+        total_mah, total_mah * 3600.0 / day_seconds, kActive.estimated_current_ma * day_seconds / 3600.0);
+    HostTimerSetFrozen(false);
+}
+
+static void TestConcurrentUpdates(PowerGovernor& governor) {
+    const DeviceState states[] = { kDeviceStateIdle, kDeviceStateListening, kDeviceStateSpeaking,
+        kDeviceStateConnecting, kDeviceStateIdle };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&governor, &states, t]() {
+            for (int i = 0; i < 300; i++) {
+                if (t == 3) {
+                    governor.SetScreenOn(i % 2 == 0);
+                } else {
+                    governor.SetDeviceState(states[(i + t) % 5]);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(overlaps == 0);
+
+    // 竞争结束后，模组省电等记录值仍与硬件一致，后续切换不会被跳过
+    governor.SetScreenOn(false);
+    governor.SetDeviceState(kDeviceStateIdle);
+    CheckProfile(kScreenOff);
+    governor.SetDeviceState(kDeviceStateListening);
+    CheckProfile(kActive);
+    governor.SetScreenOn(true);
+    governor.SetDeviceState(kDeviceStateIdle);
+    CheckProfile(kIdle);
+    CHECK(overlaps == 0);
+}
+
+static void TestReentrantScreenOn(PowerGovernor& governor) {
+    governor.SetScreenOn(false);
+    CheckProfile(kScreenOff);
+
+    // 关闭模组省电时板子唤醒省电定时器，后者在同一线程里点亮屏幕
+    int callbacks = 0;
+    on_power_save_mode = [&governor, &callbacks](bool enabled) {
+        if (!enabled) {
+            callbacks++;
+            governor.SetScreenOn(true);
+        }
+    };
+    governor.SetDeviceState(kDeviceStateListening);
+    CHECK(callbacks == 1);
+    CheckProfile(kActive);
+    on_power_save_mode = nullptr;
+
+    // 回调中的亮屏已记录，回到待机时不会落到灭屏档
+    governor.SetDeviceState(kDeviceStateIdle);
+    CheckProfile(kIdle);
+}
+
+int main() {
+    auto& governor = PowerGovernor::GetInstance();
+    TestEnergyAccounting(governor);
+    TestConcurrentUpdates(governor);
+    TestReentrantScreenOn(governor);
+    printf("power governor tests passed\n");
+    return 0;
+}
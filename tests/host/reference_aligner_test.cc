@@ -0,0 +1,186 @@
+#include "reference_aligner.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+/*
+ * 回采参考对齐的主机测试，16 kHz 双声道（麦克风 + 参考），回声路径均为合成：
+ * - 纯延迟，覆盖整数、分数、接近上限以及回声超前参考的负延迟
+ * - 反相回声、带反射的多径房间响应、叠加近端说话
+ * - 没有播放时不产生估计
+ * 除了估计值，还检查补偿后输出中回声相对参考的延迟只剩 16 个采样的余量。
+ */
+
+static const int kSampleRate = 16000;
+static const int kBlockFrames = 512;
+static const int kSafetyMargin = 16;
+
+struct Tap {
+    double delay;   // 采样，可为分数和负值
+    double gain;
+};
+
+class EchoPath {
+public:
+    EchoPath(std::vector<Tap> taps, double noise_rms, double near_end_rms = 0)
+        : taps_(taps), noise_rms_(noise_rms), near_end_rms_(near_end_rms) {}
+
+    // 低通噪声作为播放内容，麦克风为各路径的分数延迟之和加上噪声
+    void Generate(int seconds, double ref_rms, std::vector<int16_t>& interleaved) {
+        std::mt19937 rng(7);
+        std::normal_distribution<double> normal(0, 1);
+        const int pad = 1000;
+        int frames = seconds * kSampleRate;
+        std::vector<double> ref(frames + 2 * pad);
+        double lp = 0;
+        for (auto& r : ref) {
+            lp = 0.7 * lp + 0.3 * normal(rng) * ref_rms * 2.4;
+            r = lp;
+        }
+        double near_lp = 0;
+        interleaved.resize(frames * 2);
+        for (int i = 0; i < frames; i++) {
+            int n = i + pad;
+            double echo = 0;
+            for (const auto& tap : taps_) {
+                double t = n - tap.delay;
+                int ti = (int)floor(t);
+                double f = t - ti;
+                echo += tap.gain * ((1 - f) * ref[ti] + f * ref[ti + 1]);
+            }
+            near_lp = 0.9 * near_lp + 0.1 * normal(rng) * near_end_rms_ * 4.4;
+            double mic = echo + near_lp + noise_rms_ * normal(rng);
+            interleaved[2 * i] = Clamp(mic);
+            interleaved[2 * i + 1] = Clamp(ref[n]);
+        }
+    }
+
+private:
+    std::vector<Tap> taps_;
+    double noise_rms_;
+    double near_end_rms_;
+
+    static int16_t Clamp(double value) {
+        return (int16_t)std::clamp(lrint(value), -32768L, 32767L);
+    }
+};
+
+// 按 512 帧分块处理，返回处理后的交错数据
+static std::vector<int16_t> Run(ReferenceAligner& aligner, std::vector<int16_t> data) {
+    for (size_t offset = 0; offset + kBlockFrames * 2 <= data.size(); offset += kBlockFrames * 2) {
+        aligner.Process(data.data() + offset, kBlockFrames);
+    }
+    return data;
+}
+
+static double EstimateSamples(const ReferenceAligner& aligner) {
+    return aligner.delay_us() * (double)kSampleRate / 1e6;
+}
+
+// 在输出的最后两秒上求回声相对参考的延迟（整数采样，按绝对值找峰）
+static int ResidualLag(const std::vector<int16_t>& data) {
+    size_t frames = data.size() / 2;
+    size_t start = frames - 2 * kSampleRate;
+    int best_lag = 0;
+    double best = -1;
+    for (int lag = -64; lag <= 64; lag++) {
+        double sum = 0;
+        for (size_t i = start; i < frames; i++) {
+            sum += (double)data[2 * i] * data[2 * (i - lag) + 1];
+        }
+        if (std::fabs(sum) > best) {
+            best = std::fabs(sum);
+            best_lag = lag;
+        }
+    }
+    return best_lag;
+}
+
+static void CheckAligned(const char* name, const std::vector<Tap>& taps, double expected,
+    double noise_rms = 50, double near_end_rms = 0) {
+    EchoPath path(taps, noise_rms, near_end_rms);
+    std::vector<int16_t> input;
+    path.Generate(6, 2500, input);
+    ReferenceAligner aligner;
+    aligner.Configure(kSampleRate, 2);
+    auto output = Run(aligner, input);
+
+    CHECK(aligner.has_estimate());
+    double estimate = EstimateSamples(aligner);
+    CHECK(std::fabs(estimate - expected) <= 1.0);
+    int residual = ResidualLag(output);
+    CHECK(std::abs(residual - kSafetyMargin) <= 1);
+    printf("%-28s echo %7.2f samples -> estimate %7.2f, residual lag %d\n", name, expected, estimate, residual);
+}
+
+static void TestPureDelay() {
+    const double delays[] = { 2, 17.3, 40.5, 160.25, 400.7, 790, -10 };
+    for (double delay : delays) {
+        CheckAligned("pure delay", { { delay, 0.5 } }, delay);
+    }
+}
+
+static void TestInvertedEcho() {
+    CheckAligned("inverted", { { 123.4, -0.6 } }, 123.4);
+}
+
+// 直达声之后跟几路衰减的反射，估计应锁定在最强的直达声上
+static void TestRoomResponse() {
+    std::vector<Tap> taps = {
+        { 96.5, 0.5 },
+        { 131, 0.25 },
+        { 170.2, -0.15 },
+        { 260, 0.1 },
+        { 415.7, 0.05 },
+    };
+    CheckAligned("room response", taps, 96.5);
+}
+
+static void TestDoubleTalk() {
+    CheckAligned("double talk", { { 240.25, 0.4 } }, 240.25, 50, 600);
+}
+
+// 扬声器静音时窗口不参与估计，数据原样通过
+static void TestNoPlayback() {
+    EchoPath path({ { 100, 0.5 } }, 50);
+    std::vector<int16_t> input;
+    path.Generate(3, 20, input);
+    ReferenceAligner aligner;
+    aligner.Configure(kSampleRate, 2);
+    auto output = Run(aligner, input);
+    CHECK(!aligner.has_estimate());
+    CHECK(output == input);
+}
+
+// 会话之间延迟变化（例如切换了输出通路），重新开始后以上一次的估计为初值，每个 1 秒窗口把差距减半
+static void TestDelayChange() {
+    ReferenceAligner aligner;
+    aligner.Configure(kSampleRate, 2);
+    std::vector<int16_t> input;
+    EchoPath first({ { 80, 0.5 } }, 50);
+    first.Generate(4, 2500, input);
+    Run(aligner, input);
+    CHECK(std::fabs(EstimateSamples(aligner) - 80) <= 1.0);
+
+    aligner.Restart();
+    EchoPath second({ { 300.5, 0.5 } }, 50);
+    second.Generate(10, 2500, input);
+    auto output = Run(aligner, input);
+    CHECK(std::fabs(EstimateSamples(aligner) - 300.5) <= 1.0);
+    CHECK(std::abs(ResidualLag(output) - kSafetyMargin) <= 1);
+    printf("delay change 80 -> 300.5 samples: estimate %.2f after 10 s\n", EstimateSamples(aligner));
+}
+
+int main() {
+    TestPureDelay();
+    TestInvertedEcho();
+    TestRoomResponse();
+    TestDoubleTalk();
+    TestNoPlayback();
+    TestDelayChange();
+    printf("reference aligner tests passed\n");
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "polyphase_resampler.h"
+#include "host_test.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * 各预设比例的吞吐量：每秒音频的处理耗时、实时倍数，以及每秒的乘加次数。
+ * 主机上的耗时只用于比较比例之间和改动前后的差异；乘加次数与平台无关，
+ * 按 ESP32-S3 每周期约 1 次 16 位乘加估算，可以换算成设备上的 CPU 占用。
+ */
+
+struct Ratio {
+    int input_sample_rate;
+    int output_sample_rate;
+};
+
+static const Ratio kRatios[] = {
+    { 16000, 24000 },
+    { 24000, 16000 },
+    { 16000, 48000 },
+    { 48000, 16000 },
+    { 44100, 16000 },
+    { 16000, 44100 },
+};
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 1;
+    printf("%-16s %3s %12s %10s %12s\n", "ratio", "ch", "us/s audio", "realtime", "MMAC/s");
+    for (const auto& ratio : kRatios) {
+        for (int channels = 1; channels <= 2; channels++) {
+            PolyphaseResampler resampler;
+            CHECK(resampler.Configure(ratio.input_sample_rate, ratio.output_sample_rate, channels));
+            // 30 ms 一块，与音频任务的调用粒度一致
+            size_t block = ratio.input_sample_rate * 30 / 1000 * channels;
+            std::vector<int16_t> input(block);
+            for (auto& v : input) {
+                v = (int16_t)(rand() - RAND_MAX / 2);
+            }
+            std::vector<int16_t> output;
+            int blocks = seconds * 1000 / 30;
+
+            size_t produced = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < blocks; i++) {
+                output.resize(resampler.GetOutputSamples(block));
+                produced += resampler.Process(input.data(), block, output.data());
+            }
+            double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            double audio_seconds = blocks * 0.03;
+            CHECK(produced > 0);
+
+            // 每个输出采样每个声道做 taps 次乘加，produced 已含声道数
+            double us_per_second = elapsed_us / audio_seconds;
+            double macs = produced / audio_seconds * resampler.taps();
+            printf("%5d -> %-6d %3d %12.0f %9.0fx %12.2f\n", ratio.input_sample_rate, ratio.output_sample_rate,
+                channels, us_per_second, 1e6 / us_per_second, macs / 1e6);
+        }
+    }
+    return 0;
+}
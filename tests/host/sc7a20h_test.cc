@@ -0,0 +1,306 @@
+#include "sc7a20h.h"
+#include "host_test.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * 用模拟寄存器表驱动 SC7A20H 驱动：寄存器写入原样保存，FIFO 在流模式下按芯片规则
+ * 保留最新的 32 个样本，INTx_SRC/CLICK_SRC 读后清除。读取任务按真实的轮询周期运行。
+ */
+
+#define CTRL_REG3  0x22
+#define CTRL_REG5  0x24
+#define OUT_X_L_REG  0x28
+#define FIFO_CTRL_REG  0x2E
+#define FIFO_SRC_REG  0x2F
+#define INT1_CFG_REG  0x30
+#define INT1_SRC_REG  0x31
+#define INT1_THS_REG  0x32
+#define INT1_DURATION_REG  0x33
+#define INT2_SRC_REG  0x35
+#define CLICK_CFG_REG  0x38
+#define CLICK_SRC_REG  0x39
+
+class SimulatedSc7a20h : public Sc7a20hSensor {
+public:
+    SimulatedSc7a20h() : Sc7a20hSensor(nullptr) {
+        registers_[0x0F] = 0x11;
+    }
+
+    uint8_t Get(uint8_t reg) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return registers_[reg];
+    }
+
+    void Set(uint8_t reg, uint8_t value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        registers_[reg] = value;
+    }
+
+    // 传感器按输出数据率产生的样本，原始值左对齐 12 位
+    void Push(const Sc7a20hSample& sample) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if ((registers_[FIFO_CTRL_REG] & 0xC0) != 0x80 || !(registers_[CTRL_REG5] & 0x40)) {
+            return;
+        }
+        fifo_.push_back(sample);
+        if (fifo_.size() > SC7A20H_FIFO_DEPTH) {
+            fifo_.pop_front();
+            overrun_ = true;
+        }
+    }
+
+    int fifo_src_reads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return fifo_src_reads_;
+    }
+
+    // 每次读取前等待，模拟较慢的 I2C 事务
+    std::atomic<int> read_delay_ms{0};
+    std::atomic<int> reads{0};
+    std::atomic<bool> in_read{false};
+
+protected:
+    void WriteRegister(uint8_t reg, uint8_t value) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        registers_[reg] = value;
+        if (reg == FIFO_CTRL_REG && (value & 0xC0) == 0) {
+            // Bypass 模式清空 FIFO
+            fifo_.clear();
+            overrun_ = false;
+        }
+    }
+
+    void ReadRegisters(uint8_t reg, uint8_t* buffer, size_t length) override {
+        in_read = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(read_delay_ms.load()));
+        Read(reg, buffer, length);
+        reads++;
+        in_read = false;
+    }
+
+private:
+    void Read(uint8_t reg, uint8_t* buffer, size_t length) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (reg == OUT_X_L_REG && (registers_[CTRL_REG5] & 0x40)) {
+            // FIFO 模式下 OUT 寄存器自动回绕，每 6 字节弹出一个样本
+            CHECK(length % sizeof(Sc7a20hSample) == 0);
+            for (size_t i = 0; i < length / sizeof(Sc7a20hSample); i++) {
+                CHECK(!fifo_.empty());
+                memcpy(buffer + i * sizeof(Sc7a20hSample), &fifo_.front(), sizeof(Sc7a20hSample));
+                fifo_.pop_front();
+            }
+            overrun_ = false;
+            return;
+        }
+        CHECK(length == 1);
+        if (reg == FIFO_SRC_REG) {
+            fifo_src_reads_++;
+            uint8_t watermark = registers_[FIFO_CTRL_REG] & 0x1F;
+            buffer[0] = (fifo_.size() > watermark ? 0x80 : 0) | (overrun_ ? 0x40 : 0) |
+                (fifo_.size() & 0x1F);
+            return;
+        }
+        buffer[0] = registers_[reg];
+        if (reg == INT1_SRC_REG || reg == INT2_SRC_REG || reg == CLICK_SRC_REG) {
+            // 锁存的事件读后清除
+            registers_[reg] = 0;
+        }
+    }
+
+    std::mutex mutex_;
+    uint8_t registers_[256] = {};
+    std::deque<Sc7a20hSample> fifo_;
+    bool overrun_ = false;
+    int fifo_src_reads_ = 0;
+};
+
+struct Received {
+    std::mutex mutex;
+    std::vector<Sc7a20hSample> samples;
+    std::vector<Sc7a20hEvent> events;
+
+    template <typename Predicate>
+    bool WaitFor(Predicate ready, int timeout_ms) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (std::chrono::steady_clock::now() < deadline) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ready()) {
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return false;
+    }
+};
+
+static Sc7a20hSample Raw(int x, int y, int z) {
+    return Sc7a20hSample{ static_cast<int16_t>(x << 4), static_cast<int16_t>(y << 4), static_cast<int16_t>(z << 4) };
+}
+
+static void TestInitialize() {
+    SimulatedSc7a20h sensor;
+    CHECK(sensor.Initialize() == ESP_OK);
+    CHECK(sensor.Get(CTRL_REG5) == 0x0A);
+    CHECK(sensor.Get(FIFO_CTRL_REG) == 0);
+
+    SimulatedSc7a20h wrong;
+    wrong.Set(0x0F, 0x33);
+    CHECK(wrong.Initialize() == ESP_FAIL);
+}
+
+static void TestInterruptConfiguration() {
+    SimulatedSc7a20h sensor;
+    CHECK(sensor.Initialize() == ESP_OK);
+    sensor.ConfigureActivityInterrupt(250, 50);
+    // 250 mg / 16 mg 四舍五入，50 ms @ 100 Hz
+    CHECK(sensor.Get(INT1_THS_REG) == 16);
+    CHECK(sensor.Get(INT1_DURATION_REG) == 5);
+    CHECK(sensor.Get(INT1_CFG_REG) == 0x2A);
+    CHECK(sensor.Get(CTRL_REG3) == 0x40);
+    sensor.ConfigureFreeFallInterrupt(350, 30);
+    CHECK(sensor.Get(CTRL_REG3) == 0x60);
+    sensor.ConfigureDoubleTapInterrupt(1000, 80, 100, 300);
+    CHECK(sensor.Get(CLICK_CFG_REG) == 0x2A);
+    CHECK(sensor.Get(CTRL_REG3) == 0xE0);
+}
+
+static void TestEventMonitor() {
+    SimulatedSc7a20h sensor;
+    Received received;
+    CHECK(sensor.Initialize() == ESP_OK);
+    sensor.ConfigureActivityInterrupt(250, 50);
+    sensor.ConfigureDoubleTapInterrupt(1000, 80, 100, 300);
+    sensor.OnFifoData([&](const Sc7a20hSample* samples, size_t count) {
+        std::lock_guard<std::mutex> lock(received.mutex);
+        received.samples.insert(received.samples.end(), samples, samples + count);
+    });
+    sensor.OnEvent([&](Sc7a20hEvent event) {
+        std::lock_guard<std::mutex> lock(received.mutex);
+        received.events.push_back(event);
+    });
+
+    CHECK(sensor.StartEventMonitor(GPIO_NUM_NC, 20) == ESP_OK);
+    CHECK(!sensor.IsStreaming());
+    // 不开启 FIFO，也不路由水位中断
+    CHECK(!(sensor.Get(CTRL_REG5) & 0x40));
+    CHECK(sensor.Get(FIFO_CTRL_REG) == 0);
+    CHECK(!(sensor.Get(CTRL_REG3) & 0x04));
+
+    sensor.Set(INT1_SRC_REG, 0x42);
+    CHECK(received.WaitFor([&]() { return received.events.size() == 1; }, 500));
+    CHECK(received.events[0] == kSc7a20hEventActivity);
+
+    // 单击不上报，双击上报
+    sensor.Set(CLICK_SRC_REG, 0x41);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    CHECK(sensor.Get(CLICK_SRC_REG) == 0);
+    sensor.Set(CLICK_SRC_REG, 0x61);
+    CHECK(received.WaitFor([&]() { return received.events.size() == 2; }, 500));
+    CHECK(received.events[1] == kSc7a20hEventDoubleTap);
+
+    // 锁存的事件只上报一次，轮询期间不读 FIFO
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(sensor.Stop() == ESP_OK);
+    CHECK(received.events.size() == 2);
+    CHECK(received.samples.empty());
+    CHECK(sensor.fifo_src_reads() == 0);
+}
+
+static void TestStreaming() {
+    SimulatedSc7a20h sensor;
+    Received received;
+    CHECK(sensor.Initialize() == ESP_OK);
+    sensor.OnFifoData([&](const Sc7a20hSample* samples, size_t count) {
+        std::lock_guard<std::mutex> lock(received.mutex);
+        received.samples.insert(received.samples.end(), samples, samples + count);
+    });
+
+    // 水位 8，没有中断引脚时每 80 ms 轮询一次
+    CHECK(sensor.StartStreaming(7, GPIO_NUM_NC) == ESP_OK);
+    CHECK(sensor.IsStreaming());
+    CHECK(sensor.Get(FIFO_CTRL_REG) == 0x87);
+    CHECK(sensor.Get(CTRL_REG5) & 0x40);
+    CHECK(sensor.Get(CTRL_REG3) & 0x04);
+
+    for (int i = 0; i < 20; i++) {
+        sensor.Push(Raw(i, -i, 1024 - i));
+    }
+    CHECK(received.WaitFor([&]() { return received.samples.size() == 20; }, 1000));
+    for (int i = 0; i < 20; i++) {
+        CHECK(received.samples[i].x == i && received.samples[i].y == -i && received.samples[i].z == 1024 - i);
+    }
+    CHECK(sensor.Stop() == ESP_OK);
+    CHECK(!sensor.IsStreaming());
+    CHECK(sensor.Get(FIFO_CTRL_REG) == 0);
+    CHECK(!(sensor.Get(CTRL_REG3) & 0x04));
+
+    // 溢出时只剩最新的 32 个样本，FSS 为 0 也要按 32 个读取
+    SimulatedSc7a20h overrun;
+    CHECK(overrun.Initialize() == ESP_OK);
+    CHECK(overrun.StartStreaming(31, GPIO_NUM_NC) == ESP_OK);
+    CHECK(overrun.Stop() == ESP_OK);
+    overrun.Set(CTRL_REG5, 0x4A);
+    overrun.Set(FIFO_CTRL_REG, 0x9F);
+    for (int i = 0; i < 40; i++) {
+        overrun.Push(Raw(i, 0, 0));
+    }
+    Sc7a20hSample samples[SC7A20H_FIFO_DEPTH];
+    CHECK(overrun.ReadFifo(samples, SC7A20H_FIFO_DEPTH) == SC7A20H_FIFO_DEPTH);
+    CHECK(samples[0].x == 8 && samples[SC7A20H_FIFO_DEPTH - 1].x == 39);
+    CHECK(overrun.ReadFifo(samples, SC7A20H_FIFO_DEPTH) == 0);
+}
+
+// 中断注册失败时退回轮询，事件照常上报
+static void TestInterruptFallback() {
+    SimulatedSc7a20h sensor;
+    Received received;
+    CHECK(sensor.Initialize() == ESP_OK);
+    sensor.ConfigureActivityInterrupt(250, 50);
+    sensor.OnEvent([&](Sc7a20hEvent event) {
+        std::lock_guard<std::mutex> lock(received.mutex);
+        received.events.push_back(event);
+    });
+
+    host_gpio_isr_handler_add_result = ESP_FAIL;
+    CHECK(sensor.StartEventMonitor(GPIO_NUM_5, 20) == ESP_OK);
+    host_gpio_isr_handler_add_result = ESP_OK;
+    sensor.Set(INT1_SRC_REG, 0x42);
+    CHECK(received.WaitFor([&]() { return received.events.size() == 1; }, 500));
+    CHECK(sensor.Stop() == ESP_OK);
+}
+
+// Stop 等读取任务完成正在进行的 I2C 事务并退出，之后不再访问寄存器
+static void TestStopWaitsForTask() {
+    SimulatedSc7a20h sensor;
+    CHECK(sensor.Initialize() == ESP_OK);
+    CHECK(sensor.StartStreaming(7, GPIO_NUM_NC) == ESP_OK);
+    sensor.read_delay_ms = 30;
+    Received waiter;
+    CHECK(waiter.WaitFor([&]() { return sensor.in_read.load(); }, 1000));
+    CHECK(sensor.Stop() == ESP_OK);
+    CHECK(!sensor.in_read);
+    int reads = sensor.reads;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(sensor.reads == reads);
+    CHECK(!sensor.IsStreaming());
+}
+
+int main() {
+    TestInitialize();
+    TestInterruptConfiguration();
+    TestEventMonitor();
+    TestStreaming();
+    TestInterruptFallback();
+    TestStopWaitsForTask();
+    printf("sc7a20h register map tests passed\n");
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "no_audio_processor.h"
+#include "simple_vad.h"
+#include "host_test.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+/*
+ * 轻量 VAD 与预录的主机测试，信号均为 16 kHz 合成：
+ * 浊音为 150 Hz 基频的谐波并带 4 Hz 幅度调制，清音起始为白噪声，环境噪声为高斯白噪声。
+ */
+
+static const int kSampleRate = 16000;
+static const int kChunkSamples = 480;  // NoAudioProcessor::GetFeedSize，30ms
+
+class Signal {
+public:
+    Signal() : rng_(1), normal_(0, 1) {}
+
+    void Noise(int ms, double rms) {
+        for (int i = 0; i < ms * kSampleRate / 1000; i++) {
+            Push(rms * normal_(rng_));
+        }
+    }
+
+    // 背景噪声上叠加浊音
+    void Voiced(int ms, double amplitude, double noise_rms) {
+        for (int i = 0; i < ms * kSampleRate / 1000; i++) {
+            double t = (double)samples_.size() / kSampleRate;
+            double s = 0;
+            for (int h = 1; h < 10; h++) {
+                s += sin(2 * M_PI * 150 * h * t) / h;
+            }
+            Push(amplitude * s * (1 + 0.5 * sin(2 * M_PI * 4 * t)) + noise_rms * normal_(rng_));
+        }
+    }
+
+    size_t size() const { return samples_.size(); }
+    const std::vector<int16_t>& samples() const { return samples_; }
+
+private:
+    std::mt19937 rng_;
+    std::normal_distribution<double> normal_;
+    std::vector<int16_t> samples_;
+
+    void Push(double value) {
+        samples_.push_back((int16_t)std::clamp(lrint(value), -32768L, 32767L));
+    }
+};
+
+struct VadTrace {
+    std::vector<bool> active;    // 每块的 Process 返回值
+    std::vector<bool> speaking;  // 每块之后的说话状态
+};
+
+static VadTrace RunVad(SimpleVad& vad, const std::vector<int16_t>& samples) {
+    VadTrace trace;
+    for (size_t offset = 0; offset + kChunkSamples <= samples.size(); offset += kChunkSamples) {
+        trace.active.push_back(vad.Process(samples.data() + offset, kChunkSamples));
+        trace.speaking.push_back(vad.speaking());
+    }
+    return trace;
+}
+
+static int FirstSpeaking(const VadTrace& trace) {
+    for (size_t i = 0; i < trace.speaking.size(); i++) {
+        if (trace.speaking[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int LastSpeaking(const VadTrace& trace) {
+    for (int i = trace.speaking.size() - 1; i >= 0; i--) {
+        if (trace.speaking[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 聆听开始时用户已经在说话（唤醒词后紧接着说），第一块就应判为语音
+static void TestSpeechAtStart() {
+    Signal signal;
+    signal.Voiced(1500, 3000, 30);
+    signal.Noise(1000, 30);
+    SimpleVad vad;
+    auto trace = RunVad(vad, signal.samples());
+    CHECK(FirstSpeaking(trace) == 0);
+    // 说话持续到语音结束，之后按拖尾时长退出
+    int speech_chunks = 1500 / 30;
+    CHECK(LastSpeaking(trace) >= speech_chunks - 1);
+    CHECK(LastSpeaking(trace) <= speech_chunks + 12);
+    printf("speech at start: speaking from chunk %d to %d (speech ends at chunk %d)\n",
+        FirstSpeaking(trace), LastSpeaking(trace), speech_chunks);
+}
+
+static void TestQuietRoom() {
+    Signal signal;
+    signal.Noise(3000, 30);
+    SimpleVad vad;
+    auto trace = RunVad(vad, signal.samples());
+    CHECK(FirstSpeaking(trace) < 0);
+    int active = 0;
+    for (bool a : trace.active) {
+        active += a;
+    }
+    CHECK(active == 0);
+}
+
+// 冷启动在较吵的环境：预热结束后底噪跟上，不会一直当作语音上传
+static void TestNoisyStart() {
+    Signal signal;
+    signal.Noise(5000, 1000);
+    signal.Voiced(1000, 6000, 1000);
+    signal.Noise(1000, 1000);
+    SimpleVad vad;
+    auto trace = RunVad(vad, signal.samples());
+    int last_noise_speaking = -1;
+    for (int i = 0; i < 5000 / 30; i++) {
+        if (trace.speaking[i]) {
+            last_noise_speaking = i;
+        }
+    }
+    // 预热 500ms 加拖尾 300ms 之内退出
+    CHECK(last_noise_speaking * 30 <= 900);
+    // 底噪跟上之后仍能检测到高出噪声的语音
+    int first = -1;
+    for (size_t i = 5000 / 30 + 1; i < trace.speaking.size(); i++) {
+        if (trace.speaking[i]) {
+            first = i;
+            break;
+        }
+    }
+    CHECK(first >= 0 && first <= 5000 / 30 + 3);
+    printf("noisy start (-30 dBFS): noise treated as speech until %d ms, speech detected at chunk %d\n",
+        (last_noise_speaking + 1) * 30, first);
+
+    // 同一环境再次开始聆听时保留底噪，第一块噪声就不再当作语音
+    vad.Reset();
+    Signal again;
+    again.Noise(1000, 1000);
+    auto second = RunVad(vad, again.samples());
+    CHECK(FirstSpeaking(second) < 0);
+}
+
+// 弱起的清音低于门限，浊音开始后预录把它按原样送出，时间轴保持连续
+static void TestPreRoll() {
+    Signal signal;
+    signal.Noise(990, 30);
+    size_t onset = signal.size();
+    signal.Noise(60, 150);
+    size_t voiced = signal.size();
+    signal.Voiced(600, 3000, 30);
+    signal.Noise(990, 30);
+    const auto& input = signal.samples();
+
+    // 单独的 VAD 不会把清音判为语音，没有预录时这段会被替换成静音
+    SimpleVad vad;
+    auto trace = RunVad(vad, input);
+    for (size_t chunk = onset / kChunkSamples; chunk < voiced / kChunkSamples; chunk++) {
+        CHECK(!trace.active[chunk]);
+    }
+
+    NoAudioProcessor processor;
+    std::vector<int16_t> output;
+    processor.OnOutput([&output](const int16_t* data, size_t samples) {
+        output.insert(output.end(), data, data + samples);
+    });
+    std::vector<bool> states;
+    processor.OnVadStateChange([&states](bool speaking) {
+        states.push_back(speaking);
+    });
+    processor.Start();
+    std::vector<int16_t> chunk(kChunkSamples);
+    for (size_t offset = 0; offset + kChunkSamples <= input.size(); offset += kChunkSamples) {
+        chunk.assign(input.begin() + offset, input.begin() + offset + kChunkSamples);
+        processor.Feed(chunk);
+    }
+    // 停止之前输出比输入晚三块
+    size_t fed = input.size() / kChunkSamples * kChunkSamples;
+    CHECK(output.size() == fed - 3 * kChunkSamples);
+    processor.Stop();
+
+    // 停止时缓冲中的三块送出，输出与输入逐个采样对齐
+    CHECK(output.size() == fed);
+    for (size_t i = onset; i < voiced + 3000; i++) {
+        CHECK(output[i] == input[i]);
+    }
+    // 语音前的安静段仍然送零
+    for (size_t i = 0; i + 3 * kChunkSamples < onset; i++) {
+        CHECK(output[i] == 0);
+    }
+    CHECK(states.size() == 2 && states[0] && !states[1]);
+    printf("pre-roll: %d ms soft onset before the voiced part kept intact\n",
+        (int)((voiced - onset) * 1000 / kSampleRate));
+}
+
+// 说话过程中停止聆听：缓冲中最后 90ms 的语音照常送出，下一次聆听不会再送出旧数据
+static void TestStopFlushesTail() {
+    Signal signal;
+    signal.Voiced(900, 3000, 30);
+    const auto& input = signal.samples();
+
+    NoAudioProcessor processor;
+    std::vector<int16_t> output;
+    processor.OnOutput([&output](const int16_t* data, size_t samples) {
+        output.insert(output.end(), data, data + samples);
+    });
+    processor.Start();
+    std::vector<int16_t> chunk(kChunkSamples);
+    for (size_t offset = 0; offset + kChunkSamples <= input.size(); offset += kChunkSamples) {
+        chunk.assign(input.begin() + offset, input.begin() + offset + kChunkSamples);
+        processor.Feed(chunk);
+    }
+    processor.Stop();
+
+    size_t fed = input.size() / kChunkSamples * kChunkSamples;
+    CHECK(output.size() == fed);
+    for (size_t i = fed - 3 * kChunkSamples; i < fed; i++) {
+        CHECK(output[i] == input[i]);
+    }
+
+    // 停止之后不再输出，再次开始时从新数据算起
+    processor.Feed(chunk);
+    CHECK(output.size() == fed);
+    processor.Start();
+    processor.Feed(chunk);
+    processor.Stop();
+    CHECK(output.size() == fed + kChunkSamples);
+}
+
+int main() {
+    TestSpeechAtStart();
+    TestQuietRoom();
+    TestNoisyStart();
+    TestPreRoll();
+    TestStopFlushesTail();
+    printf("simple vad tests passed\n");
+    return 0;
+}
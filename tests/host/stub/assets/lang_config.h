@@ -0,0 +1,6 @@
+#pragma once
+
+// 生成的语言配置中被通用模块用到的部分
+namespace Lang {
+    constexpr const char* CODE = "zh-CN";
+}
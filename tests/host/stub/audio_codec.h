@@ -0,0 +1,13 @@
+#pragma once
+
+// 音频编解码接口中被音频处理模块用到的部分
+class AudioCodec {
+public:
+    virtual ~AudioCodec() = default;
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+protected:
+    int input_sample_rate_ = 16000;
+    int output_sample_rate_ = 24000;
+};
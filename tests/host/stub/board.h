@@ -0,0 +1,20 @@
+#pragma once
+
+#include <http.h>
+#include <string>
+
+class Display;
+class LinkQualityMonitor;
+
+// 板级接口中被通用模块用到的部分，GetInstance 由测试提供
+class Board {
+public:
+    static Board& GetInstance();
+    virtual ~Board() = default;
+    virtual Display* GetDisplay() = 0;
+    virtual void SetPowerSaveMode(bool enabled) = 0;
+    virtual Http* CreateHttp() { return nullptr; }
+    virtual std::string GetJson() { return "{}"; }
+    virtual std::string GetUuid() { return "00000000-0000-0000-0000-000000000000"; }
+    virtual LinkQualityMonitor* GetLinkQualityMonitor() { return nullptr; }
+};
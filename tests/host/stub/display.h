@@ -0,0 +1,8 @@
+#pragma once
+
+// 显示接口中被通用模块用到的部分
+class Display {
+public:
+    virtual ~Display() = default;
+    virtual void SetRefreshPeriod(int period_ms) {}
+};
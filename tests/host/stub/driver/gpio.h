@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_attr.h"
+#include "esp_err.h"
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7,
+    GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14,
+    GPIO_NUM_15, GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21,
+} gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+
+typedef enum { GPIO_MODE_DISABLE, GPIO_MODE_INPUT, GPIO_MODE_OUTPUT } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void* arg);
+
+inline esp_err_t gpio_config(const gpio_config_t*) { return ESP_OK; }
+inline esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+// 测试用：设为错误码模拟中断注册失败
+inline esp_err_t host_gpio_isr_handler_add_result = ESP_OK;
+inline esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void*) { return host_gpio_isr_handler_add_result; }
+inline esp_err_t gpio_isr_handler_remove(gpio_num_t) { return ESP_OK; }
+inline esp_err_t gpio_set_level(gpio_num_t, uint32_t) { return ESP_OK; }
+inline int gpio_get_level(gpio_num_t) { return 0; }
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+typedef struct {
+    uint8_t magic;
+    uint8_t segment_count;
+    uint8_t reserved[22];
+} esp_image_header_t;
+
+typedef struct {
+    uint32_t load_addr;
+    uint32_t data_len;
+} esp_image_segment_header_t;
+
+typedef struct {
+    uint32_t magic_word;
+    uint32_t secure_version;
+    uint32_t reserv1[2];
+    char version[32];
+    char project_name[32];
+} esp_app_desc_t;
+
+// 由测试定义，version 为当前固件版本
+const esp_app_desc_t* esp_app_get_description();
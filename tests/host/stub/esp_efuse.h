@@ -0,0 +1,3 @@
+#pragma once
+
+// 主机上没有 eFuse，序列号相关代码不参与编译
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_EXEC     (1 << 0)
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+// 分配都来自系统堆，按请求的 caps 记账，测试用 HostHeapCapsUsed 检查内存放在哪里
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+
+// 当前仍未释放、且请求的 caps 包含 caps 的字节数
+size_t HostHeapCapsUsed(uint32_t caps);
+// 为 false 时 MALLOC_CAP_SPIRAM 的分配失败，模拟没有 PSRAM 的板子
+void HostHeapCapsSetSpiramAvailable(bool available);
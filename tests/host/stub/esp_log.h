@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdio>
+
+// HOST_LOG_VERBOSE 为 0 时只输出警告和错误，测试输出保持简洁
+#ifndef HOST_LOG_VERBOSE
+#define HOST_LOG_VERBOSE 0
+#endif
+
+#define HOST_LOG(level, tag, format, ...) fprintf(stderr, level " (%s): " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do { if (HOST_LOG_VERBOSE) HOST_LOG("I", tag, format, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, format, ...) do { if (HOST_LOG_VERBOSE) HOST_LOG("D", tag, format, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, format, ...) do { if (HOST_LOG_VERBOSE) HOST_LOG("V", tag, format, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <esp_err.h>
+
+#include <cstddef>
+#include <cstdint>
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+} esp_partition_t;
+
+// 数据分区的读写擦除，stub/host_partition.cc 中以内存模拟 NOR flash：写入只能把 1 变为 0，按扇区擦除为 0xFF
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+
+// 测试用：创建指定大小的数据分区，内容为未擦除的随机数据；重复创建同名分区时保留原有内容
+const esp_partition_t* HostPartitionCreate(const char* label, uint32_t size, uint32_t erase_size = 4096);
+// 直接访问分区内容，用于模拟损坏
+uint8_t* HostPartitionData(const esp_partition_t* partition);
+// 各扇区的擦除次数
+const int* HostPartitionEraseCounts(const esp_partition_t* partition);
+// 写入了未擦除区域（某一位需要从 0 变为 1）的次数，正确的驱动应当为 0
+int HostPartitionDirtyWrites();
@@ -0,0 +1,4 @@
+#pragma once
+
+// 由测试定义
+void esp_restart();
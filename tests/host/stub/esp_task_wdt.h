@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_err.h"
+
+// 任务看门狗在主机上不生效
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <esp_err.h>
+
+#include <cstdint>
+
+// 微秒时钟。默认跟随 steady_clock；冻结后只由 HostTimerAdvance 推进，便于模拟长时间运行
+int64_t esp_timer_get_time();
+
+void HostTimerSetFrozen(bool frozen);
+void HostTimerAdvance(int64_t us);
+
+// 单次定时器：每次启动用一个线程等待到期，回调在该线程中执行，按 steady_clock 计时
+typedef struct HostEspTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+// 等待中的线程仍可能引用定时器，删除后不释放
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+// 与 IDF 的 portmacro.h 一样间接提供 heap_caps 接口
+#include <esp_heap_caps.h>
+
+// 主机上的 FreeRTOS 替身：任务是 std::thread，1 tick = 1 ms，实现见 host_freertos.cc
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)0xffffffffu)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7fffffff
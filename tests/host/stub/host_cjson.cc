@@ -0,0 +1,451 @@
+#include "cJSON.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+
+namespace {
+
+cJSON* NewItem(int type) {
+    auto item = static_cast<cJSON*>(calloc(1, sizeof(cJSON)));
+    item->type = type;
+    return item;
+}
+
+void SkipWhitespace(const char*& p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+}
+
+void AppendUtf8(std::string& out, unsigned code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+bool ParseHex4(const char* p, unsigned& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseString(const char*& p, std::string& out) {
+    if (*p != '"') {
+        return false;
+    }
+    p++;
+    while (*p != '"') {
+        if (*p == '\0') {
+            return false;
+        }
+        if (*p != '\\') {
+            out += *p++;
+            continue;
+        }
+        p++;
+        switch (*p) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case '"': case '\\': case '/': out += *p; break;
+            case 'u': {
+                unsigned code;
+                if (!ParseHex4(p + 1, code)) {
+                    return false;
+                }
+                p += 4;
+                if (code >= 0xD800 && code < 0xDC00 && p[1] == '\\' && p[2] == 'u') {
+                    unsigned low;
+                    if (!ParseHex4(p + 3, low)) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                AppendUtf8(out, code);
+                break;
+            }
+            default:
+                return false;
+        }
+        p++;
+    }
+    p++;
+    return true;
+}
+
+cJSON* ParseValue(const char*& p, int depth) {
+    if (depth > 64) {
+        return nullptr;
+    }
+    SkipWhitespace(p);
+    if (*p == '{' || *p == '[') {
+        bool object = *p == '{';
+        char end = object ? '}' : ']';
+        cJSON* container = NewItem(object ? cJSON_Object : cJSON_Array);
+        p++;
+        SkipWhitespace(p);
+        if (*p == end) {
+            p++;
+            return container;
+        }
+        while (true) {
+            std::string key;
+            if (object) {
+                SkipWhitespace(p);
+                if (!ParseString(p, key)) {
+                    break;
+                }
+                SkipWhitespace(p);
+                if (*p++ != ':') {
+                    break;
+                }
+            }
+            cJSON* child = ParseValue(p, depth + 1);
+            if (child == nullptr) {
+                break;
+            }
+            if (object) {
+                cJSON_AddItemToObject(container, key.c_str(), child);
+            } else {
+                cJSON_AddItemToArray(container, child);
+            }
+            SkipWhitespace(p);
+            if (*p == ',') {
+                p++;
+                continue;
+            }
+            if (*p == end) {
+                p++;
+                return container;
+            }
+            break;
+        }
+        cJSON_Delete(container);
+        return nullptr;
+    }
+    if (*p == '"') {
+        std::string value;
+        if (!ParseString(p, value)) {
+            return nullptr;
+        }
+        return cJSON_CreateString(value.c_str());
+    }
+    if (strncmp(p, "true", 4) == 0) {
+        p += 4;
+        return cJSON_CreateTrue();
+    }
+    if (strncmp(p, "false", 5) == 0) {
+        p += 5;
+        return cJSON_CreateFalse();
+    }
+    if (strncmp(p, "null", 4) == 0) {
+        p += 4;
+        return cJSON_CreateNull();
+    }
+    char* end;
+    double number = strtod(p, &end);
+    if (end == p) {
+        return nullptr;
+    }
+    p = end;
+    return cJSON_CreateNumber(number);
+}
+
+void PrintString(const char* s, std::string& out) {
+    out += '"';
+    for (; *s; s++) {
+        unsigned char c = *s;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+void PrintNumber(double d, std::string& out) {
+    char buffer[32];
+    if (std::isnan(d) || std::isinf(d)) {
+        out += "null";
+        return;
+    }
+    // 与 cJSON 一致：整数原样输出，其余取能还原的最短表示
+    if (d == static_cast<double>(static_cast<long long>(d)) && std::fabs(d) < 1e15) {
+        snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(d));
+    } else {
+        snprintf(buffer, sizeof(buffer), "%1.15g", d);
+        if (strtod(buffer, nullptr) != d) {
+            snprintf(buffer, sizeof(buffer), "%1.17g", d);
+        }
+    }
+    out += buffer;
+}
+
+void PrintValue(const cJSON* item, std::string& out, bool formatted, int depth) {
+    switch (item->type & 0xFF) {
+        case cJSON_False: out += "false"; break;
+        case cJSON_True: out += "true"; break;
+        case cJSON_NULL: out += "null"; break;
+        case cJSON_Number: PrintNumber(item->valuedouble, out); break;
+        case cJSON_String: PrintString(item->valuestring, out); break;
+        case cJSON_Raw: out += item->valuestring; break;
+        case cJSON_Array:
+        case cJSON_Object: {
+            bool object = (item->type & 0xFF) == cJSON_Object;
+            out += object ? '{' : '[';
+            for (auto child = item->child; child; child = child->next) {
+                if (formatted && object) {
+                    out += '\n';
+                    out.append(depth + 1, '\t');
+                }
+                if (object) {
+                    PrintString(child->string ? child->string : "", out);
+                    out += formatted ? ":\t" : ":";
+                }
+                PrintValue(child, out, formatted, depth + 1);
+                if (child->next) {
+                    out += formatted && !object ? ", " : ",";
+                }
+            }
+            if (formatted && object && item->child) {
+                out += '\n';
+                out.append(depth, '\t');
+            }
+            out += object ? '}' : ']';
+            break;
+        }
+        default:
+            out += "null";
+    }
+}
+
+char* Print(const cJSON* item, bool formatted) {
+    if (item == nullptr) {
+        return nullptr;
+    }
+    std::string out;
+    PrintValue(item, out, formatted, 0);
+    return strdup(out.c_str());
+}
+
+cJSON* AddToObject(cJSON* object, const char* name, cJSON* item) {
+    if (object == nullptr || item == nullptr) {
+        cJSON_Delete(item);
+        return nullptr;
+    }
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+}  // namespace
+
+cJSON* cJSON_Parse(const char* value) {
+    if (value == nullptr) {
+        return nullptr;
+    }
+    const char* p = value;
+    cJSON* item = ParseValue(p, 0);
+    if (item == nullptr) {
+        return nullptr;
+    }
+    return item;
+}
+
+char* cJSON_Print(const cJSON* item) {
+    return Print(item, true);
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    return Print(item, false);
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item != nullptr) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void* object) {
+    free(object);
+}
+
+cJSON* cJSON_Duplicate(const cJSON* item, cJSON_bool recurse) {
+    if (item == nullptr) {
+        return nullptr;
+    }
+    cJSON* copy = NewItem(item->type);
+    copy->valueint = item->valueint;
+    copy->valuedouble = item->valuedouble;
+    copy->valuestring = item->valuestring ? strdup(item->valuestring) : nullptr;
+    copy->string = item->string ? strdup(item->string) : nullptr;
+    if (recurse) {
+        for (auto child = item->child; child; child = child->next) {
+            cJSON* child_copy = cJSON_Duplicate(child, true);
+            cJSON_AddItemToArray(copy, child_copy);
+        }
+    }
+    return copy;
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int size = 0;
+    for (auto child = array ? array->child : nullptr; child; child = child->next) {
+        size++;
+    }
+    return size;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    auto child = array ? array->child : nullptr;
+    while (child && index-- > 0) {
+        child = child->next;
+    }
+    return index > 0 ? nullptr : child;
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* string) {
+    for (auto child = object ? object->child : nullptr; child; child = child->next) {
+        if (child->string && strcasecmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object, const char* string) {
+    for (auto child = object ? object->child : nullptr; child; child = child->next) {
+        if (child->string && strcmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+cJSON_bool cJSON_IsInvalid(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Invalid; }
+cJSON_bool cJSON_IsFalse(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_False; }
+cJSON_bool cJSON_IsTrue(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_True; }
+cJSON_bool cJSON_IsBool(const cJSON* item) { return item && (item->type & (cJSON_True | cJSON_False)) != 0; }
+cJSON_bool cJSON_IsNull(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_NULL; }
+cJSON_bool cJSON_IsNumber(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Number; }
+cJSON_bool cJSON_IsString(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_String; }
+cJSON_bool cJSON_IsArray(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Object; }
+cJSON_bool cJSON_IsRaw(const cJSON* item) { return item && (item->type & 0xFF) == cJSON_Raw; }
+
+cJSON* cJSON_CreateNull(void) { return NewItem(cJSON_NULL); }
+cJSON* cJSON_CreateTrue(void) { return NewItem(cJSON_True); }
+cJSON* cJSON_CreateFalse(void) { return NewItem(cJSON_False); }
+cJSON* cJSON_CreateBool(cJSON_bool boolean) { return NewItem(boolean ? cJSON_True : cJSON_False); }
+cJSON* cJSON_CreateArray(void) { return NewItem(cJSON_Array); }
+cJSON* cJSON_CreateObject(void) { return NewItem(cJSON_Object); }
+
+cJSON* cJSON_CreateNumber(double num) {
+    cJSON* item = NewItem(cJSON_Number);
+    item->valuedouble = num;
+    // cJSON 对超出 int 范围的值取饱和
+    if (num >= 2147483647.0) {
+        item->valueint = 2147483647;
+    } else if (num <= -2147483648.0) {
+        item->valueint = -2147483647 - 1;
+    } else {
+        item->valueint = static_cast<int>(num);
+    }
+    return item;
+}
+
+cJSON* cJSON_CreateString(const char* string) {
+    cJSON* item = NewItem(cJSON_String);
+    item->valuestring = strdup(string ? string : "");
+    return item;
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    if (array == nullptr || item == nullptr) {
+        return 0;
+    }
+    if (array->child == nullptr) {
+        array->child = item;
+        item->prev = item;
+    } else {
+        // 与 cJSON 相同，首元素的 prev 指向末尾
+        cJSON* last = array->child->prev;
+        last->next = item;
+        item->prev = last;
+        array->child->prev = item;
+    }
+    item->next = nullptr;
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* string, cJSON* item) {
+    if (object == nullptr || string == nullptr || item == nullptr) {
+        return 0;
+    }
+    free(item->string);
+    item->string = strdup(string);
+    return cJSON_AddItemToArray(object, item);
+}
+
+cJSON* cJSON_AddNullToObject(cJSON* object, const char* name) { return AddToObject(object, name, cJSON_CreateNull()); }
+cJSON* cJSON_AddTrueToObject(cJSON* object, const char* name) { return AddToObject(object, name, cJSON_CreateTrue()); }
+cJSON* cJSON_AddFalseToObject(cJSON* object, const char* name) { return AddToObject(object, name, cJSON_CreateFalse()); }
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean) {
+    return AddToObject(object, name, cJSON_CreateBool(boolean));
+}
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    return AddToObject(object, name, cJSON_CreateNumber(number));
+}
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    return AddToObject(object, name, cJSON_CreateString(string));
+}
+cJSON* cJSON_AddObjectToObject(cJSON* object, const char* name) { return AddToObject(object, name, cJSON_CreateObject()); }
+cJSON* cJSON_AddArrayToObject(cJSON* object, const char* name) { return AddToObject(object, name, cJSON_CreateArray()); }
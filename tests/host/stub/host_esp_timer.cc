@@ -0,0 +1,94 @@
+#include <esp_timer.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const auto start_time = std::chrono::steady_clock::now();
+std::atomic<bool> frozen{false};
+std::atomic<int64_t> frozen_us{0};
+
+int64_t SteadyMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+} // namespace
+
+int64_t esp_timer_get_time() {
+    return frozen ? frozen_us.load() : SteadyMicros();
+}
+
+void HostTimerSetFrozen(bool value) {
+    if (value && !frozen) {
+        frozen_us = SteadyMicros();
+    }
+    frozen = value;
+}
+
+void HostTimerAdvance(int64_t us) {
+    frozen_us += us;
+}
+
+struct HostEspTimer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool active = false;
+    uint64_t generation = 0;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    auto timer = new HostEspTimer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    uint64_t generation = ++timer->generation;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+    std::thread([timer, generation, deadline]() {
+        std::unique_lock<std::mutex> lock(timer->mutex);
+        timer->cv.wait_until(lock, deadline, [timer, generation]() { return timer->generation != generation; });
+        if (timer->generation != generation || !timer->active) {
+            return;
+        }
+        timer->active = false;
+        lock.unlock();
+        timer->callback(timer->arg);
+    }).detach();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    timer->generation++;
+    timer->cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    esp_timer_stop(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    return timer->active;
+}
@@ -0,0 +1,194 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HostTask {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string name;
+    UBaseType_t priority = 0;
+    uint32_t notify_value = 0;
+    bool deleted = false;
+    bool exited = false;
+};
+
+namespace {
+
+// 被删除的任务在阻塞点抛出，由线程入口捕获后退出
+struct TaskDeleted {};
+
+thread_local HostTask* current_task = nullptr;
+const auto start_time = std::chrono::steady_clock::now();
+
+HostTask* CurrentTask() {
+    if (current_task == nullptr) {
+        // 主线程等非 FreeRTOS 线程第一次使用任务接口时登记
+        current_task = new HostTask();
+        current_task->name = "host";
+    }
+    return current_task;
+}
+
+// 在持有 task->mutex 时等待，超时返回 false，被删除时抛出 TaskDeleted
+template <typename Predicate>
+bool WaitFor(HostTask* task, std::unique_lock<std::mutex>& lock, TickType_t ticks, Predicate ready) {
+    auto done = [&]() { return task->deleted || ready(); };
+    bool ok;
+    if (ticks == portMAX_DELAY) {
+        task->cv.wait(lock, done);
+        ok = true;
+    } else {
+        ok = task->cv.wait_for(lock, std::chrono::milliseconds(ticks), done);
+    }
+    if (task->deleted) {
+        throw TaskDeleted();
+    }
+    return ok && ready();
+}
+
+}  // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+    auto task = new HostTask();
+    task->name = name ? name : "";
+    task->priority = priority;
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    std::thread([task, function, arg]() {
+        current_task = task;
+        try {
+            function(arg);
+        } catch (const TaskDeleted&) {
+        }
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->exited = true;
+        task->cv.notify_all();
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t) {
+    return xTaskCreate(function, name, stack_depth, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == current_task) {
+        throw TaskDeleted();
+    }
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->deleted = true;
+    task->cv.notify_all();
+    if (!task->cv.wait_for(lock, std::chrono::seconds(10), [task]() { return task->exited; })) {
+        fprintf(stderr, "task %s did not reach a blocking point after vTaskDelete\n", task->name.c_str());
+        abort();
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    auto task = CurrentTask();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    WaitFor(task, lock, ticks, []() { return false; });
+}
+
+TickType_t xTaskGetTickCount() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return CurrentTask();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return (task ? task : CurrentTask())->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    (task ? task : CurrentTask())->priority = priority;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notify_value++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    auto task = CurrentTask();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!WaitFor(task, lock, ticks_to_wait, [task]() { return task->notify_value > 0; })) {
+        return 0;
+    }
+    uint32_t value = task->notify_value;
+    task->notify_value = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto ready = [group, bits, wait_for_all]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    if (ticks_to_wait == portMAX_DELAY) {
+        group->cv.wait(lock, ready);
+    } else {
+        group->cv.wait_for(lock, std::chrono::milliseconds(ticks_to_wait), ready);
+    }
+    EventBits_t result = group->bits;
+    if (clear_on_exit && ready()) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
@@ -0,0 +1,87 @@
+#include <esp_heap_caps.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace {
+
+struct Allocation {
+    size_t size;
+    uint32_t caps;
+};
+
+std::mutex mutex;
+std::map<void*, Allocation> allocations;
+bool spiram_available = true;
+
+void* Track(void* ptr, size_t size, uint32_t caps) {
+    if (ptr != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        allocations[ptr] = { size, caps };
+    }
+    return ptr;
+}
+
+void Untrack(void* ptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    allocations.erase(ptr);
+}
+
+bool Fails(uint32_t caps) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (caps & MALLOC_CAP_SPIRAM) && !spiram_available;
+}
+
+} // namespace
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    if (Fails(caps)) {
+        return nullptr;
+    }
+    return Track(malloc(size), size, caps);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    if (Fails(caps)) {
+        return nullptr;
+    }
+    return Track(calloc(n, size), n * size, caps);
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    if (Fails(caps)) {
+        return nullptr;
+    }
+    Untrack(ptr);
+    return Track(realloc(ptr, size), size, caps);
+}
+
+void heap_caps_free(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    Untrack(ptr);
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? 8 * 1024 * 1024 : 256 * 1024;
+}
+
+size_t HostHeapCapsUsed(uint32_t caps) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t used = 0;
+    for (const auto& [ptr, allocation] : allocations) {
+        if (allocation.caps & caps) {
+            used += allocation.size;
+        }
+    }
+    return used;
+}
+
+void HostHeapCapsSetSpiramAvailable(bool available) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spiram_available = available;
+}
@@ -0,0 +1,139 @@
+#include <nvs_flash.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace {
+
+struct Value {
+    bool is_string;
+    std::string text;
+    int32_t number;
+};
+
+std::mutex mutex;
+std::map<std::string, std::map<std::string, Value>> namespaces;
+std::map<nvs_handle_t, std::string> handles;
+nvs_handle_t next_handle = 1;
+int writes = 0;
+
+std::map<std::string, Value>* Find(nvs_handle_t handle) {
+    auto it = handles.find(handle);
+    return it == handles.end() ? nullptr : &namespaces[it->second];
+}
+
+} // namespace
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (open_mode == NVS_READONLY && namespaces.find(name) == namespaces.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    namespaces[name];
+    *out_handle = next_handle++;
+    handles[*out_handle] = name;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto values = Find(handle);
+    if (values == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto it = values->find(key);
+    if (it == values->end() || !it->second.is_string) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    size_t required = it->second.text.size() + 1;
+    if (out_value != nullptr) {
+        if (*length < required) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(out_value, it->second.text.c_str(), required);
+    }
+    *length = required;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto values = Find(handle);
+    if (values == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    (*values)[key] = { true, value, 0 };
+    writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto values = Find(handle);
+    if (values == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto it = values->find(key);
+    if (it == values->end() || it->second.is_string) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out_value = it->second.number;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto values = Find(handle);
+    if (values == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    (*values)[key] = { false, "", value };
+    writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto values = Find(handle);
+    if (values == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (values->erase(key) == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto values = Find(handle);
+    if (values == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    values->clear();
+    writes++;
+    return ESP_OK;
+}
+
+void HostNvsReset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    namespaces.clear();
+    writes = 0;
+}
+
+int HostNvsWrites() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writes;
+}
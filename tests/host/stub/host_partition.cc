@@ -0,0 +1,120 @@
+#include <esp_partition.h>
+
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Partition {
+    esp_partition_t info;
+    std::vector<uint8_t> data;
+    std::vector<int> erase_counts;
+};
+
+std::mutex mutex;
+std::list<Partition> partitions;
+int dirty_writes = 0;
+
+Partition* Find(const esp_partition_t* partition) {
+    for (auto& p : partitions) {
+        if (&p.info == partition) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& p : partitions) {
+        if (p.info.type == type && (label == nullptr || strcmp(p.info.label, label) == 0)) {
+            return &p.info;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto p = Find(partition);
+    if (p == nullptr || src_offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, p->data.data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto p = Find(partition);
+    if (p == nullptr || dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto bytes = (const uint8_t*)src;
+    bool dirty = false;
+    for (size_t i = 0; i < size; i++) {
+        uint8_t& cell = p->data[dst_offset + i];
+        dirty = dirty || (bytes[i] & ~cell) != 0;
+        cell &= bytes[i];
+    }
+    dirty_writes += dirty ? 1 : 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto p = Find(partition);
+    const uint32_t sector = partition->erase_size;
+    if (p == nullptr || offset % sector != 0 || size % sector != 0 || offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(p->data.data() + offset, 0xFF, size);
+    for (size_t i = offset / sector; i < (offset + size) / sector; i++) {
+        p->erase_counts[i]++;
+    }
+    return ESP_OK;
+}
+
+const esp_partition_t* HostPartitionCreate(const char* label, uint32_t size, uint32_t erase_size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& p : partitions) {
+        if (strcmp(p.info.label, label) == 0) {
+            return &p.info;
+        }
+    }
+    Partition p = {};
+    p.info.type = ESP_PARTITION_TYPE_DATA;
+    p.info.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    p.info.size = size;
+    p.info.erase_size = erase_size;
+    strncpy(p.info.label, label, sizeof(p.info.label) - 1);
+    std::mt19937 rng(size);
+    p.data.resize(size);
+    for (auto& b : p.data) {
+        b = rng();
+    }
+    p.erase_counts.assign(size / erase_size, 0);
+    partitions.push_back(std::move(p));
+    return &partitions.back().info;
+}
+
+uint8_t* HostPartitionData(const esp_partition_t* partition) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Find(partition)->data.data();
+}
+
+const int* HostPartitionEraseCounts(const esp_partition_t* partition) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Find(partition)->erase_counts.data();
+}
+
+int HostPartitionDirtyWrites() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dirty_writes;
+}
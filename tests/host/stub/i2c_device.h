@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <driver/i2c_master.h>
+
+// 主机上没有 I2C 总线，驱动测试通过覆盖驱动自己的寄存器访问方法接入模拟寄存器表
+class I2cDevice {
+public:
+    I2cDevice(i2c_master_bus_handle_t, uint8_t addr) : addr_(addr) {}
+
+protected:
+    uint8_t addr_;
+
+    void WriteReg(uint8_t reg, uint8_t) { Unsupported(reg); }
+    uint8_t ReadReg(uint8_t reg) { Unsupported(reg); return 0; }
+    void ReadRegs(uint8_t reg, uint8_t*, size_t) { Unsupported(reg); }
+
+private:
+    void Unsupported(uint8_t reg) {
+        fprintf(stderr, "I2C access to 0x%02x/0x%02x on the host\n", addr_, reg);
+        abort();
+    }
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// 4G 模组组件中的传输层接口，测试用 POSIX socket 实现
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual bool Connect(const char* host, int port) = 0;
+    virtual void Disconnect() = 0;
+    virtual int Send(const char* data, size_t length) = 0;
+    virtual int Receive(char* buffer, size_t buffer_size) = 0;
+    bool connected() const { return connected_; }
+
+protected:
+    bool connected_ = false;
+};
@@ -0,0 +1,292 @@
+#include "tls_session_cache.h"
+#include "metrics.h"
+#include "host_test.h"
+
+#include <mbedtls/build_info.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/x509_crt.h>
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+#include <psa/crypto.h>
+#endif
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * TlsSessionCache 的会话恢复，客户端按 SocketTransport 的方式配置 mbedtls，对照进程内的 mbedtls TLS 1.2 服务器：
+ * - 服务器用 Session ID 缓存或 Session Ticket 恢复会话时，首次为完整握手，之后都是简化握手
+ * - 服务器不支持恢复时，客户端提供了缓存的会话也按完整握手统计
+ * 客户端的判断来自 tls.full_handshakes / tls.resumed_handshakes 计数，
+ * 服务器一侧按握手期间发出的字节数独立判断：完整握手要发送证书，简化握手发出的字节比证书还少。
+ */
+
+enum class Resumption {
+    kNone,
+    kSessionId,
+    kTicket,
+};
+
+static const int kConnections = 5;
+
+static std::string ReadFile(const char* name) {
+    std::string path = std::string(HOST_TEST_DATA_DIR) + "/" + name;
+    FILE* file = fopen(path.c_str(), "r");
+    CHECK(file != nullptr);
+    std::string content;
+    char buffer[1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, n);
+    }
+    fclose(file);
+    return content;
+}
+
+// 逐个处理连接：握手后把收到的数据原样发回，客户端关闭后接受下一个连接
+class TlsServer {
+public:
+    TlsServer(Resumption resumption) {
+        mbedtls_entropy_init(&entropy_);
+        mbedtls_ctr_drbg_init(&drbg_);
+        CHECK(mbedtls_ctr_drbg_seed(&drbg_, mbedtls_entropy_func, &entropy_, nullptr, 0) == 0);
+
+        mbedtls_x509_crt_init(&cert_);
+        mbedtls_pk_init(&key_);
+        // PEM 的长度需包含结尾的 '\0'
+        std::string cert = ReadFile("tls_test_cert.pem");
+        std::string key = ReadFile("tls_test_key.pem");
+        CHECK(mbedtls_x509_crt_parse(&cert_, (const unsigned char*)cert.c_str(), cert.size() + 1) == 0);
+        CHECK(mbedtls_pk_parse_key(&key_, (const unsigned char*)key.c_str(), key.size() + 1, nullptr, 0,
+            mbedtls_ctr_drbg_random, &drbg_) == 0);
+
+        mbedtls_ssl_config_init(&conf_);
+        CHECK(mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+            MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+        mbedtls_ssl_conf_rng(&conf_, mbedtls_ctr_drbg_random, &drbg_);
+        CHECK(mbedtls_ssl_conf_own_cert(&conf_, &cert_, &key_) == 0);
+        mbedtls_ssl_conf_max_tls_version(&conf_, MBEDTLS_SSL_VERSION_TLS1_2);
+
+        mbedtls_ssl_cache_init(&cache_);
+        mbedtls_ssl_ticket_init(&ticket_);
+        if (resumption == Resumption::kSessionId) {
+            mbedtls_ssl_conf_session_cache(&conf_, &cache_, mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+        } else if (resumption == Resumption::kTicket) {
+            CHECK(mbedtls_ssl_ticket_setup(&ticket_, mbedtls_ctr_drbg_random, &drbg_, MBEDTLS_CIPHER_AES_256_GCM,
+                86400) == 0);
+            mbedtls_ssl_conf_session_tickets_cb(&conf_, mbedtls_ssl_ticket_write, mbedtls_ssl_ticket_parse, &ticket_);
+        }
+
+        mbedtls_net_init(&listen_);
+        CHECK(mbedtls_net_bind(&listen_, "127.0.0.1", "0", MBEDTLS_NET_PROTO_TCP) == 0);
+        sockaddr_in address = {};
+        socklen_t length = sizeof(address);
+        getsockname(listen_.fd, (sockaddr*)&address, &length);
+        port_ = ntohs(address.sin_port);
+        thread_ = std::thread([this]() { Run(); });
+    }
+
+    ~TlsServer() {
+        // accept 返回错误后服务线程退出
+        shutdown(listen_.fd, SHUT_RDWR);
+        thread_.join();
+        mbedtls_net_free(&listen_);
+        mbedtls_ssl_ticket_free(&ticket_);
+        mbedtls_ssl_cache_free(&cache_);
+        mbedtls_ssl_config_free(&conf_);
+        mbedtls_pk_free(&key_);
+        mbedtls_x509_crt_free(&cert_);
+        mbedtls_ctr_drbg_free(&drbg_);
+        mbedtls_entropy_free(&entropy_);
+    }
+
+    int port() const { return port_; }
+    size_t certificate_size() const { return cert_.raw.len; }
+
+    // 每次成功握手期间服务器发出的字节数
+    std::vector<size_t> handshake_bytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return handshake_bytes_;
+    }
+
+private:
+    mbedtls_entropy_context entropy_;
+    mbedtls_ctr_drbg_context drbg_;
+    mbedtls_x509_crt cert_;
+    mbedtls_pk_context key_;
+    mbedtls_ssl_config conf_;
+    mbedtls_ssl_cache_context cache_;
+    mbedtls_ssl_ticket_context ticket_;
+    mbedtls_net_context listen_;
+    mbedtls_net_context client_;
+    int port_ = 0;
+    size_t sent_ = 0;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::vector<size_t> handshake_bytes_;
+
+    static int CountingSend(void* context, const unsigned char* data, size_t length) {
+        auto server = (TlsServer*)context;
+        int ret = mbedtls_net_send(&server->client_, data, length);
+        if (ret > 0) {
+            server->sent_ += ret;
+        }
+        return ret;
+    }
+
+    static int Receive(void* context, unsigned char* buffer, size_t length) {
+        auto server = (TlsServer*)context;
+        return mbedtls_net_recv(&server->client_, buffer, length);
+    }
+
+    void Run() {
+        while (true) {
+            mbedtls_net_init(&client_);
+            if (mbedtls_net_accept(&listen_, &client_, nullptr, 0, nullptr) != 0) {
+                mbedtls_net_free(&client_);
+                return;
+            }
+            Serve();
+            mbedtls_net_free(&client_);
+        }
+    }
+
+    void Serve() {
+        mbedtls_ssl_context ssl;
+        mbedtls_ssl_init(&ssl);
+        CHECK(mbedtls_ssl_setup(&ssl, &conf_) == 0);
+        mbedtls_ssl_set_bio(&ssl, this, CountingSend, Receive, nullptr);
+        sent_ = 0;
+        int ret;
+        while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+                break;
+            }
+        }
+        if (ret == 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                handshake_bytes_.push_back(sent_);
+            }
+            unsigned char buffer[256];
+            while ((ret = mbedtls_ssl_read(&ssl, buffer, sizeof(buffer))) > 0) {
+                CHECK(mbedtls_ssl_write(&ssl, buffer, ret) == ret);
+            }
+            mbedtls_ssl_close_notify(&ssl);
+        }
+        mbedtls_ssl_free(&ssl);
+    }
+};
+
+struct Handshakes {
+    uint32_t full;
+    uint32_t resumed;
+};
+
+static Handshakes Count() {
+    auto& metrics = Metrics::GetInstance();
+    return { metrics.Counter("tls.full_handshakes")->value(), metrics.Counter("tls.resumed_handshakes")->value() };
+}
+
+// 与 SocketTransport 相同的客户端配置（不验证服务器证书）：连接、握手、收发一次、关闭。返回握手耗时（微秒）
+static int64_t Exchange(TlsSessionCache& cache, int port, mbedtls_ctr_drbg_context* drbg) {
+    mbedtls_net_context net;
+    mbedtls_net_init(&net);
+    CHECK(mbedtls_net_connect(&net, "127.0.0.1", std::to_string(port).c_str(), MBEDTLS_NET_PROTO_TCP) == 0);
+
+    mbedtls_ssl_config conf;
+    mbedtls_ssl_config_init(&conf);
+    CHECK(mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+        MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, drbg);
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_init(&ssl);
+    CHECK(mbedtls_ssl_setup(&ssl, &conf) == 0);
+    mbedtls_ssl_set_hostname(&ssl, "localhost");
+    mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(cache.Handshake("127.0.0.1:" + std::to_string(port), &ssl));
+    auto connected = std::chrono::steady_clock::now();
+    CHECK(mbedtls_ssl_write(&ssl, (const unsigned char*)"ping", 4) == 4);
+    unsigned char buffer[8];
+    CHECK(mbedtls_ssl_read(&ssl, buffer, sizeof(buffer)) == 4);
+    CHECK(memcmp(buffer, "ping", 4) == 0);
+
+    mbedtls_ssl_close_notify(&ssl);
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_net_free(&net);
+    return std::chrono::duration_cast<std::chrono::microseconds>(connected - start).count();
+}
+
+// 每种服务器配置使用新的会话缓存，连接 kConnections 次，返回客户端统计的握手次数
+static Handshakes Run(const char* name, Resumption resumption, mbedtls_ctr_drbg_context* drbg) {
+    TlsSessionCache cache;
+    TlsServer server(resumption);
+    Handshakes before = Count();
+    int64_t first_us = Exchange(cache, server.port(), drbg);
+    int64_t later_us = 0;
+    for (int i = 1; i < kConnections; i++) {
+        later_us += Exchange(cache, server.port(), drbg);
+    }
+    Handshakes after = Count();
+    Handshakes result = { after.full - before.full, after.resumed - before.resumed };
+
+    // 服务器一侧：完整握手要发送证书，简化握手发出的字节比证书少
+    auto bytes = server.handshake_bytes();
+    CHECK(bytes.size() == kConnections);
+    uint32_t server_resumed = 0;
+    for (size_t sent : bytes) {
+        server_resumed += sent < server.certificate_size() ? 1 : 0;
+    }
+    CHECK(server_resumed == result.resumed);
+    CHECK(bytes[0] > server.certificate_size());
+
+    printf("%-10s full %u resumed %u, server sent %zu bytes first, %zu bytes last; handshake %lld us first, %lld us later\n",
+        name, result.full, result.resumed, bytes.front(), bytes.back(), (long long)first_us,
+        (long long)(later_us / (kConnections - 1)));
+    return result;
+}
+
+int main() {
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    CHECK(psa_crypto_init() == PSA_SUCCESS);
+#endif
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    CHECK(mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0) == 0);
+
+    auto handshakes = Run("session id", Resumption::kSessionId, &drbg);
+    CHECK(handshakes.full == 1 && handshakes.resumed == kConnections - 1);
+
+    // 服务器发 Ticket 时 Session ID 为空，恢复时沿用客户端随机生成的 ID，不能靠比较 ID 判断
+    handshakes = Run("ticket", Resumption::kTicket, &drbg);
+    CHECK(handshakes.full == 1 && handshakes.resumed == kConnections - 1);
+
+    // 客户端提供了缓存的会话，服务器拒绝恢复
+    handshakes = Run("none", Resumption::kNone, &drbg);
+    CHECK(handshakes.full == kConnections && handshakes.resumed == 0);
+
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+    printf("tls session cache tests passed\n");
+    return 0;
+}
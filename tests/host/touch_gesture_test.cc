@@ -0,0 +1,177 @@
+#include "touch_gesture.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * 用录制的 CST816 触摸序列回放 xingzhi-metal-1.54 的触摸任务。
+ * 手势配置、按键区域和唤醒规则与板级 TouchTask 相同，分别按 INT 唤醒和 50 ms 轮询两种方式回放，
+ * 两种方式得到的手势序列必须一致。
+ */
+
+// 控制器读数发生变化的时刻，num 为 0 表示手指离开
+struct TouchSample {
+    int64_t time_ms;
+    int num;
+    int x;
+    int y;
+};
+
+struct GestureEvent {
+    int64_t time_ms;
+    std::string name;
+};
+
+enum TouchKey {
+    kTouchKeyVolumeUp,
+    kTouchKeyChat,
+    kTouchKeyVolumeDown,
+};
+
+static constexpr int kTouchPollIntervalMs = 50;
+
+struct ReplayResult {
+    std::vector<GestureEvent> events;
+    int wakeups = 0;
+};
+
+static ReplayResult Replay(const std::vector<TouchSample>& trace, bool use_interrupt, int64_t end_ms) {
+    ReplayResult result;
+    TouchGestureConfig config;
+    config.tap_min_ms = 300;
+    config.long_press_ms = 4000;
+    config.repeat_delay_ms = 550;
+    config.repeat_interval_ms = 550;
+    TouchGestureEngine engine(config);
+    engine.AddZone(kTouchKeyVolumeUp, 20, 600, 20, 600);
+    engine.AddZone(kTouchKeyChat, 40, 600, 40, 600);
+    engine.AddZone(kTouchKeyVolumeDown, 60, 600, 60, 600);
+
+    int64_t now_ms = 0;
+    auto record = [&](const char* name) {
+        result.events.push_back({now_ms, name});
+    };
+    engine.OnGesture(kTouchKeyVolumeUp, kTouchGestureRepeat, [&]() { record("volume_up"); });
+    engine.OnGesture(kTouchKeyVolumeDown, kTouchGestureRepeat, [&]() { record("volume_down"); });
+    engine.OnGesture(kTouchKeyChat, kTouchGestureTap, [&]() { record("chat"); });
+    engine.OnGesture(kTouchKeyChat, kTouchGestureLongPress, [&]() { record("switch_network"); });
+
+    auto read_chip = [&](int64_t t) {
+        TouchSample current = {0, 0, 0, 0};
+        for (const auto& sample : trace) {
+            if (sample.time_ms > t) {
+                break;
+            }
+            current = sample;
+        }
+        return current;
+    };
+    auto next_interrupt = [&](int64_t t) -> int64_t {
+        for (const auto& sample : trace) {
+            if (sample.time_ms > t) {
+                return sample.time_ms;
+            }
+        }
+        return -1;
+    };
+
+    bool notified = true;
+    while (now_ms < end_ms) {
+        result.wakeups++;
+        if (notified || engine.IsTouching() || !use_interrupt) {
+            auto tp = read_chip(now_ms);
+            engine.Feed(now_ms, tp.num > 0, tp.x, tp.y);
+        } else {
+            engine.Tick(now_ms);
+        }
+
+        int timeout_ms = engine.GetNextTimeoutMs(now_ms);
+        if (engine.IsTouching() || !use_interrupt) {
+            if (timeout_ms < 0 || timeout_ms > kTouchPollIntervalMs) {
+                timeout_ms = kTouchPollIntervalMs;
+            }
+        }
+        int64_t interrupt_ms = use_interrupt ? next_interrupt(now_ms) : -1;
+        if (timeout_ms < 0 && interrupt_ms < 0) {
+            break;
+        }
+        notified = interrupt_ms >= 0 && (timeout_ms < 0 || interrupt_ms <= now_ms + timeout_ms);
+        now_ms = notified ? interrupt_ms : now_ms + timeout_ms;
+    }
+    return result;
+}
+
+static std::vector<std::string> Names(const ReplayResult& result) {
+    std::vector<std::string> names;
+    for (const auto& event : result.events) {
+        names.push_back(event.name);
+    }
+    return names;
+}
+
+static void ExpectGestures(const char* name, const std::vector<TouchSample>& trace,
+                           const std::vector<std::string>& expected) {
+    int64_t end_ms = trace.back().time_ms + 5000;
+    auto interrupt = Replay(trace, true, end_ms);
+    auto polling = Replay(trace, false, end_ms);
+    printf("%-24s %zu gestures, %d wakeups with INT, %d polling\n",
+        name, interrupt.events.size(), interrupt.wakeups, polling.wakeups);
+    CHECK(Names(interrupt) == expected);
+    CHECK(Names(polling) == expected);
+    // 轮询只会让手势推迟一个轮询周期
+    for (size_t i = 0; i < expected.size(); i++) {
+        int64_t delay = polling.events[i].time_ms - interrupt.events[i].time_ms;
+        CHECK(delay >= 0 && delay <= kTouchPollIntervalMs);
+    }
+    CHECK(interrupt.wakeups < polling.wakeups);
+}
+
+int main() {
+    // 单击对话键 420 ms
+    ExpectGestures("chat tap", {
+        {1000, 1, 40, 600}, {1420, 0, 0, 0},
+    }, {"chat"});
+
+    // 抖动：按下 30 ms 与 120 ms，都短于 tap_min_ms
+    ExpectGestures("bounce", {
+        {1000, 1, 40, 600}, {1030, 0, 0, 0},
+        {2000, 1, 40, 600}, {2120, 0, 0, 0},
+    }, {});
+
+    // 按住音量加 1.8 s：按下立即一次，之后每 550 ms 一次
+    ExpectGestures("volume up held", {
+        {500, 1, 20, 600}, {2300, 0, 0, 0},
+    }, {"volume_up", "volume_up", "volume_up", "volume_up"});
+
+    // 短按音量减只触发一次
+    ExpectGestures("volume down short", {
+        {500, 1, 60, 600}, {600, 0, 0, 0},
+    }, {"volume_down"});
+
+    // 长按对话键 4.6 s 切换网络，松开后不再触发单击
+    ExpectGestures("chat long press", {
+        {200, 1, 40, 600}, {4800, 0, 0, 0},
+    }, {"switch_network"});
+
+    // 屏幕区域没有绑定手势，包括滑动
+    ExpectGestures("screen swipe", {
+        {100, 1, 120, 120}, {150, 1, 160, 118}, {200, 1, 200, 117}, {260, 0, 0, 0},
+    }, {});
+
+    // 连续两次单击，间隔大于双击窗口，各自触发
+    ExpectGestures("two chat taps", {
+        {1000, 1, 40, 600}, {1350, 0, 0, 0},
+        {1900, 1, 40, 600}, {2250, 0, 0, 0},
+    }, {"chat", "chat"});
+
+    // 从音量加滑到对话键：按下时所在的区域决定手势，离开后不再重复
+    ExpectGestures("slide between keys", {
+        {1000, 1, 20, 600}, {1300, 1, 40, 600}, {1400, 0, 0, 0},
+    }, {"volume_up"});
+
+    printf("all touch sequences passed\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "tts_cache.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+/*
+ * 句子级 TTS 缓存的主机测试，tts_cache 分区由内存中的 NOR flash 模拟（写入只能把 1 变为 0，按扇区擦除）：
+ * - 第二次完整下发时才保存，不可写时记录保留在内存中，空闲后写入
+ * - 常用句子与大量只出现两次的句子混合写入，环形日志反复回绕，中途多次模拟重启重新扫描
+ * - 统计常用句子的命中率和各扇区擦除次数的差值，记录损坏时丢弃
+ * - 命中的帧按传入的起始时间戳依次编号
+ */
+
+static const int kSampleRate = 24000;
+static const int kFrameDuration = 60;
+
+// 直接驱动扫描和写入，代替设备上的写入任务
+class TtsCacheTest {
+public:
+    static TtsCache* Boot(const esp_partition_t* partition) {
+        auto cache = new TtsCache();
+        cache->partition_ = partition;
+        cache->Scan();
+        cache->ready_ = true;
+        return cache;
+    }
+
+    static void Drain(TtsCache& cache) {
+        cache.writable_ = true;
+        while (!cache.pending_.empty()) {
+            CHECK(cache.WriteRecord(cache.pending_.front()));
+            cache.pending_.pop_front();
+        }
+        // 没有写入任务，之后不再通知它
+        cache.writable_ = false;
+    }
+
+    static size_t Pending(TtsCache& cache) { return cache.pending_.size(); }
+    static uint32_t Head(TtsCache& cache) { return cache.head_; }
+    static uint32_t Sequence(TtsCache& cache) { return cache.sequence_; }
+    static std::map<uint64_t, uint32_t> Entries(TtsCache& cache) {
+        std::map<uint64_t, uint32_t> offsets;
+        for (auto& [key, entry] : cache.entries_) {
+            offsets[key] = entry.offset;
+        }
+        return offsets;
+    }
+    static bool WriteFirstPending(TtsCache& cache) { return cache.WriteRecord(cache.pending_.front()); }
+};
+
+// 由键确定的一句话：5~64 帧，每帧 40~199 字节
+static std::vector<AudioStreamPacket> Sentence(uint64_t key) {
+    std::mt19937 rng(key);
+    int count = 5 + rng() % 60;
+    std::vector<AudioStreamPacket> frames(count);
+    for (auto& frame : frames) {
+        frame.sample_rate = kSampleRate;
+        frame.frame_duration = kFrameDuration;
+        frame.payload.resize(40 + rng() % 160);
+        for (auto& b : frame.payload) {
+            b = rng();
+        }
+    }
+    return frames;
+}
+
+static void Stream(TtsCache& cache, uint64_t key) {
+    cache.BeginSentence(key);
+    for (auto& frame : Sentence(key)) {
+        cache.AppendFrame(frame);
+    }
+    cache.EndSentence();
+}
+
+static bool Play(TtsCache& cache, uint64_t key, uint32_t timestamp = 1000) {
+    std::list<AudioStreamPacket> packets;
+    if (!cache.Lookup(key, timestamp, packets)) {
+        return false;
+    }
+    auto expected = Sentence(key);
+    CHECK(packets.size() == expected.size());
+    auto it = packets.begin();
+    for (auto& frame : expected) {
+        CHECK(it->payload == frame.payload);
+        CHECK(it->sample_rate == kSampleRate && it->frame_duration == kFrameDuration);
+        CHECK(it->timestamp == timestamp);
+        timestamp += kFrameDuration;
+        ++it;
+    }
+    return true;
+}
+
+static const esp_partition_t* partition;
+
+static void TestAdmission(TtsCache& cache) {
+    CHECK(cache.MakeKey("", kSampleRate, "你好") == cache.MakeKey("", kSampleRate, "你好"));
+    CHECK(cache.MakeKey("a", kSampleRate, "你好") != cache.MakeKey("b", kSampleRate, "你好"));
+    CHECK(TtsCache::KeyToString(0x3f2a9c).size() == 16);
+
+    // 第一次出现不保存，第二次保存，写入前从内存播放
+    Stream(cache, 1);
+    TtsCacheTest::Drain(cache);
+    CHECK(!Play(cache, 1));
+    Stream(cache, 1);
+    CHECK(TtsCacheTest::Pending(cache) == 1);
+    CHECK(Play(cache, 1, 60));
+    Stream(cache, 1);
+    CHECK(TtsCacheTest::Pending(cache) == 1);
+    TtsCacheTest::Drain(cache);
+    CHECK(Play(cache, 1));
+
+    // 不可写时记录保留，之后写入
+    Stream(cache, 2);
+    Stream(cache, 2);
+    CHECK(!TtsCacheTest::WriteFirstPending(cache));
+    TtsCacheTest::Drain(cache);
+    CHECK(Play(cache, 2, 0xFFFFFFF0));
+}
+
+// 10 句常用语占三分之一，其余为 400 句中随机抽取；每 700 轮模拟一次重启
+static TtsCache* TestChurn(TtsCache* cache) {
+    std::mt19937 rng(1);
+    int popular_hits = 0;
+    int popular_lookups = 0;
+    int reboots = 0;
+    for (int round = 0; round < 3000; round++) {
+        uint64_t key = round % 3 == 0 ? 100 + rng() % 10 : 1000 + rng() % 400;
+        bool hit = Play(*cache, key);
+        if (!hit) {
+            Stream(*cache, key);
+        }
+        if (key < 200 && round > 300) {
+            popular_lookups++;
+            popular_hits += hit ? 1 : 0;
+        }
+        if (round % 5 == 0) {
+            TtsCacheTest::Drain(*cache);
+        }
+        if (round % 700 == 699) {
+            TtsCacheTest::Drain(*cache);
+            auto entries = TtsCacheTest::Entries(*cache);
+            uint32_t head = TtsCacheTest::Head(*cache);
+            uint32_t sequence = TtsCacheTest::Sequence(*cache);
+            delete cache;
+            cache = TtsCacheTest::Boot(partition);
+            CHECK(TtsCacheTest::Head(*cache) == head);
+            CHECK(TtsCacheTest::Sequence(*cache) == sequence);
+            CHECK(TtsCacheTest::Entries(*cache) == entries);
+            for (auto& entry : entries) {
+                CHECK(Play(*cache, entry.first));
+            }
+            reboots++;
+        }
+    }
+    TtsCacheTest::Drain(*cache);
+
+    auto erases = HostPartitionEraseCounts(partition);
+    auto sectors = partition->size / partition->erase_size;
+    int min_erases = *std::min_element(erases, erases + sectors);
+    int max_erases = *std::max_element(erases, erases + sectors);
+    printf("churn: %d reboots, %zu sentences cached, popular hit rate %d/%d, sector erases %d..%d\n",
+        reboots, TtsCacheTest::Entries(*cache).size(), popular_hits, popular_lookups, min_erases, max_erases);
+    CHECK(popular_hits * 10 > popular_lookups * 9);
+    CHECK(max_erases - min_erases <= 4);
+    CHECK(HostPartitionDirtyWrites() == 0);
+    return cache;
+}
+
+// 负载中的一个字节翻转后校验失败，记录被丢弃
+static void TestCorruption(TtsCache& cache) {
+    auto entries = TtsCacheTest::Entries(cache);
+    CHECK(!entries.empty());
+    auto [key, offset] = *entries.begin();
+    HostPartitionData(partition)[offset + 40] ^= 0xFF;
+    CHECK(!Play(cache, key));
+    CHECK(TtsCacheTest::Entries(cache).count(key) == 0);
+}
+
+int main() {
+    partition = HostPartitionCreate("tts_cache", 256 * 1024);
+    auto cache = TtsCacheTest::Boot(partition);
+    CHECK(TtsCacheTest::Entries(*cache).empty() && TtsCacheTest::Head(*cache) == 0);
+
+    TestAdmission(*cache);
+    cache = TestChurn(cache);
+    TestCorruption(*cache);
+    delete cache;
+    printf("tts cache tests passed\n");
+    return 0;
+}
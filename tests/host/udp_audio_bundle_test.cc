@@ -0,0 +1,241 @@
+#include "udp_audio_bundle.h"
+#include "host_test.h"
+
+#include <vector>
+
+/*
+ * MQTT + UDP 音频通道多帧合并的主机测试：
+ * - 合并后拆包得到原来的帧，时间戳按帧长递增，序号每帧加一
+ * - 下一帧会让包超过路径 MTU 时提前发出，单帧超过 MTU 时单独发出
+ * - Flush 发出不足设定帧数的包，Reset 后序号从头计数
+ * - 合并与逐帧发送在线上（包头 16 字节 + IP/UDP 28 字节）的字节数对比
+ * - 截断的合并包被整体拒绝
+ */
+
+static const int kFrameDuration = 60;
+static const size_t kHeaderSize = 16;
+
+struct Datagram {
+    uint8_t flags;
+    uint32_t timestamp;
+    uint32_t sequence;
+    std::vector<uint8_t> payload;
+};
+
+// 记录发送回调收到的包
+class Recorder {
+public:
+    std::vector<Datagram> datagrams;
+
+    UdpAudioBundler::Sender Sender() {
+        return [this](uint8_t flags, uint32_t timestamp, uint32_t sequence, const uint8_t* payload, size_t size) {
+            datagrams.push_back(Datagram{ flags, timestamp, sequence, std::vector<uint8_t>(payload, payload + size) });
+            return true;
+        };
+    }
+
+    size_t WireBytes() const {
+        size_t bytes = 0;
+        for (auto& datagram : datagrams) {
+            bytes += datagram.payload.size() + kHeaderSize + MQTT_UDP_IP_HEADER_SIZE;
+        }
+        return bytes;
+    }
+};
+
+// 按帧长生成时间戳连续的帧，大小在 size 附近变化，大致对应 16 kbps 的 VBR
+static std::vector<AudioStreamPacket> MakePackets(int count, size_t size) {
+    std::vector<AudioStreamPacket> packets(count);
+    for (int i = 0; i < count; i++) {
+        packets[i].timestamp = 1000 + i * kFrameDuration;
+        packets[i].payload.resize(size + (i * 37) % 41 - 20);
+        for (size_t j = 0; j < packets[i].payload.size(); j++) {
+            packets[i].payload[j] = (uint8_t)(i + j);
+        }
+    }
+    return packets;
+}
+
+// 把收到的包拆开，检查每帧的负载、时间戳和序号与发送的帧一致
+static void CheckReceived(const Recorder& recorder, const std::vector<AudioStreamPacket>& sent) {
+    size_t index = 0;
+    for (auto& datagram : recorder.datagrams) {
+        std::vector<AudioStreamPacket> frames;
+        if (datagram.flags & MQTT_UDP_FLAG_BUNDLE) {
+            CHECK(UdpAudioBundler::Unpack(datagram.payload.data(), datagram.payload.size(), datagram.timestamp, 16000,
+                kFrameDuration, frames));
+        } else {
+            AudioStreamPacket packet;
+            packet.timestamp = datagram.timestamp;
+            packet.payload = datagram.payload;
+            frames.push_back(packet);
+        }
+        CHECK(datagram.sequence == index + 1);
+        for (auto& frame : frames) {
+            CHECK(index < sent.size());
+            CHECK(frame.timestamp == sent[index].timestamp);
+            CHECK(frame.payload == sent[index].payload);
+            index++;
+        }
+    }
+    CHECK(index == sent.size());
+}
+
+static void TestRoundTrip() {
+    auto packets = MakePackets(10, 120);
+    Recorder recorder;
+    UdpAudioBundler bundler(recorder.Sender());
+    CHECK(bundler.Configure(3, MQTT_UDP_PATH_MTU_WIFI - MQTT_UDP_IP_HEADER_SIZE - kHeaderSize));
+    for (auto& packet : packets) {
+        CHECK(bundler.Add(packet));
+    }
+    // 最后一帧等待合并，Flush 后发出
+    CHECK(recorder.datagrams.size() == 3);
+    CHECK(bundler.Flush());
+    CHECK(recorder.datagrams.size() == 4);
+    CHECK(recorder.datagrams.back().sequence == 10);
+    CheckReceived(recorder, packets);
+
+    std::vector<AudioStreamPacket> frames;
+    UdpAudioBundler::Unpack(recorder.datagrams[1].payload.data(), recorder.datagrams[1].payload.size(),
+        recorder.datagrams[1].timestamp, 24000, kFrameDuration, frames);
+    CHECK(frames.size() == 3);
+    CHECK(frames[2].sample_rate == 24000 && frames[2].frame_duration == kFrameDuration);
+
+    // 新会话的序号从 1 开始，未发出的帧丢弃
+    CHECK(bundler.Add(packets[0]));
+    bundler.Reset();
+    recorder.datagrams.clear();
+    for (auto& packet : packets) {
+        CHECK(bundler.Add(packet));
+    }
+    CHECK(bundler.Flush());
+    CheckReceived(recorder, packets);
+}
+
+// 不合并时每帧一个包，序号逐帧递增
+static void TestUnbundled() {
+    auto packets = MakePackets(5, 80);
+    Recorder recorder;
+    UdpAudioBundler bundler(recorder.Sender());
+    CHECK(bundler.Configure(1, MQTT_UDP_PATH_MTU_WIFI - MQTT_UDP_IP_HEADER_SIZE - kHeaderSize));
+    for (auto& packet : packets) {
+        CHECK(bundler.Add(packet));
+    }
+    CHECK(recorder.datagrams.size() == 5);
+    for (auto& datagram : recorder.datagrams) {
+        CHECK(datagram.flags == 0);
+    }
+    CheckReceived(recorder, packets);
+}
+
+static void TestMtuCap() {
+    for (size_t mtu : { (size_t)MQTT_UDP_PATH_MTU_WIFI, (size_t)MQTT_UDP_PATH_MTU_4G }) {
+        size_t max_size = mtu - MQTT_UDP_IP_HEADER_SIZE - kHeaderSize;
+        auto packets = MakePackets(40, 300);
+        Recorder recorder;
+        UdpAudioBundler bundler(recorder.Sender());
+        CHECK(bundler.Configure(10, max_size));
+        for (auto& packet : packets) {
+            CHECK(bundler.Add(packet));
+        }
+        CHECK(bundler.Flush());
+        for (size_t i = 0; i < recorder.datagrams.size(); i++) {
+            auto& datagram = recorder.datagrams[i];
+            CHECK(datagram.payload.size() <= max_size);
+            CHECK(datagram.payload.size() + kHeaderSize + MQTT_UDP_IP_HEADER_SIZE <= mtu);
+            // 提前发出的包再加下一帧就会超过 MTU
+            if (i + 1 < recorder.datagrams.size()) {
+                auto& next = packets[recorder.datagrams[i + 1].sequence - 1];
+                CHECK(datagram.payload.size() + 2 + next.payload.size() > max_size);
+            }
+        }
+        CheckReceived(recorder, packets);
+    }
+
+    // 单帧超过 MTU 时仍然发出，不与其他帧合并
+    auto packets = MakePackets(3, 100);
+    packets[1].payload.resize(600);
+    Recorder recorder;
+    UdpAudioBundler bundler(recorder.Sender());
+    CHECK(bundler.Configure(3, 500));
+    for (auto& packet : packets) {
+        CHECK(bundler.Add(packet));
+    }
+    CHECK(bundler.Flush());
+    CHECK(recorder.datagrams.size() == 3);
+    CHECK(recorder.datagrams[1].payload.size() == 602);
+    CheckReceived(recorder, packets);
+}
+
+// 10 分钟的上行音频，合并与逐帧发送的线上字节数
+static void TestBytesSaved() {
+    auto packets = MakePackets(10 * 60 * 1000 / kFrameDuration, 120);
+    size_t opus_bytes = 0;
+    for (auto& packet : packets) {
+        opus_bytes += packet.payload.size();
+    }
+
+    Recorder single;
+    UdpAudioBundler unbundled(single.Sender());
+    unbundled.Configure(1, MQTT_UDP_PATH_MTU_WIFI - MQTT_UDP_IP_HEADER_SIZE - kHeaderSize);
+    for (auto& packet : packets) {
+        unbundled.Add(packet);
+    }
+    CHECK(single.WireBytes() == opus_bytes + packets.size() * (kHeaderSize + MQTT_UDP_IP_HEADER_SIZE));
+
+    for (int frames : { 2, 3, 5 }) {
+        Recorder recorder;
+        UdpAudioBundler bundler(recorder.Sender());
+        bundler.Configure(frames, MQTT_UDP_PATH_MTU_WIFI - MQTT_UDP_IP_HEADER_SIZE - kHeaderSize);
+        for (auto& packet : packets) {
+            bundler.Add(packet);
+        }
+        bundler.Flush();
+        CheckReceived(recorder, packets);
+        // 每少一个包省下包头和 IP/UDP 头，每帧多出 2 字节长度前缀
+        size_t datagrams = (packets.size() + frames - 1) / frames;
+        CHECK(recorder.datagrams.size() == datagrams);
+        CHECK(recorder.WireBytes() == opus_bytes + datagrams * (kHeaderSize + MQTT_UDP_IP_HEADER_SIZE) +
+            packets.size() * 2);
+        CHECK(recorder.WireBytes() < single.WireBytes());
+        double seconds = packets.size() * kFrameDuration / 1000.0;
+        printf("%d frames per datagram: %zu datagrams, %zu bytes vs %zu unbundled (%.2f kbps saved)\n", frames,
+            datagrams, recorder.WireBytes(), single.WireBytes(),
+            (single.WireBytes() - recorder.WireBytes()) * 8 / seconds / 1000);
+    }
+}
+
+static void TestMalformed() {
+    auto packets = MakePackets(3, 50);
+    Recorder recorder;
+    UdpAudioBundler bundler(recorder.Sender());
+    bundler.Configure(3, 1000);
+    for (auto& packet : packets) {
+        bundler.Add(packet);
+    }
+    CHECK(recorder.datagrams.size() == 1);
+    auto& payload = recorder.datagrams[0].payload;
+    std::vector<AudioStreamPacket> frames;
+    for (size_t length = 1; length < payload.size(); length++) {
+        // 截断处恰好落在帧边界时前面的帧是完整的
+        bool boundary = length == packets[0].payload.size() + 2 ||
+            length == packets[0].payload.size() + packets[1].payload.size() + 4;
+        CHECK(UdpAudioBundler::Unpack(payload.data(), length, 0, 16000, kFrameDuration, frames) == boundary);
+        if (!boundary) {
+            CHECK(frames.empty());
+        }
+    }
+    CHECK(UdpAudioBundler::Unpack(payload.data(), payload.size(), 0, 16000, kFrameDuration, frames));
+    CHECK(frames.size() == 3);
+}
+
+int main() {
+    TestRoundTrip();
+    TestUnbundled();
+    TestMtuCap();
+    TestBytesSaved();
+    TestMalformed();
+    printf("udp audio bundle tests passed\n");
+    return 0;
+}